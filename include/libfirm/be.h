@@ -98,6 +98,18 @@ typedef void (*after_transform_func)(ir_graph *irg, const char *name);
  */
 FIRM_API void be_set_after_transform_func(after_transform_func func);
 
+typedef void (*before_codegen_func)(ir_graph *irg);
+
+/**
+ * Sets a callback that is called by be_main() right before code is generated
+ * for a graph, which is already lowered for the target then. With the backend
+ * option freeirgs, graphs are handed over in reverse topological order of the
+ * callgraph and each graph is freed right after its code is emitted. This
+ * allows whole-program passes to finish graphs one at a time and bounds the
+ * memory to the graphs not compiled yet.
+ */
+FIRM_API void be_set_before_codegen_func(before_codegen_func func);
+
 /**
  * Main interface to the frontend.
  */
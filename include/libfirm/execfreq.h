@@ -37,6 +37,41 @@ FIRM_API void ir_estimate_execfreq(ir_graph *irg);
 /** Returns execution frequency of block @p block. */
 FIRM_API double get_block_execfreq(const ir_node *block);
 
+/**
+ * Instruments all graphs of the program with profile code, which counts the
+ * executions of each block and records the most frequent callees of indirect
+ * Calls. If @p profile_operands is set, the most frequent divisors of Div and
+ * Mod and selectors of Switch nodes are recorded, too. The profile is written
+ * to @p filename when the program exits.
+ *
+ * Blocks and profiling sites are identified by their order, so the profile
+ * must be read by ir_profile_read() at the same point of the compilation
+ * pipeline as the instrumentation took place. The backend options
+ * "profilegenerate" and "profileuse" do both after target lowering, calling
+ * both functions before optimizing makes the profile available to the
+ * middle end, e.g. for promote_indirect_calls() and form_superblocks().
+ *
+ * @return the graph of the constructor, which registers the counters with
+ *         the profiling runtime library
+ */
+FIRM_API ir_graph *ir_profile_instrument(const char *filename,
+                                         int profile_operands);
+
+/**
+ * Reads the profile written by a program instrumented with
+ * ir_profile_instrument().
+ *
+ * @param filename  the name of the file containing the profile
+ * @return non-zero if the profile was read
+ */
+FIRM_API int ir_profile_read(const char *filename);
+
+/** Frees the profile read by ir_profile_read(). */
+FIRM_API void ir_profile_free(void);
+
+/** Sets the execution frequencies of all graphs from the profile. */
+FIRM_API void ir_create_execfreqs_from_profile(void);
+
 /** @} */
 
 #include "end.h"
@@ -69,6 +69,14 @@ FIRM_API const char *get_id_str(ident *id);
  */
 FIRM_API ident *id_unique(const char *tag);
 
+/**
+ * Prepares the ident table for about @p n_idents additional idents.
+ *
+ * Frontends which know the size of their symbol table up front can use this
+ * to avoid repeatedly growing the table while interning names.
+ */
+FIRM_API void id_reserve(size_t n_idents);
+
 /** @} */
 
 #include "end.h"
@@ -52,6 +52,137 @@ FIRM_API int ir_import(const char *filename);
  */
 FIRM_API int ir_import_file(FILE *input, const char *inputname);
 
+/**
+ * Filter deciding which function bodies ir_import_functions() imports.
+ * Returns non-zero if the body of the function with linker name @p ld_name
+ * should be imported.
+ */
+typedef int ir_import_filter_func(ident *ld_name, void *data);
+
+/**
+ * Imports selected function bodies from the given file into the existing
+ * program.
+ *
+ * Unlike ir_import() the contents of the file are merged with the current
+ * irp: Global entities are identified by their linker name, and only the
+ * graphs accepted by @p filter are read. Imported graphs are attached to
+ * (possibly newly created) declarations with IR_LINKAGE_NO_CODEGEN, so
+ * they are available for inlining but do not produce code. Functions that
+ * already have a graph in the current program are never replaced.
+ * The bodies and frame types of the other graphs are skipped unparsed.
+ * The imported graphs must not reference entities which are local to the
+ * exporting module.
+ *
+ * @param filename  the name of the file
+ * @param filter    decides which graphs are imported
+ * @param data      passed to @p filter
+ * @returns 0 if no errors occured, other values in case of errors
+ */
+FIRM_API int ir_import_functions(const char *filename,
+                                 ir_import_filter_func *filter, void *data);
+
+/**
+ * same as ir_import_functions but imports from a FILE*
+ */
+FIRM_API int ir_import_functions_file(FILE *input, const char *inputname,
+                                      ir_import_filter_func *filter,
+                                      void *data);
+
+/** @} */
+
+/**
+ * @defgroup irsummary Module Summaries
+ *
+ * Module summaries allow cross-module inlining without loading the IR of
+ * the whole program into one irp: Every module exports a compact summary
+ * next to its IR. It contains the size of every function definition, its
+ * static call edges, its additional properties and whether its address is
+ * taken. A whole-program index over the summaries of all modules selects
+ * the foreign function bodies worth inlining into a module, and only these
+ * are imported with ir_import_functions(). Modules can thus still be
+ * compiled separately and in parallel.
+ * @{
+ */
+
+/** A whole-program index over module summaries. */
+typedef struct ir_summary_index ir_summary_index;
+
+/**
+ * Exports a summary of the current irp to the given file.
+ * The entity usage of the program globals is computed if necessary.
+ *
+ * @param filename     the name of the resulting file
+ * @param ir_filename  the name of the file the IR of this module is
+ *                     exported to (see ir_export())
+ * @return  0 if no errors occured, other values in case of errors
+ */
+FIRM_API int ir_export_summary(const char *filename, const char *ir_filename);
+
+/**
+ * same as ir_export_summary but writes to a FILE*
+ * @note As with any FILE* errors are indicated by ferror(output)
+ */
+FIRM_API void ir_export_summary_file(FILE *output, const char *ir_filename);
+
+/** Creates a new, empty summary index. */
+FIRM_API ir_summary_index *ir_new_summary_index(void);
+
+/** Frees a summary index. */
+FIRM_API void ir_free_summary_index(ir_summary_index *index);
+
+/**
+ * Reads a module summary from the given file and adds it to @p index.
+ *
+ * @returns 0 if no errors occured, other values in case of errors
+ */
+FIRM_API int ir_summary_index_add(ir_summary_index *index,
+                                  const char *filename);
+
+/**
+ * same as ir_summary_index_add but reads from a FILE*
+ */
+FIRM_API int ir_summary_index_add_file(ir_summary_index *index, FILE *input,
+                                       const char *inputname);
+
+/**
+ * Callback reporting that the function @p ld_name should be imported from
+ * the module stored in @p ir_filename.
+ */
+typedef void ir_summary_import_func(const char *ir_filename, ident *ld_name,
+                                    void *data);
+
+/**
+ * Selects the foreign functions worth importing into a module.
+ *
+ * Every function called by the module, defined in another module and not
+ * larger than @p max_size nodes is selected. The callees of selected
+ * functions are considered as well, with a threshold decaying for every
+ * level. Functions which reference entities local to their module are never
+ * selected. The selection is reported through @p func, grouped by module.
+ *
+ * @param index        the whole-program index
+ * @param ir_filename  the IR file of the module to import into
+ * @param max_size     the size threshold for direct callees in nodes
+ * @param func         called for every selected function
+ * @param data         passed to @p func
+ */
+FIRM_API void ir_summary_index_select_imports(const ir_summary_index *index,
+                                              const char *ir_filename,
+                                              unsigned max_size,
+                                              ir_summary_import_func *func,
+                                              void *data);
+
+/**
+ * Imports the functions selected by ir_summary_index_select_imports() into
+ * the current irp, which must contain the module stored in @p ir_filename.
+ * The imported bodies can then be inlined with inline_functions().
+ *
+ * @returns 0 if no errors occured, other values in case of errors
+ */
+FIRM_API int ir_summary_import_callees(const ir_summary_index *index,
+                                       const char *ir_filename,
+                                       unsigned max_size);
+
 /** @} */
 
 #include "end.h"
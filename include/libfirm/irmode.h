@@ -99,6 +99,18 @@ FIRM_API ir_mode *new_float_mode(const char *name,
  */
 FIRM_API ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size);
 
+/**
+ * Creates a vector mode holding @p n_elements values of @p element_mode.
+ *
+ * Vector modes are non-arithmetic data modes (there are no vector tarvals).
+ * Add, Sub, Mul, And, Or, Eor, Load, Store and Phi nodes of a vector mode
+ * operate lane-wise. A Mux of vector mode whose selector is a Cmp of two
+ * vector operands selects lane-wise, too.
+ * Vector modes should only be created if the target supports them, see
+ * ir_target_vector_size().
+ */
+FIRM_API ir_mode *new_vector_mode(ir_mode *element_mode, unsigned n_elements);
+
 /** Returns the ident* of the mode */
 FIRM_API ident *get_mode_ident(const ir_mode *mode);
 
@@ -276,6 +288,15 @@ FIRM_API int mode_is_num(const ir_mode *mode);
  */
 FIRM_API int mode_is_data(const ir_mode *mode);
 
+/** Returns 1 if @p mode is a vector mode, 0 otherwise */
+FIRM_API int mode_is_vector(const ir_mode *mode);
+
+/** Returns the mode of a single element of the vector mode @p mode. */
+FIRM_API ir_mode *get_mode_vector_element_mode(const ir_mode *mode);
+
+/** Returns the number of elements of the vector mode @p mode. */
+FIRM_API unsigned get_mode_vector_n_elements(const ir_mode *mode);
+
 /**
  * Returns true if a value of mode @p sm can be converted to mode @p lm without
  * loss.
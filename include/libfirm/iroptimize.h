@@ -131,6 +131,26 @@ FIRM_API void opt_if_conv(ir_graph *irg);
  */
 FIRM_API void opt_if_conv_cb(ir_graph *irg, arch_allow_ifconv_func callback);
 
+/**
+ * Forms superblocks by tail duplication.
+ *
+ * Traces of blocks are selected along the most frequent control flow edges.
+ * The part of a trace after its first side entrance is duplicated and the
+ * copies take over all side entrances, so the hot path becomes a chain of
+ * blocks with a single predecessor each. Call optimize_cf() afterwards to merge
+ * them into one block for scheduling and if-conversion.
+ *
+ * Block frequencies come from the profile counts, if a profile was read with
+ * ir_profile_read() at the point of the pipeline it was recorded at (see
+ * ir_profile_instrument()), and are estimated otherwise. Blocks created after
+ * reading the profile count as never executed.
+ *
+ * @param irg         the graph
+ * @param max_growth  maximum number of duplicated nodes in percent of the
+ *                    number of nodes of the graph
+ */
+FIRM_API void form_superblocks(ir_graph *irg, unsigned max_growth);
+
 /**
  * Tries to reduce dependencies for memory nodes where possible by parallelizing
  * them and synchronizing with Sync nodes
@@ -414,6 +434,20 @@ typedef void (*opt_ptr)(ir_graph *irg);
 FIRM_API void inline_functions(unsigned maxsize, int inline_threshold,
                                opt_ptr after_inline_opt);
 
+/**
+ * Promotes indirect calls to guarded direct calls of their most frequent
+ * targets according to the value profile read with the execution counts.
+ * Does nothing if there is no value profile.
+ *
+ * Run it after ir_profile_read() and before inline_functions(), so the
+ * direct calls can be inlined. The backend runs it as well when it reads
+ * the profile itself (option "profileuse"). There the direct calls only
+ * save the indirect branch, as inlining is already over.
+ *
+ * @param irg  the graph
+ */
+FIRM_API void promote_indirect_calls(ir_graph *irg);
+
 /**
  * Combines congruent blocks into one.
  *
@@ -444,11 +478,63 @@ FIRM_API void do_loop_unrolling(ir_graph *irg);
  */
 FIRM_API void unroll_loops(ir_graph *irg, unsigned factor, unsigned maxsize);
 
+/**
+ * Vectorizes innermost counted loops.
+ *
+ * Loads, Stores and arithmetic of the loop body are widened by the number of
+ * lanes of the target vector registers (see ir_target_vector_size()). The
+ * original loop is kept as scalar epilogue and as fallback when a runtime
+ * check finds overlapping memory accesses. Sums, minimums and maximums are
+ * supported as reductions.
+ *
+ * @param irg  the graph
+ */
+FIRM_API void vectorize_loops(ir_graph *irg);
+
+/**
+ * Inserts software prefetches for strided memory accesses of innermost loops.
+ *
+ * Loads and Stores, whose address advances by a constant or loop invariant
+ * stride of at least a cache line per iteration, are preceded by a prefetch of
+ * the address they access some iterations later. The number of iterations is
+ * @p latency divided by the estimated cost of one iteration. Accesses, whose
+ * cache line is already prefetched for another access, get no prefetch.
+ *
+ * @param irg      the graph
+ * @param latency  the memory latency to hide in units of simple operations
+ */
+FIRM_API void insert_prefetches(ir_graph *irg, unsigned latency);
+
+/**
+ * Promotes loop invariant memory locations of innermost loops to registers.
+ *
+ * A location is promoted if its address is loop invariant and all other
+ * memory operations of the loop provably access different memory. It is
+ * loaded once in front of the loop and stored on the loop exits if the loop
+ * wrote it.
+ *
+ * @param irg  the graph
+ */
+FIRM_API void promote_loop_memory(ir_graph *irg);
+
 /**
  * Perform loop peeling on a given graph.
  */
 FIRM_API void do_loop_peeling(ir_graph *irg);
 
+/**
+ * Perform loop unswitching on a given graph.
+ *
+ * Branches on loop invariant conditions inside innermost loops are hoisted in
+ * front of the loop by duplicating the loop: one version is entered if the
+ * condition holds, the other one if it does not.  Conds on an And/Or with a
+ * single invariant operand and Switches on an invariant selector are
+ * unswitched partially.
+ *
+ * @param irg  the graph
+ */
+FIRM_API void do_loop_unswitching(ir_graph *irg);
+
 /**
  * Removes all entities which are unused.
  *
@@ -459,6 +545,17 @@ FIRM_API void do_loop_peeling(ir_graph *irg);
  */
 FIRM_API void garbage_collect_entities(void);
 
+/**
+ * Folds functions with identical code.
+ *
+ * Graphs are hashed structurally and compared for isomorphism. References to
+ * a duplicate are redirected to the canonical function. A duplicate which has
+ * to stay visible or whose address is taken becomes an alias of the canonical
+ * function where the object format supports this, otherwise a thunk calling
+ * the canonical function. Must run before the backend.
+ */
+FIRM_API void fold_identical_functions(void);
+
 /**
  * Performs dead node elimination by copying the ir graph to a new obstack.
  *
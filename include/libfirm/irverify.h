@@ -39,8 +39,35 @@ FIRM_API int irn_verify(const ir_node *node);
 FIRM_API int irg_verify(ir_graph *irg);
 
 /**
- * Convenience function: Checks graph for errors, in case of error the graph
- * is dumped to a file with "-assert" suffix and the program aborted.
+ * Enables incremental verification by irg_verify_incremental().
+ *
+ * While enabled, created nodes and nodes whose inputs, mode or attributes
+ * change are recorded for each graph. Every @p full_interval-th verification
+ * of a graph still checks the whole graph, which also catches the changes not
+ * recorded: Attributes written without their setter, the block attributes
+ * and changes of the entities and types nodes refer to.
+ *
+ * @param full_interval  interval of full verifications, 0 disables incremental
+ *                       verification
+ */
+FIRM_API void ir_set_verify_incremental(unsigned full_interval);
+
+/**
+ * Like irg_verify() but, if incremental verification is enabled, only checks
+ * the nodes changed since the last verification of @p irg and their users
+ * if out edges are activated. Global properties are not checked.
+ * Falls back to irg_verify() for the first verification of a graph, after
+ * changes of the control flow and periodically.
+ *
+ * @param irg  the IR-graph to check
+ * @return NON-zero if no problems were found
+ */
+FIRM_API int irg_verify_incremental(ir_graph *irg);
+
+/**
+ * Convenience function: Checks graph for errors (incrementally if enabled),
+ * in case of error the graph is dumped to a file with "-assert" suffix and
+ * the program aborted.
  */
 FIRM_API void irg_assert_verify(ir_graph *irg);
 
@@ -62,6 +62,24 @@ FIRM_API void const *be_jit_get_entity_addr(ir_entity const *entity);
 FIRM_API ir_jit_function_t *be_jit_compile(ir_jit_segment_t *segment,
                                            ir_graph *irg);
 
+/**
+ * Compile graph \p irg with the baseline tier. The code is generated in a
+ * single pass over the graph without optimizations and register allocation,
+ * which is considerably faster than be_jit_compile() but results in slower
+ * code. The graph is not changed (except for splitting critical edges), so hot
+ * functions can be recompiled with be_jit_compile() later.
+ *
+ * If \p counter is not NULL, it must be a 32bit integer variable, which is
+ * incremented on every invocation of the function. Its value can be used to
+ * decide which functions to recompile.
+ *
+ * Graphs, which the baseline tier cannot handle, are compiled with
+ * be_jit_compile().
+ */
+FIRM_API ir_jit_function_t *be_jit_compile_baseline(ir_jit_segment_t *segment,
+                                                    ir_graph *irg,
+                                                    ir_entity *counter);
+
 /**
  * Return the buffer size necessary to emit \p function with be_emit_function().
  */
@@ -72,6 +90,64 @@ FIRM_API unsigned be_get_function_size(ir_jit_function_t const *function);
  */
 FIRM_API void be_emit_function(char *buffer, ir_jit_function_t *function);
 
+/**
+ * Executable memory for jit compiled functions. Functions installed into the
+ * heap are independent of their \ref ir_jit_segment_t, which may be destroyed
+ * afterwards.
+ */
+typedef struct ir_jit_code_heap_t ir_jit_code_heap_t;
+
+/**
+ * A function installed in a \ref ir_jit_code_heap_t.
+ */
+typedef struct ir_jit_code_t ir_jit_code_t;
+
+/**
+ * Create a new code heap.
+ */
+FIRM_API ir_jit_code_heap_t *be_new_jit_code_heap(void);
+
+/**
+ * Destroy code heap \p heap and release its memory. Entities bound to
+ * functions in the heap lose their address.
+ */
+FIRM_API void be_destroy_jit_code_heap(ir_jit_code_heap_t *heap);
+
+/**
+ * Copy \p function into \p heap and resolve its relocations. If \p entity is
+ * not NULL, it is bound to the address of the function.
+ *
+ * Relocations to entities without an address are resolved as soon as the
+ * address is set with be_jit_set_entity_addr() or the entity is bound by
+ * installing its function, so mutually recursive functions can be installed
+ * in any order.
+ *
+ * The memory modified by installing and binding only becomes executable with
+ * be_jit_make_executable(), no code in the affected memory may run until
+ * then.
+ */
+FIRM_API ir_jit_code_t *be_jit_install_function(ir_jit_code_heap_t *heap,
+                                                ir_jit_function_t *function,
+                                                ir_entity *entity);
+
+/**
+ * Return the address of the installed function \p code.
+ */
+FIRM_API void const *be_jit_get_code_addr(ir_jit_code_t const *code);
+
+/**
+ * Free the installed function \p code. The entity bound to it loses its
+ * address. The function must not be referenced by other code anymore.
+ */
+FIRM_API void be_jit_free_code(ir_jit_code_heap_t *heap, ir_jit_code_t *code);
+
+/**
+ * Make all code installed or patched in \p heap since the last call
+ * executable. Memory is never writable and executable at the same time, so
+ * installing many functions before calling this saves protection changes.
+ */
+FIRM_API void be_jit_make_executable(ir_jit_code_heap_t *heap);
+
 /** @} */
 
 #include "end.h"
@@ -79,7 +79,11 @@ FIRM_API void lower_CopyB(ir_graph *irg, unsigned max_small_size,
 
 /**
  * Lowers all Switches (Cond nodes with non-boolean mode) depending on spare_size.
- * They will either remain the same or be converted into if-cascades.
+ * The cases are partitioned into clusters which are dense enough for a jump
+ * table, clusters which are tested with a single bit mask and single case
+ * comparisons. The clusters are then selected with a binary search which is
+ * weighted by the execution frequencies of the case blocks. If the blocks
+ * of the Switches have no frequencies yet, they are estimated.
  *
  * @param irg        The ir graph to be lowered.
  * @param small_switch  If switch has <= cases then change it to an if-cascade.
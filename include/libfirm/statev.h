@@ -62,6 +62,21 @@ FIRM_API void stat_ev(const char *name);
  */
 FIRM_API void stat_ev_begin(const char *filename_prefix, const char *filter);
 
+/**
+ * Initialize the stat ev machinery with binary output.
+ *
+ * Events are written as fixed size records with numbered keys, which is much
+ * faster and more compact than the text output of stat_ev_begin(). The filter
+ * is only matched once per key. support/statev_decode converts the output
+ * into the text format.
+ *
+ * @param filename_prefix  The name of the file (.evb will be appended).
+ *                         File will be truncated!
+ * @param filter           see stat_ev_begin()
+ */
+FIRM_API void stat_ev_begin_binary(const char *filename_prefix,
+                                   const char *filter);
+
 /**
  * Shuts down stat ev machinery
  */
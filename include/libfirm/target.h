@@ -82,6 +82,12 @@ FIRM_API int ir_target_supports_pic(void);
  */
 FIRM_API int ir_target_fast_unaligned_memaccess(void);
 
+/**
+ * Returns the size of the target vector registers in bytes or 0 if the
+ * backend does not support vector modes.
+ */
+FIRM_API unsigned ir_target_vector_size(void);
+
 /**
  * Returns supported float arithmetic mode or NULL if mode_D and mode_F
  * are supported natively.
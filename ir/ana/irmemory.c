@@ -18,11 +18,18 @@
 #include "irflag.h"
 #include "irgraph_t.h"
 #include "irgwalk.h"
+#include "irhooks.h"
 #include "irnode_t.h"
+#include "irnodehashmap.h"
+#include "irnodeset.h"
 #include "irouts_t.h"
 #include "irprintf.h"
 #include "irprog_t.h"
+#include "obst.h"
 #include "panic.h"
+#include "set.h"
+#include "stat_timing.h"
+#include "statev_t.h"
 #include "type_t.h"
 #include "typerep.h"
 #include "util.h"
@@ -36,6 +43,9 @@ DEBUG_ONLY(static firm_dbg_module_t *dbgcall = NULL;)
 /** The global memory disambiguator options. */
 static unsigned global_mem_disamgig_opt = aa_opt_none;
 
+/** Hook flushing alias caches, when nodes they depend on are replaced. */
+static hook_entry_t alias_cache_hook;
+
 const char *get_ir_alias_relation_name(ir_alias_relation rel)
 {
 #define X(a) case a: return #a
@@ -78,13 +88,17 @@ ir_storage_class_class_t get_base_sc(ir_storage_class_class_t x)
  *
  * @param node the node
  * @param pEnt after return points to the base entity.
+ * @param deps if not NULL, receives the visited nodes
  *
  * @return the base address.
  */
-static const ir_node *find_base_addr(const ir_node *node, ir_entity **pEnt)
+static const ir_node *find_base_addr(const ir_node *node, ir_entity **pEnt,
+                                     ir_nodeset_t *deps)
 {
 	const ir_node *member = NULL;
 	for (;;) {
+		if (deps != NULL)
+			ir_nodeset_insert(deps, (ir_node*)node);
 		if (is_Sel(node)) {
 			node = get_Sel_ptr(node);
 			continue;
@@ -244,12 +258,14 @@ typedef struct address_info {
 	bool           has_const_offset;
 } address_info;
 
-static address_info get_address_info(ir_node const *addr)
+static address_info get_address_info(ir_node const *addr, ir_nodeset_t *deps)
 {
 	ir_node *sym_offset       = NULL;
 	long     offset           = 0;
 	bool     has_const_offset = true;
 	for (;;) {
+		if (deps != NULL)
+			ir_nodeset_insert(deps, (ir_node*)addr);
 		switch (get_irn_opcode(addr)) {
 		case iro_Add: {
 			ir_node       *ptr_node;
@@ -271,6 +287,8 @@ static address_info get_address_info(ir_node const *addr)
 					goto follow_ptr;
 				}
 			}
+			if (deps != NULL)
+				ir_nodeset_insert(deps, int_node);
 			if (!sym_offset) {
 				sym_offset = int_node;
 			} else {
@@ -294,19 +312,95 @@ follow_ptr:
 	}
 }
 
-static ir_alias_relation _get_alias_relation(const ir_node *addr1, const ir_type *const objt1, unsigned size1,
-                                             const ir_node *addr2, const ir_type *const objt2, unsigned size2)
+/**
+ * Describes an address as seen by get_alias_relation().
+ */
+typedef struct alias_addr_t {
+	address_info             info; /**< base and offsets of the address */
+	ir_node const           *base; /**< base without Sels and Members */
+	ir_entity               *ent;  /**< outermost Member entity or NULL */
+	ir_storage_class_class_t sc;   /**< storage class of base */
+} alias_addr_t;
+
+/**
+ * A cached alias query, normalized such that addr1 < addr2.
+ */
+typedef struct alias_query_t {
+	ir_node const    *addr1;
+	ir_type const    *type1;
+	unsigned          size1;
+	ir_node const    *addr2;
+	ir_type const    *type2;
+	unsigned          size2;
+	ir_alias_relation rel;
+} alias_query_t;
+
+/**
+ * Memoized results of get_alias_relation() for one graph.
+ */
+struct ir_alias_cache_t {
+	struct obstack   obst;
+	ir_nodehashmap_t addrs;      /**< maps addresses to alias_addr_t */
+	set             *queries;    /**< set of alias_query_t */
+	ir_nodeset_t     deps;       /**< nodes the cached results depend on */
+	unsigned         n_queries;  /**< number of cacheable queries */
+	unsigned         n_hits;     /**< number of queries answered by cache */
+	unsigned         n_flushes;  /**< number of flushes due to replaced nodes */
+	timing_ticks_t   miss_ticks; /**< time spent answering cache misses */
+};
+
+static void compute_alias_addr(alias_addr_t *const res,
+                               ir_node const *const addr,
+                               ir_nodeset_t *const deps)
 {
-	if (addr1 == addr2)
-		return ir_sure_alias;
-	ir_graph *const irg     = get_irn_irg(addr1);
-	unsigned  const options = get_irg_memory_disambiguator_options(irg);
-	if (options & aa_opt_always_alias)
-		return ir_may_alias;
-	/* The Armageddon switch */
-	if (options & aa_opt_no_alias)
-		return ir_no_alias;
+	res->info = get_address_info(addr, deps);
+	res->ent  = NULL;
+	res->base = find_base_addr(res->info.base, &res->ent, deps);
+	res->sc   = classify_pointer(res->info.base, res->base);
+	/* classify_pointer() looks through Projs for malloc results */
+	if (deps != NULL && is_Proj(res->base)) {
+		ir_node *const pred = get_Proj_pred(res->base);
+		ir_nodeset_insert(deps, pred);
+		if (is_Proj(pred))
+			ir_nodeset_insert(deps, get_Proj_pred(pred));
+	}
+}
+
+/**
+ * Returns the description of @p addr, from the alias cache of its graph if
+ * present, otherwise computed into @p buf.
+ */
+static alias_addr_t const *get_alias_addr(ir_node const *const addr,
+                                          alias_addr_t *const buf)
+{
+	ir_alias_cache_t *const cache = get_irn_irg(addr)->alias_cache;
+	if (cache == NULL) {
+		compute_alias_addr(buf, addr, NULL);
+		return buf;
+	}
 
+	alias_addr_t *res = ir_nodehashmap_get(alias_addr_t, &cache->addrs, addr);
+	if (res == NULL) {
+		res = OALLOC(&cache->obst, alias_addr_t);
+		compute_alias_addr(res, addr, &cache->deps);
+		ir_nodehashmap_insert(&cache->addrs, (ir_node*)addr, res);
+	}
+	return res;
+}
+
+const ir_node *get_alias_base(const ir_node *const addr,
+                              ir_storage_class_class_t *const sc)
+{
+	alias_addr_t        buf;
+	alias_addr_t const *desc = get_alias_addr(addr, &buf);
+	*sc = desc->sc;
+	return desc->base;
+}
+
+static ir_alias_relation _get_alias_relation(alias_addr_t const *const desc1, const ir_type *const objt1, unsigned size1,
+                                             alias_addr_t const *const desc2, const ir_type *const objt2, unsigned size2,
+                                             unsigned const options)
+{
 	/* do the addresses have constants offsets from the same base?
 	 *  Note: sub X, C is normalized to add X, -C */
 
@@ -315,12 +409,12 @@ static ir_alias_relation _get_alias_relation(const ir_node *addr1, const ir_type
 	 * offset can be handled.  To extend this, change
 	 * sym_offset to be a set, and compare the sets.
 	 */
-	address_info const info1   = get_address_info(addr1);
-	address_info const info2   = get_address_info(addr2);
-	long               offset1 = info1.offset;
-	long               offset2 = info2.offset;
-	addr1 = info1.base;
-	addr2 = info2.base;
+	address_info const  info1   = desc1->info;
+	address_info const  info2   = desc2->info;
+	long                offset1 = info1.offset;
+	long                offset2 = info2.offset;
+	ir_node const      *addr1   = info1.base;
+	ir_node const      *addr2   = info2.base;
 
 	/* same base address -> compare offsets if possible.
 	 * FIXME: type long is not sufficient for this task ... */
@@ -344,10 +438,10 @@ static ir_alias_relation _get_alias_relation(const ir_node *addr1, const ir_type
 	}
 
 	/* skip Sels/Members */
-	ir_entity     *ent1  = NULL;
-	ir_entity     *ent2  = NULL;
-	const ir_node *base1 = find_base_addr(addr1, &ent1);
-	const ir_node *base2 = find_base_addr(addr2, &ent2);
+	ir_entity     *ent1  = desc1->ent;
+	ir_entity     *ent2  = desc2->ent;
+	const ir_node *base1 = desc1->base;
+	const ir_node *base2 = desc2->base;
 
 	/* two struct accesses -> compare entities */
 	if (ent1 != NULL && ent2 != NULL) {
@@ -380,8 +474,8 @@ static ir_alias_relation _get_alias_relation(const ir_node *addr1, const ir_type
 
 check_classes:;
 	/* no alias if 1 is a primitive object and the other a compound object */
-	const ir_storage_class_class_t mod1 = classify_pointer(addr1, base1);
-	const ir_storage_class_class_t mod2 = classify_pointer(addr2, base2);
+	const ir_storage_class_class_t mod1 = desc1->sc;
+	const ir_storage_class_class_t mod2 = desc2->sc;
 	if (((mod1 | mod2) & (ir_sc_modifier_obj_comp | ir_sc_modifier_obj_prim))
 	    == (ir_sc_modifier_obj_comp | ir_sc_modifier_obj_prim))
 		return ir_no_alias;
@@ -474,15 +568,155 @@ leave_type_based_alias:;
 	return ir_may_alias;
 }
 
+static int cmp_alias_query(void const *const elt, void const *const key,
+                           size_t const size)
+{
+	(void)size;
+	alias_query_t const *const q1 = (alias_query_t const*)elt;
+	alias_query_t const *const q2 = (alias_query_t const*)key;
+	return q1->addr1 != q2->addr1 || q1->type1 != q2->type1
+	    || q1->size1 != q2->size1 || q1->addr2 != q2->addr2
+	    || q1->type2 != q2->type2 || q1->size2 != q2->size2;
+}
+
+static unsigned hash_alias_query(alias_query_t const *const query)
+{
+	unsigned hash = hash_combine(hash_ptr(query->addr1), hash_ptr(query->addr2));
+	hash = hash_combine(hash, hash_ptr(query->type1) ^ query->size1);
+	return hash_combine(hash, hash_ptr(query->type2) ^ query->size2);
+}
+
+static ir_alias_relation get_alias_relation_cached(
+		ir_alias_cache_t *const cache, ir_node const *addr1,
+		ir_type const *type1, unsigned size1, ir_node const *addr2,
+		ir_type const *type2, unsigned size2, unsigned const options)
+{
+	/* the relation is symmetric, normalize the query */
+	if (addr1 > addr2) {
+		ir_node const *const addr = addr1;
+		ir_type const *const type = type1;
+		unsigned       const size = size1;
+		addr1 = addr2;
+		type1 = type2;
+		size1 = size2;
+		addr2 = addr;
+		type2 = type;
+		size2 = size;
+	}
+
+	alias_query_t key = { addr1, type1, size1, addr2, type2, size2,
+	                      ir_may_alias };
+	unsigned const hash = hash_alias_query(&key);
+	++cache->n_queries;
+	alias_query_t const *const entry
+		= set_find(alias_query_t, cache->queries, &key, sizeof(key), hash);
+	if (entry != NULL) {
+		++cache->n_hits;
+		return entry->rel;
+	}
+
+	timing_ticks_t const start = stat_ev_enabled ? timing_ticks() : 0;
+	alias_addr_t         buf1;
+	alias_addr_t         buf2;
+	alias_addr_t const  *desc1 = get_alias_addr(addr1, &buf1);
+	alias_addr_t const  *desc2 = get_alias_addr(addr2, &buf2);
+	key.rel = _get_alias_relation(desc1, type1, size1, desc2, type2, size2,
+	                              options);
+	if (stat_ev_enabled)
+		cache->miss_ticks += timing_ticks() - start;
+	(void)set_insert(alias_query_t, cache->queries, &key, sizeof(key), hash);
+	return key.rel;
+}
+
 ir_alias_relation get_alias_relation(const ir_node *const addr1, const ir_type *const type1, unsigned size1,
                                      const ir_node *const addr2, const ir_type *const type2, unsigned size2)
 {
-	ir_alias_relation rel = _get_alias_relation(addr1, type1, size1, addr2, type2, size2);
+	ir_alias_relation rel;
+	ir_graph *const irg     = get_irn_irg(addr1);
+	unsigned  const options = get_irg_memory_disambiguator_options(irg);
+	if (addr1 == addr2) {
+		rel = ir_sure_alias;
+	} else if (options & aa_opt_always_alias) {
+		rel = ir_may_alias;
+	} else if (options & aa_opt_no_alias) {
+		/* The Armageddon switch */
+		rel = ir_no_alias;
+	} else if (irg->alias_cache != NULL && get_irn_irg(addr2) == irg) {
+		rel = get_alias_relation_cached(irg->alias_cache, addr1, type1, size1,
+		                                addr2, type2, size2, options);
+	} else {
+		alias_addr_t buf1;
+		alias_addr_t buf2;
+		rel = _get_alias_relation(get_alias_addr(addr1, &buf1), type1, size1,
+		                          get_alias_addr(addr2, &buf2), type2, size2,
+		                          options);
+	}
 	DB((dbg, LEVEL_1, "alias(%+F, %+F) = %s\n", addr1, addr2,
 	    get_ir_alias_relation_name(rel)));
 	return rel;
 }
 
+static void init_alias_cache(ir_alias_cache_t *const cache)
+{
+	obstack_init(&cache->obst);
+	ir_nodehashmap_init(&cache->addrs);
+	cache->queries = new_set(cmp_alias_query, 64);
+	ir_nodeset_init(&cache->deps);
+}
+
+static void destroy_alias_cache(ir_alias_cache_t *const cache)
+{
+	ir_nodeset_destroy(&cache->deps);
+	del_set(cache->queries);
+	ir_nodehashmap_destroy(&cache->addrs);
+	obstack_free(&cache->obst, NULL);
+}
+
+/**
+ * Drops all cached results of a graph, when a node they were computed from
+ * is replaced.
+ */
+static void alias_cache_replace(void *const ctx, ir_node *const old_node,
+                                ir_node *const new_node)
+{
+	(void)ctx;
+	(void)new_node;
+	ir_alias_cache_t *const cache = get_irn_irg(old_node)->alias_cache;
+	if (cache == NULL || !ir_nodeset_contains(&cache->deps, old_node))
+		return;
+	destroy_alias_cache(cache);
+	init_alias_cache(cache);
+	++cache->n_flushes;
+}
+
+void assure_irg_alias_cache(ir_graph *const irg)
+{
+	if (irg->alias_cache != NULL)
+		return;
+	ir_alias_cache_t *const cache = XMALLOCZ(ir_alias_cache_t);
+	init_alias_cache(cache);
+	irg->alias_cache = cache;
+}
+
+void free_irg_alias_cache(ir_graph *const irg)
+{
+	ir_alias_cache_t *const cache = irg->alias_cache;
+	if (cache == NULL)
+		return;
+	stat_ev_int("alias_cache_queries", cache->n_queries);
+	stat_ev_int("alias_cache_hits",    cache->n_hits);
+	stat_ev_int("alias_cache_flushes", cache->n_flushes);
+	if (cache->n_queries > cache->n_hits) {
+		/* estimate the time saved by the hits from the cost of the misses */
+		unsigned const n_misses = cache->n_queries - cache->n_hits;
+		stat_ev_dbl("alias_cache_saved_ticks",
+		            (double)cache->miss_ticks / n_misses * cache->n_hits);
+	}
+	destroy_alias_cache(cache);
+	free(cache);
+	irg->alias_cache = NULL;
+}
+
 /**
  * Check the mode of a Load/Store with the mode of the entity
  * that is accessed.
@@ -871,6 +1105,9 @@ void firm_init_memory_disambiguator(void)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ana.irmemory");
 	FIRM_DBG_REGISTER(dbgcall, "firm.opt.cc");
+
+	alias_cache_hook.hook._hook_replace = alias_cache_replace;
+	register_hook(hook_replace, &alias_cache_hook);
 }
 
 /** Maps method types to cloned method types. */
@@ -60,4 +60,29 @@ ir_storage_class_class_t get_base_sc(ir_storage_class_class_t x);
 ir_storage_class_class_t classify_pointer(const ir_node *addr,
                                           const ir_node *base);
 
+/**
+ * Returns the base address of @p addr as used by get_alias_relation(), that is
+ * without constant offsets, Sels and Members, and classifies it.
+ * Accesses with different bases only alias if their storage classes permit.
+ * @param addr the node representing the address
+ * @param sc   receives the storage class of the base address
+ */
+const ir_node *get_alias_base(const ir_node *addr,
+                              ir_storage_class_class_t *sc);
+
+typedef struct ir_alias_cache_t ir_alias_cache_t;
+
+/**
+ * Enables memoization of get_alias_relation() for @p irg until
+ * free_irg_alias_cache() is called. Cached results are dropped when a node
+ * they were computed from is exchanged. Entity usage, types and the memory
+ * disambiguator options must not change while the cache is active.
+ */
+void assure_irg_alias_cache(ir_graph *irg);
+
+/**
+ * Frees the alias cache of @p irg and reports its hit rate via statev.
+ */
+void free_irg_alias_cache(ir_graph *irg);
+
 #endif
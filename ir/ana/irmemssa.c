@@ -0,0 +1,631 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Memory SSA with memory partitioned into alias classes.
+ *
+ * Alias classes are built with union-find over keys describing an access:
+ * - Accesses to an entity whose address is not taken only alias accesses with
+ *   the same base entity.
+ * - All other accesses may alias through pointers, so the key of their base
+ *   (entity or base pointer) is merged with the key of their type. Without
+ *   type based alias analysis all types share a single key.
+ *
+ * The memory chain is cut into segments, linear pieces without merges, which
+ * record the positions of the relevant nodes for each class. memssa_skip()
+ * finds the closest relevant node of a segment with a binary search and
+ * caches the result above each segment and each merge, so walks do not
+ * depend on the number of unrelated operations between. A Phi or Sync is only
+ * relevant for a class if its predecessors reach different nodes of the
+ * class, so walks pass through merges of unrelated memory.
+ */
+#include "irmemssa.h"
+
+#include "array.h"
+#include "debug.h"
+#include "hashptr.h"
+#include "iredges_t.h"
+#include "irmemory_t.h"
+#include "irnode_t.h"
+#include "irnodehashmap.h"
+#include "irnodeset.h"
+#include "obst.h"
+#include "pmap.h"
+#include "raw_bitset.h"
+#include "set.h"
+#include "type_t.h"
+#include "unionfind.h"
+#include "xmalloc.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** A relevant node at a position of a segment. */
+typedef struct entry_t {
+	unsigned  pos;
+	ir_node  *node;
+} entry_t;
+
+/**
+ * A linear piece of the memory chain. Every memory operation is part of
+ * exactly one segment, a fork of the chain starts a new segment.
+ */
+typedef struct segment_t {
+	ir_node  **nodes;       /**< memory operations in chain order */
+	size_t     first_alive; /**< no node before is part of the chain */
+	entry_t   *clobbers;    /**< operations relevant for all classes */
+	entry_t   *calls;       /**< calls, relevant for non-private classes */
+} segment_t;
+
+typedef struct position_t {
+	segment_t *seg;
+	unsigned   pos;
+} position_t;
+
+/** Information about a segment or a merge for one class. */
+typedef struct class_info_t {
+	void const *key;      /**< the segment or merge */
+	unsigned    cls;
+	entry_t    *accesses; /**< accesses of the class in the segment */
+	ir_node    *result;   /**< cached result above the segment/of the merge */
+} class_info_t;
+
+struct memssa_t {
+	ir_nodehashmap_t   classes;    /**< access -> class + 1 */
+	unsigned          *is_private; /**< classes not visible to callees */
+	struct obstack     obst;
+	ir_nodehashmap_t   positions;  /**< memop -> position_t */
+	segment_t        **segments;
+	set               *infos;      /**< class_info_t */
+	class_info_t     **path;       /**< segments passed in the current walk */
+};
+
+/** An address accessed by a Load, Store or CopyB. */
+typedef struct access_addr_t {
+	ir_node       *node;
+	ir_type const *type;
+	int            base_key;
+	bool           escaped;  /**< may be accessed through pointers */
+	bool           second;   /**< second address of the same access */
+} access_addr_t;
+
+typedef struct build_env_t {
+	unsigned       options;
+	pmap          *keys;         /**< key -> index + 1 */
+	bool          *private_keys; /**< keys not visible to callees */
+	access_addr_t *addrs;
+	int           *uf;
+	bool           collapse;     /**< all types may alias each other */
+} build_env_t;
+
+/* dummy objects for keys without natural representative */
+static char all_key;
+static char globaladdr_key;
+static char type_key;
+static char pointer_key;
+
+static int get_key(build_env_t *const env, void const *const key)
+{
+	int const idx = (int)(intptr_t)pmap_get(void, env->keys, key);
+	if (idx != 0)
+		return idx - 1;
+	int const res = ARR_LEN(env->uf);
+	ARR_APP1(int, env->uf, -1);
+	ARR_APP1(bool, env->private_keys, false);
+	pmap_insert(env->keys, key, (void*)(intptr_t)(res + 1));
+	return res;
+}
+
+static void add_addr(build_env_t *const env, ir_node *const node,
+                     ir_node const *const addr, ir_type const *const type,
+                     bool const second)
+{
+	access_addr_t entry = {
+		.node   = node,
+		.type   = type,
+		.second = second,
+	};
+
+	unsigned const options = env->options;
+	if (options & aa_opt_always_alias) {
+		entry.base_key = get_key(env, &all_key);
+	} else if (options & aa_opt_no_alias) {
+		/* only identical addresses alias */
+		entry.base_key = get_key(env, addr);
+	} else {
+		ir_storage_class_class_t sc;
+		ir_node const *const base = get_alias_base(addr, &sc);
+		void    const *      key  = base;
+		bool                 frame = false;
+		switch (get_base_sc(sc)) {
+		case ir_sc_globalvar:
+		case ir_sc_tls:
+			key = get_Address_entity(base);
+			break;
+		case ir_sc_localvar:
+		case ir_sc_argument:
+			key   = get_Member_entity(base);
+			frame = true;
+			break;
+		case ir_sc_globaladdr:
+			key = &globaladdr_key;
+			break;
+		default:
+			break;
+		}
+		entry.base_key = get_key(env, key);
+		entry.escaped  = !(sc & ir_sc_modifier_nottaken);
+		if (frame && !entry.escaped)
+			env->private_keys[entry.base_key] = true;
+	}
+	ARR_APP1(access_addr_t, env->addrs, entry);
+}
+
+static void collect_access(build_env_t *const env, ir_node *const node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+		add_addr(env, node, get_Load_ptr(node), get_Load_type(node), false);
+		return;
+	case iro_Store:
+		add_addr(env, node, get_Store_ptr(node), get_Store_type(node), false);
+		return;
+	case iro_CopyB: {
+		ir_type const *const type = get_CopyB_type(node);
+		add_addr(env, node, get_CopyB_dst(node), type, false);
+		add_addr(env, node, get_CopyB_src(node), type, true);
+		return;
+	}
+	default:
+		return;
+	}
+}
+
+/**
+ * Returns the type key of an escaped access. Types in different keys are
+ * considered different by the type based part of get_alias_relation().
+ */
+static void const *get_type_key(build_env_t *const env,
+                                ir_type const *const type)
+{
+	unsigned const options = env->options;
+	if (!(options & aa_opt_type_based))
+		return &type_key;
+	if ((options & aa_opt_byte_type_may_alias) && get_type_size(type) == 1)
+		return NULL;
+	if (is_Pointer_type(type))
+		return &pointer_key;
+	if (is_Primitive_type(type))
+		return type;
+	return NULL;
+}
+
+static void unite(build_env_t *const env, int const key1, int const key2)
+{
+	uf_union(env->uf, uf_find(env->uf, key1), uf_find(env->uf, key2));
+}
+
+static bool is_merge(ir_node const *const node)
+{
+	return is_Sync(node) || (is_Phi(node) && get_irn_mode(node) == mode_M);
+}
+
+/**
+ * Checks whether @p node is still part of the memory chain. Memory operations
+ * removed by exchanging their memory Proj are not deleted themselves.
+ */
+static bool is_in_chain(ir_node const *const node)
+{
+	if (get_irn_op(node) == op_Deleted)
+		return false;
+	if (!is_memop(node))
+		return true;
+	foreach_out_edge(node, edge) {
+		if (get_irn_mode(get_edge_src_irn(edge)) == mode_M)
+			return true;
+	}
+	return false;
+}
+
+static int cmp_class_info(void const *const elt, void const *const key,
+                          size_t const size)
+{
+	(void)size;
+	class_info_t const *const a = (class_info_t const*)elt;
+	class_info_t const *const b = (class_info_t const*)key;
+	return a->key != b->key || a->cls != b->cls;
+}
+
+static class_info_t *find_class_info(memssa_t const *const ms,
+                                     void const *const key, unsigned const cls)
+{
+	class_info_t const templ = { .key = key, .cls = cls };
+	unsigned     const hash  = hash_combine(hash_ptr(key), cls);
+	return set_find(class_info_t, ms->infos, &templ, sizeof(templ), hash);
+}
+
+static class_info_t *get_class_info(memssa_t const *const ms,
+                                    void const *const key, unsigned const cls)
+{
+	class_info_t const templ = { .key = key, .cls = cls };
+	unsigned     const hash  = hash_combine(hash_ptr(key), cls);
+	return set_insert(class_info_t, ms->infos, &templ, sizeof(templ), hash);
+}
+
+static position_t const *get_position(memssa_t const *const ms,
+                                      ir_node const *const node)
+{
+	return ir_nodehashmap_get(position_t const, &ms->positions, node);
+}
+
+unsigned memssa_get_class(memssa_t const *const ms, ir_node const *const access)
+{
+	uintptr_t const cls = (uintptr_t)ir_nodehashmap_get(void, &ms->classes,
+	                                                    access);
+	return cls != 0 ? (unsigned)cls - 1 : MEMSSA_UNKNOWN_CLASS;
+}
+
+static void add_entry(entry_t **const entries, unsigned const pos,
+                      ir_node *const node)
+{
+	if (*entries == NULL)
+		*entries = NEW_ARR_F(entry_t, 0);
+	entry_t const entry = { .pos = pos, .node = node };
+	ARR_APP1(entry_t, *entries, entry);
+}
+
+/**
+ * Appends the memory operation @p node to the segment of its memory
+ * predecessor, which has been indexed before.
+ */
+static void index_memop(memssa_t *const ms, ir_node *const node)
+{
+	ir_node          *const pred     = skip_Proj(get_memop_mem(node));
+	position_t const *const pred_pos = get_position(ms, pred);
+	segment_t              *seg;
+	if (pred_pos != NULL
+	 && pred_pos->pos + 1 == ARR_LEN(pred_pos->seg->nodes)) {
+		seg = pred_pos->seg;
+	} else {
+		seg = OALLOCZ(&ms->obst, segment_t);
+		seg->nodes    = NEW_ARR_F(ir_node*, 0);
+		seg->clobbers = NEW_ARR_F(entry_t, 0);
+		seg->calls    = NEW_ARR_F(entry_t, 0);
+		ARR_APP1(segment_t*, ms->segments, seg);
+	}
+	position_t *const pos = OALLOC(&ms->obst, position_t);
+	pos->seg = seg;
+	pos->pos = ARR_LEN(seg->nodes);
+	ARR_APP1(ir_node*, seg->nodes, node);
+	ir_nodehashmap_insert(&ms->positions, node, pos);
+
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+	case iro_Store:
+	case iro_CopyB: {
+		unsigned const cls = memssa_get_class(ms, node);
+		if (cls == MEMSSA_UNKNOWN_CLASS) {
+			add_entry(&seg->clobbers, pos->pos, node);
+		} else {
+			class_info_t *const info = get_class_info(ms, seg, cls);
+			add_entry(&info->accesses, pos->pos, node);
+		}
+		return;
+	}
+	case iro_Call:
+		if (!is_irn_const_memory(node))
+			add_entry(&seg->calls, pos->pos, node);
+		return;
+	default:
+		if (!is_irn_const_memory(node))
+			add_entry(&seg->clobbers, pos->pos, node);
+		return;
+	}
+}
+
+/**
+ * Returns the memory operations of @p irg, each after its memory predecessor.
+ * Following the out edges of the memory chain is much cheaper than walking
+ * the whole graph. Operations not reachable from the initial memory or NoMem
+ * are left out, so they act as barriers for memssa_skip().
+ */
+static ir_node **collect_memops(ir_graph *const irg)
+{
+	ir_node **memops   = NEW_ARR_F(ir_node*, 0);
+	ir_node **worklist = NEW_ARR_F(ir_node*, 0);
+	ARR_APP1(ir_node*, worklist, get_irg_initial_mem(irg));
+	ARR_APP1(ir_node*, worklist, get_irg_no_mem(irg));
+	ir_nodeset_t merges;
+	ir_nodeset_init(&merges);
+	while (ARR_LEN(worklist) > 0) {
+		ir_node *const mem = worklist[ARR_LEN(worklist) - 1];
+		ARR_SHRINKLEN(worklist, ARR_LEN(worklist) - 1);
+		foreach_out_edge(mem, edge) {
+			ir_node *const user = get_edge_src_irn(edge);
+			if (is_merge(user)) {
+				if (ir_nodeset_insert(&merges, user))
+					ARR_APP1(ir_node*, worklist, user);
+			} else if (is_memop(user)) {
+				ARR_APP1(ir_node*, memops, user);
+				foreach_out_edge(user, user_edge) {
+					ir_node *const proj = get_edge_src_irn(user_edge);
+					if (get_irn_mode(proj) == mode_M)
+						ARR_APP1(ir_node*, worklist, proj);
+				}
+			}
+		}
+	}
+	ir_nodeset_destroy(&merges);
+	DEL_ARR_F(worklist);
+	return memops;
+}
+
+memssa_t *memssa_new(ir_graph *const irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ana.memssa");
+
+	memssa_t *const ms = XMALLOCZ(memssa_t);
+	build_env_t env = {
+		.options      = get_irg_memory_disambiguator_options(irg),
+		.keys         = pmap_create(),
+		.private_keys = NEW_ARR_F(bool, 0),
+		.addrs        = NEW_ARR_F(access_addr_t, 0),
+		.uf           = NEW_ARR_F(int, 0),
+	};
+	ir_node **const memops  = collect_memops(irg);
+	size_t    const n_memops = ARR_LEN(memops);
+	for (size_t i = 0; i < n_memops; ++i)
+		collect_access(&env, memops[i]);
+
+	/* Escaped accesses alias all accesses of compatible types. */
+	size_t const n_addrs = ARR_LEN(env.addrs);
+	for (size_t i = 0; i < n_addrs; ++i) {
+		access_addr_t const *const entry = &env.addrs[i];
+		if (entry->escaped && get_type_key(&env, entry->type) == NULL) {
+			env.collapse = true;
+			break;
+		}
+	}
+	for (size_t i = 0; i < n_addrs; ++i) {
+		access_addr_t const *const entry = &env.addrs[i];
+		if (entry->second)
+			unite(&env, env.addrs[i - 1].base_key, entry->base_key);
+		if (!entry->escaped)
+			continue;
+		void const *const key = env.collapse ? &type_key
+		                                     : get_type_key(&env, entry->type);
+		unite(&env, entry->base_key, get_key(&env, key));
+	}
+
+	/* Number the classes. A class is private if it consists of local
+	 * variables only, whose address is never taken. */
+	size_t    const n_keys    = ARR_LEN(env.uf);
+	unsigned *const class_num = NEW_ARR_F(unsigned, n_keys);
+	unsigned        n_classes = 0;
+	for (size_t i = 0; i < n_keys; ++i) {
+		if (env.uf[i] < 0)
+			class_num[i] = n_classes++;
+	}
+	ms->is_private = rbitset_malloc(n_classes);
+	rbitset_set_all(ms->is_private, n_classes);
+	for (size_t i = 0; i < n_keys; ++i) {
+		if (!env.private_keys[i])
+			rbitset_clear(ms->is_private, class_num[uf_find(env.uf, i)]);
+	}
+
+	ir_nodehashmap_init(&ms->classes);
+	for (size_t i = 0; i < n_addrs; ++i) {
+		access_addr_t const *const entry = &env.addrs[i];
+		unsigned const cls = class_num[uf_find(env.uf, entry->base_key)];
+		ir_nodehashmap_insert(&ms->classes, entry->node,
+		                      (void*)(uintptr_t)(cls + 1));
+	}
+	DB((dbg, LEVEL_1, "%+F: %zu accesses in %u alias classes\n", irg, n_addrs,
+	    n_classes));
+
+	obstack_init(&ms->obst);
+	ir_nodehashmap_init(&ms->positions);
+	ms->segments = NEW_ARR_F(segment_t*, 0);
+	ms->infos    = new_set(cmp_class_info, 64);
+	ms->path     = NEW_ARR_F(class_info_t*, 0);
+	for (size_t i = 0; i < n_memops; ++i)
+		index_memop(ms, memops[i]);
+
+	DEL_ARR_F(memops);
+	DEL_ARR_F(class_num);
+	DEL_ARR_F(env.uf);
+	DEL_ARR_F(env.addrs);
+	DEL_ARR_F(env.private_keys);
+	pmap_destroy(env.keys);
+	return ms;
+}
+
+void memssa_free(memssa_t *const ms)
+{
+	foreach_set(ms->infos, class_info_t, info) {
+		if (info->accesses != NULL)
+			DEL_ARR_F(info->accesses);
+	}
+	del_set(ms->infos);
+	for (size_t i = 0, n = ARR_LEN(ms->segments); i < n; ++i) {
+		segment_t *const seg = ms->segments[i];
+		DEL_ARR_F(seg->nodes);
+		DEL_ARR_F(seg->clobbers);
+		DEL_ARR_F(seg->calls);
+	}
+	DEL_ARR_F(ms->segments);
+	ir_nodehashmap_destroy(&ms->positions);
+	obstack_free(&ms->obst, NULL);
+	free(ms->is_private);
+	DEL_ARR_F(ms->path);
+	ir_nodehashmap_destroy(&ms->classes);
+	free(ms);
+}
+
+void memssa_add_access(memssa_t *const ms, ir_node *const access,
+                       unsigned const cls)
+{
+	if (cls != MEMSSA_UNKNOWN_CLASS)
+		ir_nodehashmap_insert(&ms->classes, access,
+		                      (void*)(uintptr_t)(cls + 1));
+	index_memop(ms, access);
+}
+
+/**
+ * Returns the last entry at or before position @p pos, whose node is still
+ * part of the memory chain, or NULL.
+ */
+static entry_t const *find_entry(entry_t const *const entries,
+                                 unsigned const pos)
+{
+	if (entries == NULL)
+		return NULL;
+	size_t lo = 0;
+	size_t hi = ARR_LEN(entries);
+	while (lo < hi) {
+		size_t const mid = lo + (hi - lo) / 2;
+		if (entries[mid].pos <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	while (lo-- > 0) {
+		if (is_in_chain(entries[lo].node))
+			return &entries[lo];
+	}
+	return NULL;
+}
+
+static entry_t const *later(entry_t const *const a, entry_t const *const b)
+{
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	return a->pos > b->pos ? a : b;
+}
+
+/**
+ * Returns the last node relevant for class @p cls at or before position
+ * @p pos of segment @p seg, or NULL.
+ */
+static ir_node *find_in_segment(memssa_t *const ms, segment_t *const seg,
+                                unsigned const pos, unsigned const cls)
+{
+	class_info_t const *const info = find_class_info(ms, seg, cls);
+	entry_t const *res = info != NULL ? find_entry(info->accesses, pos) : NULL;
+	res = later(res, find_entry(seg->clobbers, pos));
+	if (!rbitset_is_set(ms->is_private, cls))
+		res = later(res, find_entry(seg->calls, pos));
+	return res != NULL ? res->node : NULL;
+}
+
+/**
+ * Returns the cached result of @p info or NULL.
+ */
+static ir_node *get_result(memssa_t *const ms, class_info_t const *const info)
+{
+	ir_node *res = info->result;
+	/* follow merges which turned out to be irrelevant */
+	while (res != NULL && res != info->key && is_merge(res)) {
+		class_info_t const *const merge_info
+			= find_class_info(ms, res, info->cls);
+		if (merge_info == NULL || merge_info->result == NULL
+		 || merge_info->result == res)
+			break;
+		res = merge_info->result;
+	}
+	/* the cached node may have been removed from the chain */
+	if (res != NULL && !is_in_chain(res))
+		return NULL;
+	return res;
+}
+
+/**
+ * Returns the node above segment @p seg. The segment is only entered at
+ * nodes which are part of the memory chain. Removed nodes keep their memory
+ * input, so the first remaining node tells where the segment hangs now.
+ */
+static ir_node *get_above(segment_t *const seg)
+{
+	while (!is_in_chain(seg->nodes[seg->first_alive]))
+		++seg->first_alive;
+	return skip_Proj(get_memop_mem(seg->nodes[seg->first_alive]));
+}
+
+static ir_node *skip(memssa_t *ms, ir_node *mem, unsigned cls);
+
+static ir_node *resolve_merge(memssa_t *const ms, ir_node *const merge,
+                              unsigned const cls)
+{
+	class_info_t *const info = get_class_info(ms, merge, cls);
+	ir_node      *const res  = get_result(ms, info);
+	if (res != NULL)
+		return res;
+
+	/* Reaching the merge again through a loop means no change. */
+	info->result = merge;
+	ir_node *common = NULL;
+	foreach_irn_in(merge, i, pred) {
+		ir_node *const prev = skip(ms, pred, cls);
+		if (prev == merge)
+			continue;
+		if (common == NULL) {
+			common = prev;
+		} else if (common != prev) {
+			common = merge;
+			break;
+		}
+	}
+	if (common == NULL)
+		common = merge;
+	info->result = common;
+	return common;
+}
+
+static ir_node *skip(memssa_t *const ms, ir_node *const mem,
+                     unsigned const cls)
+{
+	ir_node          *const node = skip_Proj(mem);
+	position_t const *const p    = get_position(ms, node);
+	if (p == NULL)
+		return is_merge(node) ? resolve_merge(ms, node, cls) : node;
+
+	size_t const path_begin = ARR_LEN(ms->path);
+	segment_t   *seg        = p->seg;
+	unsigned     pos        = p->pos;
+	ir_node     *res;
+	for (;;) {
+		res = find_in_segment(ms, seg, pos, cls);
+		if (res != NULL)
+			break;
+		class_info_t *const info = get_class_info(ms, seg, cls);
+		res = get_result(ms, info);
+		if (res != NULL)
+			break;
+		ARR_APP1(class_info_t*, ms->path, info);
+		ir_node          *const above     = get_above(seg);
+		position_t const *const above_pos = get_position(ms, above);
+		if (above_pos == NULL) {
+			res = is_merge(above) ? resolve_merge(ms, above, cls) : above;
+			break;
+		}
+		seg = above_pos->seg;
+		pos = above_pos->pos;
+	}
+
+	for (size_t i = path_begin, n = ARR_LEN(ms->path); i < n; ++i)
+		ms->path[i]->result = res;
+	ARR_SHRINKLEN(ms->path, path_begin);
+	return res;
+}
+
+ir_node *memssa_skip(memssa_t *const ms, ir_node *const mem,
+                     unsigned const cls)
+{
+	if (cls == MEMSSA_UNKNOWN_CLASS)
+		return skip_Proj(mem);
+	return skip(ms, mem, cls);
+}
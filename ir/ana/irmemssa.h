@@ -0,0 +1,60 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Memory SSA with memory partitioned into alias classes.
+ *
+ * The memory accesses of a graph (Load, Store and CopyB) are partitioned into
+ * alias classes, such that get_alias_relation() reports ir_no_alias for all
+ * pairs of accesses in different classes. Along the single memory chain of
+ * the graph, memssa_skip() finds the closest node relevant for a class,
+ * skipping accesses to other classes and merges of unrelated memory.
+ */
+#ifndef FIRM_ANA_IRMEMSSA_H
+#define FIRM_ANA_IRMEMSSA_H
+
+#include "firm_types.h"
+
+typedef struct memssa_t memssa_t;
+
+/** Class of accesses created after memssa_new(), they alias everything. */
+#define MEMSSA_UNKNOWN_CLASS (~0u)
+
+/**
+ * Partitions the memory accesses of @p irg into alias classes. Requires the
+ * same information about entity usage as get_alias_relation() and consistent
+ * out edges.
+ */
+memssa_t *memssa_new(ir_graph *irg);
+
+/**
+ * Frees the memory SSA information @p ms.
+ */
+void memssa_free(memssa_t *ms);
+
+/**
+ * Returns the alias class of the Load, Store or CopyB @p access.
+ */
+unsigned memssa_get_class(memssa_t const *ms, ir_node const *access);
+
+/**
+ * Returns the closest node at or above memory value @p mem, which is relevant
+ * for accesses of class @p cls: an access of class @p cls, an operation which
+ * may read or write any memory of the class, or a Phi or Sync merging
+ * different memory states of the class.
+ *
+ * The results are cached. Removing nodes from the memory chain is fine, new
+ * accesses have to be registered with memssa_add_access().
+ */
+ir_node *memssa_skip(memssa_t *ms, ir_node *mem, unsigned cls);
+
+/**
+ * Registers the new @p access of class @p cls, which takes the place of
+ * removed accesses of the same class in the memory chain.
+ */
+void memssa_add_access(memssa_t *ms, ir_node *access, unsigned cls);
+
+#endif
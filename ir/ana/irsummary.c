@@ -0,0 +1,356 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Module summaries and a whole-program index for cross-module
+ *          inlining.
+ *
+ * Every module exports a summary of its function definitions (sizes, call
+ * edges, properties) alongside its IR. The index combines the summaries of
+ * all modules and selects, similar to ThinLTO, the foreign function bodies
+ * worth importing into a module. Only these bodies are loaded again, so
+ * modules can be compiled independently and in parallel.
+ */
+#include "irsummary_t.h"
+
+#include "array.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "irprog_t.h"
+#include "pset_new.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/**
+ * The size threshold for imports is scaled by this factor (in percent) for
+ * every level of transitive imports.
+ */
+#define IMPORT_THRESHOLD_DECAY 70
+
+typedef struct summary_env_t {
+	summary_function_t *summary;
+	pmap               *call_idx; /**< maps callee ident to index + 1 */
+} summary_env_t;
+
+/**
+ * Returns true if @p node does not generate code, matching the size
+ * estimation of the inliner.
+ */
+static bool is_free_node(const ir_node *node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Anchor:
+	case iro_Bad:
+	case iro_Confirm:
+	case iro_Deleted:
+	case iro_Dummy:
+	case iro_End:
+	case iro_Id:
+	case iro_NoMem:
+	case iro_Pin:
+	case iro_Proj:
+	case iro_Start:
+	case iro_Sync:
+	case iro_Tuple:
+	case iro_Unknown:
+		return true;
+	case iro_Phi:
+		return get_irn_mode(node) == mode_M;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Returns true if a copy of a function referencing @p entity can be placed
+ * into another module.
+ */
+static bool is_importable_reference(const ir_entity *entity)
+{
+	if (!is_segment_type(get_entity_owner(entity)))
+		return true;
+	return entity_is_externally_visible(entity);
+}
+
+static void summarize_node(ir_node *node, void *data)
+{
+	summary_env_t      *env     = (summary_env_t*)data;
+	summary_function_t *summary = env->summary;
+
+	if (is_free_node(node))
+		return;
+	if (is_Block(node)) {
+		++summary->n_blocks;
+		return;
+	}
+	++summary->n_nodes;
+
+	if (is_ASM(node)) {
+		/* asm texts may refer to local symbols */
+		summary->flags &= ~summary_flag_importable;
+		return;
+	}
+
+	ir_entity *entity = get_irn_entity_attr(node);
+	if (entity != NULL && !is_importable_reference(entity))
+		summary->flags &= ~summary_flag_importable;
+
+	if (!is_Call(node))
+		return;
+	ir_entity *callee = get_Call_callee(node);
+	if (callee == NULL)
+		return;
+	ident *id  = get_entity_ld_ident(callee);
+	size_t idx = (size_t)pmap_get(void, env->call_idx, id);
+	if (idx == 0) {
+		summary_add_call(summary, id, 1);
+		pmap_insert(env->call_idx, id, (void*)ARR_LEN(summary->calls));
+	} else {
+		++summary->calls[idx - 1].n_sites;
+	}
+}
+
+void summarize_irg(ir_graph *irg, summary_function_t *summary)
+{
+	ir_entity *entity = get_irg_entity(irg);
+	summary->ld_name  = get_entity_ld_ident(entity);
+	summary->module   = NULL;
+	summary->n_nodes  = 0;
+	summary->n_blocks = 0;
+	summary->props    = get_entity_additional_properties(entity);
+	summary->flags    = summary_flag_none;
+	summary->calls    = NEW_ARR_F(summary_call_t, 0);
+
+	if (get_entity_usage(entity) & ir_usage_address_taken)
+		summary->flags |= summary_flag_address_taken;
+	if (entity_is_externally_visible(entity)
+	 && !(get_entity_linkage(entity) & IR_LINKAGE_WEAK)
+	 && !(summary->props & mtp_property_noinline))
+		summary->flags |= summary_flag_importable;
+
+	summary_env_t env = {
+		.summary  = summary,
+		.call_idx = pmap_create(),
+	};
+	irg_walk_graph(irg, NULL, summarize_node, &env);
+	pmap_destroy(env.call_idx);
+
+	/* the End block is no real block */
+	if (summary->n_blocks > 0)
+		--summary->n_blocks;
+}
+
+ir_summary_index *ir_new_summary_index(void)
+{
+	ir_summary_index *index = XMALLOCZ(ir_summary_index);
+	obstack_init(&index->obst);
+	index->modules   = NEW_ARR_F(summary_module_t*, 0);
+	index->functions = pmap_create();
+	return index;
+}
+
+void ir_free_summary_index(ir_summary_index *index)
+{
+	for (size_t m = 0, n_modules = ARR_LEN(index->modules); m < n_modules;
+	     ++m) {
+		summary_module_t *module = index->modules[m];
+		for (size_t f = 0, n = ARR_LEN(module->functions); f < n; ++f)
+			DEL_ARR_F(module->functions[f]->calls);
+		DEL_ARR_F(module->functions);
+	}
+	DEL_ARR_F(index->modules);
+	pmap_destroy(index->functions);
+	obstack_free(&index->obst, NULL);
+	free(index);
+}
+
+summary_module_t *summary_new_module(ir_summary_index *index,
+                                     const char *ir_filename)
+{
+	size_t            len    = strlen(ir_filename);
+	summary_module_t *module = OALLOC(&index->obst, summary_module_t);
+	module->ir_filename = (const char*)obstack_copy0(&index->obst, ir_filename,
+	                                                 len);
+	module->functions   = NEW_ARR_F(summary_function_t*, 0);
+	ARR_APP1(summary_module_t*, index->modules, module);
+	return module;
+}
+
+summary_function_t *summary_new_function(ir_summary_index *index,
+                                         summary_module_t *module,
+                                         ident *ld_name)
+{
+	summary_function_t *function = OALLOCZ(&index->obst, summary_function_t);
+	function->ld_name = ld_name;
+	function->module  = module;
+	function->calls   = NEW_ARR_F(summary_call_t, 0);
+	ARR_APP1(summary_function_t*, module->functions, function);
+
+	/* the index only knows the first definition of a name */
+	if (!pmap_contains(index->functions, ld_name))
+		pmap_insert(index->functions, ld_name, function);
+	return function;
+}
+
+void summary_add_call(summary_function_t *function, ident *callee,
+                      unsigned n_sites)
+{
+	summary_call_t call = { .callee = callee, .n_sites = n_sites };
+	ARR_APP1(summary_call_t, function->calls, call);
+}
+
+static summary_module_t *find_module(const ir_summary_index *index,
+                                     const char *ir_filename)
+{
+	for (size_t m = 0, n = ARR_LEN(index->modules); m < n; ++m) {
+		summary_module_t *module = index->modules[m];
+		if (streq(module->ir_filename, ir_filename))
+			return module;
+	}
+	return NULL;
+}
+
+typedef struct import_entry_t {
+	summary_function_t *function;
+	unsigned            threshold;
+} import_entry_t;
+
+/**
+ * Decides whether @p callee should be imported into @p module and, if so,
+ * queues it so that its own callees get considered as well.
+ */
+static void consider_import(const ir_summary_index *index,
+                            const pset_new_t *defined, ident *callee,
+                            unsigned threshold, pset_new_t *selected,
+                            import_entry_t **worklist)
+{
+	if (pset_new_contains(defined, callee))
+		return;
+	summary_function_t *function
+		= pmap_get(summary_function_t, index->functions, callee);
+	if (function == NULL)
+		return;
+	if (!(function->flags & summary_flag_importable))
+		return;
+	if (function->n_nodes > threshold
+	 && !(function->props & mtp_property_always_inline))
+		return;
+	if (!pset_new_insert(selected, function))
+		return;
+
+	DB((dbg, LEVEL_2, "import %s from %s (%u nodes)\n",
+	    get_id_str(callee), function->module->ir_filename, function->n_nodes));
+	import_entry_t entry = {
+		.function  = function,
+		.threshold = threshold * IMPORT_THRESHOLD_DECAY / 100,
+	};
+	ARR_APP1(import_entry_t, *worklist, entry);
+}
+
+void ir_summary_index_select_imports(const ir_summary_index *index,
+                                     const char *ir_filename,
+                                     unsigned max_size,
+                                     ir_summary_import_func *func, void *data)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ana.summary");
+
+	summary_module_t *module = find_module(index, ir_filename);
+	if (module == NULL)
+		return;
+
+	/* names defined by the module itself are never imported */
+	pset_new_t defined;
+	pset_new_init(&defined);
+	for (size_t f = 0, n = ARR_LEN(module->functions); f < n; ++f)
+		pset_new_insert(&defined, (void*)module->functions[f]->ld_name);
+
+	pset_new_t selected;
+	pset_new_init(&selected);
+	import_entry_t *worklist = NEW_ARR_F(import_entry_t, 0);
+
+	for (size_t f = 0, n = ARR_LEN(module->functions); f < n; ++f) {
+		const summary_function_t *function = module->functions[f];
+		for (size_t c = 0, n_calls = ARR_LEN(function->calls); c < n_calls;
+		     ++c) {
+			consider_import(index, &defined, function->calls[c].callee,
+			                max_size, &selected, &worklist);
+		}
+	}
+	/* transitively consider the callees of imported functions, but with a
+	 * decaying threshold */
+	for (size_t i = 0; i < ARR_LEN(worklist); ++i) {
+		import_entry_t entry = worklist[i];
+		const summary_call_t *calls = entry.function->calls;
+		for (size_t c = 0, n_calls = ARR_LEN(calls); c < n_calls; ++c) {
+			consider_import(index, &defined, calls[c].callee,
+			                entry.threshold, &selected, &worklist);
+		}
+	}
+
+	/* report grouped by module, so each IR file has to be read only once */
+	for (size_t m = 0, n_modules = ARR_LEN(index->modules); m < n_modules;
+	     ++m) {
+		const summary_module_t *other = index->modules[m];
+		for (size_t i = 0, n = ARR_LEN(worklist); i < n; ++i) {
+			const summary_function_t *function = worklist[i].function;
+			if (function->module == other)
+				func(other->ir_filename, function->ld_name, data);
+		}
+	}
+
+	DEL_ARR_F(worklist);
+	pset_new_destroy(&selected);
+	pset_new_destroy(&defined);
+}
+
+typedef struct import_list_t {
+	const char *ir_filename;
+	pset_new_t  names;
+	int         res;
+} import_list_t;
+
+static int is_selected(ident *ld_name, void *data)
+{
+	import_list_t *list = (import_list_t*)data;
+	return pset_new_contains(&list->names, ld_name);
+}
+
+static void flush_imports(import_list_t *list)
+{
+	if (list->ir_filename == NULL)
+		return;
+	if (ir_import_functions(list->ir_filename, is_selected, list) != 0)
+		list->res = 1;
+	pset_new_destroy(&list->names);
+	list->ir_filename = NULL;
+}
+
+static void collect_import(const char *ir_filename, ident *ld_name,
+                           void *data)
+{
+	import_list_t *list = (import_list_t*)data;
+	if (list->ir_filename != ir_filename) {
+		flush_imports(list);
+		list->ir_filename = ir_filename;
+		pset_new_init(&list->names);
+	}
+	pset_new_insert(&list->names, (void*)ld_name);
+}
+
+int ir_summary_import_callees(const ir_summary_index *index,
+                              const char *ir_filename, unsigned max_size)
+{
+	import_list_t list = { .ir_filename = NULL, .res = 0 };
+	ir_summary_index_select_imports(index, ir_filename, max_size,
+	                                collect_import, &list);
+	flush_imports(&list);
+	return list.res;
+}
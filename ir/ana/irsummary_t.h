@@ -0,0 +1,92 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Module summaries for cross-module inlining.
+ */
+#ifndef FIRM_ANA_IRSUMMARY_T_H
+#define FIRM_ANA_IRSUMMARY_T_H
+
+#include "firm_types.h"
+#include "irio.h"
+#include "obst.h"
+#include "pmap.h"
+
+typedef enum summary_flags_t {
+	summary_flag_none          = 0,
+	/** The body only references externally visible entities and may be
+	 * copied into another module. */
+	summary_flag_importable    = 1u << 0,
+	/** The address of the function escapes (see irmemory.c). */
+	summary_flag_address_taken = 1u << 1,
+} summary_flags_t;
+ENUM_BITSET(summary_flags_t)
+
+/**
+ * Properties which describe the behaviour of a function body and therefore
+ * remain valid in a module which only sees a declaration of the function.
+ */
+#define SUMMARY_TRANSFERABLE_PROPERTIES \
+	(mtp_property_no_write | mtp_property_pure | mtp_property_noreturn \
+	 | mtp_property_terminates | mtp_property_nothrow | mtp_property_malloc)
+
+/** A statically known call edge of a summarized function. */
+typedef struct summary_call_t {
+	ident    *callee;  /**< linker name of the called function */
+	unsigned  n_sites; /**< number of Call nodes calling it */
+} summary_call_t;
+
+typedef struct summary_module_t summary_module_t;
+
+/** The summary of a single function definition. */
+typedef struct summary_function_t {
+	ident                     *ld_name;
+	summary_module_t          *module;   /**< module defining the function */
+	unsigned                   n_nodes;  /**< size of the body in nodes */
+	unsigned                   n_blocks; /**< number of blocks */
+	mtp_additional_properties  props;
+	summary_flags_t            flags;
+	summary_call_t            *calls;    /**< flexible array of call edges */
+} summary_function_t;
+
+struct summary_module_t {
+	const char          *ir_filename; /**< file containing the module's IR */
+	summary_function_t **functions;   /**< flexible array */
+};
+
+struct ir_summary_index {
+	struct obstack      obst;
+	summary_module_t  **modules;   /**< flexible array */
+	pmap               *functions; /**< maps ld_name to summary_function_t */
+};
+
+/**
+ * Computes the summary of the graph @p irg.
+ * The global entity usage must be computed already.
+ * The call array of the result has to be freed with DEL_ARR_F().
+ */
+void summarize_irg(ir_graph *irg, summary_function_t *summary);
+
+/**
+ * Adds a new module, whose IR is stored in @p ir_filename, to @p index.
+ */
+summary_module_t *summary_new_module(ir_summary_index *index,
+                                     const char *ir_filename);
+
+/**
+ * Adds a new function summary for @p ld_name to @p module.
+ */
+summary_function_t *summary_new_function(ir_summary_index *index,
+                                         summary_module_t *module,
+                                         ident *ld_name);
+
+/**
+ * Adds a call edge to @p callee with @p n_sites call sites to @p function.
+ */
+void summary_add_call(summary_function_t *function, ident *callee,
+                      unsigned n_sites);
+
+#endif
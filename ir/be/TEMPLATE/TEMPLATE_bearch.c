@@ -11,6 +11,7 @@
 #include "TEMPLATE_new_nodes.h"
 #include "TEMPLATE_transform.h"
 #include "be_t.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bemodule.h"
 #include "benode.h"
@@ -80,7 +81,9 @@ static void TEMPLATE_generate_code(FILE *output, const char *cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_TEMPLATE_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_SP);
 
-	foreach_irp_irg(i, irg) {
+	ir_graph **const irgs = be_get_irg_compile_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!be_step_first(irg))
 			continue;
 
@@ -100,6 +103,7 @@ static void TEMPLATE_generate_code(FILE *output, const char *cup_name)
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
 
 	be_finish();
 }
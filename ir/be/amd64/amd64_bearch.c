@@ -17,6 +17,7 @@
 #include "amd64_transform.h"
 #include "amd64_varargs.h"
 #include "beflags.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bemodule.h"
 #include "bera.h"
@@ -659,7 +660,9 @@ static void amd64_generate_code(FILE *output, const char *cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AMD64_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_RSP);
 
-	foreach_irp_irg(i, irg) {
+	ir_graph **const irgs = be_get_irg_compile_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!be_step_first(irg))
 			continue;
 
@@ -679,9 +682,11 @@ static void amd64_generate_code(FILE *output, const char *cup_name)
 		be_step_regalloc(irg, &amd64_regalloc_if);
 
 		amd64_finish_and_emit(irg);
+		amd64_record_clobbers(irg);
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
 
 	be_finish();
 	pmap_destroy(amd64_constants);
@@ -700,6 +705,12 @@ static const ir_settings_arch_dep_t amd64_arch_dep = {
 	.max_bits_for_mulh    = 32,
 };
 
+static int amd64_lower_mux(ir_node *const mux)
+{
+	/* only vector Muxes selecting a minimum or maximum are transformed */
+	return !mode_is_vector(get_irn_mode(mux));
+}
+
 static void amd64_lower_for_target(void)
 {
 	ir_arch_lower(&amd64_arch_dep);
@@ -728,6 +739,8 @@ static void amd64_lower_for_target(void)
 	}
 
 	foreach_irp_irg(i, irg) {
+		lower_mux(irg, amd64_lower_mux);
+		be_after_transform(irg, "lower-mux");
 		/* lower for mode_b stuff */
 		ir_lower_mode_b(irg, mode_Lu);
 		be_after_transform(irg, "lower-modeb");
@@ -744,7 +757,7 @@ static void amd64_lower_for_target(void)
 		be_after_transform(irg, "lower-copyb");
 	}
 
-	ir_builtin_kind supported[6];
+	ir_builtin_kind supported[7];
 	size_t  s = 0;
 	supported[s++] = ir_bk_ffs;
 	supported[s++] = ir_bk_clz;
@@ -752,6 +765,7 @@ static void amd64_lower_for_target(void)
 	supported[s++] = ir_bk_compare_swap;
 	supported[s++] = ir_bk_saturating_increment;
 	supported[s++] = ir_bk_va_start;
+	supported[s++] = ir_bk_prefetch;
 
 	assert(s <= ARRAY_SIZE(supported));
 	lower_builtins(s, supported, amd64_lower_va_arg);
@@ -779,6 +793,8 @@ static void amd64_init(void)
 	ir_target.experimental = "the amd64 backend is experimental and unfinished (consider the ia32 backend)";
 	ir_target.fast_unaligned_memaccess = true;
 	ir_target.float_int_overflow       = ir_overflow_indefinite;
+	ir_target.allow_vector_op          = amd64_allow_vector_op;
+	ir_target.vector_size              = 16;
 }
 
 static unsigned amd64_get_op_estimated_cost(const ir_node *node)
@@ -834,6 +850,7 @@ void be_init_arch_amd64(void)
 {
 	static const lc_opt_table_entry_t options[] = {
 		LC_OPT_ENT_BOOL("no-red-zone", "gcc compatibility",                &amd64_use_red_zone),
+		LC_OPT_ENT_BOOL("burs",        "use the generated BURS instruction selector", &amd64_use_burs),
 		LC_OPT_LAST
 	};
 	lc_opt_entry_t *be_grp    = lc_opt_get_grp(firm_opt_get_root(), "be");
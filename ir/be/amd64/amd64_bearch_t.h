@@ -23,6 +23,7 @@ extern pmap *amd64_constants; /**< A map of entities that store const tarvals */
 extern ir_mode *amd64_mode_xmm;
 
 extern bool amd64_use_red_zone;
+extern bool amd64_use_burs;
 
 #define AMD64_REGISTER_SIZE   8
 /** power of two stack alignment on calls */
@@ -48,6 +49,12 @@ int amd64_get_sp_change(ir_node *const node);
 
 void amd64_cconv_init(void);
 
+/**
+ * Records the registers clobbered by @p irg for interprocedural register
+ * allocation.
+ */
+void amd64_record_clobbers(ir_graph *irg);
+
 void amd64_adjust_pic(ir_graph *irg);
 
 void amd64_simulate_graph_x87(ir_graph *irg);
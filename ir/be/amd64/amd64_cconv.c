@@ -16,6 +16,7 @@
 #include "amd64_bearch_t.h"
 #include "be_t.h"
 #include "becconv.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bitfiddle.h"
 #include "gen_amd64_regalloc_if.h"
@@ -221,6 +222,25 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 	return cconv;
 }
 
+void amd64_record_clobbers(ir_graph *const irg)
+{
+	/* the x87 register stack is not refined, it has to be empty at calls
+	 * anyway */
+	static const unsigned x87_regs[] = {
+		REG_ST0,
+		REG_ST1,
+		REG_ST2,
+		REG_ST3,
+		REG_ST4,
+		REG_ST5,
+		REG_ST6,
+		REG_ST7,
+	};
+	unsigned *const always_clobbered = rbitset_alloca(N_AMD64_REGISTERS);
+	be_cconv_add_regs(always_clobbered, x87_regs, ARRAY_SIZE(x87_regs));
+	be_ipra_record_clobbers(irg, always_clobbered);
+}
+
 void amd64_cconv_init(void)
 {
 	static const unsigned common_caller_saves[] = {
@@ -844,13 +844,16 @@ void amd64_emit_function(ir_graph *irg)
 	/* register all emitter functions */
 	amd64_register_emitters();
 
-	ir_node **blk_sched = be_create_block_schedule(irg);
+	ir_node **blk_sched  = be_create_block_schedule(irg);
+	ir_node  *cold_block = be_split_cold_blocks(irg, blk_sched);
 
 	be_gas_emit_function_prolog(entity, 4, NULL);
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 
 	be_emit_init_cf_links(blk_sched);
+	if (cold_block != NULL)
+		be_emit_mark_fragment_start(cold_block);
 
 	amd64_irg_data_t const *const irg_data = amd64_get_irg_data(irg);
 	omit_fp = irg_data->omit_fp;
@@ -870,6 +873,8 @@ void amd64_emit_function(ir_graph *irg)
 
 	for (size_t i = 0, n = ARR_LEN(blk_sched); i < n; ++i) {
 		ir_node *block = blk_sched[i];
+		if (block == cold_block)
+			be_gas_begin_cold_fragment(entity);
 		amd64_gen_block(block);
 	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
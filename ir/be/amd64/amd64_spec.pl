@@ -253,6 +253,20 @@ my $cvtopx2i = {
 	emit      => "{name} %AM, %D0",
 };
 
+# packed SSE operation on full xmm registers, register operands only (memory
+# operands of packed instructions would have to be aligned)
+my $packedop = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "xmm", "xmm" ],
+	out_reqs  => [ "in_r0 !in_r1" ],
+	ins       => [ "left", "right" ],
+	outs      => [ "res" ],
+	attr_type => "amd64_attr_t",
+	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n"
+	            ."x86_insn_size_t size    = X86_SIZE_128;\n",
+	emit      => "{name} %^S1, %^D0",
+};
+
 my $movopx = {
 	state     => "exc_pinned",
 	in_reqs   => "...",
@@ -263,6 +277,19 @@ my $movopx = {
 	emit      => "{name} %AM, %D0",
 };
 
+my $prefetchop = {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	in_reqs   => "...",
+	out_reqs  => [ "mem" ],
+	outs      => [ "M" ],
+	attr_type => "amd64_addr_attr_t",
+	attr      => "x86_addr_t addr",
+	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_ADDR;\n"
+	            ."x86_insn_size_t size    = X86_SIZE_8;\n",
+	emit      => "{name} %A",
+};
+
 my $x87const = {
 	op_flags  => [ "constlike" ],
 	irn_flags => [ "rematerializable" ],
@@ -531,6 +558,14 @@ mov_store => {
 	emit      => "mov%M %AM",
 },
 
+prefetcht0 => { template => $prefetchop },
+
+prefetcht1 => { template => $prefetchop },
+
+prefetcht2 => { template => $prefetchop },
+
+prefetchnta => { template => $prefetchop },
+
 jmp_switch => {
 	op_flags  => [ "cfopcode", "forking" ],
 	state     => "pinned",
@@ -654,6 +689,67 @@ pxor_0 => {
 	emit      => "pxor %^D0, %^D0",
 },
 
+# Packed operations, used for vector modes
+
+paddb => { template => $packedop },
+
+paddw => { template => $packedop },
+
+paddd => { template => $packedop },
+
+paddq => { template => $packedop },
+
+psubb => { template => $packedop },
+
+psubw => { template => $packedop },
+
+psubd => { template => $packedop },
+
+psubq => { template => $packedop },
+
+pmullw => { template => $packedop },
+
+pand => { template => $packedop },
+
+pandn => { template => $packedop },
+
+por => { template => $packedop },
+
+pxor => { template => $packedop },
+
+pcmpgtd => { template => $packedop },
+
+pminub => { template => $packedop },
+
+pmaxub => { template => $packedop },
+
+pminsw => { template => $packedop },
+
+pmaxsw => { template => $packedop },
+
+addps => { template => $packedop },
+
+addpd => { template => $packedop },
+
+subps => { template => $packedop },
+
+subpd_packed => {
+	template => $packedop,
+	emit     => "subpd %^S1, %^D0",
+},
+
+mulps => { template => $packedop },
+
+mulpd => { template => $packedop },
+
+minps => { template => $packedop },
+
+maxps => { template => $packedop },
+
+minpd => { template => $packedop },
+
+maxpd => { template => $packedop },
+
 # Conversion operations
 
 cvtss2sd => { template => $cvtop2x },
@@ -855,3 +951,77 @@ fpop => {
 },
 
 );
+
+# Operations of the BURS patterns, which are not matched by is_<Op>().
+%burs_ops = (
+	# the result of a Load usable as source address mode operand
+	Load => {
+		match => "amd64_burs_match_load",
+		kids  => [ "amd64_burs_get_load_ptr" ],
+	},
+);
+
+# Tree patterns of the generated instruction selector used with -bamd64-burs,
+# see generate_burs.pl. The costs count instructions; of rules with equal
+# cost the first one wins.
+@burs_rules = (
+	# immediates and address modes
+	{ rule => "imm: Const",              cond => "amd64_burs_is_imm32(node)", action => "imm" },
+	{ rule => "index: reg",              action => "index" },
+	{ rule => "index: Shl(reg, Const)",  cond => "amd64_burs_is_scale(k1)", action => "index_scaled" },
+	{ rule => "bi: Add(reg, index)",     commutative => 1, action => "base_index" },
+	{ rule => "addr: reg",               action => "addr_base" },
+	{ rule => "addr: bi",                action => "addr_base_index" },
+	{ rule => "addr: Add(reg, imm)",     action => "addr_base_disp" },
+	{ rule => "addr: Add(bi, imm)",      action => "addr_base_index_disp" },
+	{ rule => "mem: Load(addr)",         action => "mem" },
+
+	# integer ALU
+	{ rule => "reg: addr",               cost => 1, action => "lea" },
+	{ rule => "reg: Add(reg, mem)",      cost => 1, commutative => 1, cond => "amd64_burs_am_independent(k1, k0)", action => "binop_am" },
+	{ rule => "reg: Sub(reg, reg)",      cost => 1, action => "binop" },
+	{ rule => "reg: Sub(reg, imm)",      cost => 1, action => "binop_imm" },
+	{ rule => "reg: And(reg, Const)",    cost => 1, cond => "amd64_burs_is_zext_mask(k1)", action => "zext" },
+	{ rule => "reg: And(reg, reg)",      cost => 1, action => "binop" },
+	{ rule => "reg: And(reg, imm)",      cost => 1, action => "binop_imm" },
+	{ rule => "reg: And(reg, mem)",      cost => 1, commutative => 1, cond => "amd64_burs_am_independent(k1, k0)", action => "binop_am" },
+	{ rule => "reg: Or(reg, reg)",       cost => 1, action => "binop" },
+	{ rule => "reg: Or(reg, imm)",       cost => 1, action => "binop_imm" },
+	{ rule => "reg: Or(reg, mem)",       cost => 1, commutative => 1, cond => "amd64_burs_am_independent(k1, k0)", action => "binop_am" },
+	{ rule => "reg: Eor(reg, reg)",      cost => 1, action => "binop" },
+	{ rule => "reg: Eor(reg, imm)",      cost => 1, action => "binop_imm" },
+	{ rule => "reg: Eor(reg, mem)",      cost => 1, commutative => 1, cond => "amd64_burs_am_independent(k1, k0)", action => "binop_am" },
+	{ rule => "reg: Shl(reg, Const)",    cost => 1, cond => "is_irn_one(k1)", action => "lea_double" },
+	{ rule => "reg: Shl(reg, Const)",    cost => 1, action => "shift_imm" },
+	{ rule => "reg: Shl(reg, reg)",      cost => 1, action => "shift" },
+	{ rule => "reg: Shr(reg, Const)",    cost => 1, action => "shift_imm" },
+	{ rule => "reg: Shr(reg, reg)",      cost => 1, action => "shift" },
+	{ rule => "reg: Shrs(reg, Const)",   cost => 1, action => "shift_imm" },
+	{ rule => "reg: Shrs(reg, reg)",     cost => 1, action => "shift" },
+
+	# compare and branch
+	{ rule => "flags: Cmp(reg, reg)",    cost => 1, cond => "amd64_burs_is_gp_cmp(node)", action => "cmp" },
+	{ rule => "flags: Cmp(reg, imm)",    cost => 1, cond => "amd64_burs_is_gp_cmp(node)", action => "cmp_imm" },
+	{ rule => "flags: Cmp(reg, mem)",    cost => 1, cond => "amd64_burs_is_gp_cmp(node) && amd64_burs_am_independent(k1, k0)", action => "cmp_am" },
+	{ rule => "flags: Cmp(And(reg, reg), Const)", cost => 1, cond => "amd64_burs_is_gp_cmp(node) && is_irn_null(k1)", action => "test" },
+	{ rule => "flags: Cmp(And(reg, imm), Const)", cost => 1, cond => "amd64_burs_is_gp_cmp(node) && is_irn_null(k1)", action => "test_imm" },
+	{ rule => "stmt: Cond(flags)",       cost => 1, action => "jcc" },
+);
+
+# Peephole rules applied after register allocation, see generate_peephole.pl.
+@peephole_rules = (
+	{ match => "amd64_cmp",      action => "cmp_zero" },
+	{ match => "amd64_lea",      free => [ "eflags" ], action => "lea_to_add" },
+	{ match => "amd64_mov_imm",  free => [ "eflags" ], action => "mov_zero" },
+	# mov_gp zero extends, so a mov_gp of a not larger mov_gp in the same
+	# register is redundant, e.g. movzwl (%r1), %r2; movzwl %r2, %r2
+	{ match => "amd64_mov_gp(p:Proj(op:amd64_mov_gp))", same_reg => [ "node", "p", "op" ],
+	  cond => "get_amd64_addr_attr_const(node)->addr.variant == X86_ADDR_REG && get_amd64_attr_const(node)->size >= get_amd64_attr_const(op)->size",
+	  replace => "p" },
+	# merge stack pointer adjustments
+	{ match => "be_IncSP(pred:be_IncSP)", one_user => [ "pred" ],
+	  code => "be_set_IncSP_offset(pred, be_get_IncSP_offset(pred) + be_get_IncSP_offset(node));",
+	  replace => "pred" },
+	{ match => "amd64_cvtsi2sd", action => "cvtsi2sX" },
+	{ match => "amd64_cvtsi2ss", action => "cvtsi2sX" },
+);
@@ -15,11 +15,13 @@
 #include "amd64_new_nodes.h"
 #include "amd64_nodes_attr.h"
 #include "amd64_varargs.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "benode.h"
 #include "besched.h"
 #include "betranshlp.h"
 #include "debug.h"
+#include "gen_amd64_burs.h"
 #include "gen_amd64_regalloc_if.h"
 #include "heights.h"
 #include "ircons.h"
@@ -985,6 +987,112 @@ static x86_insn_size_t get_size_32_64_from_mode(ir_mode *const mode)
 	return get_mode_size_bits(mode) <= 32 ? X86_SIZE_32 : X86_SIZE_64;
 }
 
+typedef ir_node *(*construct_packed_func)(dbg_info *dbgi, ir_node *block,
+                                          ir_node *left, ir_node *right);
+
+static bool is_sse_float_mode(ir_mode const *const mode)
+{
+	return mode == mode_F || mode == mode_D;
+}
+
+/**
+ * Returns the constructor of the packed SSE2 instruction performing @p op on
+ * the lanes of vector mode @p mode or NULL if there is none.
+ */
+static construct_packed_func get_packed_func(ir_op const *const op,
+                                             ir_mode const *const mode)
+{
+	if (get_mode_size_bytes(mode) != 16)
+		return NULL;
+	ir_mode *const elem = get_mode_vector_element_mode(mode);
+	if (mode_is_float(elem)) {
+		if (!is_sse_float_mode(elem))
+			return NULL;
+		bool const d = elem == mode_D;
+		if (op == op_Add)
+			return d ? &new_bd_amd64_addpd : &new_bd_amd64_addps;
+		if (op == op_Sub)
+			return d ? &new_bd_amd64_subpd_packed : &new_bd_amd64_subps;
+		if (op == op_Mul)
+			return d ? &new_bd_amd64_mulpd : &new_bd_amd64_mulps;
+		return NULL;
+	}
+
+	unsigned const bits = get_mode_size_bits(elem);
+	if (op == op_Add) {
+		switch (bits) {
+		case  8: return &new_bd_amd64_paddb;
+		case 16: return &new_bd_amd64_paddw;
+		case 32: return &new_bd_amd64_paddd;
+		case 64: return &new_bd_amd64_paddq;
+		}
+	} else if (op == op_Sub) {
+		switch (bits) {
+		case  8: return &new_bd_amd64_psubb;
+		case 16: return &new_bd_amd64_psubw;
+		case 32: return &new_bd_amd64_psubd;
+		case 64: return &new_bd_amd64_psubq;
+		}
+	} else if (op == op_Mul) {
+		/* pmulld needs SSE4.1 */
+		if (bits == 16)
+			return &new_bd_amd64_pmullw;
+	} else if (op == op_And) {
+		return &new_bd_amd64_pand;
+	} else if (op == op_Or) {
+		return &new_bd_amd64_por;
+	} else if (op == op_Eor) {
+		return &new_bd_amd64_pxor;
+	}
+	return NULL;
+}
+
+/**
+ * Returns the constructor of the packed minimum (@p max false) or maximum
+ * instruction for vector mode @p mode, NULL if there is none.
+ */
+static construct_packed_func get_packed_minmax_func(ir_mode const *const mode,
+                                                    bool const max)
+{
+	ir_mode *const elem = get_mode_vector_element_mode(mode);
+	if (elem == mode_F)
+		return max ? &new_bd_amd64_maxps : &new_bd_amd64_minps;
+	if (elem == mode_D)
+		return max ? &new_bd_amd64_maxpd : &new_bd_amd64_minpd;
+	if (elem == mode_Bu)
+		return max ? &new_bd_amd64_pmaxub : &new_bd_amd64_pminub;
+	if (elem == mode_Hs)
+		return max ? &new_bd_amd64_pmaxsw : &new_bd_amd64_pminsw;
+	return NULL;
+}
+
+bool amd64_allow_vector_op(ir_op const *const op, ir_mode const *const mode)
+{
+	if (get_mode_size_bytes(mode) != 16)
+		return false;
+	if (op == op_Mux) {
+		/* signed 32 bit lanes are selected with a compare mask */
+		return get_packed_minmax_func(mode, false) != NULL
+		    || get_mode_vector_element_mode(mode) == mode_Is;
+	}
+	return get_packed_func(op, mode) != NULL;
+}
+
+static ir_node *gen_packed_binop(ir_node *const node, ir_node *const op1,
+                                 ir_node *const op2)
+{
+	construct_packed_func const cons
+		= get_packed_func(get_irn_op(node), get_irn_mode(node));
+	if (cons == NULL)
+		panic("no packed instruction for %+F", node);
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_op1   = be_transform_node(op1);
+	ir_node  *const new_op2   = be_transform_node(op2);
+	return cons(dbgi, new_block, new_op1, new_op2);
+}
+
 static ir_node *gen_Add(ir_node *const node)
 {
 	ir_node *const op1   = get_Add_left(node);
@@ -992,6 +1100,8 @@ static ir_node *gen_Add(ir_node *const node)
 	ir_mode *const mode  = get_irn_mode(node);
 	ir_node *const block = get_nodes_block(node);
 
+	if (mode_is_vector(mode))
+		return gen_packed_binop(node, op1, op2);
 	if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fadd);
@@ -1032,6 +1142,8 @@ static ir_node *gen_Sub(ir_node *const node)
 	ir_node *const op2  = get_Sub_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
+	if (mode_is_vector(mode))
+		return gen_packed_binop(node, op1, op2);
 	if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fsub);
@@ -1055,6 +1167,8 @@ static ir_node *gen_And(ir_node *const node)
 {
 	ir_node *const op1 = get_And_left(node);
 	ir_node *const op2 = get_And_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_packed_binop(node, op1, op2);
 
 	/* Is it a zero extension? */
 	if (is_Const(op2)) {
@@ -1085,6 +1199,8 @@ static ir_node *gen_Eor(ir_node *const node)
 {
 	ir_node *const op1 = get_Eor_left(node);
 	ir_node *const op2 = get_Eor_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_packed_binop(node, op1, op2);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_xor, pn_amd64_xor_res,
 	                    match_immediate | match_am | match_mode_neutral
 	                    | match_commutative);
@@ -1094,6 +1210,8 @@ static ir_node *gen_Or(ir_node *const node)
 {
 	ir_node *const op1 = get_Or_left(node);
 	ir_node *const op2 = get_Or_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_packed_binop(node, op1, op2);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_or, pn_amd64_or_res,
 	                    match_immediate | match_am | match_mode_neutral
 	                    | match_commutative);
@@ -1105,7 +1223,9 @@ static ir_node *gen_Mul(ir_node *const node)
 	ir_node *const op2  = get_Mul_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (get_mode_size_bits(mode) < 16) {
+	if (mode_is_vector(mode)) {
+		return gen_packed_binop(node, op1, op2);
+	} else if (get_mode_size_bits(mode) < 16) {
 		/* imulb only supports rax - reg form */
 		ir_node *new_node
 			= gen_binop_rax(node, op1, op2, new_bd_amd64_imul_1op,
@@ -1123,6 +1243,58 @@ static ir_node *gen_Mul(ir_node *const node)
 	}
 }
 
+/**
+ * Only vector Muxes selecting the lane-wise minimum or maximum are supported:
+ * Mux(left < right, right, left), Mux(left > right, right, left) and their
+ * mirrored forms.
+ */
+static ir_node *gen_Mux(ir_node *const node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	ir_node *const sel  = get_Mux_sel(node);
+	if (!mode_is_vector(mode) || !is_Cmp(sel))
+		panic("cannot transform %+F", node);
+
+	ir_node    *left     = get_Cmp_left(sel);
+	ir_node    *right    = get_Cmp_right(sel);
+	ir_relation relation = get_Cmp_relation(sel);
+	if (!mode_is_float(get_mode_vector_element_mode(mode))) {
+		/* equal lanes make the selection irrelevant */
+		relation &= ~ir_relation_unordered;
+		if (relation == ir_relation_less_equal)
+			relation = ir_relation_less;
+		else if (relation == ir_relation_greater_equal)
+			relation = ir_relation_greater;
+	}
+	if (get_Mux_true(node) == right && get_Mux_false(node) == left) {
+		ir_node *const t = left;
+		left     = right;
+		right    = t;
+		relation = get_inversed_relation(relation);
+	}
+	if (get_Mux_true(node) != left || get_Mux_false(node) != right
+	 || (relation != ir_relation_less && relation != ir_relation_greater))
+		panic("unsupported vector %+F", node);
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_left  = be_transform_node(left);
+	ir_node  *const new_right = be_transform_node(right);
+	bool      const max       = relation == ir_relation_greater;
+	construct_packed_func const cons = get_packed_minmax_func(mode, max);
+	if (cons != NULL)
+		return cons(dbgi, new_block, new_left, new_right);
+
+	/* res = (left & mask) | (right & ~mask) with mask = left REL right */
+	assert(get_mode_vector_element_mode(mode) == mode_Is);
+	ir_node *const mask = max
+		? new_bd_amd64_pcmpgtd(dbgi, new_block, new_left, new_right)
+		: new_bd_amd64_pcmpgtd(dbgi, new_block, new_right, new_left);
+	ir_node *const res_left  = new_bd_amd64_pand(dbgi, new_block, mask, new_left);
+	ir_node *const res_right = new_bd_amd64_pandn(dbgi, new_block, mask, new_right);
+	return new_bd_amd64_por(dbgi, new_block, res_left, res_right);
+}
+
 static ir_node *gen_Mulh(ir_node *const node)
 {
 	ir_node *const op1  = get_Mulh_left(node);
@@ -1747,7 +1919,10 @@ static ir_node *make_store_for_mode(ir_mode *const mode, dbg_info *const dbgi, i
 {
 	construct_binop_func               cons;
 	arch_register_req_t const **const *reqs;
-	if (!mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		cons = &new_bd_amd64_movdqu_store;
+		reqs = xmm_am_reqs;
+	} else if (!mode_is_float(mode)) {
 		cons = &new_bd_amd64_mov_store;
 		reqs = gp_am_reqs;
 	} else if (mode == x86_mode_E) {
@@ -1956,6 +2131,10 @@ no_call_mem:;
 
 	assert(in_arity <= (int)max_inputs);
 
+	/* calls of already compiled local functions only clobber the registers
+	 * actually used by the callee */
+	be_ipra_restrict_caller_saves(get_Call_callee(node), cconv->caller_saves);
+
 	/* count outputs */
 	unsigned       o              = pn_amd64_call_first_result;
 	unsigned const n_caller_saves = rbitset_popcount(cconv->caller_saves, N_AMD64_REGISTERS);
@@ -2151,6 +2330,8 @@ static ir_node *gen_Phi(ir_node *const node)
 		req = mode == x86_mode_E
 		    ? &amd64_class_reg_req_x87
 		    : &amd64_class_reg_req_xmm;
+	} else if (mode_is_vector(mode)) {
+		req = &amd64_class_reg_req_xmm;
 	} else {
 		req = arch_memory_req;
 	}
@@ -2669,7 +2850,7 @@ ir_node *amd64_new_spill(ir_node *const value, ir_node *const after)
 	return store;
 }
 
-static ir_node *create_sse_spill(dbg_info *const dbgi, ir_node *const block,
+static ir_node *create_movdqu(dbg_info *const dbgi, ir_node *const block,
                                  int const arity, ir_node *const *const in,
                                  arch_register_req_t const **const in_reqs,
                                  x86_insn_size_t const size, amd64_op_mode_t const op_mode,
@@ -2707,7 +2888,7 @@ ir_node *amd64_new_reload(ir_node *value, ir_node *spill, ir_node *before)
 		pn_res = pn_amd64_fld_res;
 	} else {
 		size   = X86_SIZE_128;
-		cons   = &create_sse_spill;
+		cons   = &create_movdqu;
 		pn_res = pn_amd64_movdqu_res;
 	}
 	ir_node *const load = cons(NULL, block, ARRAY_SIZE(in), in, reg_mem_reqs,
@@ -2742,6 +2923,7 @@ static ir_node *gen_Load(ir_node *const node)
 	assert((size_t)arity <= ARRAY_SIZE(in));
 
 	create_mov_func   const cons      =
+		mode_is_vector(mode)                                  ? &create_movdqu :
 		mode_is_float(mode)                                   ?
 			(mode == x86_mode_E ? new_bd_amd64_fld : &new_bd_amd64_movs_xmm) :
 		get_mode_size_bits(mode) < 64 && mode_is_signed(mode) ? &new_bd_amd64_movs     :
@@ -2757,7 +2939,7 @@ static ir_node *gen_Unknown(ir_node *const node)
 {
 	ir_node *const block = be_transform_nodes_block(node);
 	ir_mode *const mode  = get_irn_mode(node);
-	if (mode_is_float(mode)) {
+	if (mode_is_float(mode) || mode_is_vector(mode)) {
 		return be_new_Unknown(block, &amd64_class_reg_req_xmm);
 	} else if (be_mode_needs_gp_reg(mode)) {
 		return be_new_Unknown(block, &amd64_class_reg_req_gp);
@@ -2807,6 +2989,13 @@ static ir_node *gen_Proj_Load(ir_node *const node)
 			return be_new_Proj(new_load, pn_amd64_movs_M);
 		}
 		break;
+	case iro_amd64_movdqu:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_M);
+		}
+		break;
 	case iro_amd64_fld:
 		if (pn == pn_Load_res) {
 			return be_new_Proj(new_load, pn_amd64_fld_res);
@@ -2817,6 +3006,8 @@ static ir_node *gen_Proj_Load(ir_node *const node)
 	case iro_amd64_add:
 	case iro_amd64_and:
 	case iro_amd64_cmp:
+	case iro_amd64_or:
+	case iro_amd64_xor:
 		assert(pn == pn_Load_M);
 		return be_new_Proj(new_load, pn_amd64_mem);
 	default:
@@ -3134,6 +3325,37 @@ static ir_node *gen_va_start(ir_node *const node)
 	return amd64_initialize_va_list(dbgi, block, current_cconv, mem, ap, fp);
 }
 
+static ir_node *gen_prefetch(ir_node *const node)
+{
+	dbg_info *const dbgi     = get_irn_dbg_info(node);
+	ir_node  *const block    = be_transform_nodes_block(node);
+	ir_node  *const ptr      = get_Builtin_param(node, 0);
+	ir_node  *const mem      = get_Builtin_mem(node);
+	size_t    const n_params = get_Builtin_n_params(node);
+	/* note: the rw argument is ignored, prefetchw is not part of x86_64 */
+	long      const locality = n_params > 2 ? get_Const_long(get_Builtin_param(node, 2)) : 3;
+
+	int arity = 0;
+	ir_node *in[3];
+	x86_addr_t addr;
+	perform_address_matching(ptr, &arity, in, &addr);
+
+	arch_register_req_t const **const reqs = gp_am_reqs[arity];
+	int mem_input  = arity++;
+	in[mem_input]  = be_transform_node(mem);
+	addr.mem_input = mem_input;
+
+	ir_node *new_node;
+	switch (locality) {
+	case 0:  new_node = new_bd_amd64_prefetchnta(dbgi, block, arity, in, reqs, addr); break;
+	case 1:  new_node = new_bd_amd64_prefetcht2(dbgi, block, arity, in, reqs, addr);  break;
+	case 2:  new_node = new_bd_amd64_prefetcht1(dbgi, block, arity, in, reqs, addr);  break;
+	default: new_node = new_bd_amd64_prefetcht0(dbgi, block, arity, in, reqs, addr);  break;
+	}
+	set_irn_pinned(new_node, get_irn_pinned(node));
+	return new_node;
+}
+
 static ir_node *gen_Builtin(ir_node *const node)
 {
 	ir_builtin_kind const kind = get_Builtin_kind(node);
@@ -3150,6 +3372,8 @@ static ir_node *gen_Builtin(ir_node *const node)
 		return gen_saturating_increment(node);
 	case ir_bk_va_start:
 		return gen_va_start(node);
+	case ir_bk_prefetch:
+		return gen_prefetch(node);
 	default:
 		break;
 	}
@@ -3179,6 +3403,7 @@ static ir_node *gen_Proj_Builtin(ir_node *const proj)
 	case ir_bk_saturating_increment:
 		return be_new_Proj(new_node, pn_amd64_sbb_res);
 	case ir_bk_va_start:
+	case ir_bk_prefetch:
 		assert(get_Proj_num(proj) == pn_Builtin_M);
 		return new_node;
 	default:
@@ -3233,26 +3458,414 @@ static ir_node *gen_amd64_l_haddpd(ir_node *const node)
 	return gen_binop_xmm(node, op0, op1, new_bd_amd64_haddpd, match_am);
 }
 
+bool amd64_use_burs = false;
+
+static bool burs_mode_ok(ir_node const *const node)
+{
+	if (is_Cond(node))
+		return is_Cmp(get_Cond_selector(node));
+	ir_mode *const mode = is_Cmp(node) ? get_irn_mode(get_Cmp_left(node))
+	                                   : get_irn_mode(node);
+	return mode_needs_gp_reg(mode) && get_mode_size_bits(mode) >= 32;
+}
+
+bool amd64_burs_can_fold(ir_node const *const node)
+{
+	if (is_Const(node))
+		return true;
+	/* like x86_create_address_mode() duplicate address arithmetic into all
+	 * its users, unless it has to be materialized anyway */
+	if ((is_Add(node) || is_Shl(node)) && get_irn_n_edges(node) > 1)
+		return burs_mode_ok(node) && !x86_is_non_address_mode_node(node);
+	if (!burs_mode_ok(node) || get_irn_n_edges(node) != 1
+	 || be_is_transformed(node))
+		return false;
+	/* only cover trees within a block, as with source address mode */
+	ir_edge_t const *const edge = get_irn_out_edge_first(node);
+	return get_nodes_block(get_edge_src_irn(edge)) == get_nodes_block(node);
+}
+
+amd64_burs_nt_t amd64_burs_leaf_nt(ir_node const *const node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	if (mode == mode_b)
+		return amd64_burs_nt_flags;
+	if (mode_needs_gp_reg(mode))
+		return amd64_burs_nt_reg;
+	return amd64_burs_nt_none;
+}
+
+bool amd64_burs_is_imm32(ir_node const *const node)
+{
+	if (!mode_needs_gp_reg(get_irn_mode(node)))
+		return false;
+	x86_imm32_t imm = { .kind = X86_IMM_VALUE };
+	return match_immediate_32(&imm, node, false);
+}
+
+bool amd64_burs_is_scale(ir_node const *const node)
+{
+	ir_tarval *const tv = get_Const_tarval(node);
+	if (!tarval_is_long(tv))
+		return false;
+	long const scale = get_tarval_long(tv);
+	return 1 <= scale && scale <= 3;
+}
+
+bool amd64_burs_is_zext_mask(ir_node const *const node)
+{
+	ir_tarval *const tv = get_Const_tarval(node);
+	if (!tarval_is_long(tv))
+		return false;
+	uint64_t const v = get_tarval_uint64(tv);
+	return v == 0xFF || v == 0xFFFF || v == 0xFFFFFFFF;
+}
+
+bool amd64_burs_is_gp_cmp(ir_node const *const node)
+{
+	return burs_mode_ok(node);
+}
+
+bool amd64_burs_am_independent(ir_node *const proj, ir_node *const other)
+{
+	if (!amd64_burs_match_load(proj))
+		return false;
+	return !input_depends_on_load(get_Proj_pred(proj), other);
+}
+
+bool amd64_burs_match_load(ir_node const *const node)
+{
+	if (!is_Proj(node) || get_Proj_num(node) != pn_Load_res)
+		return false;
+	ir_node const *const load = get_Proj_pred(node);
+	return is_Load(load) && burs_mode_ok(node);
+}
+
+ir_node *amd64_burs_get_load_ptr(ir_node const *const node)
+{
+	return get_Load_ptr(get_Proj_pred(node));
+}
+
+static void burs_reduce_imm(ir_node *const node, x86_imm32_t *const imm)
+{
+	bool const ok = match_immediate_32(imm, node, false);
+	assert(ok);
+	(void)ok;
+}
+
+static void burs_reduce_index(ir_node *const node, int *const arity,
+                              ir_node **const in, x86_addr_t *const addr)
+{
+	ir_node       *kids[2];
+	unsigned const rule = amd64_burs_rule(node, amd64_burs_nt_index, false);
+	amd64_burs_kids(node, rule, kids);
+	switch (amd64_burs_get_action(rule)) {
+	case amd64_burs_act_index:
+		break;
+	case amd64_burs_act_index_scaled:
+		addr->log_scale = get_Const_long(get_Shl_right(node));
+		break;
+	default:
+		panic("unexpected index rule %s", amd64_burs_get_rule_name(rule));
+	}
+	addr->index_input = (*arity)++;
+	in[addr->index_input] = be_transform_node(kids[0]);
+}
+
+static void burs_reduce_base_index(ir_node *const node, bool const root,
+                                   int *const arity, ir_node **const in,
+                                   x86_addr_t *const addr)
+{
+	ir_node       *kids[2];
+	unsigned const rule = amd64_burs_rule(node, amd64_burs_nt_bi, root);
+	if (amd64_burs_get_action(rule) != amd64_burs_act_base_index)
+		panic("unexpected base index rule %s", amd64_burs_get_rule_name(rule));
+	amd64_burs_kids(node, rule, kids);
+	addr->base_input = (*arity)++;
+	in[addr->base_input] = be_transform_node(kids[0]);
+	burs_reduce_index(kids[1], arity, in, addr);
+	addr->variant = X86_ADDR_BASE_INDEX;
+}
+
+static void burs_reduce_addr(ir_node *const node, bool const root,
+                             int *const arity, ir_node **const in,
+                             x86_addr_t *const addr)
+{
+	ir_node       *kids[2];
+	unsigned const rule = amd64_burs_rule(node, amd64_burs_nt_addr, root);
+	amd64_burs_kids(node, rule, kids);
+	switch (amd64_burs_get_action(rule)) {
+	case amd64_burs_act_addr_base:
+		assert(!root);
+		addr->base_input = (*arity)++;
+		in[addr->base_input] = be_transform_node(kids[0]);
+		addr->variant = X86_ADDR_BASE;
+		return;
+	case amd64_burs_act_addr_base_index:
+		burs_reduce_base_index(kids[0], root, arity, in, addr);
+		return;
+	case amd64_burs_act_addr_base_disp:
+		addr->base_input = (*arity)++;
+		in[addr->base_input] = be_transform_node(kids[0]);
+		addr->variant = X86_ADDR_BASE;
+		burs_reduce_imm(kids[1], &addr->immediate);
+		return;
+	case amd64_burs_act_addr_base_index_disp:
+		burs_reduce_base_index(kids[0], false, arity, in, addr);
+		burs_reduce_imm(kids[1], &addr->immediate);
+		return;
+	default:
+		panic("unexpected address rule %s", amd64_burs_get_rule_name(rule));
+	}
+}
+
+/**
+ * Folds the Load result @p node as source address mode operand into @p args,
+ * like match_binop() does.
+ */
+static void burs_reduce_mem(ir_node *const node, amd64_args_t *const args)
+{
+	ir_node       *kids[1];
+	unsigned const rule = amd64_burs_rule(node, amd64_burs_nt_mem, false);
+	if (amd64_burs_get_action(rule) != amd64_burs_act_mem)
+		panic("unexpected memory rule %s", amd64_burs_get_rule_name(rule));
+	amd64_burs_kids(node, rule, kids);
+
+	ir_node    *const load = get_Proj_pred(node);
+	x86_addr_t *const addr = &args->attr.base.addr;
+	burs_reduce_addr(kids[0], false, &args->arity, args->in, addr);
+	args->reqs = gp_am_reqs[args->arity];
+
+	int const mem_input = args->arity++;
+	args->in[mem_input] = be_transform_node(get_Load_mem(load));
+	addr->mem_input     = mem_input;
+	args->mem_proj      = get_Proj_for_pn(load, pn_Load_M);
+	args->attr.base.base.op_mode = AMD64_OP_REG_ADDR;
+}
+
+static void burs_binop_args(amd64_args_t *const args, ir_mode *const mode,
+                            amd64_burs_action_t const action,
+                            ir_node *const op1, ir_node *const op2)
+{
+	memset(args, 0, sizeof(*args));
+	amd64_binop_addr_attr_t *const attr = &args->attr;
+	attr->base.base.size = x86_size_from_mode(mode);
+
+	x86_addr_t *const addr = &attr->base.addr;
+	int         const reg_input = args->arity++;
+	switch (action) {
+	case amd64_burs_act_binop_am:
+	case amd64_burs_act_cmp_am:
+		attr->u.reg_input   = reg_input;
+		args->in[reg_input] = be_transform_node(op1);
+		burs_reduce_mem(op2, args);
+		return;
+	case amd64_burs_act_binop_imm:
+	case amd64_burs_act_cmp_imm:
+	case amd64_burs_act_test_imm:
+		args->in[reg_input]     = be_transform_node(op1);
+		addr->variant           = X86_ADDR_REG;
+		addr->base_input        = reg_input;
+		attr->base.base.op_mode = AMD64_OP_REG_IMM;
+		args->reqs              = reg_reqs;
+		burs_reduce_imm(op2, &attr->u.immediate);
+		return;
+	default: {
+		int const reg_input1 = args->arity++;
+		args->in[reg_input]     = be_transform_node(op1);
+		args->in[reg_input1]    = be_transform_node(op2);
+		addr->variant           = X86_ADDR_REG;
+		addr->base_input        = reg_input;
+		attr->u.reg_input       = reg_input1;
+		attr->base.base.op_mode = AMD64_OP_REG_REG;
+		args->reqs              = amd64_reg_reg_reqs;
+		return;
+	}
+	}
+}
+
+static ir_node *gen_burs_binop(ir_node *const node,
+                               amd64_burs_action_t const action,
+                               ir_node *const op1, ir_node *const op2)
+{
+	construct_binop_func func;
+	unsigned             pn_res;
+	switch (get_irn_opcode(node)) {
+	case iro_Add: func = new_bd_amd64_add; pn_res = pn_amd64_add_res; break;
+	case iro_And: func = new_bd_amd64_and; pn_res = pn_amd64_and_res; break;
+	case iro_Eor: func = new_bd_amd64_xor; pn_res = pn_amd64_xor_res; break;
+	case iro_Or:  func = new_bd_amd64_or;  pn_res = pn_amd64_or_res;  break;
+	case iro_Sub: func = new_bd_amd64_sub; pn_res = pn_amd64_sub_res; break;
+	default:
+		panic("unexpected binop %+F", node);
+	}
+
+	amd64_args_t args;
+	burs_binop_args(&args, get_irn_mode(node), action, op1, op2);
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_node  = func(dbgi, new_block, args.arity, args.in, args.reqs, &args.attr);
+	fix_node_mem_proj(new_node, args.mem_proj);
+	arch_set_irn_register_req_out(new_node, 0, &amd64_requirement_gp_same_0);
+	return be_new_Proj(new_node, pn_res);
+}
+
+static ir_node *gen_burs_cmp(ir_node *const node,
+                             amd64_burs_action_t const action,
+                             ir_node *const op1, ir_node *const op2)
+{
+	bool const is_test = action == amd64_burs_act_test
+	                  || action == amd64_burs_act_test_imm;
+	amd64_args_t args;
+	burs_binop_args(&args, get_irn_mode(get_Cmp_left(node)), action, op1, op2);
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_node  = is_test
+		? new_bd_amd64_test(dbgi, new_block, args.arity, args.in, args.reqs, &args.attr)
+		: new_bd_amd64_cmp(dbgi, new_block, args.arity, args.in, args.reqs, &args.attr);
+	fix_node_mem_proj(new_node, args.mem_proj);
+	assert((unsigned)pn_amd64_test_flags == (unsigned)pn_amd64_cmp_flags);
+	return be_new_Proj(new_node, pn_amd64_cmp_flags);
+}
+
+static ir_node *gen_burs_shift(ir_node *const node)
+{
+	ir_node *const op1 = get_binop_left(node);
+	ir_node *const op2 = get_binop_right(node);
+	switch (get_irn_opcode(node)) {
+	case iro_Shl:
+		return gen_shift_binop(node, op1, op2, new_bd_amd64_shl,
+		                       pn_amd64_shl_res,
+		                       match_immediate | match_mode_neutral);
+	case iro_Shr:
+		return gen_shift_binop(node, op1, op2, new_bd_amd64_shr,
+		                       pn_amd64_shr_res, match_immediate);
+	case iro_Shrs:
+		return gen_shift_binop(node, op1, op2, new_bd_amd64_sar,
+		                       pn_amd64_sar_res, match_immediate);
+	default:
+		panic("unexpected shift %+F", node);
+	}
+}
+
+static ir_node *gen_burs_fallback(ir_node *const node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Add:  return gen_Add(node);
+	case iro_And:  return gen_And(node);
+	case iro_Cmp:  return gen_Cmp(node);
+	case iro_Cond: return gen_Cond(node);
+	case iro_Eor:  return gen_Eor(node);
+	case iro_Or:   return gen_Or(node);
+	case iro_Shl:  return gen_Shl(node);
+	case iro_Shr:  return gen_Shr(node);
+	case iro_Shrs: return gen_Shrs(node);
+	case iro_Sub:  return gen_Sub(node);
+	default:
+		panic("unexpected node %+F", node);
+	}
+}
+
+static ir_node *reduce_burs(ir_node *const node)
+{
+	unsigned rule = AMD64_BURS_RULE_NONE;
+	if (burs_mode_ok(node)) {
+		amd64_burs_nt_t const nt = is_Cond(node) ? amd64_burs_nt_stmt
+		                                         : amd64_burs_leaf_nt(node);
+		rule = amd64_burs_rule(node, nt, true);
+	}
+	if (rule <= AMD64_BURS_RULE_LEAF)
+		return gen_burs_fallback(node);
+
+	DB((dbg, LEVEL_2, "%+F: %s\n", node, amd64_burs_get_rule_name(rule)));
+	ir_node                  *kids[2];
+	amd64_burs_action_t const action = amd64_burs_get_action(rule);
+	amd64_burs_kids(node, rule, kids);
+	dbg_info *const dbgi = get_irn_dbg_info(node);
+	ir_mode  *const mode = get_irn_mode(node);
+	switch (action) {
+	case amd64_burs_act_lea: {
+		int        arity = 0;
+		ir_node   *in[2];
+		x86_addr_t addr;
+		memset(&addr, 0, sizeof(addr));
+		burs_reduce_addr(kids[0], true, &arity, in, &addr);
+		ir_node        *const new_block = be_transform_nodes_block(node);
+		x86_insn_size_t const size      = get_size_32_64_from_mode(mode);
+		ir_node        *const res       = new_bd_amd64_lea(dbgi, new_block, arity, in, amd64_reg_reg_reqs, size, addr);
+		x86_mark_non_am(node);
+		return res;
+	}
+	case amd64_burs_act_lea_double: {
+		ir_node        *const new_block = be_transform_nodes_block(node);
+		x86_insn_size_t const size      = get_size_32_64_from_mode(mode);
+		ir_node        *const new_op    = be_transform_node(kids[0]);
+		return create_add_lea(dbgi, new_block, size, new_op, new_op);
+	}
+	case amd64_burs_act_binop:
+	case amd64_burs_act_binop_imm:
+	case amd64_burs_act_binop_am:
+		return gen_burs_binop(node, action, kids[0], kids[1]);
+	case amd64_burs_act_zext: {
+		uint64_t const v = get_Const_long(get_And_right(node));
+		x86_insn_size_t const size = v == 0xFF   ? X86_SIZE_8
+		                           : v == 0xFFFF ? X86_SIZE_16
+		                                         : X86_SIZE_32;
+		ir_node *const block = get_nodes_block(node);
+		return match_mov(dbgi, block, kids[0], size, &new_bd_amd64_mov_gp, pn_amd64_mov_gp_res);
+	}
+	case amd64_burs_act_shift:
+	case amd64_burs_act_shift_imm:
+		return gen_burs_shift(node);
+	case amd64_burs_act_cmp:
+	case amd64_burs_act_cmp_imm:
+	case amd64_burs_act_cmp_am:
+	case amd64_burs_act_test:
+	case amd64_burs_act_test_imm:
+		return gen_burs_cmp(node, action, kids[0], kids[1]);
+	case amd64_burs_act_jcc:
+		return gen_Cond(node);
+	default:
+		panic("unexpected rule %s for %+F", amd64_burs_get_rule_name(rule), node);
+	}
+}
+
+/**
+ * Transforms @p node with the generated BURS labeler: the cheapest cover of
+ * the expression tree rooted at @p node is reduced, its register and flags
+ * operands are transformed on their own. Nodes not covered by any pattern
+ * are transformed by the hand-written code.
+ */
+static ir_node *gen_burs(ir_node *const node)
+{
+	amd64_burs_begin();
+	ir_node *const res = reduce_burs(node);
+	amd64_burs_end();
+	return res;
+}
+
 /* Boilerplate code for transformation: */
 
 static void amd64_register_transformers(void)
 {
 	be_start_transform_setup();
 
-	be_set_transform_function(op_Add,               gen_Add);
+	be_set_transform_function(op_Add,               amd64_use_burs ? gen_burs : gen_Add);
 	be_set_transform_function(op_Address,           gen_Address);
 	be_set_transform_function(op_Alloc,             gen_Alloc);
-	be_set_transform_function(op_And,               gen_And);
+	be_set_transform_function(op_And,               amd64_use_burs ? gen_burs : gen_And);
 	be_set_transform_function(op_ASM,               gen_ASM);
 	be_set_transform_function(op_Bitcast,           gen_Bitcast);
 	be_set_transform_function(op_Builtin,           gen_Builtin);
 	be_set_transform_function(op_Call,              gen_Call);
-	be_set_transform_function(op_Cmp,               gen_Cmp);
-	be_set_transform_function(op_Cond,              gen_Cond);
+	be_set_transform_function(op_Cmp,               amd64_use_burs ? gen_burs : gen_Cmp);
+	be_set_transform_function(op_Cond,              amd64_use_burs ? gen_burs : gen_Cond);
 	be_set_transform_function(op_Const,             gen_Const);
 	be_set_transform_function(op_Conv,              gen_Conv);
 	be_set_transform_function(op_Div,               gen_Div);
-	be_set_transform_function(op_Eor,               gen_Eor);
+	be_set_transform_function(op_Eor,               amd64_use_burs ? gen_burs : gen_Eor);
 	be_set_transform_function(op_IJmp,              gen_IJmp);
 	be_set_transform_function(op_Jmp,               gen_Jmp);
 	be_set_transform_function(op_Load,              gen_Load);
@@ -3261,16 +3874,17 @@ static void amd64_register_transformers(void)
 	be_set_transform_function(op_Mod,               gen_Mod);
 	be_set_transform_function(op_Mul,               gen_Mul);
 	be_set_transform_function(op_Mulh,              gen_Mulh);
+	be_set_transform_function(op_Mux,               gen_Mux);
 	be_set_transform_function(op_Not,               gen_Not);
-	be_set_transform_function(op_Or,                gen_Or);
+	be_set_transform_function(op_Or,                amd64_use_burs ? gen_burs : gen_Or);
 	be_set_transform_function(op_Phi,               gen_Phi);
 	be_set_transform_function(op_Return,            gen_Return);
-	be_set_transform_function(op_Shl,               gen_Shl);
-	be_set_transform_function(op_Shr,               gen_Shr);
-	be_set_transform_function(op_Shrs,              gen_Shrs);
+	be_set_transform_function(op_Shl,               amd64_use_burs ? gen_burs : gen_Shl);
+	be_set_transform_function(op_Shr,               amd64_use_burs ? gen_burs : gen_Shr);
+	be_set_transform_function(op_Shrs,              amd64_use_burs ? gen_burs : gen_Shrs);
 	be_set_transform_function(op_Start,             gen_Start);
 	be_set_transform_function(op_Store,             gen_Store);
-	be_set_transform_function(op_Sub,               gen_Sub);
+	be_set_transform_function(op_Sub,               amd64_use_burs ? gen_burs : gen_Sub);
 	be_set_transform_function(op_Switch,            gen_Switch);
 	be_set_transform_function(op_Unknown,           gen_Unknown);
 	be_set_transform_function(op_amd64_l_punpckldq, gen_amd64_l_punpckldq);
@@ -3320,7 +3934,11 @@ void amd64_transform_graph(ir_graph *irg)
 
 	heights = heights_new(irg);
 	x86_calculate_non_address_mode_nodes(irg);
+	if (amd64_use_burs)
+		amd64_burs_init(irg);
 	be_transform_graph(irg, NULL);
+	if (amd64_use_burs)
+		amd64_burs_free();
 	x86_free_non_address_mode_nodes();
 	heights_free(heights);
 	heights = NULL;
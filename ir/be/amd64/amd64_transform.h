@@ -26,6 +26,24 @@ extern arch_register_req_t const        *amd64_reg_reg_reqs[];
 extern arch_register_req_t const        *amd64_xmm_xmm_reqs[];
 
 
+/**
+ * Operands and predicates of the BURS patterns in amd64_spec.pl, used by the
+ * generated labeler.
+ */
+bool amd64_burs_is_imm32(ir_node const *node);
+bool amd64_burs_is_scale(ir_node const *node);
+bool amd64_burs_is_zext_mask(ir_node const *node);
+bool amd64_burs_is_gp_cmp(ir_node const *node);
+bool amd64_burs_am_independent(ir_node *proj, ir_node *other);
+bool amd64_burs_match_load(ir_node const *node);
+ir_node *amd64_burs_get_load_ptr(ir_node const *node);
+
+/**
+ * Returns true if @p op can be performed on the lanes of vector mode @p mode
+ * with SSE2 instructions, a Mux standing for a lane-wise minimum or maximum.
+ */
+bool amd64_allow_vector_op(ir_op const *op, ir_mode const *mode);
+
 void amd64_init_transform(void);
 
 ir_node *amd64_new_spill(ir_node *value, ir_node *after);
@@ -16,6 +16,7 @@
 #include "be_t.h"
 #include "beflags.h"
 #include "begnuas.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bemodule.h"
 #include "benode.h"
@@ -177,7 +178,9 @@ static void arm_generate_code(FILE *output, const char *cup_name)
 
 	arm_emit_file_prologue();
 
-	foreach_irp_irg(i, irg) {
+	ir_graph **const irgs = be_get_irg_compile_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!be_step_first(irg))
 			continue;
 
@@ -202,6 +205,7 @@ static void arm_generate_code(FILE *output, const char *cup_name)
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
 
 	be_finish();
 }
@@ -37,10 +37,13 @@ struct be_options_t {
 	bool timing;               /**< time the backend phases */
 	bool opt_profile_generate; /**< instrument code for profiling */
 	bool opt_profile_use;      /**< use existing profile data */
+	bool opt_profile_values;   /**< profile divisors and switch selectors */
 	bool omit_fp;              /**< try to omit the frame pointer */
 	bool do_verify;            /**< backend verify option */
 	char ilp_solver[128];      /**< the ilp solver name */
 	bool verbose_asm;          /**< dump verbose assembler */
+	bool ipra;                 /**< interprocedural register allocation */
+	bool free_irgs;            /**< free each graph after its code is emitted */
 };
 extern be_options_t be_options;
 
@@ -293,6 +293,14 @@ struct arch_isa_if_t {
 
 	ir_jit_function_t* (*jit_compile)(ir_jit_segment_t *segment, ir_graph *irg);
 
+	/**
+	 * Compile a graph with the baseline JIT tier, see
+	 * be_jit_compile_baseline(). Returns NULL for unsupported graphs.
+	 */
+	ir_jit_function_t* (*jit_compile_baseline)(ir_jit_segment_t *segment,
+	                                           ir_graph *irg,
+	                                           ir_entity *counter);
+
 	void (*emit_function)(char *buffer, ir_jit_function_t *function);
 
 	/**
@@ -18,10 +18,15 @@
  * to change as many edges to fallthroughs as possible, this is done by setting
  * a next and prev pointers on blocks. The greedy algorithm sorts the edges by
  * execution frequencies and tries to transform them to fallthroughs in this order
+ *
+ * Afterwards blocks which are rarely executed compared to the function entry
+ * may be moved out of the schedule into a cold fragment, which the emitter
+ * places into a separate text section.
  */
 #include "beblocksched.h"
 
 #include "bearch.h"
+#include "begnuas.h"
 #include "beirg.h"
 #include "bemodule.h"
 #include "besched.h"
@@ -31,11 +36,25 @@
 #include "irgmod.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
+#include "irtools.h"
+#include "lc_opts.h"
 #include "pdeq.h"
+#include "statev_t.h"
 #include "util.h"
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
+static bool   split_cold = true;
+/** blocks executed less often than this fraction of the function entries are
+ * moved into the cold fragment */
+static double cold_freq  = 0.0001;
+
+static const lc_opt_table_entry_t options[] = {
+	LC_OPT_ENT_BOOL("splitcold", "move rarely executed blocks into a separate section", &split_cold),
+	LC_OPT_ENT_DBL ("coldfreq",  "relative execution frequency of cold blocks",         &cold_freq),
+	LC_OPT_LAST
+};
+
 static bool blocks_removed;
 
 /**
@@ -560,8 +579,49 @@ ir_node **be_create_block_schedule(ir_graph *irg)
 	return block_list;
 }
 
+ir_node *be_split_cold_blocks(ir_graph *irg, ir_node **block_schedule)
+{
+	if (!split_cold)
+		return NULL;
+	/* cold functions are placed into the cold section as a whole */
+	if (be_birg_from_irg(irg)->hotness == be_hotness_cold)
+		return NULL;
+	if (!be_gas_can_split_function(get_irg_entity(irg)))
+		return NULL;
+
+	/* stable partition, the start block always stays in the hot part */
+	double    const threshold = get_block_execfreq(get_irg_start_block(irg))
+	                            * cold_freq;
+	ir_node       **cold      = NEW_ARR_F(ir_node*, 0);
+	size_t          n_hot     = 1;
+	for (size_t i = 1, n = ARR_LEN(block_schedule); i < n; ++i) {
+		ir_node *const block = block_schedule[i];
+		if (get_block_execfreq(block) < threshold) {
+			ARR_APP1(ir_node*, cold, block);
+		} else {
+			block_schedule[n_hot++] = block;
+		}
+	}
+
+	size_t const n_cold = ARR_LEN(cold);
+	ir_node     *first  = NULL;
+	if (n_cold > 0) {
+		MEMCPY(&block_schedule[n_hot], cold, n_cold);
+		first = cold[0];
+		DB((dbg, LEVEL_1, "Cold fragment of %+F starts at %+F (%zu blocks)\n",
+		    irg, first, n_cold));
+		stat_ev_int("blocksched_cold_blocks", n_cold);
+	}
+	DEL_ARR_F(cold);
+	return first;
+}
+
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_blocksched)
 void be_init_blocksched(void)
 {
+	lc_opt_entry_t *be_grp    = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_entry_t *sched_grp = lc_opt_get_grp(be_grp, "blocksched");
+	lc_opt_add_table(sched_grp, options);
+
 	FIRM_DBG_REGISTER(dbg, "firm.be.blocksched");
 }
@@ -16,4 +16,13 @@
 
 ir_node **be_create_block_schedule(ir_graph *irg);
 
+/**
+ * Moves the rarely executed blocks of @p block_schedule behind all other
+ * blocks, keeping their relative order.
+ *
+ * @return the first block of the cold fragment or NULL if the function is not
+ *         split. No control flow may fall through into this block.
+ */
+ir_node *be_split_cold_blocks(ir_graph *irg, ir_node **block_schedule);
+
 #endif
@@ -324,6 +324,15 @@ static void constraints(ir_node *const bl, void *const data)
 	}
 }
 
+void be_chordal_handle_constraints(be_chordal_env_t *const env)
+{
+	be_timer_push(T_CONSTR);
+	dom_tree_walk_irg(env->irg, constraints, NULL, env);
+	be_timer_pop(T_CONSTR);
+
+	be_chordal_dump(BE_CH_DUMP_CONSTR, env->irg, env->cls, "constr");
+}
+
 static void assign(ir_node *const block, void *const env_ptr)
 {
 	be_chordal_env_t *const env  = (be_chordal_env_t*)env_ptr;
@@ -381,11 +390,7 @@ static void be_ra_chordal_color(be_chordal_env_t *const chordal_env)
 	be_assure_live_sets(irg);
 
 	/* Handle register targeting constraints */
-	be_timer_push(T_CONSTR);
-	dom_tree_walk_irg(irg, constraints, NULL, chordal_env);
-	be_timer_pop(T_CONSTR);
-
-	be_chordal_dump(BE_CH_DUMP_CONSTR, irg, chordal_env->cls, "constr");
+	be_chordal_handle_constraints(chordal_env);
 
 	/* First, determine the pressure */
 	dom_tree_walk_irg(irg, create_borders, NULL, chordal_env);
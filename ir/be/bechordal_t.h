@@ -78,4 +78,12 @@ void be_chordal_dump(unsigned mask, ir_graph *irg, arch_register_class_t const *
 
 void check_for_memory_operands(ir_graph *irg, const regalloc_if_t *regif);
 
+/**
+ * Assigns registers to the operands of all instructions with register
+ * constraints. Values living through such an instruction are permuted in
+ * front of it, so they can be assigned new registers as well.
+ * Requires dominance information and liveness.
+ */
+void be_chordal_handle_constraints(be_chordal_env_t *env);
+
 #endif
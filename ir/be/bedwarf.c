@@ -71,6 +71,12 @@ typedef enum custom_abbrevs {
 	abbrev_void_subroutine_type,
 } custom_abbrevs;
 
+/** A callee saved register stored in the callframe. */
+typedef struct callframe_spill_t {
+	const arch_register_t *reg;
+	int                    offset;
+} callframe_spill_t;
+
 /**
  * The dwarf handle.
  */
@@ -86,6 +92,13 @@ typedef struct dwarf_t {
 	const char       *curr_file;    /**< name of the current source file */
 	unsigned          label_num;
 	unsigned          last_line;
+	bool              function_split; /**< hot part of cur_ent ended */
+	/** callframe state of the current function, restated at the beginning
+	 * of its cold fragment */
+	const arch_register_t *cfa_reg;
+	int                    cfa_offset;
+	bool                   has_cfa_offset;
+	callframe_spill_t     *cfa_spills;
 } dwarf_t;
 
 static dwarf_t               env;
@@ -323,6 +336,7 @@ void be_dwarf_callframe_register(const arch_register_t *reg)
 	be_emit_cstring("\t.cfi_def_cfa_register ");
 	be_emit_irprintf("%d\n", reg->dwarf_number);
 	be_emit_write_line();
+	env.cfa_reg = reg;
 }
 
 void be_dwarf_callframe_offset(int offset)
@@ -332,6 +346,8 @@ void be_dwarf_callframe_offset(int offset)
 	be_emit_cstring("\t.cfi_def_cfa_offset ");
 	be_emit_irprintf("%d\n", offset);
 	be_emit_write_line();
+	env.cfa_offset     = offset;
+	env.has_cfa_offset = true;
 }
 
 void be_dwarf_callframe_spilloffset(const arch_register_t *reg, int offset)
@@ -341,6 +357,8 @@ void be_dwarf_callframe_spilloffset(const arch_register_t *reg, int offset)
 	be_emit_cstring("\t.cfi_offset ");
 	be_emit_irprintf("%d, %d\n", reg->dwarf_number, offset);
 	be_emit_write_line();
+	callframe_spill_t const spill = { .reg = reg, .offset = offset };
+	ARR_APP1(callframe_spill_t, env.cfa_spills, spill);
 }
 
 static bool is_extern_entity(const ir_entity *entity)
@@ -498,7 +516,8 @@ void be_dwarf_function_before(const ir_entity *entity,
 
 	ARR_APP1(const ir_entity*, env.pubnames_list, entity);
 
-	env.cur_ent = entity;
+	env.cur_ent        = entity;
+	env.function_split = false;
 }
 
 void be_dwarf_function_begin(void)
@@ -507,12 +526,14 @@ void be_dwarf_function_begin(void)
 		return;
 	be_emit_cstring("\t.cfi_startproc\n");
 	be_emit_write_line();
+
+	env.cfa_reg        = NULL;
+	env.has_cfa_offset = false;
+	ARR_SHRINKLEN(env.cfa_spills, 0);
 }
 
-void be_dwarf_function_end(void)
+static void emit_function_end(void)
 {
-	if (debug_level < LEVEL_BASIC)
-		return;
 	const ir_entity *entity = env.cur_ent;
 	be_emit_irprintf("%sfunction_end_%s:\n", be_gas_get_private_prefix(),
 	                 get_entity_ld_name(entity));
@@ -523,6 +544,53 @@ void be_dwarf_function_end(void)
 	}
 }
 
+void be_dwarf_function_end(void)
+{
+	if (debug_level < LEVEL_BASIC)
+		return;
+	if (!env.function_split) {
+		emit_function_end();
+	} else if (debug_level >= LEVEL_FRAMEINFO) {
+		be_emit_cstring("\t.cfi_endproc\n");
+		be_emit_write_line();
+	}
+}
+
+void be_dwarf_function_split(void)
+{
+	if (debug_level < LEVEL_BASIC)
+		return;
+	/* the debug info only describes the hot part */
+	emit_function_end();
+	env.function_split = true;
+}
+
+void be_dwarf_cold_fragment_begin(void)
+{
+	if (debug_level < LEVEL_FRAMEINFO)
+		return;
+	be_emit_cstring("\t.cfi_startproc\n");
+	be_emit_write_line();
+
+	/* the fragment is described by its own FDE, which starts with the initial
+	 * state of the CIE */
+	if (env.cfa_reg != NULL) {
+		be_emit_irprintf("\t.cfi_def_cfa_register %d\n",
+		                 env.cfa_reg->dwarf_number);
+		be_emit_write_line();
+	}
+	if (env.has_cfa_offset) {
+		be_emit_irprintf("\t.cfi_def_cfa_offset %d\n", env.cfa_offset);
+		be_emit_write_line();
+	}
+	for (size_t i = 0, n = ARR_LEN(env.cfa_spills); i < n; ++i) {
+		callframe_spill_t const *const spill = &env.cfa_spills[i];
+		be_emit_irprintf("\t.cfi_offset %d, %d\n", spill->reg->dwarf_number,
+		                 spill->offset);
+		be_emit_write_line();
+	}
+}
+
 static void emit_base_type_abbrev(void)
 {
 	begin_abbrev(abbrev_base_type, DW_TAG_base_type, DW_CHILDREN_no);
@@ -932,6 +1000,7 @@ void be_dwarf_close(void)
 	pmap_destroy(env.file_map);
 	DEL_ARR_F(env.file_list);
 	DEL_ARR_F(env.pubnames_list);
+	DEL_ARR_F(env.cfa_spills);
 	pset_new_destroy(&env.emitted_types);
 }
 
@@ -943,6 +1012,7 @@ void be_dwarf_open(void)
 	env.file_map      = pmap_create();
 	env.file_list     = NEW_ARR_F(const char*, 0);
 	env.pubnames_list = NEW_ARR_F(const ir_entity*, 0);
+	env.cfa_spills    = NEW_ARR_F(callframe_spill_t, 0);
 	pset_new_init(&env.emitted_types);
 }
 
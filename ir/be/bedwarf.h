@@ -39,6 +39,10 @@ void be_dwarf_function_begin(void);
 
 /** debug for a function end */
 void be_dwarf_function_end(void);
+/** ends the hot part of a function which continues in a cold fragment */
+void be_dwarf_function_split(void);
+/** output debug info at the beginning of the cold fragment of a function */
+void be_dwarf_cold_fragment_begin(void);
 
 /** dump a variable in the global type */
 void be_dwarf_variable(const ir_entity *ent);
@@ -15,6 +15,7 @@
 #include "bearch.h"
 #include "beemithlp.h"
 #include "beemitter.h"
+#include "beirg.h"
 #include "bemodule.h"
 #include "betranshlp.h"
 #include "dbginfo.h"
@@ -36,6 +37,11 @@ bool                   be_gas_emit_types    = true;
 char                   be_gas_elf_type_char = '@';
 
 static be_gas_section_t current_section = (be_gas_section_t) -1;
+/** the function currently emitted and the section of its hot part */
+static ir_entity const *function_entity;
+static be_gas_section_t function_section;
+/** true while the cold fragment of the current function is emitted */
+static bool             in_cold_fragment;
 static pmap            *block_numbers;
 static unsigned         next_block_nr;
 
@@ -73,6 +79,8 @@ static void emit_section_macho(be_gas_section_t const section)
 
 	static const macho_sectioninfo_t macho_sectioninfos[] = {
 		[GAS_SECTION_TEXT]            = { "__TEXT,__text",            "regular,pure_instructions" },
+		[GAS_SECTION_TEXT_HOT]        = { "__TEXT,__text",            "regular,pure_instructions" },
+		[GAS_SECTION_TEXT_UNLIKELY]   = { "__TEXT,__text",            "regular,pure_instructions" },
 		[GAS_SECTION_DATA]            = { "__DATA,__data",            NULL },
 		[GAS_SECTION_RODATA]          = { "__TEXT,__const",           NULL },
 		[GAS_SECTION_REL_RO]          = { "__DATA,__const",           NULL },
@@ -124,6 +132,8 @@ typedef struct {
 
 static const elf_sectioninfo_t elf_sectioninfos[] = {
 	[GAS_SECTION_TEXT]           = { "text",              "progbits", "ax" },
+	[GAS_SECTION_TEXT_HOT]       = { "text.hot",          "progbits", "ax" },
+	[GAS_SECTION_TEXT_UNLIKELY]  = { "text.unlikely",     "progbits", "ax" },
 	[GAS_SECTION_DATA]           = { "data",              "progbits", "aw" },
 	[GAS_SECTION_RODATA]         = { "rodata",            "progbits", "a"  },
 	[GAS_SECTION_REL_RO_LOCAL]   = { "data.rel.ro.local", "progbits", "aw" },
@@ -166,14 +176,17 @@ static void emit_section_sparc(be_gas_section_t section,
 	be_emit_char('"');
 
 	/* for the simple sections we're done here */
-	if (flags != 0) {
+	if (flags != 0 || base == GAS_SECTION_TEXT_HOT
+	    || base == GAS_SECTION_TEXT_UNLIKELY) {
 		be_emit_cstring(",#alloc");
 
 		switch (base) {
-		case GAS_SECTION_TEXT: be_emit_cstring(",#execinstr"); break;
+		case GAS_SECTION_TEXT:
+		case GAS_SECTION_TEXT_HOT:
+		case GAS_SECTION_TEXT_UNLIKELY: be_emit_cstring(",#execinstr"); break;
 		case GAS_SECTION_DATA:
-		case GAS_SECTION_BSS:  be_emit_cstring(",#write"); break;
-		default:               /* nothing */ break;
+		case GAS_SECTION_BSS:           be_emit_cstring(",#write"); break;
+		default:                        /* nothing */ break;
 		}
 		if (flags & GAS_SECTION_FLAG_TLS)
 			be_emit_cstring(",#tls");
@@ -516,6 +529,37 @@ static be_gas_section_t determine_section(be_main_env_t const *const main_env, i
 	panic("couldn't determine section for %+F", entity);
 }
 
+/**
+ * Places functions into the sections for frequently and rarely executed code
+ * according to their profiled entry counts.
+ */
+static be_gas_section_t determine_function_section(ir_entity const *const entity)
+{
+	be_gas_section_t const section = determine_section(NULL, entity);
+	if (section != GAS_SECTION_TEXT)
+		return section;
+
+	ir_graph const *const irg = get_entity_irg(entity);
+	if (irg == NULL || irg->be_data == NULL)
+		return section;
+	switch (be_birg_from_irg(irg)->hotness) {
+	case be_hotness_normal: return GAS_SECTION_TEXT;
+	case be_hotness_hot:    return GAS_SECTION_TEXT_HOT;
+	case be_hotness_cold:   return GAS_SECTION_TEXT_UNLIKELY;
+	}
+	panic("invalid hotness for %+F", entity);
+}
+
+/** Switches back to the section of the code fragment currently emitted. */
+static void emit_function_section(void)
+{
+	if (in_cold_fragment) {
+		emit_section(GAS_SECTION_TEXT_UNLIKELY, NULL);
+	} else {
+		emit_section(function_section, function_entity);
+	}
+}
+
 static void emit_symbol_directive(const char *directive,
                                   const ir_entity *entity)
 {
@@ -597,8 +641,11 @@ void be_gas_emit_function_prolog(const ir_entity *entity, unsigned po2alignment,
 {
 	be_dwarf_function_before(entity, parameter_infos);
 
-	be_gas_section_t const section = determine_section(NULL, entity);
+	be_gas_section_t const section = determine_function_section(entity);
 	emit_section(section, entity);
+	function_entity  = entity;
+	function_section = section;
+	in_cold_fragment = false;
 
 	/* write the begin line (makes the life easier for scripts parsing the
 	 * assembler) */
@@ -644,10 +691,60 @@ void be_gas_emit_function_prolog(const ir_entity *entity, unsigned po2alignment,
 	be_dwarf_function_begin();
 }
 
+static void emit_entity_name(ir_entity const *entity, char const *suffix);
+
+static void emit_cold_fragment_name(ir_entity const *const entity)
+{
+	emit_entity_name(entity, ".cold");
+}
+
+bool be_gas_can_split_function(ir_entity const *const entity)
+{
+	/* mach-o has no section for unlikely code and a comdat function would
+	 * need a second group for its fragment */
+	return !is_macho() && !is_comdat(entity);
+}
+
+void be_gas_begin_cold_fragment(ir_entity const *const entity)
+{
+	assert(entity == function_entity && !in_cold_fragment);
+	assert(be_gas_can_split_function(entity));
+
+	be_dwarf_function_split();
+	in_cold_fragment = true;
+	emit_function_section();
+
+	if (ir_platform.object_format == OBJECT_FORMAT_ELF) {
+		be_emit_cstring("\t.type\t");
+		emit_cold_fragment_name(entity);
+		be_emit_irprintf(", %cfunction\n", be_gas_elf_type_char);
+		be_emit_write_line();
+	}
+	emit_cold_fragment_name(entity);
+	be_emit_cstring(":\n");
+	be_emit_write_line();
+
+	be_dwarf_cold_fragment_begin();
+}
+
 void be_gas_emit_function_epilog(ir_entity const *const entity)
 {
 	be_dwarf_function_end();
 
+	if (in_cold_fragment) {
+		if (ir_platform.object_format == OBJECT_FORMAT_ELF) {
+			be_emit_cstring("\t.size\t");
+			emit_cold_fragment_name(entity);
+			be_emit_cstring(", .-");
+			emit_cold_fragment_name(entity);
+			be_emit_char('\n');
+			be_emit_write_line();
+		}
+		/* the size of the function is measured in its hot part */
+		in_cold_fragment = false;
+		emit_function_section();
+	}
+
 	if (ir_platform.object_format == OBJECT_FORMAT_ELF) {
 		be_emit_cstring("\t.size\t");
 		be_gas_emit_entity(entity);
@@ -1293,14 +1390,12 @@ static bool check_needs_quotes(char const *const s)
 	return false;
 }
 
-void be_gas_emit_entity(const ir_entity *entity)
+/**
+ * Emits the linker name of @p entity followed by @p suffix.
+ */
+static void emit_entity_name(ir_entity const *const entity,
+                             char const *const suffix)
 {
-	if (entity->kind == IR_ENTITY_LABEL) {
-		ir_label_t label = get_entity_label(entity);
-		be_emit_irprintf("%s_%lu", be_gas_get_private_prefix(), label);
-		return;
-	}
-
 	char const *const name         = get_entity_ld_name(entity);
 	bool        const needs_quotes = check_needs_quotes(name);
 	if (needs_quotes)
@@ -1308,10 +1403,22 @@ void be_gas_emit_entity(const ir_entity *entity)
 	if (get_entity_visibility(entity) == ir_visibility_private)
 		be_emit_string(be_gas_get_private_prefix());
 	be_emit_string(name);
+	be_emit_string(suffix);
 	if (needs_quotes)
 		be_emit_char('"');
 }
 
+void be_gas_emit_entity(const ir_entity *entity)
+{
+	if (entity->kind == IR_ENTITY_LABEL) {
+		ir_label_t label = get_entity_label(entity);
+		be_emit_irprintf("%s_%lu", be_gas_get_private_prefix(), label);
+		return;
+	}
+
+	emit_entity_name(entity, "");
+}
+
 void be_gas_emit_block_name(const ir_node *block)
 {
 	ir_entity *entity = get_Block_entity(block);
@@ -1626,7 +1733,7 @@ void be_emit_jump_table(ir_node const *const node, be_switch_attr_t const *const
 	}
 
 	if (entity && !is_macho())
-		be_gas_emit_switch_section(GAS_SECTION_TEXT);
+		emit_function_section();
 
 	free(labels);
 	free(targets);
@@ -19,6 +19,8 @@
 
 typedef enum {
 	GAS_SECTION_TEXT,            /**< text section - program code */
+	GAS_SECTION_TEXT_HOT,        /**< frequently executed program code */
+	GAS_SECTION_TEXT_UNLIKELY,   /**< rarely executed program code */
 	GAS_SECTION_DATA,            /**< data section - arbitrary data */
 	GAS_SECTION_RODATA,          /**< read only data no relocations */
 	GAS_SECTION_REL_RO,          /**< read only data containing relocations */
@@ -72,6 +74,20 @@ void be_gas_emit_function_prolog(const ir_entity *entity,
 
 void be_gas_emit_function_epilog(const ir_entity *entity);
 
+/**
+ * Returns true if the code of @p entity may be split into a hot part and a
+ * cold fragment placed in another section.
+ */
+bool be_gas_can_split_function(const ir_entity *entity);
+
+/**
+ * Ends the hot part of the current function and starts its cold fragment
+ * in the section for rarely executed code. The fragment gets its own local
+ * symbol and call frame information, so the function has to be emitted
+ * without fallthroughs into the fragment.
+ */
+void be_gas_begin_cold_fragment(const ir_entity *entity);
+
 char const *be_gas_get_private_prefix(void);
 
 /**
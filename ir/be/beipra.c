@@ -0,0 +1,177 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural register allocation for local functions.
+ *
+ * The registers clobbered by a function are the registers assigned to the
+ * results of its instructions. Calls are modeled with an output for every
+ * register they clobber, so the clobbers of callees are included
+ * transitively. Only functions which are not externally visible are
+ * considered, as other definitions may be interposed at link time.
+ */
+#include "beipra.h"
+
+#include "array.h"
+#include "be_t.h"
+#include "bearch.h"
+#include "beirg.h"
+#include "besched.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "pmap.h"
+#include "pset_new.h"
+#include "raw_bitset.h"
+#include "target_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** maps entities of compiled local functions to their clobbered registers */
+static pmap           *clobbers;
+static struct obstack  obst;
+
+static void collect_callees(ir_node *node, void *data)
+{
+	if (!is_Call(node))
+		return;
+	ir_entity *const callee = get_Call_callee(node);
+	if (callee == NULL || !is_method_entity(callee))
+		return;
+	ir_graph *const callee_irg = get_entity_irg(callee);
+	if (callee_irg != NULL) {
+		ir_graph ***const callees = (ir_graph***)data;
+		ARR_APP1(ir_graph*, *callees, callee_irg);
+	}
+}
+
+static void add_callees_first(ir_graph *irg, pset_new_t *visited,
+                              ir_graph ***order)
+{
+	if (!pset_new_insert(visited, irg))
+		return;
+
+	ir_graph **callees = NEW_ARR_F(ir_graph*, 0);
+	irg_walk_graph(irg, NULL, collect_callees, &callees);
+	for (size_t i = 0, n = ARR_LEN(callees); i < n; ++i)
+		add_callees_first(callees[i], visited, order);
+	DEL_ARR_F(callees);
+
+	ARR_APP1(ir_graph*, *order, irg);
+}
+
+ir_graph **be_get_irg_compile_order(void)
+{
+	ir_graph **order = NEW_ARR_F(ir_graph*, 0);
+	if (!be_options.ipra && !be_options.free_irgs) {
+		foreach_irp_irg(i, irg) {
+			ARR_APP1(ir_graph*, order, irg);
+		}
+		return order;
+	}
+
+	pset_new_t visited;
+	pset_new_init_size(&visited, get_irp_n_irgs());
+	foreach_irp_irg(i, irg) {
+		add_callees_first(irg, &visited, &order);
+	}
+	pset_new_destroy(&visited);
+	return order;
+}
+
+static void mark_clobbered(unsigned *const clobbered,
+                           arch_register_t const *const reg,
+                           arch_register_req_t const *const req)
+{
+	arch_register_class_t const *const cls = req->cls;
+	if (cls == NULL || cls->n_regs == 0)
+		return;
+	unsigned const width = MAX(req->width, 1);
+	if (reg != NULL) {
+		for (unsigned i = 0; i < width; ++i)
+			rbitset_set(clobbered, reg->global_index + i);
+		return;
+	}
+
+	/* be conservative about values without an assigned register */
+	arch_register_t const *const regs = &cls->regs[0];
+	for (unsigned i = 0; i < cls->n_regs; ++i) {
+		if (req->limited == NULL || rbitset_is_set(req->limited, i))
+			rbitset_set(clobbered, regs[i].global_index);
+	}
+}
+
+static void collect_clobbers(ir_node *block, void *data)
+{
+	unsigned *const clobbered = (unsigned*)data;
+	sched_foreach(block, node) {
+		be_foreach_out(node, o) {
+			arch_register_req_t const *const req
+				= arch_get_irn_register_req_out(node, o);
+			mark_clobbered(clobbered, arch_get_irn_register_out(node, o), req);
+		}
+		foreach_irn_in(node, i, pred) {
+			arch_register_req_t const *const req
+				= arch_get_irn_register_req_in(node, i);
+			if (req->kills_value)
+				mark_clobbered(clobbered, arch_get_irn_register(pred), req);
+		}
+	}
+}
+
+void be_ipra_record_clobbers(ir_graph *const irg,
+                             unsigned const *const always_clobbered)
+{
+	ir_entity *const entity = get_irg_entity(irg);
+	if (!be_options.ipra || entity_is_externally_visible(entity))
+		return;
+
+	if (clobbers == NULL) {
+		FIRM_DBG_REGISTER(dbg, "firm.be.ipra");
+		clobbers = pmap_create();
+		obstack_init(&obst);
+	}
+
+	unsigned  const n_regs    = ir_target.isa->n_registers;
+	unsigned *const clobbered = rbitset_obstack_alloc(&obst, n_regs);
+	if (always_clobbered != NULL)
+		rbitset_copy(clobbered, always_clobbered, n_regs);
+	irg_block_walk_graph(irg, collect_clobbers, NULL, clobbered);
+	pmap_insert(clobbers, entity, clobbered);
+
+#ifdef DEBUG_libfirm
+	DB((dbg, LEVEL_1, "%+F clobbers:", entity));
+	rbitset_foreach(clobbered, n_regs, r) {
+		DB((dbg, LEVEL_1, " %s", ir_target.isa->registers[r].name));
+	}
+	DB((dbg, LEVEL_1, "\n"));
+#endif
+}
+
+void be_ipra_restrict_caller_saves(ir_entity const *const callee,
+                                   unsigned *const caller_saves)
+{
+	if (callee == NULL || clobbers == NULL)
+		return;
+	unsigned const *const clobbered = pmap_get(unsigned const, clobbers, callee);
+	if (clobbered == NULL)
+		return;
+	rbitset_and(caller_saves, clobbered, ir_target.isa->n_registers);
+}
+
+void be_ipra_free(void)
+{
+	if (clobbers == NULL)
+		return;
+	pmap_destroy(clobbers);
+	obstack_free(&obst, NULL);
+	clobbers = NULL;
+}
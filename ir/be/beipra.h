@@ -0,0 +1,47 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural register allocation for local functions.
+ *
+ * Local functions are compiled before their callers. After register
+ * allocation the registers a function actually clobbers are recorded, so
+ * calls to it only have to treat these registers as caller saved.
+ */
+#ifndef FIRM_BE_BEIPRA_H
+#define FIRM_BE_BEIPRA_H
+
+#include "firm_types.h"
+
+/**
+ * Returns the graphs of the program in the order in which they should be
+ * compiled. With interprocedural register allocation enabled or if graphs are
+ * freed after emission, callees come before their callers (except for
+ * recursive calls).
+ * The result has to be freed with DEL_ARR_F().
+ */
+ir_graph **be_get_irg_compile_order(void);
+
+/**
+ * Records the registers clobbered by @p irg. Must be called after register
+ * allocation, once no more instructions are added to the graph.
+ * Registers in @p always_clobbered are recorded regardless of their use.
+ */
+void be_ipra_record_clobbers(ir_graph *irg, unsigned const *always_clobbered);
+
+/**
+ * Removes the registers which a call of @p callee is known to preserve from
+ * @p caller_saves. @p callee may be NULL for indirect calls.
+ */
+void be_ipra_restrict_caller_saves(ir_entity const *callee,
+                                   unsigned *caller_saves);
+
+/**
+ * Frees the recorded clobber sets.
+ */
+void be_ipra_free(void);
+
+#endif
@@ -36,6 +36,13 @@ void be_invalidate_live_chk(ir_graph *irg);
  */
 void be_free_birg(ir_graph *irg);
 
+/** How often a function is executed according to profile data. */
+typedef enum be_hotness_t {
+	be_hotness_normal, /**< no profile data or an average function */
+	be_hotness_hot,    /**< the function is entered very frequently */
+	be_hotness_cold,   /**< the function was never entered */
+} be_hotness_t;
+
 /**
  * An ir_graph with additional analysis data about this irg. Also includes some
  * backend structures
@@ -55,6 +62,8 @@ typedef struct be_irg_t {
 	/** Architecture specific per-graph data */
 	void             *isa_link;
 	bool              has_returns_twice_call;
+	/** Selects the text section of the function. */
+	be_hotness_t      hotness;
 } be_irg_t;
 
 static inline be_irg_t *be_birg_from_irg(const ir_graph *irg)
@@ -85,6 +85,8 @@ void be_jit_set_entity_addr(ir_entity *entity, void const *address)
 {
 	assert(is_global_entity(entity));
 	entity->attr.global.jit_addr = address;
+	if (address != (void const*)-1)
+		be_jit_bind_deferred(entity);
 }
 
 void const *be_jit_get_entity_addr(ir_entity const *const entity)
@@ -264,9 +266,23 @@ static unsigned emit_relocation(ir_jit_function_t const *const function,
 		                                             relocation_address);
 		return emit(relocation_abs, relocation->be_kind, NULL, dest);
 	}
-	case RELOC_DEST_ENTITY:
-		return emit(relocation_abs, relocation->be_kind,
-		            relocation->dest.entity, relocation->dest_offset);
+	case RELOC_DEST_ENTITY: {
+		ir_entity *const entity = relocation->dest.entity;
+		if (relocation_abs != NULL
+		    && be_jit_get_entity_addr(entity) == (void const*)-1
+		    && be_jit_defer_relocation(relocation_abs, relocation->be_kind,
+		                               entity, relocation->dest_offset, emit)) {
+			/* Emit with a placeholder address to skip the relocation, the code
+			 * heap patches it once the entity is bound. */
+			entity->attr.global.jit_addr = relocation_abs;
+			unsigned const size = emit(relocation_abs, relocation->be_kind,
+			                           entity, relocation->dest_offset);
+			entity->attr.global.jit_addr = (void const*)-1;
+			return size;
+		}
+		return emit(relocation_abs, relocation->be_kind, entity,
+		            relocation->dest_offset);
+	}
 	}
 	panic("Invalid relocation");
 }
@@ -360,7 +376,7 @@ void be_jit_emit_memory(char *const buffer, ir_jit_function_t *const function,
 	for (size_t i = 0, n = function->n_fragments; i < n; ++i) {
 		fragment_info_t const *const fragment  = function->fragment_infos[i];
 		unsigned               const address   = fragment->address;
-		unsigned               const nop_bytes = last_address - address;
+		unsigned               const nop_bytes = address - last_address;
 		assert(address >= last_address);
 		if (nop_bytes > 0)
 			emitter->nops(buffer + last_address, nop_bytes);
@@ -12,6 +12,7 @@
 #ifndef FIRM_BE_BEEMITTER_BINARY_H
 #define FIRM_BE_BEEMITTER_BINARY_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "firm_types.h"
@@ -35,6 +36,21 @@ void be_jit_emit_memory(char *buffer, ir_jit_function_t *function,
 
 void be_jit_emit_as_asm(ir_jit_function_t *function, emit_relocation_func emit);
 
+/**
+ * Records a relocation to @p entity, which has no address yet, at @p location
+ * while a function is installed into a code heap. The relocation is emitted
+ * with @p emit when the entity is bound.
+ * @returns false if no function is being installed
+ */
+bool be_jit_defer_relocation(char *location, uint8_t be_kind,
+                             ir_entity *entity, int32_t offset,
+                             emit_relocation_func emit);
+
+/**
+ * Resolves the deferred relocations to @p entity in all code heaps.
+ */
+void be_jit_bind_deferred(ir_entity *entity);
+
 void be_jit_begin_function(ir_jit_segment_t *segment);
 ir_jit_function_t *be_jit_finish_function(void);
 
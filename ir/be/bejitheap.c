@@ -0,0 +1,463 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Executable memory for just in time compiled functions.
+ *
+ * Code is placed in chunks of memory obtained directly from the operating
+ * system. A chunk is never writable and executable at the same time: chunks
+ * receiving code are made writable and stay so until be_jit_make_executable()
+ * switches all of them back at once.
+ *
+ * Functions are allocated in power of two size classes. Freed space is kept
+ * in a bin for its size class and reused for later functions of the same
+ * class. Chunks without any function left are returned to the operating
+ * system, functions larger than the largest size class get a chunk of their
+ * own.
+ */
+#include "bejit.h"
+
+#include "array.h"
+#include "bitfiddle.h"
+#include "entity_t.h"
+#include "panic.h"
+#include "pmap.h"
+#include "util.h"
+#include "xmalloc.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/** log2 of the size of the smallest size class, this is also the alignment
+ * of all functions */
+#define MIN_BLOCK_LOG  4
+#define N_SIZE_CLASSES 13
+#define CHUNK_SIZE     (256 * 1024)
+
+typedef struct jit_chunk_t jit_chunk_t;
+
+struct ir_jit_code_t {
+	char          *addr;
+	unsigned       size;          /**< size of the block, not of the code */
+	int            size_class;    /**< -1 if the block is a whole chunk */
+	bool           is_free;
+	jit_chunk_t   *chunk;
+	ir_entity     *entity;        /**< entity bound to the function */
+	ir_entity    **unresolved;    /**< entities with deferred relocations */
+	ir_jit_code_t *next_free;     /**< bin list */
+	ir_jit_code_t *prev_free;
+	ir_jit_code_t *next_in_chunk;
+};
+
+struct jit_chunk_t {
+	char          *base;
+	size_t         size;
+	size_t         used;          /**< bytes handed out so far */
+	unsigned       n_live;        /**< number of functions in the chunk */
+	bool           writable;
+	char          *dirty_begin;   /**< modified range since last made writable */
+	char          *dirty_end;
+	ir_jit_code_t *blocks;        /**< all blocks carved from the chunk */
+	jit_chunk_t   *next;
+};
+
+/** A relocation which could not be resolved when the function was installed
+ * because its entity had no address yet. */
+typedef struct jit_fixup_t {
+	char                *location;
+	ir_jit_code_t       *code;
+	emit_relocation_func emit;
+	int32_t              offset;
+	uint8_t              be_kind;
+} jit_fixup_t;
+
+struct ir_jit_code_heap_t {
+	jit_chunk_t        *chunks;
+	jit_chunk_t        *current;  /**< chunk for new blocks */
+	ir_jit_code_t      *bins[N_SIZE_CLASSES];
+	jit_chunk_t       **writable; /**< chunks to protect in be_jit_make_executable() */
+	pmap               *fixups;   /**< entity -> ARR_F of jit_fixup_t */
+	ir_jit_code_heap_t *next;
+};
+
+/** all live code heaps, they are notified about newly bound entities */
+static ir_jit_code_heap_t *heaps;
+/** heap and block of the function being installed */
+static ir_jit_code_heap_t *install_heap;
+static ir_jit_code_t      *install_code;
+
+static size_t get_page_size(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static char *map_memory(size_t const size)
+{
+#ifdef _WIN32
+	void *const res = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT,
+	                               PAGE_READWRITE);
+	if (res == NULL)
+		panic("could not allocate %zu bytes of code memory", size);
+#else
+	void *const res = mmap(NULL, size, PROT_READ | PROT_WRITE,
+	                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED)
+		panic("could not allocate %zu bytes of code memory", size);
+#endif
+	return (char*)res;
+}
+
+static void unmap_memory(char *const base, size_t const size)
+{
+#ifdef _WIN32
+	(void)size;
+	VirtualFree(base, 0, MEM_RELEASE);
+#else
+	munmap(base, size);
+#endif
+}
+
+static void protect_memory(char *const base, size_t const size,
+                           bool const executable)
+{
+#ifdef _WIN32
+	DWORD old;
+	DWORD const prot = executable ? PAGE_EXECUTE_READ : PAGE_READWRITE;
+	if (!VirtualProtect(base, size, prot, &old))
+		panic("could not change protection of code memory");
+#else
+	int const prot = executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE;
+	if (mprotect(base, size, prot) != 0)
+		panic("could not change protection of code memory");
+#endif
+}
+
+static void flush_icache(char *const begin, char *const end)
+{
+#ifdef _WIN32
+	FlushInstructionCache(GetCurrentProcess(), begin, end - begin);
+#elif defined(__GNUC__)
+	__builtin___clear_cache(begin, end);
+#else
+	(void)begin;
+	(void)end;
+#endif
+}
+
+static void mark_dirty(ir_jit_code_heap_t *const heap, jit_chunk_t *const chunk,
+                       char *const begin, char *const end)
+{
+	if (!chunk->writable) {
+		protect_memory(chunk->base, chunk->size, false);
+		chunk->writable    = true;
+		chunk->dirty_begin = begin;
+		chunk->dirty_end   = end;
+		ARR_APP1(jit_chunk_t*, heap->writable, chunk);
+		return;
+	}
+	chunk->dirty_begin = MIN(chunk->dirty_begin, begin);
+	chunk->dirty_end   = MAX(chunk->dirty_end, end);
+}
+
+static jit_chunk_t *new_chunk(ir_jit_code_heap_t *const heap, size_t const size)
+{
+	jit_chunk_t *const chunk = XMALLOCZ(jit_chunk_t);
+	chunk->base        = map_memory(size);
+	chunk->size        = size;
+	chunk->writable    = true;
+	chunk->dirty_begin = chunk->base + size;
+	chunk->dirty_end   = chunk->base;
+	chunk->next        = heap->chunks;
+	heap->chunks       = chunk;
+	ARR_APP1(jit_chunk_t*, heap->writable, chunk);
+	return chunk;
+}
+
+static ir_jit_code_t *new_block(jit_chunk_t *const chunk, char *const addr,
+                                unsigned const size, int const size_class)
+{
+	ir_jit_code_t *const code = XMALLOCZ(ir_jit_code_t);
+	code->addr          = addr;
+	code->size          = size;
+	code->size_class    = size_class;
+	code->chunk         = chunk;
+	code->next_in_chunk = chunk->blocks;
+	chunk->blocks       = code;
+	return code;
+}
+
+static void bin_remove(ir_jit_code_heap_t *const heap, ir_jit_code_t *const code)
+{
+	assert(code->is_free);
+	if (code->prev_free != NULL)
+		code->prev_free->next_free = code->next_free;
+	else
+		heap->bins[code->size_class] = code->next_free;
+	if (code->next_free != NULL)
+		code->next_free->prev_free = code->prev_free;
+	code->is_free = false;
+}
+
+static void bin_insert(ir_jit_code_heap_t *const heap, ir_jit_code_t *const code)
+{
+	ir_jit_code_t **const bin = &heap->bins[code->size_class];
+	code->is_free   = true;
+	code->prev_free = NULL;
+	code->next_free = *bin;
+	if (*bin != NULL)
+		(*bin)->prev_free = code;
+	*bin = code;
+}
+
+static void release_chunk(ir_jit_code_heap_t *const heap,
+                          jit_chunk_t *const chunk)
+{
+	assert(chunk->n_live == 0);
+	for (ir_jit_code_t *code = chunk->blocks, *next; code != NULL; code = next) {
+		next = code->next_in_chunk;
+		if (code->is_free)
+			bin_remove(heap, code);
+		free(code);
+	}
+
+	for (jit_chunk_t **c = &heap->chunks; *c != NULL; c = &(*c)->next) {
+		if (*c == chunk) {
+			*c = chunk->next;
+			break;
+		}
+	}
+	if (chunk->writable) {
+		for (size_t i = 0, n = ARR_LEN(heap->writable); i < n; ++i) {
+			if (heap->writable[i] == chunk) {
+				heap->writable[i] = heap->writable[n - 1];
+				ARR_SHRINKLEN(heap->writable, n - 1);
+				break;
+			}
+		}
+	}
+	if (heap->current == chunk)
+		heap->current = NULL;
+
+	unmap_memory(chunk->base, chunk->size);
+	free(chunk);
+}
+
+static ir_jit_code_t *alloc_block(ir_jit_code_heap_t *const heap,
+                                  unsigned const size)
+{
+	unsigned const log        = MAX(log2_ceil(size), MIN_BLOCK_LOG);
+	int      const size_class = log - MIN_BLOCK_LOG;
+	if (size_class >= N_SIZE_CLASSES) {
+		size_t       const chunk_size = round_up2(size, get_page_size());
+		jit_chunk_t *const chunk      = new_chunk(heap, chunk_size);
+		chunk->used   = chunk_size;
+		chunk->n_live = 1;
+		return new_block(chunk, chunk->base, chunk_size, -1);
+	}
+
+	ir_jit_code_t *code = heap->bins[size_class];
+	if (code != NULL) {
+		bin_remove(heap, code);
+	} else {
+		unsigned     const block_size = 1u << log;
+		jit_chunk_t *      chunk      = heap->current;
+		if (chunk == NULL || chunk->used + block_size > chunk->size) {
+			if (chunk != NULL && chunk->n_live == 0)
+				release_chunk(heap, chunk);
+			chunk         = new_chunk(heap, CHUNK_SIZE);
+			heap->current = chunk;
+		}
+		code = new_block(chunk, chunk->base + chunk->used, block_size,
+		                 size_class);
+		chunk->used += block_size;
+	}
+	++code->chunk->n_live;
+	return code;
+}
+
+ir_jit_code_heap_t *be_new_jit_code_heap(void)
+{
+	ir_jit_code_heap_t *const heap = XMALLOCZ(ir_jit_code_heap_t);
+	heap->writable = NEW_ARR_F(jit_chunk_t*, 0);
+	heap->fixups   = pmap_create();
+	heap->next     = heaps;
+	heaps          = heap;
+	return heap;
+}
+
+void be_destroy_jit_code_heap(ir_jit_code_heap_t *const heap)
+{
+	for (ir_jit_code_heap_t **h = &heaps; *h != NULL; h = &(*h)->next) {
+		if (*h == heap) {
+			*h = heap->next;
+			break;
+		}
+	}
+
+	for (jit_chunk_t *chunk = heap->chunks, *next; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		for (ir_jit_code_t *code = chunk->blocks, *next_code; code != NULL;
+		     code = next_code) {
+			next_code = code->next_in_chunk;
+			ir_entity *const entity = code->entity;
+			if (!code->is_free && entity != NULL
+			    && be_jit_get_entity_addr(entity) == code->addr)
+				be_jit_set_entity_addr(entity, (void const*)-1);
+			if (code->unresolved != NULL)
+				DEL_ARR_F(code->unresolved);
+			free(code);
+		}
+		unmap_memory(chunk->base, chunk->size);
+		free(chunk);
+	}
+
+	foreach_pmap(heap->fixups, entry) {
+		if (entry->value != NULL)
+			DEL_ARR_F(entry->value);
+	}
+	pmap_destroy(heap->fixups);
+	DEL_ARR_F(heap->writable);
+	free(heap);
+}
+
+ir_jit_code_t *be_jit_install_function(ir_jit_code_heap_t *const heap,
+                                       ir_jit_function_t *const function,
+                                       ir_entity *const entity)
+{
+	assert(install_heap == NULL);
+	unsigned       const size = be_get_function_size(function);
+	ir_jit_code_t *const code = alloc_block(heap, MAX(size, 1));
+	mark_dirty(heap, code->chunk, code->addr, code->addr + size);
+
+	install_heap = heap;
+	install_code = code;
+	be_emit_function(code->addr, function);
+	install_heap = NULL;
+	install_code = NULL;
+
+	if (entity != NULL) {
+		code->entity = entity;
+		be_jit_set_entity_addr(entity, code->addr);
+	}
+	return code;
+}
+
+void const *be_jit_get_code_addr(ir_jit_code_t const *const code)
+{
+	return code->addr;
+}
+
+static void remove_fixups(ir_jit_code_heap_t *const heap,
+                          ir_jit_code_t *const code)
+{
+	if (code->unresolved == NULL)
+		return;
+	for (size_t i = 0, n = ARR_LEN(code->unresolved); i < n; ++i) {
+		ir_entity   *const entity = code->unresolved[i];
+		jit_fixup_t *const fixups = pmap_get(jit_fixup_t, heap->fixups, entity);
+		if (fixups == NULL)
+			continue;
+		size_t       n_kept   = 0;
+		size_t const n_fixups = ARR_LEN(fixups);
+		for (size_t f = 0; f < n_fixups; ++f) {
+			if (fixups[f].code != code)
+				fixups[n_kept++] = fixups[f];
+		}
+		ARR_SHRINKLEN(fixups, n_kept);
+	}
+	DEL_ARR_F(code->unresolved);
+	code->unresolved = NULL;
+}
+
+void be_jit_free_code(ir_jit_code_heap_t *const heap, ir_jit_code_t *const code)
+{
+	assert(!code->is_free);
+	remove_fixups(heap, code);
+	ir_entity *const entity = code->entity;
+	if (entity != NULL && be_jit_get_entity_addr(entity) == code->addr)
+		be_jit_set_entity_addr(entity, (void const*)-1);
+	code->entity = NULL;
+
+	jit_chunk_t *const chunk = code->chunk;
+	--chunk->n_live;
+	if (code->size_class < 0) {
+		release_chunk(heap, chunk);
+		return;
+	}
+	bin_insert(heap, code);
+	if (chunk->n_live == 0 && chunk != heap->current)
+		release_chunk(heap, chunk);
+}
+
+void be_jit_make_executable(ir_jit_code_heap_t *const heap)
+{
+	for (size_t i = 0, n = ARR_LEN(heap->writable); i < n; ++i) {
+		jit_chunk_t *const chunk = heap->writable[i];
+		protect_memory(chunk->base, chunk->size, true);
+		if (chunk->dirty_begin < chunk->dirty_end)
+			flush_icache(chunk->dirty_begin, chunk->dirty_end);
+		chunk->writable = false;
+	}
+	ARR_SHRINKLEN(heap->writable, 0);
+}
+
+bool be_jit_defer_relocation(char *const location, uint8_t const be_kind,
+                             ir_entity *const entity, int32_t const offset,
+                             emit_relocation_func const emit)
+{
+	ir_jit_code_heap_t *const heap = install_heap;
+	if (heap == NULL)
+		return false;
+
+	jit_fixup_t *fixups = pmap_get(jit_fixup_t, heap->fixups, entity);
+	if (fixups == NULL)
+		fixups = NEW_ARR_F(jit_fixup_t, 0);
+	jit_fixup_t const fixup = {
+		.location = location,
+		.code     = install_code,
+		.emit     = emit,
+		.offset   = offset,
+		.be_kind  = be_kind,
+	};
+	ARR_APP1(jit_fixup_t, fixups, fixup);
+	pmap_insert(heap->fixups, entity, fixups);
+
+	if (install_code->unresolved == NULL)
+		install_code->unresolved = NEW_ARR_F(ir_entity*, 0);
+	ARR_APP1(ir_entity*, install_code->unresolved, entity);
+	return true;
+}
+
+void be_jit_bind_deferred(ir_entity *const entity)
+{
+	for (ir_jit_code_heap_t *heap = heaps; heap != NULL; heap = heap->next) {
+		jit_fixup_t *const fixups = pmap_get(jit_fixup_t, heap->fixups, entity);
+		if (fixups == NULL)
+			continue;
+		for (size_t i = 0, n = ARR_LEN(fixups); i < n; ++i) {
+			jit_fixup_t const *const fixup    = &fixups[i];
+			char              *const location = fixup->location;
+			jit_chunk_t       *const chunk    = fixup->code->chunk;
+			mark_dirty(heap, chunk, location, location);
+			unsigned const size = fixup->emit(location, fixup->be_kind, entity,
+			                                  fixup->offset);
+			chunk->dirty_end = MAX(chunk->dirty_end, location + size);
+		}
+		DEL_ARR_F(fixups);
+		pmap_insert(heap->fixups, entity, NULL);
+	}
+}
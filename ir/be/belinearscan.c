@@ -0,0 +1,260 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Linear scan register allocator.
+ *
+ * A fast register allocator for settings where compile time matters more
+ * than code quality. After the selected spiller has lowered the register
+ * pressure to the number of registers, registers are assigned in a single
+ * scan over the existing schedule, visiting the blocks in dominance order.
+ * The register of a value becomes free again after its last use. In SSA form
+ * this always succeeds, so no interference graph and no live range splitting
+ * is needed. Instead of copy coalescing, cheap hints prefer the registers of
+ * Phi arguments, should-be-same inputs and copied values.
+ */
+#include "be_t.h"
+#include "bechordal_t.h"
+#include "beirg.h"
+#include "belive.h"
+#include "belower.h"
+#include "bemodule.h"
+#include "benode.h"
+#include "bera.h"
+#include "besched.h"
+#include "bespill.h"
+#include "bespillutil.h"
+#include "bessadestr.h"
+#include "beverify.h"
+#include "bitfiddle.h"
+#include "debug.h"
+#include "irdom.h"
+#include "iredges_t.h"
+#include "irnode_t.h"
+#include "panic.h"
+#include "raw_bitset.h"
+#include "statev_t.h"
+#include "target_t.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+static void occupy(unsigned *const available, arch_register_t const *const reg,
+                   arch_register_req_t const *const req)
+{
+	for (unsigned i = 0; i < req->width; ++i)
+		rbitset_clear(available, reg->index + i);
+}
+
+static void release(unsigned *const available, arch_register_t const *const reg,
+                    arch_register_req_t const *const req)
+{
+	for (unsigned i = 0; i < req->width; ++i)
+		rbitset_set(available, reg->index + i);
+}
+
+static bool is_free(unsigned const *const available, unsigned const col,
+                    unsigned const width)
+{
+	for (unsigned i = 0; i < width; ++i) {
+		if (!rbitset_is_set(available, col + i))
+			return false;
+	}
+	return true;
+}
+
+static bool is_available(unsigned const *const available,
+                         arch_register_class_t const *const cls,
+                         arch_register_t const *const reg)
+{
+	return reg != NULL && reg->cls == cls
+	    && rbitset_is_set(available, reg->index);
+}
+
+/**
+ * Returns a free register which avoids a copy for @p value, or NULL.
+ */
+static arch_register_t const *get_hint(ir_node *const value,
+                                       arch_register_req_t const *const req,
+                                       unsigned const *const available)
+{
+	arch_register_class_t const *const cls = req->cls;
+	if (req->width > 1 || req->limited != NULL)
+		return NULL;
+
+	if (is_Phi(value)) {
+		foreach_irn_in(value, i, pred) {
+			arch_register_t const *const reg = arch_get_irn_register(pred);
+			if (is_available(available, cls, reg))
+				return reg;
+		}
+		return NULL;
+	}
+
+	/* values flowing into an already assigned Phi, e.g. over a loop back
+	 * edge */
+	foreach_out_edge(value, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (is_Phi(user)) {
+			arch_register_t const *const reg = arch_get_irn_register(user);
+			if (is_available(available, cls, reg))
+				return reg;
+		}
+	}
+
+	ir_node *const node = skip_Proj(value);
+	if (be_is_Copy(node)) {
+		arch_register_t const *const reg
+			= arch_get_irn_register(be_get_Copy_op(node));
+		return is_available(available, cls, reg) ? reg : NULL;
+	}
+
+	for (unsigned same = req->should_be_same; same != 0; same &= same - 1) {
+		ir_node               *const in  = get_irn_n(node, ntz(same));
+		arch_register_t const *const reg = arch_get_irn_register(in);
+		if (is_available(available, cls, reg))
+			return reg;
+	}
+	return NULL;
+}
+
+static arch_register_t const *choose_register(ir_node *const value,
+                                              arch_register_req_t const *const req,
+                                              unsigned const *const available)
+{
+	arch_register_t const *const hint = get_hint(value, req, available);
+	if (hint != NULL)
+		return hint;
+
+	arch_register_class_t const *const cls   = req->cls;
+	unsigned                     const width = req->width;
+	for (unsigned col = 0; col + width <= cls->n_regs; col += width) {
+		if (req->limited != NULL && !rbitset_is_set(req->limited, col))
+			continue;
+		if (is_free(available, col, width))
+			return arch_register_for_index(cls, col);
+	}
+	panic("no register left for %+F (register pressure not reduced?)", value);
+}
+
+static void assign_block(ir_node *const block, void *const data)
+{
+	be_chordal_env_t            *const env       = (be_chordal_env_t*)data;
+	arch_register_class_t const *const cls       = env->cls;
+	unsigned                    *const available = rbitset_alloca(cls->n_regs);
+	rbitset_copy(available, env->allocatable_regs->data, cls->n_regs);
+
+	DBG((dbg, LEVEL_2, "assigning registers in %+F\n", block));
+
+	/* live-ins have been assigned in the dominators already */
+	be_lv_t *const lv = be_get_irg_liveness(env->irg);
+	be_lv_foreach_cls(lv, block, be_lv_state_in, cls, value) {
+		arch_register_t const *const reg = arch_get_irn_register(value);
+		assert(reg != NULL);
+		occupy(available, reg, arch_get_irn_register_req(value));
+	}
+
+	sched_foreach(block, node) {
+		/* the registers of values used for the last time become free */
+		if (!is_Phi(node)) {
+			be_foreach_use(node, cls, in_req, value, value_req,
+				if (!be_value_live_after(value, node))
+					release(available, arch_get_irn_register(value), value_req);
+			);
+		}
+
+		be_foreach_definition(node, cls, value, req,
+			arch_register_t const *reg = arch_get_irn_register(value);
+			if (reg == NULL) {
+				reg = choose_register(value, req, available);
+				arch_set_irn_register(value, reg);
+				DB((dbg, LEVEL_2, "\t%+F: %s\n", value, reg->name));
+			}
+			assert(is_free(available, reg->index, req->width)
+			       && "pre-colored register must be free");
+			occupy(available, reg, req);
+		);
+
+		/* unused results die immediately */
+		be_foreach_definition(node, cls, value, req,
+			if (get_irn_n_edges(value) == 0)
+				release(available, arch_get_irn_register(value), req);
+		);
+	}
+}
+
+static void be_ra_linearscan(ir_graph *irg, const regalloc_if_t *regif)
+{
+	be_timer_push(T_RA_OTHER);
+
+	be_spill_prepare_for_constraints(irg);
+
+	be_chordal_env_t env;
+	obstack_init(&env.obst);
+	env.irg          = irg;
+	env.border_heads = NULL;
+	env.ifg          = NULL;
+
+	arch_register_class_t const *const reg_classes
+		= ir_target.isa->register_classes;
+	for (int j = 0, m = ir_target.isa->n_register_classes; j < m; ++j) {
+		arch_register_class_t const *const cls = &reg_classes[j];
+		if (cls->manual_ra)
+			continue;
+
+		stat_ev_ctx_push_str("belinearscan_cls", cls->name);
+
+		env.cls              = cls;
+		env.allocatable_regs = bitset_malloc(cls->n_regs);
+		be_get_allocatable_regs(irg, cls, env.allocatable_regs->data);
+		be_assure_live_chk(irg);
+
+		be_timer_push(T_RA_SPILL);
+		be_do_spill(irg, cls, regif);
+		be_timer_pop(T_RA_SPILL);
+
+		be_timer_push(T_RA_SPILL_APPLY);
+		check_for_memory_operands(irg, regif);
+		be_timer_pop(T_RA_SPILL_APPLY);
+
+		if (be_options.do_verify) {
+			be_timer_push(T_VERIFY);
+			bool check_schedule = be_verify_schedule(irg);
+			be_check_verify_result(check_schedule, irg);
+			bool check_pressure = be_verify_register_pressure(irg, cls);
+			be_check_verify_result(check_pressure, irg);
+			be_timer_pop(T_VERIFY);
+		}
+
+		be_timer_push(T_RA_COLOR);
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+		be_assure_live_sets(irg);
+		be_chordal_handle_constraints(&env);
+		dom_tree_walk_irg(irg, assign_block, NULL, &env);
+		be_timer_pop(T_RA_COLOR);
+
+		be_timer_push(T_RA_SSA);
+		be_ssa_destruction(irg, cls);
+		be_timer_pop(T_RA_SSA);
+
+		free(env.allocatable_regs);
+		stat_ev_ctx_pop("belinearscan_cls");
+	}
+
+	be_timer_push(T_RA_EPILOG);
+	lower_nodes_after_ra(irg, true);
+	obstack_free(&env.obst, NULL);
+	be_invalidate_live_sets(irg);
+	be_timer_pop(T_RA_EPILOG);
+
+	be_timer_pop(T_RA_OTHER);
+}
+
+BE_REGISTER_MODULE_CONSTRUCTOR(be_init_linearscan)
+void be_init_linearscan(void)
+{
+	be_register_allocator("linearscan", be_ra_linearscan);
+	FIRM_DBG_REGISTER(dbg, "firm.be.linearscan");
+}
@@ -16,6 +16,7 @@
 #include "beemitter.h"
 #include "begnuas.h"
 #include "beifg.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "belistsched.h"
 #include "belive.h"
@@ -30,6 +31,7 @@
 #include "bestat.h"
 #include "beutil.h"
 #include "beverify.h"
+#include "entity_t.h"
 #include "execfreq_t.h"
 #include "ident_t.h"
 #include "ircons.h"
@@ -53,6 +55,8 @@
 
 static struct obstack obst;
 static be_main_env_t  env;
+/** graphs are freed after emission, set for the duration of be_main() */
+static bool           free_irgs;
 
 /* options visible for anyone */
 be_options_t be_options = {
@@ -60,10 +64,13 @@ be_options_t be_options = {
 	.timing               = false,
 	.opt_profile_generate = false,
 	.opt_profile_use      = false,
+	.opt_profile_values   = false,
 	.omit_fp              = false,
 	.do_verify            = true,
 	.ilp_solver           = "",
 	.verbose_asm          = true,
+	.ipra                 = false,
+	.free_irgs            = false,
 };
 
 /* possible dumping options */
@@ -90,7 +97,10 @@ static const lc_opt_table_entry_t be_main_options[] = {
 	LC_OPT_ENT_BOOL     ("time",       "get backend timing statistics",                       &be_options.timing),
 	LC_OPT_ENT_BOOL     ("profilegenerate", "instrument the code for execution count profiling", &be_options.opt_profile_generate),
 	LC_OPT_ENT_BOOL     ("profileuse",      "use existing profile data",                         &be_options.opt_profile_use),
+	LC_OPT_ENT_BOOL     ("profilevalues",   "also profile divisors and switch selectors",        &be_options.opt_profile_values),
 	LC_OPT_ENT_BOOL     ("verboseasm", "enable verbose assembler output",                        &be_options.verbose_asm),
+	LC_OPT_ENT_BOOL     ("ipra",       "interprocedural register allocation for local functions", &be_options.ipra),
+	LC_OPT_ENT_BOOL     ("freeirgs",   "free each graph after its code is emitted",          &be_options.free_irgs),
 
 	LC_OPT_ENT_STR("ilp.solver", "the ilp solver name", &be_options.ilp_solver),
 	LC_OPT_LAST
@@ -281,6 +291,63 @@ static void initialize_birg(be_irg_t *birg, ir_graph *irg, be_main_env_t *env)
 	}
 }
 
+/**
+ * The most frequently entered functions, which together account for this
+ * permille of all function entries, are placed into the hot text section.
+ */
+#define HOT_ENTRIES_PERMILLE 990
+
+static int cmp_entry_count(const void *p1, const void *p2)
+{
+	uint32_t const count1 = *(const uint32_t*)p1;
+	uint32_t const count2 = *(const uint32_t*)p2;
+	return QSORT_CMP(count2, count1);
+}
+
+/**
+ * Classifies the functions by their profiled entry counts. Functions which
+ * were never entered are cold.
+ */
+static void determine_function_hotness(void)
+{
+	uint32_t *const counts  = XMALLOCN(uint32_t, get_irp_n_irgs());
+	size_t          n_irgs  = 0;
+	uint64_t        total   = 0;
+	foreach_irp_irg(i, irg) {
+		if (irg->be_data == NULL)
+			continue;
+		uint32_t const count
+			= ir_profile_get_block_execcount(get_irg_start_block(irg));
+		counts[n_irgs++] = count;
+		total           += count;
+	}
+	QSORT(counts, n_irgs, cmp_entry_count);
+
+	uint32_t hot_count = UINT32_MAX;
+	uint64_t sum       = 0;
+	for (size_t i = 0; i < n_irgs; ++i) {
+		sum += counts[i];
+		if (sum * 1000 >= total * HOT_ENTRIES_PERMILLE) {
+			hot_count = counts[i];
+			break;
+		}
+	}
+	free(counts);
+
+	foreach_irp_irg(i, irg) {
+		if (irg->be_data == NULL)
+			continue;
+		uint32_t const count
+			= ir_profile_get_block_execcount(get_irg_start_block(irg));
+		be_irg_t *const birg = be_birg_from_irg(irg);
+		if (count == 0) {
+			birg->hotness = be_hotness_cold;
+		} else if (count >= hot_count) {
+			birg->hotness = be_hotness_hot;
+		}
+	}
+}
+
 static ir_graph *be_prepare_profile(const char *const cup_name)
 {
 	obstack_printf(&obst, "%s.prof", cup_name);
@@ -293,7 +360,11 @@ static ir_graph *be_prepare_profile(const char *const cup_name)
 		if (!res) {
 			be_warningf(NULL, "could not read profile data '%s'", prof_filename);
 		} else {
+			foreach_irp_irg(i, irg) {
+				promote_indirect_calls(irg);
+			}
 			ir_create_execfreqs_from_profile();
+			determine_function_hotness();
 			ir_profile_free();
 			have_profile = true;
 		}
@@ -301,7 +372,7 @@ static ir_graph *be_prepare_profile(const char *const cup_name)
 
 	ir_graph *prof_init_irg = NULL;
 	if (be_options.opt_profile_generate)
-		prof_init_irg = ir_profile_instrument(prof_filename);
+		prof_init_irg = ir_profile_instrument(prof_filename, be_options.opt_profile_values);
 
 	if (!have_profile) {
 		be_timer_push(T_EXECFREQ);
@@ -338,6 +409,7 @@ void be_begin(FILE *file_handle, const char *cup_name)
 	}
 
 	be_timing = be_options.timing;
+	free_irgs = be_options.free_irgs;
 
 	/* perform target lowering if it didn't happen yet */
 	if (get_irp_n_irgs() > 0 && !irg_is_constrained(get_irp_irg(0), IR_GRAPH_CONSTRAINT_TARGET_LOWERED))
@@ -436,6 +508,13 @@ void be_set_after_transform_func(after_transform_func after_transform)
 	be_after_transform = after_transform;
 }
 
+static before_codegen_func be_before_codegen;
+
+void be_set_before_codegen_func(before_codegen_func before_codegen)
+{
+	be_before_codegen = before_codegen;
+}
+
 void be_after_irp_transform(const char *name)
 {
 	if (be_after_transform == NULL)
@@ -465,6 +544,9 @@ bool be_step_first(ir_graph *irg)
 	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
 		return false;
 
+	if (be_before_codegen != NULL)
+		be_before_codegen(irg);
+
 	be_timer_push(T_OTHER);
 	if (stat_ev_enabled) {
 		stat_ev_ctx_push_fmt("bemain_irg", "%+F", irg);
@@ -547,6 +629,14 @@ void be_step_last(ir_graph *irg)
 	stat_ev_ctx_pop("bemain_irg");
 
 	set_opt_cse(cse_setting);
+
+	/* Only the entity survives, it keeps its definition, so later references
+	 * from other functions and initializers are still resolved locally. */
+	if (free_irgs) {
+		ir_entity *const entity = get_irg_entity(irg);
+		entity->attr.mtd_attr.code_emitted = true;
+		free_ir_graph(irg);
+	}
 }
 
 void be_finish(void)
@@ -570,6 +660,8 @@ void be_finish(void)
 
 	be_emit_exit();
 	be_info_free();
+	be_ipra_free();
+	free_irgs = false;
 
 	pmap_destroy(env.ent_trampoline_map);
 	pmap_destroy(env.ent_pic_symbol_map);
@@ -603,6 +695,25 @@ ir_jit_function_t *be_jit_compile(ir_jit_segment_t *const segment,
 	return ir_target.isa->jit_compile(segment, irg);
 }
 
+ir_jit_function_t *be_jit_compile_baseline(ir_jit_segment_t *const segment,
+                                           ir_graph *const irg,
+                                           ir_entity *const counter)
+{
+	if (ir_target.isa->jit_compile_baseline != NULL) {
+		ir_entity *entity = get_irg_entity(irg);
+		if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
+			return NULL;
+
+		be_timer_push(T_EMIT);
+		ir_jit_function_t *const res
+			= ir_target.isa->jit_compile_baseline(segment, irg, counter);
+		be_timer_pop(T_EMIT);
+		if (res != NULL)
+			return res;
+	}
+	return be_jit_compile(segment, irg);
+}
+
 void be_emit_function(char *const buffer, ir_jit_function_t *const function)
 {
 	ir_target.isa->emit_function(buffer, function);
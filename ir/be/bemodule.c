@@ -39,6 +39,7 @@ void be_init_copynone(void);
 void be_init_copyopt(void);
 void be_init_daemelspill(void);
 void be_init_dwarf(void);
+void be_init_linearscan(void);
 void be_init_listsched(void);
 void be_init_live(void);
 void be_init_loopana(void);
@@ -104,6 +105,7 @@ void be_init_modules(void)
 
 	be_init_chordal_main();
 	be_init_pref_alloc();
+	be_init_linearscan();
 
 	be_init_chordal();
 	be_init_pbqp_coloring();
@@ -356,7 +356,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 					clique[clique_size] = clique_member;
 
 					for (idx = 0; idx < costs->len; idx++) {
-						if (costs->entries[idx].data != INF_COSTS) {
+						if (costs->entries[idx] != INF_COSTS) {
 							bipartite_add(bp, clique_size, idx);
 						}
 					}
@@ -398,7 +398,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 
 					vector_t *costs = clique_candidate->costs;
 					for (idx = 0; idx < costs->len; idx++) {
-						if (costs->entries[idx].data != INF_COSTS) {
+						if (costs->entries[idx] != INF_COSTS) {
 							bipartite_add(bp, clique_size, idx);
 						}
 					}
@@ -417,7 +417,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 				vector_t *costs = clique[nodeIdx]->costs;
 				for (int idx = 0; idx < (int)costs->len; idx++) {
 					if (assignment[nodeIdx] != idx) {
-						costs->entries[idx].data = INF_COSTS;
+						costs->entries[idx] = INF_COSTS;
 					}
 				}
 				assert(assignment[nodeIdx] >= 0 && "there must have been a register assigned (node not register pressure faithful?)");
@@ -25,11 +25,13 @@
 #include "raw_bitset.h"
 #include "statev_t.h"
 
-bool be_coalesce_spill_slots = true;
-bool be_do_remats            = true;
+bool be_coalesce_spill_slots     = true;
+bool be_coalesce_spill_intervals = true;
+bool be_do_remats                = true;
 
 static const lc_opt_table_entry_t be_spill_options[] = {
 	LC_OPT_ENT_BOOL ("coalesce_slots", "coalesce the spill slots", &be_coalesce_spill_slots),
+	LC_OPT_ENT_BOOL ("coalesce_intervals", "coalesce spill slots by live intervals instead of pairwise interference", &be_coalesce_spill_intervals),
 	LC_OPT_ENT_BOOL ("remat", "try to rematerialize values instead of reloading", &be_do_remats),
 	LC_OPT_LAST
 };
@@ -16,6 +16,7 @@
 #include <stdbool.h>
 
 extern bool be_coalesce_spill_slots;
+extern bool be_coalesce_spill_intervals;
 extern bool be_do_remats;
 
 typedef void (*be_spill_func)(ir_graph *irg, const arch_register_class_t *cls,
@@ -18,12 +18,14 @@
 #include "bemodule.h"
 #include "benode.h"
 #include "besched.h"
+#include "beutil.h"
 #include "bespill.h"
 #include "bespillutil.h"
 #include "debug.h"
 #include "execfreq.h"
 #include "ircons.h"
 #include "irdump_t.h"
+#include "iredges_t.h"
 #include "irgwalk.h"
 #include "set.h"
 #include "statev_t.h"
@@ -354,6 +356,367 @@ static void do_greedy_coalescing(be_fec_env_t *env)
 	obstack_free(&data, 0);
 }
 
+/**
+ * A live segment of a spill value. Positions number the scheduled nodes of
+ * all blocks consecutively: a value defined by the node at position p starts
+ * at p + 1, a value used by the node at position p ends at p.
+ */
+typedef struct live_segment_t {
+	unsigned begin;
+	unsigned end;
+} live_segment_t;
+
+/** Linearized position range of a block. */
+typedef struct block_range_t {
+	unsigned     begin;
+	unsigned     end;
+	unsigned     def;     /**< earliest definition of the current value */
+	ir_visited_t def_nr;  /**< def is valid if this equals the value number */
+} block_range_t;
+
+typedef struct interval_env_t {
+	struct obstack   obst;
+	unsigned        *positions;  /**< schedule position by node index */
+	ir_node        **worklist;
+	ir_visited_t     value_nr;
+	live_segment_t **segments;   /**< sorted live segments by spill number */
+} interval_env_t;
+
+static block_range_t *get_block_range(const ir_node *block)
+{
+	return (block_range_t*)get_irn_link(block);
+}
+
+/**
+ * Number the blocks in reverse postorder and the nodes within each block in
+ * schedule order.
+ */
+static void number_schedule(interval_env_t *ienv, ir_graph *irg)
+{
+	ir_node  **blocks = be_get_cfgpostorder(irg);
+	unsigned   pos    = 0;
+	for (size_t i = ARR_LEN(blocks); i-- > 0;) {
+		ir_node       *block = blocks[i];
+		block_range_t *range = OALLOCZ(&ienv->obst, block_range_t);
+		range->begin = pos++;
+		sched_foreach(block, node) {
+			ienv->positions[get_irn_idx(node)] = pos;
+			pos += 2;
+		}
+		range->end = pos++;
+		set_irn_link(block, range);
+	}
+	DEL_ARR_F(blocks);
+}
+
+static void add_segment(live_segment_t **segments, unsigned begin,
+                        unsigned end)
+{
+	live_segment_t segment = { begin, end };
+	ARR_APP1(live_segment_t, *segments, segment);
+}
+
+static void mark_def(interval_env_t *ienv, const ir_node *node)
+{
+	if (is_NoMem(node))
+		return;
+	if (is_Sync(node)) {
+		foreach_irn_in(node, i, in) {
+			mark_def(ienv, in);
+		}
+		return;
+	}
+
+	block_range_t *range = get_block_range(get_nodes_block(node));
+	unsigned       pos   = is_Phi(node) ? range->begin
+	                     : ienv->positions[get_irn_idx(skip_Proj_const(node))] + 1;
+	if (range->def_nr != ienv->value_nr || pos < range->def) {
+		range->def    = pos;
+		range->def_nr = ienv->value_nr;
+	}
+}
+
+/** The value is live at the end of @p block. */
+static void live_out(interval_env_t *ienv, ir_node *block)
+{
+	if (Block_block_visited(block))
+		return;
+	mark_Block_block_visited(block);
+	ARR_APP1(ir_node*, ienv->worklist, block);
+}
+
+/** The value is used at position @p pos in @p block. */
+static void live_use(interval_env_t *ienv, live_segment_t **segments,
+                     ir_node *block, unsigned pos)
+{
+	block_range_t *range = get_block_range(block);
+	if (range->def_nr == ienv->value_nr && range->def <= pos) {
+		add_segment(segments, range->def, pos);
+		return;
+	}
+	add_segment(segments, range->begin, pos);
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		ir_node *pred = get_Block_cfgpred_block(block, i);
+		if (pred != NULL)
+			live_out(ienv, pred);
+	}
+}
+
+static void collect_uses(interval_env_t *ienv, live_segment_t **segments,
+                         const ir_node *value)
+{
+	foreach_out_edge(value, edge) {
+		ir_node *user = get_edge_src_irn(edge);
+		if (is_Sync(user)) {
+			collect_uses(ienv, segments, user);
+		} else if (is_Phi(user)) {
+			ir_node *block = get_nodes_block(user);
+			ir_node *pred  = get_Block_cfgpred_block(block, get_edge_src_pos(edge));
+			if (pred != NULL)
+				live_use(ienv, segments, pred, get_block_range(pred)->end);
+		} else if (sched_is_scheduled(user)) {
+			live_use(ienv, segments, get_nodes_block(user),
+			         ienv->positions[get_irn_idx(user)]);
+		}
+	}
+}
+
+static int cmp_segment(const void *d1, const void *d2)
+{
+	const live_segment_t *s1 = (const live_segment_t*)d1;
+	const live_segment_t *s2 = (const live_segment_t*)d2;
+	if (s1->begin != s2->begin)
+		return s1->begin < s2->begin ? -1 : 1;
+	return (s1->end > s2->end) - (s1->end < s2->end);
+}
+
+/** Sort segments and merge overlapping ones. */
+static void normalize_segments(live_segment_t *segments)
+{
+	size_t n = ARR_LEN(segments);
+	if (n == 0)
+		return;
+	QSORT_ARR(segments, cmp_segment);
+	size_t last = 0;
+	for (size_t i = 1; i < n; ++i) {
+		if (segments[i].begin <= segments[last].end) {
+			segments[last].end = MAX(segments[last].end, segments[i].end);
+		} else {
+			segments[++last] = segments[i];
+		}
+	}
+	ARR_SHRINKLEN(segments, last + 1);
+}
+
+/**
+ * Compute the live segments of a spill value by walking backwards from its
+ * uses to its definitions.
+ */
+static live_segment_t *compute_segments(interval_env_t *ienv, ir_graph *irg,
+                                        const ir_node *value)
+{
+	live_segment_t *segments = NEW_ARR_F(live_segment_t, 0);
+	if (is_NoMem(value))
+		return segments;
+
+	++ienv->value_nr;
+	inc_irg_block_visited(irg);
+	mark_def(ienv, value);
+
+	/* a definition without uses still writes the slot */
+	if (is_Phi(value)) {
+		unsigned begin = get_block_range(get_nodes_block(value))->begin;
+		add_segment(&segments, begin, begin);
+	} else if (!is_Sync(value)) {
+		unsigned pos
+			= ienv->positions[get_irn_idx(skip_Proj_const(value))] + 1;
+		add_segment(&segments, pos, pos);
+	}
+
+	collect_uses(ienv, &segments, value);
+	for (size_t n; (n = ARR_LEN(ienv->worklist)) > 0;) {
+		ir_node *block = ienv->worklist[n - 1];
+		ARR_SHRINKLEN(ienv->worklist, n - 1);
+		live_use(ienv, &segments, block, get_block_range(block)->end);
+	}
+
+	normalize_segments(segments);
+	return segments;
+}
+
+static bool segments_intersect(const live_segment_t *s1,
+                               const live_segment_t *s2)
+{
+	for (size_t i1 = 0, i2 = 0, n1 = ARR_LEN(s1), n2 = ARR_LEN(s2);
+	     i1 < n1 && i2 < n2;) {
+		if (s1[i1].end < s2[i2].begin) {
+			++i1;
+		} else if (s2[i2].end < s1[i1].begin) {
+			++i2;
+		} else {
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Merge two non-intersecting segment lists, frees both inputs. */
+static live_segment_t *merge_segments(live_segment_t *s1, live_segment_t *s2)
+{
+	size_t          n1     = ARR_LEN(s1);
+	size_t          n2     = ARR_LEN(s2);
+	live_segment_t *result = NEW_ARR_F(live_segment_t, n1 + n2);
+	size_t          i1     = 0;
+	size_t          i2     = 0;
+	for (size_t i = 0; i < n1 + n2; ++i) {
+		if (i2 == n2 || (i1 < n1 && s1[i1].begin < s2[i2].begin)) {
+			result[i] = s1[i1++];
+		} else {
+			result[i] = s2[i2++];
+		}
+	}
+	DEL_ARR_F(s1);
+	DEL_ARR_F(s2);
+	return result;
+}
+
+static unsigned get_interval_end(const live_segment_t *segments)
+{
+	return segments[ARR_LEN(segments) - 1].end;
+}
+
+static live_segment_t **sort_segments;
+
+static int cmp_begin(const void *d1, const void *d2)
+{
+	int      i1 = *(const int*)d1;
+	int      i2 = *(const int*)d2;
+	unsigned b1 = sort_segments[i1][0].begin;
+	unsigned b2 = sort_segments[i2][0].begin;
+	if (b1 != b2)
+		return b1 < b2 ? -1 : 1;
+	return (i1 > i2) - (i1 < i2);
+}
+
+static int cmp_end(const void *d1, const void *d2)
+{
+	int      i1 = *(const int*)d1;
+	int      i2 = *(const int*)d2;
+	unsigned e1 = get_interval_end(sort_segments[i1]);
+	unsigned e2 = get_interval_end(sort_segments[i2]);
+	if (e1 != e2)
+		return e1 < e2 ? -1 : 1;
+	return (i1 > i2) - (i1 < i2);
+}
+
+/**
+ * Spillslot coalescing based on live intervals over the final schedule:
+ *  1. Compute the live segments of all spills
+ *  2. Merge slots along affinity edges if their segments do not intersect
+ *  3. Color the remaining slots with a sweep over their sorted start and end
+ *     points, reusing slots whose interval ended.
+ * Apart from the sorting and the affinity merges, this is linear in the size
+ * of the live ranges.
+ */
+static void do_interval_coalescing(be_fec_env_t *env)
+{
+	spill_t **spills     = env->spills;
+	size_t    spillcount = ARR_LEN(spills);
+	if (spillcount == 0)
+		return;
+
+	DB((dbg, LEVEL_1, "Interval coalescing %d spillslots\n", spillcount));
+
+	ir_graph      *irg = env->irg;
+	interval_env_t ienv;
+	obstack_init(&ienv.obst);
+	ienv.positions = OALLOCNZ(&ienv.obst, unsigned, get_irg_last_idx(irg));
+	ienv.worklist  = NEW_ARR_F(ir_node*, 0);
+	ienv.value_nr  = 0;
+	ienv.segments  = OALLOCN(&ienv.obst, live_segment_t*, spillcount);
+
+	/* the spills keep their links, block links are free */
+	number_schedule(&ienv, irg);
+
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	for (size_t i = 0; i < spillcount; ++i) {
+		ienv.segments[i] = compute_segments(&ienv, irg, spills[i]->spill);
+	}
+	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+
+	int *spillslot_unionfind = OALLOCN(&ienv.obst, int, spillcount);
+	uf_init(spillslot_unionfind, spillcount);
+
+	/* try to merge affine slots */
+	QSORT_ARR(env->affinity_edges, cmp_affinity);
+	for (size_t i = 0, n = ARR_LEN(env->affinity_edges); i < n; ++i) {
+		const affinity_edge_t *edge = env->affinity_edges[i];
+		int s1 = uf_find(spillslot_unionfind, edge->slot1);
+		int s2 = uf_find(spillslot_unionfind, edge->slot2);
+		if (s1 == s2
+		    || segments_intersect(ienv.segments[s1], ienv.segments[s2]))
+			continue;
+
+		DB((dbg, LEVEL_1,
+		    "Merging %d and %d because of affinity edge\n", s1, s2));
+
+		live_segment_t *merged
+			= merge_segments(ienv.segments[s1], ienv.segments[s2]);
+		ienv.segments[s1] = NULL;
+		ienv.segments[s2] = NULL;
+		ienv.segments[uf_union(spillslot_unionfind, s1, s2)] = merged;
+	}
+
+	/* collect the intervals of the remaining slots */
+	int *by_begin = NEW_ARR_F(int, 0);
+	int *slots    = OALLOCN(&ienv.obst, int, spillcount);
+	for (size_t i = 0; i < spillcount; ++i) {
+		slots[i] = i;
+		if (uf_find(spillslot_unionfind, i) == (int)i
+		    && ARR_LEN(ienv.segments[i]) > 0)
+			ARR_APP1(int, by_begin, i);
+	}
+	size_t const n_intervals = ARR_LEN(by_begin);
+	int         *by_end      = NEW_ARR_F(int, n_intervals);
+	MEMCPY(by_end, by_begin, n_intervals);
+	sort_segments = ienv.segments;
+	QSORT_ARR(by_begin, cmp_begin);
+	QSORT_ARR(by_end, cmp_end);
+	sort_segments = NULL;
+
+	/* sweep: slots of intervals that ended before the current one begins are
+	 * free for reuse */
+	int *free_slots = NEW_ARR_F(int, 0);
+	for (size_t b = 0, e = 0; b < n_intervals; ++b) {
+		int      const s     = by_begin[b];
+		unsigned const begin = ienv.segments[s][0].begin;
+		for (; get_interval_end(ienv.segments[by_end[e]]) < begin; ++e) {
+			ARR_APP1(int, free_slots, slots[by_end[e]]);
+		}
+		size_t const n_free = ARR_LEN(free_slots);
+		if (n_free > 0) {
+			slots[s] = free_slots[n_free - 1];
+			ARR_SHRINKLEN(free_slots, n_free - 1);
+			DB((dbg, LEVEL_1, "Merging %d into slot %d\n", s, slots[s]));
+		}
+	}
+
+	/* Assign spillslots to spills */
+	for (size_t i = 0; i < spillcount; ++i) {
+		spills[i]->spillslot = slots[uf_find(spillslot_unionfind, i)];
+	}
+
+	for (size_t i = 0; i < spillcount; ++i) {
+		if (ienv.segments[i] != NULL)
+			DEL_ARR_F(ienv.segments[i]);
+	}
+	DEL_ARR_F(free_slots);
+	DEL_ARR_F(by_end);
+	DEL_ARR_F(by_begin);
+	DEL_ARR_F(ienv.worklist);
+	obstack_free(&ienv.obst, NULL);
+}
+
 typedef struct spill_slot_t {
 	ir_entity *entity;
 	unsigned   size;
@@ -593,8 +956,12 @@ void be_assign_entities(be_fec_env_t *env,
 	/* Disable coalescing for "returns twice" calls: In case of setjmp/longjmp
 	 * our control flow graph isn't completely correct: There are no backedges
 	 * from longjmp to the setjmp => coalescing would produce wrong results. */
-	if (be_coalesce_spill_slots && !be_birg_from_irg(env->irg)->has_returns_twice_call)
-		do_greedy_coalescing(env);
+	if (be_coalesce_spill_slots && !be_birg_from_irg(env->irg)->has_returns_twice_call) {
+		if (be_coalesce_spill_intervals)
+			do_interval_coalescing(env);
+		else
+			do_greedy_coalescing(env);
+	}
 
 	if (stat_ev_enabled)
 		stat_ev_dbl("spillslots_after_coalescing", count_spillslots(env));
@@ -0,0 +1,1048 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Baseline JIT tier: machine code directly from the firm graph.
+ *
+ * Functions, which are only executed a few times, are not worth running the
+ * whole backend. The baseline tier generates code for a graph without
+ * instruction selection, scheduling and register allocation: Every value gets
+ * its own stack slot and each node is translated with a fixed instruction
+ * template, which loads the operands into eax/ecx/edx and stores the result
+ * back into the slot of the node. Phis are resolved with parallel copies on
+ * the control flow edges.
+ *
+ * The graph is not modified (apart from splitting critical edges), so a hot
+ * function can be recompiled with the optimizing pipeline later.
+ */
+#include "ia32_baseline.h"
+
+#include "array.h"
+#include "bejit.h"
+#include "beutil.h"
+#include "debug.h"
+#include "gen_ia32_regalloc_if.h"
+#include "ia32_bearch_t.h"
+#include "ia32_encode.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "irop_t.h"
+#include "obst.h"
+#include "pmap.h"
+#include "tv_t.h"
+#include "type_t.h"
+#include "util.h"
+#include "x86_cconv.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+#define EAX (&ia32_registers[REG_EAX])
+#define ECX (&ia32_registers[REG_ECX])
+#define EDX (&ia32_registers[REG_EDX])
+#define EBP (&ia32_registers[REG_EBP])
+#define ESP (&ia32_registers[REG_ESP])
+
+/** Stack alignment at call sites. */
+#define STACK_ALIGNMENT 16
+
+typedef struct block_info_t {
+	unsigned  fragment_num;
+	ir_node  *cfop;    /**< the control flow operation ending the block */
+	ir_node **nodes;   /**< the other nodes of the block in dependency order */
+} block_info_t;
+
+typedef struct baseline_env_t {
+	ir_graph       *irg;
+	struct obstack  obst;
+	int32_t        *offsets;     /**< frame pointer offsets of the values */
+	unsigned        frame_size;  /**< bytes used below the frame pointer */
+	unsigned        call_area;   /**< bytes for outgoing call arguments */
+	x86_cconv_t    *cconv;       /**< calling convention of the function */
+	ir_node       **blocks;      /**< blocks in emission order */
+	ir_node       **param_projs; /**< parameters, which need a prologue copy */
+	pmap           *locals;      /**< offsets of the frame entities */
+	ir_node        *unsupported; /**< a node the baseline cannot handle */
+} baseline_env_t;
+
+static block_info_t *get_block_info(ir_node const *const block)
+{
+	return (block_info_t*)get_irn_link(block);
+}
+
+static bool is_supported_mode(ir_mode const *const mode)
+{
+	if (mode == mode_b)
+		return true;
+	return (mode_is_int(mode) || mode_is_reference(mode))
+	    && get_mode_size_bits(mode) <= 32;
+}
+
+static int32_t new_slot(baseline_env_t *const env)
+{
+	env->frame_size += 4;
+	return -(int32_t)env->frame_size;
+}
+
+static void set_offset(baseline_env_t *const env, ir_node const *const node,
+                       int32_t const offset)
+{
+	env->offsets[get_irn_idx(node)] = offset;
+}
+
+static int32_t get_offset(baseline_env_t const *const env,
+                          ir_node const *const node)
+{
+	int32_t const offset = env->offsets[get_irn_idx(node)];
+	assert(offset != 0);
+	return offset;
+}
+
+static void layout_locals(baseline_env_t *const env)
+{
+	ir_type *const frame = get_irg_frame_type(env->irg);
+	for (size_t i = 0, n = get_compound_n_members(frame); i < n; ++i) {
+		ir_entity *const member = get_compound_member(frame, i);
+		if (is_parameter_entity(member))
+			continue;
+		ir_type  *const type  = get_entity_type(member);
+		unsigned  const align = get_type_alignment(type);
+		/* the frame pointer is only 8 byte aligned */
+		if (align > 8) {
+			env->unsupported = get_irg_frame(env->irg);
+			return;
+		}
+		env->frame_size = round_up2(env->frame_size + get_type_size(type),
+		                            MAX(align, 1));
+		pmap_insert(env->locals, member, INT_TO_PTR(-(int)env->frame_size));
+	}
+}
+
+static bool is_frame_member(baseline_env_t const *const env,
+                            ir_node const *const node)
+{
+	return is_Member(node) && get_Member_ptr(node) == get_irg_frame(env->irg);
+}
+
+static void check_call(baseline_env_t *const env, ir_node *const call)
+{
+	ir_type     *const type  = get_Call_type(call);
+	x86_cconv_t *const cconv = ia32_decide_calling_convention(type, NULL);
+	for (size_t i = 0, n = get_Call_n_params(call); i < n; ++i) {
+		ir_node *const param = get_Call_param(call, i);
+		if (!is_supported_mode(get_irn_mode(param))
+		 || mode_is_float(get_irn_mode(param)))
+			env->unsupported = call;
+	}
+	for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i) {
+		ir_type *const res_type = get_method_res_type(type, i);
+		if (!is_atomic_type(res_type)
+		 || !is_supported_mode(get_type_mode(res_type)))
+			env->unsupported = call;
+	}
+	env->call_area = MAX(env->call_area, cconv->param_stacksize);
+	x86_free_calling_convention(cconv);
+}
+
+/**
+ * Assigns a stack slot to a value. Projs and Confirms share the slot of
+ * their predecessor where possible.
+ */
+static void assign_slot(baseline_env_t *const env, ir_node *const node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	if (!is_Proj(node)) {
+		set_offset(env, node, new_slot(env));
+		return;
+	}
+
+	ir_node *const pred = get_Proj_pred(node);
+	if (is_Proj(pred) && get_Proj_pred(pred) == get_irg_start(env->irg)) {
+		/* parameter */
+		unsigned            const num   = get_Proj_num(node);
+		reg_or_stackslot_t const *const param = &env->cconv->parameters[num];
+		if (param->reg != NULL || get_mode_size_bits(mode) < 32) {
+			set_offset(env, node, new_slot(env));
+			ARR_APP1(ir_node*, env->param_projs, node);
+		} else {
+			set_offset(env, node, 2 * IA32_REGISTER_SIZE + param->offset);
+		}
+	} else if (is_Proj(pred) && is_Call(get_Proj_pred(pred))) {
+		/* call result */
+		ir_node *const call = get_Proj_pred(pred);
+		set_offset(env, node, get_offset(env, call) - 4 * get_Proj_num(node));
+	} else {
+		/* results of Load, Div, Mod */
+		set_offset(env, node, get_offset(env, pred));
+	}
+}
+
+static void prepare_node(ir_node *const node, void *const data)
+{
+	baseline_env_t *const env = (baseline_env_t*)data;
+	if (is_Block(node))
+		return;
+
+	/* the frame base is only supported as address of frame entities */
+	ir_node *const frame = get_irg_frame(env->irg);
+	foreach_irn_in(node, i, pred) {
+		if (pred == frame && !is_Member(node))
+			env->unsupported = node;
+	}
+
+	ir_mode *const mode = get_irn_mode(node);
+	switch (get_irn_opcode(node)) {
+	case iro_Start:
+	case iro_End:
+	case iro_NoMem:
+	case iro_Sync:
+	case iro_Pin:
+		return;
+
+	case iro_Proj:
+		if (mode == mode_M || mode == mode_T || mode == mode_X)
+			return;
+		if (get_Proj_pred(node) == get_irg_start(env->irg)) {
+			/* only the frame base is a value; it is handled by Member */
+			return;
+		}
+		break;
+
+	case iro_Phi:
+		if (mode == mode_M)
+			return;
+		add_Block_phi(get_nodes_block(node), node);
+		break;
+
+	case iro_Jmp:
+	case iro_Return:
+	case iro_Cond:
+	case iro_Switch: {
+		block_info_t *const info = get_block_info(get_nodes_block(node));
+		assert(info->cfop == NULL);
+		info->cfop = node;
+		if (is_Switch(node)
+		 && !is_supported_mode(get_irn_mode(get_Switch_selector(node))))
+			env->unsupported = node;
+		return;
+	}
+
+	case iro_Call:
+		if (ir_throws_exception(node))
+			env->unsupported = node;
+		check_call(env, node);
+		/* reserve a slot for each result */
+		set_offset(env, node, new_slot(env));
+		env->frame_size += 4;
+		goto add;
+
+	case iro_Load:
+	case iro_Store:
+	case iro_Div:
+	case iro_Mod:
+		if (ir_throws_exception(node))
+			env->unsupported = node;
+		if (is_Load(node) && !is_supported_mode(get_Load_mode(node)))
+			env->unsupported = node;
+		if (is_Store(node)
+		 && !is_supported_mode(get_irn_mode(get_Store_value(node))))
+			env->unsupported = node;
+		if (is_Div(node) && !is_supported_mode(get_Div_resmode(node)))
+			env->unsupported = node;
+		if (is_Mod(node) && !is_supported_mode(get_Mod_resmode(node)))
+			env->unsupported = node;
+		if (!is_Store(node))
+			set_offset(env, node, new_slot(env));
+		goto add;
+
+	case iro_Cmp: {
+		ir_mode *const cmp_mode = get_irn_mode(get_Cmp_left(node));
+		if (!is_supported_mode(cmp_mode) || cmp_mode == mode_b)
+			env->unsupported = node;
+		break;
+	}
+
+	case iro_Member:
+		if (is_frame_member(env, node)) {
+			ir_entity *const entity = get_Member_entity(node);
+			if (is_parameter_entity(entity)) {
+				size_t const num = get_entity_parameter_number(entity);
+				if (num >= env->cconv->n_parameters
+				 || env->cconv->parameters[num].reg != NULL)
+					env->unsupported = node;
+			} else if (!pmap_contains(env->locals, entity)) {
+				env->unsupported = node;
+			}
+		}
+		break;
+
+	case iro_Address:
+		if (is_tls_entity(get_Address_entity(node)))
+			env->unsupported = node;
+		break;
+
+	case iro_Mulh:
+		if (get_mode_size_bits(mode) != 32)
+			env->unsupported = node;
+		break;
+
+	case iro_Confirm:
+		set_offset(env, node, get_offset(env, get_Confirm_value(node)));
+		goto add;
+
+	case iro_Add:
+	case iro_And:
+	case iro_Bitcast:
+	case iro_Const:
+	case iro_Conv:
+	case iro_Eor:
+	case iro_Minus:
+	case iro_Mul:
+	case iro_Mux:
+	case iro_Not:
+	case iro_Or:
+	case iro_Shl:
+	case iro_Shr:
+	case iro_Shrs:
+	case iro_Sub:
+	case iro_Unknown:
+		break;
+
+	default:
+		env->unsupported = node;
+		return;
+	}
+
+	if (!is_supported_mode(mode)) {
+		env->unsupported = node;
+		return;
+	}
+	if (is_Conv(node) || is_Bitcast(node)) {
+		ir_mode *const op_mode = get_irn_mode(get_irn_n(node, 0));
+		if (!is_supported_mode(op_mode) || op_mode == mode_b)
+			env->unsupported = node;
+	}
+	assign_slot(env, node);
+	if (is_Proj(node) || is_Phi(node))
+		return;
+
+add:;
+	block_info_t *const info = get_block_info(get_nodes_block(node));
+	ARR_APP1(ir_node*, info->nodes, node);
+}
+
+static void prepare_block(ir_node *const block, void *const data)
+{
+	baseline_env_t *const env = (baseline_env_t*)data;
+	set_Block_phis(block, NULL);
+
+	block_info_t *const info = OALLOCZ(&env->obst, block_info_t);
+	info->nodes = NEW_ARR_F(ir_node*, 0);
+	set_irn_link(block, info);
+	if (block != get_irg_end_block(env->irg))
+		ARR_APP1(ir_node*, env->blocks, block);
+
+	/* remember the targets of the control flow operations */
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		ir_node *const pred = get_Block_cfgpred(block, i);
+		if (is_Proj(pred)) {
+			ir_node *const fork = get_Proj_pred(pred);
+			if (!is_Cond(fork) && !is_Switch(fork)) {
+				env->unsupported = fork;
+				continue;
+			}
+			ir_node **targets = (ir_node**)get_irn_link(fork);
+			if (targets == NULL) {
+				unsigned const n_outs
+					= is_Cond(fork) ? pn_Cond_max + 1 : get_Switch_n_outs(fork);
+				targets = OALLOCNZ(&env->obst, ir_node*, n_outs);
+				set_irn_link(fork, targets);
+			}
+			targets[get_Proj_num(pred)] = block;
+		} else if (is_Jmp(pred) || is_Return(pred)) {
+			set_irn_link(pred, block);
+		} else {
+			env->unsupported = pred;
+		}
+	}
+}
+
+static void clear_links(ir_node *const node, void *const data)
+{
+	(void)data;
+	set_irn_link(node, NULL);
+}
+
+/*
+ * Instruction templates. The operands are always loaded from and stored to
+ * the stack slots relative to ebp.
+ */
+
+static void enc_load_slot(baseline_env_t const *const env,
+                          arch_register_t const *const reg,
+                          ir_node const *const value)
+{
+	be_emit8(0x8B); // movl slot, %reg
+	ia32_enc_mod_base(reg->encoding, EBP, get_offset(env, value));
+}
+
+static void enc_store_slot(baseline_env_t const *const env,
+                           ir_node const *const value,
+                           arch_register_t const *const reg)
+{
+	be_emit8(0x89); // movl %reg, slot
+	ia32_enc_mod_base(reg->encoding, EBP, get_offset(env, value));
+}
+
+/** Emits "op slot, %eax" for a binary operation in the 0x01-0x3B range. */
+static void enc_binop_slot(baseline_env_t const *const env, uint8_t const code,
+                           ir_node const *const right)
+{
+	be_emit8(code | 0x03);
+	ia32_enc_mod_base(EAX->encoding, EBP, get_offset(env, right));
+}
+
+static void enc_unop_eax(uint8_t const code, uint8_t const ext)
+{
+	be_emit8(code);
+	be_emit8(0xC0 | ext << 3 | EAX->encoding);
+}
+
+static void enc_mov_reg(arch_register_t const *const src,
+                        arch_register_t const *const dst)
+{
+	be_emit8(0x89); // movl %src, %dst
+	be_emit8(0xC0 | src->encoding << 3 | dst->encoding);
+}
+
+/** Emits a sign/zero extension of %eax if @p mode is smaller than 32 bits. */
+static void enc_extend_eax(ir_mode *const mode)
+{
+	unsigned const bits = get_mode_size_bits(mode);
+	if (mode == mode_b || bits == 32)
+		return;
+	assert(bits == 8 || bits == 16);
+	be_emit8(0x0F); // movs/movz %al/%ax, %eax
+	be_emit8((mode_is_signed(mode) ? 0xBE : 0xB6) | (bits == 16));
+	be_emit8(0xC0);
+}
+
+static void enc_mov_imm_slot(baseline_env_t const *const env,
+                             ir_node const *const value,
+                             x86_imm32_t const *const imm)
+{
+	be_emit8(0xC7); // movl $imm, slot
+	ia32_enc_mod_base(0, EBP, get_offset(env, value));
+	ia32_enc_relocation(imm);
+}
+
+static void enc_cmp_slot_0(baseline_env_t const *const env,
+                           ir_node const *const value)
+{
+	be_emit8(0x80); // cmpb $0, slot
+	ia32_enc_mod_base(7, EBP, get_offset(env, value));
+	be_emit8(0);
+}
+
+static void enc_esp_adjust(uint8_t const ext, unsigned const size)
+{
+	be_emit8(0x81); // add/subl $size, %esp
+	be_emit8(0xC0 | ext << 3 | ESP->encoding);
+	be_emit32(size);
+}
+
+static uint32_t get_imm32(ir_tarval *const tv)
+{
+	if (get_tarval_mode(tv) == mode_b)
+		return tv == tarval_b_true;
+	if (tarval_is_long(tv))
+		return (uint32_t)get_tarval_long(tv);
+	/* unsigned values beyond the range of long on 32bit hosts */
+	uint32_t res = 0;
+	for (unsigned i = 0; i < 4; ++i)
+		res |= (uint32_t)get_tarval_sub_bits(tv, i) << (8 * i);
+	return res;
+}
+
+static void enc_const(baseline_env_t const *const env, ir_node const *const node,
+                      uint32_t const value)
+{
+	x86_imm32_t const imm = { .kind = X86_IMM_VALUE, .offset = value };
+	enc_mov_imm_slot(env, node, &imm);
+}
+
+/** Loads both operands of a Cmp and compares them. */
+static x86_condition_code_t enc_cmp(baseline_env_t const *const env,
+                                    ir_node const *const cmp)
+{
+	ir_node *const left  = get_Cmp_left(cmp);
+	ir_node *const right = get_Cmp_right(cmp);
+	enc_load_slot(env, EAX, left);
+	enc_binop_slot(env, 0x38, right);
+	return ir_relation_to_x86_condition_code(get_Cmp_relation(cmp),
+	                                         get_irn_mode(left), true);
+}
+
+static void enc_memop(uint8_t const code, ir_mode *const mode)
+{
+	unsigned const bits = get_mode_size_bits(mode);
+	if (bits == 16)
+		be_emit8(0x66);
+	be_emit8(bits == 8 ? code : code | 0x01);
+	ia32_enc_mod_base(EAX->encoding, ECX, 0);
+}
+
+static void enc_load(baseline_env_t const *const env, ir_node const *const node)
+{
+	ir_mode *const mode = get_Load_mode(node);
+	enc_load_slot(env, ECX, get_Load_ptr(node));
+	unsigned const bits = get_mode_size_bits(mode);
+	if (bits == 32 || mode == mode_b) {
+		be_emit8(0x8B); // movl (%ecx), %eax
+	} else {
+		be_emit8(0x0F); // movs/movz (%ecx), %eax
+		be_emit8((mode_is_signed(mode) ? 0xBE : 0xB6) | (bits == 16));
+	}
+	ia32_enc_mod_base(EAX->encoding, ECX, 0);
+	if (mode == mode_b)
+		enc_extend_eax(mode_Bu);
+	enc_store_slot(env, node, EAX);
+}
+
+static void enc_store(baseline_env_t const *const env, ir_node const *const node)
+{
+	ir_node *const value = get_Store_value(node);
+	ir_mode *const mode  = get_irn_mode(value);
+	enc_load_slot(env, ECX, get_Store_ptr(node));
+	enc_load_slot(env, EAX, value);
+	enc_memop(0x88, mode == mode_b ? mode_Bu : mode);
+}
+
+static void enc_divmod(baseline_env_t const *const env, ir_node const *const node,
+                       ir_node const *const left, ir_node const *const right,
+                       ir_mode *const mode, bool const is_mod)
+{
+	enc_load_slot(env, EAX, left);
+	bool const is_signed = mode_is_signed(mode);
+	if (is_signed) {
+		be_emit8(0x99); // cltd
+	} else {
+		be_emit8(0x31); // xorl %edx, %edx
+		be_emit8(0xD2);
+	}
+	be_emit8(0xF7); // (i)divl slot
+	ia32_enc_mod_base(is_signed ? 7 : 6, EBP, get_offset(env, right));
+	if (is_mod)
+		enc_mov_reg(EDX, EAX);
+	enc_extend_eax(mode);
+	enc_store_slot(env, node, EAX);
+}
+
+static void enc_member(baseline_env_t const *const env, ir_node const *const node)
+{
+	ir_entity *const entity = get_Member_entity(node);
+	if (is_frame_member(env, node)) {
+		int32_t offset;
+		if (is_parameter_entity(entity)) {
+			size_t const num = get_entity_parameter_number(entity);
+			offset = 2 * IA32_REGISTER_SIZE
+			       + env->cconv->parameters[num].offset;
+		} else {
+			offset = PTR_TO_INT(pmap_get(void, env->locals, entity));
+		}
+		be_emit8(0x8D); // leal offset(%ebp), %eax
+		ia32_enc_mod_base(EAX->encoding, EBP, offset);
+	} else {
+		enc_load_slot(env, EAX, get_Member_ptr(node));
+		int32_t const offset = get_entity_offset(entity);
+		if (offset != 0) {
+			be_emit8(0x05); // addl $offset, %eax
+			be_emit32(offset);
+		}
+	}
+	enc_store_slot(env, node, EAX);
+}
+
+static void enc_mux(baseline_env_t const *const env, ir_node const *const node)
+{
+	ir_node *const val_true = get_Mux_true(node);
+	int32_t  const offset   = get_offset(env, val_true);
+	enc_load_slot(env, EAX, get_Mux_false(node));
+	enc_cmp_slot_0(env, get_Mux_sel(node));
+	/* skip the following movl */
+	be_emit8(0x74); // je
+	be_emit8(ia32_is_8bit_val(offset) ? 3 : 6);
+	enc_load_slot(env, EAX, val_true);
+	enc_store_slot(env, node, EAX);
+}
+
+static void enc_call(baseline_env_t const *const env, ir_node const *const node)
+{
+	ir_type     *const type  = get_Call_type(node);
+	x86_cconv_t *const cconv = ia32_decide_calling_convention(type, NULL);
+
+	/* stack parameters are stored into the outgoing argument area */
+	for (size_t i = 0, n = get_Call_n_params(node); i < n; ++i) {
+		reg_or_stackslot_t const *const param = &cconv->parameters[i];
+		if (param->reg != NULL)
+			continue;
+		enc_load_slot(env, EAX, get_Call_param(node, i));
+		be_emit8(0x89); // movl %eax, offset(%esp)
+		ia32_enc_mod_base(EAX->encoding, ESP, param->offset);
+	}
+	for (size_t i = 0, n = get_Call_n_params(node); i < n; ++i) {
+		reg_or_stackslot_t const *const param = &cconv->parameters[i];
+		if (param->reg != NULL)
+			enc_load_slot(env, param->reg, get_Call_param(node, i));
+	}
+
+	ir_node *const callee = get_Call_ptr(node);
+	if (is_Address(callee)) {
+		ia32_enc_call_entity(get_Address_entity(callee), 0);
+	} else {
+		be_emit8(0xFF); // call *slot
+		ia32_enc_mod_base(2, EBP, get_offset(env, callee));
+	}
+	if (cconv->sp_delta != 0)
+		enc_esp_adjust(5, cconv->sp_delta);
+
+	int32_t const offset = get_offset(env, node);
+	for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i) {
+		arch_register_t const *const reg = cconv->results[i].reg;
+		if (reg != EAX) {
+			assert(i > 0);
+			enc_mov_reg(reg, EAX);
+		}
+		enc_extend_eax(get_type_mode(get_method_res_type(type, i)));
+		be_emit8(0x89); // movl %eax, slot
+		ia32_enc_mod_base(EAX->encoding, EBP, offset - 4 * (int32_t)i);
+	}
+	x86_free_calling_convention(cconv);
+}
+
+static void enc_node(baseline_env_t const *const env, ir_node *const node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	switch (get_irn_opcode(node)) {
+	case iro_Const:
+		enc_const(env, node, get_imm32(get_Const_tarval(node)));
+		return;
+
+	case iro_Address: {
+		x86_imm32_t const imm = {
+			.kind   = X86_IMM_ADDR,
+			.entity = get_Address_entity(node),
+		};
+		enc_mov_imm_slot(env, node, &imm);
+		return;
+	}
+
+	case iro_Member:
+		enc_member(env, node);
+		return;
+
+	case iro_Add:  enc_load_slot(env, EAX, get_Add_left(node));
+	               enc_binop_slot(env, 0x00, get_Add_right(node)); break;
+	case iro_Sub:  enc_load_slot(env, EAX, get_Sub_left(node));
+	               enc_binop_slot(env, 0x28, get_Sub_right(node)); break;
+	case iro_And:  enc_load_slot(env, EAX, get_And_left(node));
+	               enc_binop_slot(env, 0x20, get_And_right(node)); break;
+	case iro_Or:   enc_load_slot(env, EAX, get_Or_left(node));
+	               enc_binop_slot(env, 0x08, get_Or_right(node)); break;
+	case iro_Eor:  enc_load_slot(env, EAX, get_Eor_left(node));
+	               enc_binop_slot(env, 0x30, get_Eor_right(node)); break;
+
+	case iro_Mul:
+		enc_load_slot(env, EAX, get_Mul_left(node));
+		be_emit8(0x0F); // imull slot, %eax
+		be_emit8(0xAF);
+		ia32_enc_mod_base(EAX->encoding, EBP, get_offset(env, get_Mul_right(node)));
+		break;
+
+	case iro_Mulh:
+		enc_load_slot(env, EAX, get_Mulh_left(node));
+		be_emit8(0xF7); // (i)mull slot
+		ia32_enc_mod_base(mode_is_signed(mode) ? 5 : 4, EBP,
+		                  get_offset(env, get_Mulh_right(node)));
+		enc_mov_reg(EDX, EAX);
+		break;
+
+	case iro_Shl:
+	case iro_Shr:
+	case iro_Shrs: {
+		uint8_t const ext = is_Shl(node) ? 4 : is_Shr(node) ? 5 : 7;
+		enc_load_slot(env, EAX, get_binop_left(node));
+		enc_load_slot(env, ECX, get_binop_right(node));
+		enc_unop_eax(0xD3, ext); // shl/shr/sar %cl, %eax
+		break;
+	}
+
+	case iro_Minus:
+		enc_load_slot(env, EAX, get_Minus_op(node));
+		enc_unop_eax(0xF7, 3); // negl %eax
+		break;
+
+	case iro_Not:
+		enc_load_slot(env, EAX, get_Not_op(node));
+		if (mode == mode_b) {
+			be_emit8(0x83); // xorl $1, %eax
+			be_emit8(0xF0);
+			be_emit8(1);
+		} else {
+			enc_unop_eax(0xF7, 2); // notl %eax
+		}
+		break;
+
+	case iro_Conv:
+	case iro_Bitcast:
+		enc_load_slot(env, EAX, get_irn_n(node, 0));
+		break;
+
+	case iro_Cmp: {
+		ir_relation const relation = get_Cmp_relation(node);
+		if (relation == ir_relation_false || relation == ir_relation_true) {
+			enc_const(env, node, relation == ir_relation_true);
+			return;
+		}
+		x86_condition_code_t const cc = enc_cmp(env, node);
+		be_emit8(0x0F); // setcc %al
+		be_emit8(0x90 | (cc & 0xF));
+		be_emit8(0xC0);
+		enc_extend_eax(mode_Bu);
+		break;
+	}
+
+	case iro_Mux:
+		enc_mux(env, node);
+		return;
+
+	case iro_Load:
+		enc_load(env, node);
+		return;
+	case iro_Store:
+		enc_store(env, node);
+		return;
+
+	case iro_Div:
+		enc_divmod(env, node, get_Div_left(node), get_Div_right(node),
+		           get_Div_resmode(node), false);
+		return;
+	case iro_Mod:
+		enc_divmod(env, node, get_Mod_left(node), get_Mod_right(node),
+		           get_Mod_resmode(node), true);
+		return;
+
+	case iro_Call:
+		enc_call(env, node);
+		return;
+
+	case iro_Confirm:
+	case iro_Unknown:
+		return;
+
+	default:
+		panic("unexpected node %+F", node);
+	}
+
+	enc_extend_eax(mode);
+	enc_store_slot(env, node, EAX);
+}
+
+/**
+ * Copies the values of the Phi operands of @p block for predecessor @p pos
+ * into the slots of the Phis. The copies have to be parallel as the Phis may
+ * use each other, so all values are pushed first.
+ */
+static void enc_phi_copies(baseline_env_t const *const env,
+                           ir_node const *const block, int const pos)
+{
+	unsigned n_phis = 0;
+	for (ir_node *phi = get_Block_phis(block); phi != NULL;
+	     phi = get_Phi_next(phi)) {
+		be_emit8(0xFF); // pushl slot
+		ia32_enc_mod_base(6, EBP, get_offset(env, get_Phi_pred(phi, pos)));
+		++n_phis;
+	}
+	if (n_phis == 0)
+		return;
+
+	ir_node **const phis = ALLOCAN(ir_node*, n_phis);
+	unsigned        i    = 0;
+	for (ir_node *phi = get_Block_phis(block); phi != NULL;
+	     phi = get_Phi_next(phi)) {
+		phis[i++] = phi;
+	}
+	while (i-- > 0) {
+		be_emit8(0x8F); // popl slot
+		ia32_enc_mod_base(0, EBP, get_offset(env, phis[i]));
+	}
+}
+
+static bool is_edge_copy_block(ir_node const *const block)
+{
+	/* Phi copies are placed at the end of predecessors ending with a Jmp.
+	 * Otherwise the critical edge splitting made sure that the block has only
+	 * a single predecessor, so they are placed at its begin. */
+	return get_Block_n_cfgpreds(block) == 1
+	    && !is_Jmp(get_Block_cfgpred(block, 0));
+}
+
+static void enc_jump_to(unsigned const fragment_num, ir_node const *const block)
+{
+	unsigned const target = get_block_info(block)->fragment_num;
+	if (target != fragment_num + 1)
+		ia32_enc_jmp_fragment(target);
+}
+
+static void enc_cond(baseline_env_t const *const env, ir_node const *const node,
+                     unsigned const fragment_num)
+{
+	ir_node **const targets = (ir_node**)get_irn_link(node);
+	ir_node  *const sel     = get_Cond_selector(node);
+	ir_node  *const t       = targets[pn_Cond_true];
+	ir_node  *const f       = targets[pn_Cond_false];
+
+	x86_condition_code_t cc;
+	if (is_Cmp(sel)) {
+		ir_relation const relation = get_Cmp_relation(sel);
+		if (relation == ir_relation_false || relation == ir_relation_true) {
+			ir_node *const target = relation == ir_relation_true ? t : f;
+			ia32_enc_jmp_fragment(get_block_info(target)->fragment_num);
+			return;
+		}
+		cc = enc_cmp(env, sel);
+	} else {
+		enc_cmp_slot_0(env, sel);
+		cc = x86_cc_not_equal;
+	}
+	unsigned const t_num = get_block_info(t)->fragment_num;
+	unsigned const f_num = get_block_info(f)->fragment_num;
+	if (t_num == fragment_num + 1) {
+		ia32_enc_jcc_fragment(x86_negate_condition_code(cc), f_num);
+	} else {
+		ia32_enc_jcc_fragment(cc, t_num);
+		enc_jump_to(fragment_num, f);
+	}
+}
+
+/** Switches are lowered to a sequence of compares. */
+static void enc_switch(baseline_env_t const *const env, ir_node const *const node,
+                       unsigned const fragment_num)
+{
+	ir_node         **const targets = (ir_node**)get_irn_link(node);
+	ir_switch_table  *const table   = get_Switch_table(node);
+	enc_load_slot(env, EAX, get_Switch_selector(node));
+	for (size_t e = 0, n = ir_switch_table_get_n_entries(table); e < n; ++e) {
+		ir_switch_table_entry const *const entry
+			= ir_switch_table_get_entry_const(table, e);
+		ir_node *const target = targets[entry->pn];
+		if (entry->min == NULL || target == NULL)
+			continue;
+		uint32_t const min = get_imm32(entry->min);
+		uint32_t const max = get_imm32(entry->max);
+		if (min == max) {
+			be_emit8(0x3D); // cmpl $min, %eax
+			be_emit32(min);
+			ia32_enc_jcc_fragment(x86_cc_equal,
+			                      get_block_info(target)->fragment_num);
+		} else {
+			enc_mov_reg(EAX, ECX);
+			be_emit8(0x81); // subl $min, %ecx
+			be_emit8(0xE9);
+			be_emit32(min);
+			be_emit8(0x81); // cmpl $(max - min), %ecx
+			be_emit8(0xF9);
+			be_emit32(max - min);
+			ia32_enc_jcc_fragment(x86_cc_below_equal,
+			                      get_block_info(target)->fragment_num);
+		}
+	}
+	ir_node *const default_target = targets[pn_Switch_default];
+	if (default_target != NULL)
+		enc_jump_to(fragment_num, default_target);
+}
+
+static void enc_return(baseline_env_t const *const env, ir_node const *const node)
+{
+	for (size_t i = 0, n = get_Return_n_ress(node); i < n; ++i) {
+		arch_register_t const *const reg = env->cconv->results[i].reg;
+		enc_load_slot(env, reg, get_Return_res(node, i));
+	}
+	ia32_enc_simple(0xC9); // leave
+	unsigned const pop = env->cconv->sp_delta;
+	if (pop > 0) {
+		be_emit8(0xC2); // ret $pop
+		be_emit16(pop);
+	} else {
+		be_emit8(0xC3); // ret
+	}
+}
+
+static void enc_prologue(baseline_env_t const *const env,
+                         ir_entity *const counter)
+{
+	if (counter != NULL) {
+		x86_imm32_t const imm = { .kind = X86_IMM_ADDR, .entity = counter };
+		be_emit8(0xFF); // incl counter
+		ia32_enc_mod_abs(0, &imm);
+	}
+
+	be_emit8(0x55); // pushl %ebp
+	enc_mov_reg(ESP, EBP);
+
+	/* keep the stack pointer aligned at calls */
+	unsigned const size = env->frame_size + env->call_area;
+	unsigned const aligned
+		= round_up2(size + 2 * IA32_REGISTER_SIZE, STACK_ALIGNMENT)
+		- 2 * IA32_REGISTER_SIZE;
+	if (aligned > 0)
+		enc_esp_adjust(5, aligned);
+
+	/* copy register parameters into their slots first, they are clobbered by
+	 * the extension of small parameters */
+	for (size_t i = 0, n = ARR_LEN(env->param_projs); i < n; ++i) {
+		ir_node                  *const proj  = env->param_projs[i];
+		reg_or_stackslot_t const *const param
+			= &env->cconv->parameters[get_Proj_num(proj)];
+		if (param->reg != NULL)
+			enc_store_slot(env, proj, param->reg);
+	}
+	for (size_t i = 0, n = ARR_LEN(env->param_projs); i < n; ++i) {
+		ir_node                  *const proj  = env->param_projs[i];
+		ir_mode                  *const mode  = get_irn_mode(proj);
+		reg_or_stackslot_t const *const param
+			= &env->cconv->parameters[get_Proj_num(proj)];
+		if (get_mode_size_bits(mode) == 32)
+			continue;
+		be_emit8(0x8B); // movl param, %eax
+		ia32_enc_mod_base(EAX->encoding, EBP, param->reg != NULL
+			? get_offset(env, proj)
+			: 2 * IA32_REGISTER_SIZE + (int32_t)param->offset);
+		enc_extend_eax(mode);
+		enc_store_slot(env, proj, EAX);
+	}
+}
+
+static void enc_block(baseline_env_t const *const env, ir_node *const block,
+                      ir_entity *const counter)
+{
+	block_info_t *const info = get_block_info(block);
+	unsigned const fragment_num = be_begin_fragment(0, 0);
+	assert(fragment_num == info->fragment_num);
+
+	if (block == get_irg_start_block(env->irg))
+		enc_prologue(env, counter);
+	if (is_edge_copy_block(block))
+		enc_phi_copies(env, block, 0);
+
+	for (size_t i = 0, n = ARR_LEN(info->nodes); i < n; ++i)
+		enc_node(env, info->nodes[i]);
+
+	ir_node *const cfop = info->cfop;
+	switch (get_irn_opcode(cfop)) {
+	case iro_Jmp: {
+		ir_node *const target = (ir_node*)get_irn_link(cfop);
+		if (!is_edge_copy_block(target)) {
+			int pos = 0;
+			while (get_Block_cfgpred(target, pos) != cfop)
+				++pos;
+			enc_phi_copies(env, target, pos);
+		}
+		enc_jump_to(fragment_num, target);
+		break;
+	}
+	case iro_Cond:
+		enc_cond(env, cfop, fragment_num);
+		break;
+	case iro_Switch:
+		enc_switch(env, cfop, fragment_num);
+		break;
+	case iro_Return:
+		enc_return(env, cfop);
+		break;
+	default:
+		panic("unexpected control flow operation %+F", cfop);
+	}
+
+	be_finish_fragment();
+}
+
+ir_jit_function_t *ia32_baseline_jit(ir_jit_segment_t *const segment,
+                                     ir_graph *const irg,
+                                     ir_entity *const counter)
+{
+	assure_irg_properties(irg,
+		IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+		| IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES);
+
+	ir_type *const type = get_entity_type(get_irg_entity(irg));
+	baseline_env_t env = {
+		.irg         = irg,
+		.offsets     = XMALLOCNZ(int32_t, get_irg_last_idx(irg)),
+		.cconv       = ia32_decide_calling_convention(type, NULL),
+		.blocks      = NEW_ARR_F(ir_node*, 0),
+		.param_projs = NEW_ARR_F(ir_node*, 0),
+		.locals      = pmap_create(),
+	};
+	obstack_init(&env.obst);
+	for (size_t i = 0, n = env.cconv->n_parameters; i < n; ++i) {
+		if (env.cconv->parameters[i].type != NULL
+		 && !is_atomic_type(env.cconv->parameters[i].type))
+			env.unsupported = get_irg_start(irg);
+	}
+	for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i) {
+		if (mode_is_float(get_type_mode(get_method_res_type(type, i))))
+			env.unsupported = get_irg_end(irg);
+	}
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
+	irg_walk_graph(irg, clear_links, NULL, NULL);
+	layout_locals(&env);
+	irg_block_walk_graph(irg, NULL, prepare_block, &env);
+	/* the function is entered at the first fragment */
+	ir_node *const start_block = get_irg_start_block(irg);
+	for (size_t i = ARR_LEN(env.blocks); i-- > 0;) {
+		ir_node *const block = env.blocks[i];
+		if (block == start_block) {
+			memmove(&env.blocks[1], &env.blocks[0], i * sizeof(*env.blocks));
+			env.blocks[0] = start_block;
+			break;
+		}
+	}
+	for (size_t i = 0, n = ARR_LEN(env.blocks); i < n; ++i)
+		get_block_info(env.blocks[i])->fragment_num = i;
+	irg_walk_graph(irg, NULL, prepare_node, &env);
+
+	ir_jit_function_t *res = NULL;
+	if (env.unsupported == NULL) {
+		be_jit_begin_function(segment);
+		for (size_t i = 0, n = ARR_LEN(env.blocks); i < n; ++i)
+			enc_block(&env, env.blocks[i], counter);
+		res = be_jit_finish_function();
+	} else {
+		DB((dbg, LEVEL_1, "%+F not supported by baseline JIT in %+F\n",
+		    env.unsupported, irg));
+	}
+
+	for (size_t i = 0, n = ARR_LEN(env.blocks); i < n; ++i)
+		DEL_ARR_F(get_block_info(env.blocks[i])->nodes);
+	DEL_ARR_F(get_block_info(get_irg_end_block(irg))->nodes);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
+
+	pmap_destroy(env.locals);
+	DEL_ARR_F(env.param_projs);
+	DEL_ARR_F(env.blocks);
+	x86_free_calling_convention(env.cconv);
+	obstack_free(&env.obst, NULL);
+	free(env.offsets);
+	return res;
+}
+
+void ia32_init_baseline(void)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.be.ia32.baseline");
+}
@@ -0,0 +1,26 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Baseline JIT tier for ia32.
+ */
+#ifndef FIRM_BE_IA32_IA32_BASELINE_H
+#define FIRM_BE_IA32_IA32_BASELINE_H
+
+#include "firm_types.h"
+#include "jit.h"
+
+/**
+ * Generates code for @p irg in a single pass without register allocation.
+ * Returns NULL if @p irg contains operations, which are not supported by the
+ * baseline tier.
+ */
+ir_jit_function_t *ia32_baseline_jit(ir_jit_segment_t *segment, ir_graph *irg,
+                                     ir_entity *counter);
+
+void ia32_init_baseline(void);
+
+#endif
@@ -12,6 +12,7 @@
 
 #include "beflags.h"
 #include "begnuas.h"
+#include "beipra.h"
 #include "bemodule.h"
 #include "bera.h"
 #include "besched.h"
@@ -22,6 +23,7 @@
 #include "bevarargs.h"
 #include "gen_ia32_regalloc_if.h"
 #include "ia32_architecture.h"
+#include "ia32_baseline.h"
 #include "ia32_emitter.h"
 #include "ia32_encode.h"
 #include "ia32_new_nodes.h"
@@ -1420,16 +1422,20 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_IA32_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_ESP);
 
-	foreach_irp_irg(i, irg) {
+	ir_graph **const irgs = be_get_irg_compile_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!lower_for_emit(irg, sp_is_non_ssa))
 			continue;
 
 		be_timer_push(T_EMIT);
 		ia32_emit_function(irg);
 		be_timer_pop(T_EMIT);
+		ia32_record_clobbers(irg);
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
 
 	ia32_emit_thunks();
 
@@ -1668,6 +1674,7 @@ arch_isa_if_t const ia32_isa_if = {
 	.finish                = ia32_finish,
 	.generate_code         = ia32_generate_code,
 	.jit_compile           = ia32_jit_compile,
+	.jit_compile_baseline  = ia32_baseline_jit,
 	.emit_function         = ia32_emit_jit_function,
 	.lower_for_target      = ia32_lower_for_target,
 	.additional_reg_names  = ia32_additional_reg_names,
@@ -1683,6 +1690,7 @@ void be_init_arch_ia32(void)
 	lc_opt_add_table(ia32_grp, ia32_options);
 
 	ia32_init_emitter();
+	ia32_init_baseline();
 	ia32_init_optimize();
 	ia32_init_transform();
 	x86_init_x87();
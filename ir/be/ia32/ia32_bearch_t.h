@@ -103,6 +103,12 @@ int ia32_get_sp_change(ir_node *node);
 
 void ia32_cconv_init(void);
 
+/**
+ * Records the registers clobbered by @p irg for interprocedural register
+ * allocation.
+ */
+void ia32_record_clobbers(ir_graph *irg);
+
 /**
  * Handle switching of fpu mode
  */
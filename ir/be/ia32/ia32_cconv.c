@@ -10,6 +10,7 @@
  */
 #include "be_t.h"
 #include "becconv.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bitfiddle.h"
 #include "gen_ia32_regalloc_if.h"
@@ -32,6 +33,13 @@ static const unsigned ignore_regs[] = {
 static const arch_register_t* const default_param_regs[] = {};
 static const arch_register_t* const float_param_regs[]   = {};
 
+/* registers for passing parameters to private functions, like regparm(3) */
+static const arch_register_t* const private_param_regs[] = {
+	&ia32_registers[REG_EAX],
+	&ia32_registers[REG_EDX],
+	&ia32_registers[REG_ECX],
+};
+
 static const arch_register_t* const result_regs[] = {
 	&ia32_registers[REG_EAX],
 	&ia32_registers[REG_EDX],
@@ -47,7 +55,7 @@ static const unsigned caller_saves_gp[] = {
 	REG_EDX,
 };
 
-static const unsigned caller_saves_fp[] = {
+static const unsigned caller_saves_x87[] = {
 	REG_FPCW,
 	REG_ST0,
 	REG_ST1,
@@ -57,6 +65,9 @@ static const unsigned caller_saves_fp[] = {
 	REG_ST5,
 	REG_ST6,
 	REG_ST7,
+};
+
+static const unsigned caller_saves_xmm[] = {
 	REG_XMM0,
 	REG_XMM1,
 	REG_XMM2,
@@ -99,9 +110,13 @@ x86_cconv_t *ia32_decide_calling_convention(ir_type const *const function_type,
 		ia32_get_irg_data(irg)->omit_fp = omit_fp;
 	}
 
+	/* Private functions are only called directly from this compilation
+	 * unit, so they may use a custom calling convention. */
 	mtp_additional_properties mtp
 		= get_method_additional_properties(function_type);
-	(void)mtp;
+	bool const private_regs = be_options.ipra
+	                       && (mtp & mtp_property_private)
+	                       && !is_method_variadic(function_type);
 	/* TODO: do something with cc_reg_param/cc_this_call */
 
 	unsigned *caller_saves = rbitset_malloc(N_IA32_REGISTERS);
@@ -116,8 +131,13 @@ x86_cconv_t *ia32_decide_calling_convention(ir_type const *const function_type,
 	reg_or_stackslot_t *params             = XMALLOCNZ(reg_or_stackslot_t,
 	                                                   n_params);
 
+	arch_register_t const *const *param_regs = default_param_regs;
 	unsigned n_param_regs       = ARRAY_SIZE(default_param_regs);
 	unsigned n_float_param_regs = ARRAY_SIZE(float_param_regs);
+	if (private_regs) {
+		param_regs   = private_param_regs;
+		n_param_regs = ARRAY_SIZE(private_param_regs);
+	}
 	unsigned stack_offset       = 0;
 	for (unsigned i = 0; i < n_params; ++i) {
 		ir_type            *param_type = get_method_param_type(function_type, i);
@@ -133,7 +153,7 @@ x86_cconv_t *ia32_decide_calling_convention(ir_type const *const function_type,
 		if (mode_is_float(mode) && float_param_regnum < n_float_param_regs) {
 			param->reg = float_param_regs[float_param_regnum++];
 		} else if (!mode_is_float(mode) && param_regnum < n_param_regs) {
-			param->reg = default_param_regs[param_regnum++];
+			param->reg = param_regs[param_regnum++];
 		} else {
 			param->type   = param_type;
 			param->offset = stack_offset;
@@ -183,7 +203,7 @@ align_stack:;
 
 	x86_cconv_t *cconv     = XMALLOCZ(x86_cconv_t);
 	cconv->sp_delta        = (cc & cc_compound_ret) && !(cc & cc_reg_param)
-	                         ? IA32_REGISTER_SIZE : 0;
+	                         && !private_regs ? IA32_REGISTER_SIZE : 0;
 	cconv->parameters      = params;
 	cconv->n_parameters    = n_params;
 	cconv->param_stacksize = stack_offset;
@@ -207,12 +227,22 @@ align_stack:;
 	return cconv;
 }
 
+void ia32_record_clobbers(ir_graph *const irg)
+{
+	/* the x87 register stack is not refined, it has to be empty at calls
+	 * anyway */
+	unsigned *const always_clobbered = rbitset_alloca(N_IA32_REGISTERS);
+	be_cconv_add_regs(always_clobbered, caller_saves_x87, ARRAY_SIZE(caller_saves_x87));
+	be_ipra_record_clobbers(irg, always_clobbered);
+}
+
 void ia32_cconv_init(void)
 {
 	be_cconv_add_regs(default_caller_saves, caller_saves_gp, ARRAY_SIZE(caller_saves_gp));
 	be_cconv_add_regs(default_callee_saves, callee_saves, ARRAY_SIZE(callee_saves));
 	if (!ia32_cg_config.use_softfloat) {
-		be_cconv_add_regs(default_caller_saves, caller_saves_fp, ARRAY_SIZE(caller_saves_fp));
+		be_cconv_add_regs(default_caller_saves, caller_saves_x87, ARRAY_SIZE(caller_saves_x87));
+		be_cconv_add_regs(default_caller_saves, caller_saves_xmm, ARRAY_SIZE(caller_saves_xmm));
 		rbitset_set(default_callee_saves, REG_FPCW);
 	}
 }
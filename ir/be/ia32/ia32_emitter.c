@@ -1385,16 +1385,21 @@ static void emit_function_text(ir_graph *const irg, exc_entry **const exc_list)
 {
 	ia32_register_emitters();
 
-	ir_node  **const blk_sched = be_create_block_schedule(irg);
+	ir_node  **const blk_sched  = be_create_block_schedule(irg);
+	ir_node   *const cold_block = be_split_cold_blocks(irg, blk_sched);
 
 	/* we use links to point to target blocks */
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 	irg_block_walk_graph(irg, ia32_gen_labels, NULL, exc_list);
 
 	be_emit_init_cf_links(blk_sched);
+	if (cold_block != NULL)
+		be_emit_mark_fragment_start(cold_block);
 
 	for (size_t i = 0, n = ARR_LEN(blk_sched); i < n; ++i) {
 		ir_node *const block = blk_sched[i];
+		if (block == cold_block)
+			be_gas_begin_cold_fragment(get_irg_entity(irg));
 		ia32_gen_block(block);
 	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
@@ -91,13 +91,18 @@ static void enc_relocation(x86_imm32_t const *const imm)
 	be_emit_reloc_entity(4, imm->kind, entity, offset);
 }
 
+static void enc_fragment_destination(unsigned const fragment_num)
+{
+	be_emit_reloc_fragment(4, IA32_RELOCATION_RELJUMP, fragment_num, -4);
+}
+
 static void enc_jmp_destination(ir_node const *const cfop)
 {
 	assert(get_irn_mode(cfop) == mode_X);
 	ir_node const *const dest_block = be_emit_get_cfop_target(cfop);
 	unsigned const fragment_num
 		= PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, dest_block));
-	be_emit_reloc_fragment(4, IA32_RELOCATION_RELJUMP, fragment_num, -4);
+	enc_fragment_destination(fragment_num);
 }
 
 /* end emit routines, all emitters following here should only use the functions
@@ -239,6 +244,43 @@ static void enc_mod_am(unsigned reg, const ir_node *node)
 	}
 }
 
+void ia32_enc_mod_base(unsigned const reg, arch_register_t const *const base,
+                       int32_t const offset)
+{
+	unsigned const base_enc = base->encoding;
+	unsigned       modrm    = ENC_REG(reg, REG_LOW) | ENC_RM(base_enc, REG_LOW);
+	/* EBP without displacement encodes an absolute address */
+	if (offset == 0 && base_enc != 0x05) {
+		modrm |= MOD_IND;
+	} else if (ia32_is_8bit_val(offset)) {
+		modrm |= MOD_IND_BYTE_OFS;
+	} else {
+		modrm |= MOD_IND_WORD_OFS;
+	}
+
+	be_emit8(modrm);
+	/* ESP as base always needs a SIB byte */
+	if (base_enc == 0x04)
+		be_emit8(ENC_SIB(0, 0x04, 0x04));
+
+	if ((modrm & MOD_REG) == MOD_IND_BYTE_OFS) {
+		be_emit8((unsigned)offset);
+	} else if ((modrm & MOD_REG) == MOD_IND_WORD_OFS) {
+		be_emit32((uint32_t)offset);
+	}
+}
+
+void ia32_enc_relocation(x86_imm32_t const *const imm)
+{
+	enc_relocation(imm);
+}
+
+void ia32_enc_mod_abs(unsigned const reg, x86_imm32_t const *const imm)
+{
+	be_emit8(MOD_IND | ENC_REG(reg, REG_LOW) | ENC_RM(0x05, REG_LOW));
+	enc_relocation(imm);
+}
+
 static void enc_imm32(ir_node const *const node)
 {
 	const ia32_immediate_attr_t *attr = get_ia32_immediate_attr_const(node);
@@ -315,6 +357,12 @@ static void enc_perm(const ir_node *node)
 	}
 }
 
+static void enc_copyebpesp(const ir_node *node)
+{
+	(void)node;
+	enc_mov(&ia32_registers[REG_EBP], &ia32_registers[REG_ESP]);
+}
+
 static void enc_xor0(const ir_node *node)
 {
 	be_emit8(0x31);
@@ -884,6 +932,24 @@ static void enc_popmem(const ir_node *node)
 	enc_mod_am(0, node);
 }
 
+void ia32_enc_call_entity(ir_entity *const entity, int32_t const offset)
+{
+	if (ia32_cg_config.emit_machcode) {
+		/* Cheat because I cannot find a way to output .long ENTITY
+		 * as a PC relative relocation. See emit_jit_entity_relocation_asm()
+		 * for the other half of the cheat! */
+		be_emit_reloc_entity(5, X86_IMM_PCREL, entity, offset);
+	} else {
+		be_emit8(0xE8);
+		x86_imm32_t const call_imm = {
+			.kind   = X86_IMM_PCREL,
+			.entity = entity,
+			.offset = offset - 4,
+		};
+		enc_relocation(&call_imm);
+	}
+}
+
 static void enc_call(ir_node const *const node)
 {
 	ir_node *const callee = get_irn_n(node, n_ia32_Call_callee);
@@ -891,26 +957,26 @@ static void enc_call(ir_node const *const node)
 		x86_imm32_t const *const imm
 			= &get_ia32_immediate_attr_const(callee)->imm;
 		assert(imm->kind == X86_IMM_PCREL);
-
-		if (ia32_cg_config.emit_machcode) {
-			/* Cheat because I cannot find a way to output .long ENTITY
-			 * as a PC relative relocation. See emit_jit_entity_relocation_asm()
-			 * for the other half of the cheat! */
-			be_emit_reloc_entity(5, X86_IMM_PCREL, imm->entity, imm->offset);
-		} else {
-			be_emit8(0xE8);
-			x86_imm32_t const call_imm = {
-				.kind   = X86_IMM_PCREL,
-				.entity = imm->entity,
-				.offset = imm->offset - 4,
-			};
-			enc_relocation(&call_imm);
-		}
+		ia32_enc_call_entity(imm->entity, imm->offset);
 	} else {
 		ia32_enc_unop(node, 0xFF, 2, n_ia32_Call_callee);
 	}
 }
 
+void ia32_enc_jmp_fragment(unsigned const fragment_num)
+{
+	be_emit8(0xE9);
+	enc_fragment_destination(fragment_num);
+}
+
+void ia32_enc_jcc_fragment(x86_condition_code_t const cc,
+                           unsigned const fragment_num)
+{
+	be_emit8(0x0F);
+	be_emit8(0x80 + pnc2cc(cc));
+	enc_fragment_destination(fragment_num);
+}
+
 static void enc_jmp(ir_node const *const cfop)
 {
 	be_emit8(0xE9);
@@ -1285,6 +1351,7 @@ static void ia32_register_binary_emitters(void)
 	be_set_emitter(op_ia32_CMovcc,        enc_cmovcc);
 	be_set_emitter(op_ia32_Call,          enc_call);
 	be_set_emitter(op_ia32_Const,         enc_mov_const);
+	be_set_emitter(op_ia32_CopyEbpEsp,    enc_copyebpesp);
 	be_set_emitter(op_ia32_Conv_I2I,      enc_conv_i2i);
 	be_set_emitter(op_ia32_CopyB_i,       enc_copybi);
 	be_set_emitter(op_ia32_Dec,           enc_dec);
@@ -1435,10 +1502,15 @@ static unsigned enc_relocation_callback(char *const buffer,
 		if (entity_addr == (intptr_t)-1)
 			panic("Could not resolve address of entity %+F", entity);
 		intptr_t addr = entity_addr + offset;
-		if (be_kind == X86_IMM_PCREL)
-			addr -= (intptr_t)buffer;
 		value = (uint32_t)addr;
-		if ((intptr_t)value != addr)
+		bool overflow = (intptr_t)value != addr;
+		if (be_kind == X86_IMM_PCREL) {
+			/* displacements are signed */
+			addr    -= (intptr_t)buffer;
+			value    = (uint32_t)addr;
+			overflow = (intptr_t)(int32_t)value != addr;
+		}
+		if (overflow)
 			panic("Overflow in relocation");
 	}
 
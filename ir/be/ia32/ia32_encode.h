@@ -12,8 +12,10 @@
 #define FIRM_BE_IA32_IA32_ENCODE_H
 
 #include <stdint.h>
+#include "bearch.h"
 #include "firm_types.h"
 #include "jit.h"
+#include "x86_node.h"
 
 enum {
 	IA32_RELOCATION_RELJUMP = 128,
@@ -45,4 +47,31 @@ void ia32_enc_fbinop(ir_node const *node, unsigned op_fwd, unsigned op_rev);
 
 void ia32_enc_fop_reg(ir_node const *node, uint8_t op0, uint8_t op1);
 
+/**
+ * Emits a ModR/M byte (and SIB byte and displacement if necessary) for the
+ * memory operand [@p base + @p offset].
+ *
+ * @param reg  content of the reg field: a register encoding or an opcode
+ *             extension
+ */
+void ia32_enc_mod_base(unsigned reg, arch_register_t const *base,
+                       int32_t offset);
+
+/**
+ * Emits a ModR/M byte for the absolute memory operand @p imm.
+ */
+void ia32_enc_mod_abs(unsigned reg, x86_imm32_t const *imm);
+
+/** Emits a 32bit immediate, which may need a relocation. */
+void ia32_enc_relocation(x86_imm32_t const *imm);
+
+/** Emits a direct call of @p entity. */
+void ia32_enc_call_entity(ir_entity *entity, int32_t offset);
+
+/** Emits a jump to the begin of fragment @p fragment_num. */
+void ia32_enc_jmp_fragment(unsigned fragment_num);
+
+/** Emits a conditional jump to the begin of fragment @p fragment_num. */
+void ia32_enc_jcc_fragment(x86_condition_code_t cc, unsigned fragment_num);
+
 #endif
@@ -13,6 +13,7 @@
 
 #include "array.h"
 #include "bediagnostic.h"
+#include "beipra.h"
 #include "benode.h"
 #include "betranshlp.h"
 #include "beutil.h"
@@ -4675,6 +4676,10 @@ static ir_node *gen_Call(ir_node *node)
 	in[n_ia32_Call_mem]     = be_make_Sync(block, sync_arity, sync_ins);
 	in_req[n_ia32_Call_mem] = arch_memory_req;
 
+	/* Calls of already compiled local functions only clobber the registers
+	 * actually used by the callee. */
+	be_ipra_restrict_caller_saves(get_Call_callee(node), cconv->caller_saves);
+
 	/* Count outputs. */
 	unsigned       o              = pn_ia32_Call_first_result;
 	unsigned const n_reg_results  = cconv->n_reg_results;
@@ -7,6 +7,7 @@
 
 #include "be2addr.h"
 #include "be_t.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bemodule.h"
 #include "bera.h"
@@ -233,7 +234,9 @@ static void mips_generate_code(FILE *const output, char const *const cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_MIPS_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_SP);
 
-	foreach_irp_irg(i, irg) {
+	ir_graph **const irgs = be_get_irg_compile_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!be_step_first(irg))
 			continue;
 
@@ -260,6 +263,7 @@ static void mips_generate_code(FILE *const output, char const *const cup_name)
 		mips_emit_function(irg);
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
 
 	be_finish();
 }
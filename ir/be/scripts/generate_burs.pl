@@ -0,0 +1,622 @@
+#! /usr/bin/env perl
+
+#
+# This file is part of libFirm.
+# Copyright (C) 2018 University of Karlsruhe.
+#
+
+# This script generates a bottom-up rewrite system (BURS) labeler from the
+# tree patterns in the @burs_rules list of a spec. For each node the labeler
+# determines by dynamic programming the cheapest rule deriving each
+# nonterminal. Reducing the nodes according to the chosen rules is left to the
+# backend, which dispatches on the action of the rules.
+#
+# A rule looks like
+#   { rule => "reg: Add(reg, imm)", cost => 1, action => "binop_imm" }
+# Lowercase names are nonterminals, capitalized names are firm operations,
+# which are matched with is_<Op>() and whose operands are get_irn_n(). Other
+# operations can be defined in %burs_ops with a match function and a list of
+# operand getters. Optional keys are "cond", a C expression which may refer
+# to the root node as "node" and to its pattern operands as k0, k1, ..., and
+# "commutative", which also matches the operands of the root swapped.
+#
+# The backend has to provide ${arch}_burs_leaf_nt(), which returns the
+# nonterminal computed by a node, which is not covered by a pattern of its
+# user, and ${arch}_burs_can_fold(), which decides whether a node may be
+# covered by a pattern of its user. These functions as well as the functions
+# used in conditions have to be declared in ${arch}_transform.h.
+
+use strict;
+use warnings;
+
+our $specfile   = $ARGV[0];
+our $target_dir = $ARGV[1];
+
+our $arch;
+our @burs_rules;
+our %burs_ops;
+
+unless (my $return = do "${specfile}") {
+	die "Fatal error: couldn't parse $specfile: $@" if $@;
+	die "Fatal error: couldn't do $specfile: $!"    unless defined $return;
+	die "Fatal error: couldn't run $specfile"       unless $return;
+}
+
+my $uarch = uc($arch);
+
+sub is_nonterminal
+{
+	my ($name) = @_;
+	return $name =~ /^[a-z]/;
+}
+
+# Parses a pattern like "Add(reg, Shl(reg, Const))" into a tree of
+# { name => ..., kids => [...] }.
+sub parse_pattern
+{
+	my ($text, $rule) = @_;
+	my @tokens = $text =~ /\s*([A-Za-z_][A-Za-z0-9_]*|[(),])/g;
+	my $pos    = 0;
+
+	my $parse;
+	$parse = sub {
+		my $name = $tokens[$pos++];
+		die "Fatal error: expected name in rule \"$rule\"\n"
+			if !defined($name) || $name !~ /^[A-Za-z_]/;
+		my @kids;
+		if (defined($tokens[$pos]) && $tokens[$pos] eq "(") {
+			die "Fatal error: nonterminal $name with operands in rule \"$rule\"\n"
+				if is_nonterminal($name);
+			++$pos;
+			for (;;) {
+				push(@kids, $parse->());
+				my $sep = $tokens[$pos++] // "";
+				last if $sep eq ")";
+				die "Fatal error: expected , or ) in rule \"$rule\"\n"
+					if $sep ne ",";
+			}
+		}
+		return { name => $name, kids => \@kids };
+	};
+
+	my $tree = $parse->();
+	die "Fatal error: trailing input in rule \"$rule\"\n"
+		if $pos != scalar(@tokens);
+	return $tree;
+}
+
+# collect nonterminals and actions
+my @nts;
+my %nt_index;
+my @actions = ( "leaf" );
+my %action_index = ( leaf => 0 );
+
+my @rules;
+foreach my $r (@burs_rules) {
+	my $text = $r->{rule};
+	my ($lhs, $pattern) = $text =~ /^\s*([a-z][a-z0-9_]*)\s*:\s*(.*?)\s*$/
+		or die "Fatal error: malformed rule \"$text\"\n";
+	if (!defined($nt_index{$lhs})) {
+		push(@nts, $lhs);
+		$nt_index{$lhs} = scalar(@nts);
+	}
+	my $action = $r->{action} // die "Fatal error: no action for rule \"$text\"\n";
+	if (!defined($action_index{$action})) {
+		$action_index{$action} = scalar(@actions);
+		push(@actions, $action);
+	}
+
+	my $tree = parse_pattern($pattern, $text);
+	my @variants = (0);
+	if ($r->{commutative}) {
+		die "Fatal error: commutative rule \"$text\" needs a binary root\n"
+			if scalar(@{$tree->{kids}}) != 2;
+		push(@variants, 1);
+	}
+	foreach my $swap (@variants) {
+		push(@rules, {
+			text   => $text,
+			lhs    => $lhs,
+			tree   => $tree,
+			cost   => $r->{cost} // 0,
+			cond   => $r->{cond},
+			action => $action,
+			swap   => $swap,
+		});
+	}
+}
+
+# rule numbers 0 and 1 are reserved for "no rule" and leaves
+my $rule_nr = 2;
+foreach my $r (@rules) {
+	$r->{nr} = $rule_nr++;
+}
+
+foreach my $r (@rules) {
+	my @check = ($r->{tree});
+	while (my $t = shift(@check)) {
+		if (is_nonterminal($t->{name})) {
+			die "Fatal error: undefined nonterminal $t->{name} in rule \"$r->{text}\"\n"
+				if !defined($nt_index{$t->{name}});
+		}
+		push(@check, @{$t->{kids}});
+	}
+}
+
+sub nt_enum
+{
+	my ($nt) = @_;
+	return "${arch}_burs_nt_$nt";
+}
+
+sub op_match
+{
+	my ($op, $var) = @_;
+	my $custom = $burs_ops{$op};
+	return defined($custom) ? "$custom->{match}($var)" : "is_$op($var)";
+}
+
+sub op_kid
+{
+	my ($op, $var, $i) = @_;
+	my $custom = $burs_ops{$op};
+	return defined($custom) ? "$custom->{kids}->[$i]($var)"
+	                        : "get_irn_n($var, $i)";
+}
+
+# Generates the matcher of a rule. Nested operations are checked before their
+# operands are accessed, so each of them opens a new block.
+sub gen_rule_match
+{
+	my ($r) = @_;
+	my $tree   = $r->{tree};
+	my $code   = "";
+	my $indent = "\t\t";
+	my $depth  = 0;
+	my @costs  = ($r->{cost});
+	my @leaves;
+
+	my $visit;
+	$visit = sub {
+		my ($t, $var) = @_;
+		my $n_kids = scalar(@{$t->{kids}});
+		for (my $i = 0; $i < $n_kids; ++$i) {
+			my $kid = $t->{kids}->[$i];
+			my $pos = $i;
+			$pos = $n_kids - 1 - $i if $var eq "node" && $r->{swap};
+			my $kid_var = $var eq "node" ? "k$i" : "${var}_$i";
+			$code .= "${indent}ir_node *const $kid_var = " . op_kid($t->{name}, $var, $pos) . ";\n";
+			if (is_nonterminal($kid->{name})) {
+				push(@costs, "kid_cost($kid_var, " . nt_enum($kid->{name}) . ")");
+				push(@leaves, $kid_var);
+			}
+		}
+		for (my $i = 0; $i < $n_kids; ++$i) {
+			my $kid = $t->{kids}->[$i];
+			next if is_nonterminal($kid->{name});
+			my $kid_var = $var eq "node" ? "k$i" : "${var}_$i";
+			$code .= "${indent}if (" . op_match($kid->{name}, $kid_var)
+			       . " && can_fold($kid_var)) {\n";
+			$indent .= "\t";
+			++$depth;
+			$visit->($kid, $kid_var);
+		}
+	};
+
+	if (is_nonterminal($tree->{name})) {
+		# chain rule
+		return undef;
+	}
+	$visit->($tree, "node");
+
+	my $cond = $r->{cond};
+	if (defined($cond)) {
+		$code .= "${indent}if ($cond) {\n";
+		$indent .= "\t";
+		++$depth;
+	}
+	my $nt   = nt_enum($r->{lhs});
+	my $cost = join(" + ", @costs);
+	$code .= "${indent}record(s, $nt, $cost, $r->{nr});\n";
+	while ($depth-- > 0) {
+		$indent = substr($indent, 1);
+		$code .= "${indent}}\n";
+	}
+	$r->{leaves} = \@leaves;
+	return $code;
+}
+
+# generate the labelers of the root operations
+my %root_code;
+my @root_ops;
+my $obst_closure = "";
+my $obst_kids    = "";
+my @rule_actions = ("${arch}_burs_act_leaf", "${arch}_burs_act_leaf");
+my @rule_names   = ("\"none\"", "\"leaf\"");
+my @rule_chain   = ("false", "false");
+
+foreach my $r (@rules) {
+	my $match = gen_rule_match($r);
+	my $comment = $r->{text} . ($r->{swap} ? " (swapped)" : "");
+	push(@rule_actions, "${arch}_burs_act_$r->{action}");
+	push(@rule_names, "\"$comment\"");
+	if (!defined($match)) {
+		# chain rule
+		push(@rule_chain, "true");
+		my $from = nt_enum($r->{tree}->{name});
+		my $to   = nt_enum($r->{lhs});
+		my $cond = defined($r->{cond}) ? " && ($r->{cond})" : "";
+		$obst_closure .= "\t\t/* $comment */\n";
+		$obst_closure .= "\t\tif (s->cost[$from] != BURS_INF$cond)\n";
+		$obst_closure .= "\t\t\tchanged |= record(s, $to, s->cost[$from] + $r->{cost}, $r->{nr});\n";
+		$obst_kids .= "\tcase $r->{nr}: /* $comment */\n";
+		$obst_kids .= "\t\tkids[0] = node;\n";
+		$obst_kids .= "\t\treturn 1;\n";
+		next;
+	}
+	push(@rule_chain, "false");
+
+	my $op = $r->{tree}->{name};
+	if (!defined($root_code{$op})) {
+		$root_code{$op} = "";
+		push(@root_ops, $op);
+	}
+	$root_code{$op} .= "\t/* $comment */\n\t{\n$match\t}\n";
+
+	# operand collection: recompute the operand expressions without checks
+	my @leaves;
+	my $collect;
+	$collect = sub {
+		my ($t, $expr, $is_root) = @_;
+		my $n_kids = scalar(@{$t->{kids}});
+		for (my $i = 0; $i < $n_kids; ++$i) {
+			my $pos = $i;
+			$pos = $n_kids - 1 - $i if $is_root && $r->{swap};
+			my $kid      = $t->{kids}->[$i];
+			my $kid_expr = op_kid($t->{name}, $expr, $pos);
+			if (is_nonterminal($kid->{name})) {
+				push(@leaves, $kid_expr);
+			} else {
+				$collect->($kid, $kid_expr, 0);
+			}
+		}
+	};
+	$collect->($r->{tree}, "node", 1);
+	$obst_kids .= "\tcase $r->{nr}: /* $comment */\n";
+	for (my $i = 0; $i < scalar(@leaves); ++$i) {
+		$obst_kids .= "\t\tkids[$i] = $leaves[$i];\n";
+	}
+	$obst_kids .= "\t\treturn " . scalar(@leaves) . ";\n";
+}
+
+my $obst_label_funcs = "";
+my $obst_dispatch    = "";
+my $obst_custom      = "";
+foreach my $op (@root_ops) {
+	$obst_label_funcs .= "static void label_$op(ir_node *const node, burs_state_t *const s)\n";
+	$obst_label_funcs .= "{\n$root_code{$op}}\n\n";
+	if (defined($burs_ops{$op})) {
+		$obst_custom .= "\tif ($burs_ops{$op}->{match}(node))\n";
+		$obst_custom .= "\t\tlabel_$op(node, s);\n";
+	} else {
+		$obst_dispatch .= "\tcase iro_$op:\n";
+		$obst_dispatch .= "\t\tlabel_$op(node, s);\n";
+		$obst_dispatch .= "\t\tbreak;\n";
+	}
+}
+
+my $n_nts       = scalar(@nts) + 1;
+my $obst_nts    = join("", map { "\t" . nt_enum($_) . ",\n" } @nts);
+my $obst_acts   = join("", map { "\t${arch}_burs_act_$_,\n" } @actions);
+my $obst_rule_actions = join(",\n", map { "\t$_" } @rule_actions);
+my $obst_rule_names   = join(",\n", map { "\t$_" } @rule_names);
+my $obst_rule_chain   = join(",\n", map { "\t$_" } @rule_chain);
+
+my $creation_time = localtime(time());
+
+sub create_with_header
+{
+	my ($name, $brief) = @_;
+
+	open(my $out, ">", $name) // die("Could not open $name, reason: $!\n");
+	print $out <<EOF;
+/**
+ * \@file
+ * \@brief $brief
+ * \@note  DO NOT EDIT THIS FILE, your changes will be lost.
+ *         Edit $specfile instead.
+ *         created by: $0 $specfile $target_dir
+ * \@date  $creation_time
+ */
+EOF
+	return $out;
+}
+
+my $out_h = create_with_header("$target_dir/gen_${arch}_burs.h", "BURS labeler for the instruction selection.");
+print $out_h <<EOF;
+#ifndef FIRM_BE_${uarch}_GEN_${uarch}_BURS_H
+#define FIRM_BE_${uarch}_GEN_${uarch}_BURS_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+typedef enum ${arch}_burs_nt_t {
+	${arch}_burs_nt_none,
+${obst_nts}} ${arch}_burs_nt_t;
+
+typedef enum ${arch}_burs_action_t {
+${obst_acts}} ${arch}_burs_action_t;
+
+/** No rule derives the nonterminal. */
+#define ${uarch}_BURS_RULE_NONE 0
+/** The node is not covered by a pattern, but transformed on its own. */
+#define ${uarch}_BURS_RULE_LEAF 1
+
+/**
+ * Prepares labeling the nodes of \@p irg.
+ */
+void ${arch}_burs_init(ir_graph *irg);
+
+/**
+ * Frees the labels.
+ */
+void ${arch}_burs_free(void);
+
+/**
+ * Starts reducing a tree. Trees reduced while reducing another tree share its
+ * labeling, others are labeled anew.
+ */
+void ${arch}_burs_begin(void);
+
+/**
+ * Ends reducing a tree.
+ */
+void ${arch}_burs_end(void);
+
+/**
+ * Returns the cheapest rule deriving nonterminal \@p nt for \@p node. If
+ * \@p root is false, \@p node is the operand of a pattern and only covered by
+ * patterns itself, if ${arch}_burs_can_fold() allowed it when labeling.
+ */
+unsigned ${arch}_burs_rule(ir_node *node, ${arch}_burs_nt_t nt, bool root);
+
+/**
+ * Stores the nodes matched by the nonterminals of the pattern of \@p rule at
+ * \@p node in \@p kids and returns their number.
+ */
+unsigned ${arch}_burs_kids(ir_node *node, unsigned rule, ir_node **kids);
+
+/**
+ * Returns the action of \@p rule.
+ */
+${arch}_burs_action_t ${arch}_burs_get_action(unsigned rule);
+
+/**
+ * Returns whether \@p rule is a chain rule, that is, its pattern consists of
+ * a nonterminal only.
+ */
+bool ${arch}_burs_is_chain_rule(unsigned rule);
+
+/**
+ * Returns the text of \@p rule.
+ */
+char const *${arch}_burs_get_rule_name(unsigned rule);
+
+/* provided by the backend */
+${arch}_burs_nt_t ${arch}_burs_leaf_nt(ir_node const *node);
+bool ${arch}_burs_can_fold(ir_node const *node);
+
+#endif
+EOF
+close($out_h);
+
+my $out_c = create_with_header("$target_dir/gen_${arch}_burs.c", "BURS labeler for the instruction selection.");
+print $out_c <<EOF;
+#include "gen_${arch}_burs.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "array.h"
+#include "irgraph_t.h"
+#include "irnode_t.h"
+#include "obst.h"
+#include "${arch}_transform.h"
+
+#define BURS_INF  0xFFFFu
+#define BURS_N_NT $n_nts
+
+typedef struct burs_state_t {
+	unsigned short cost[BURS_N_NT];
+	unsigned short rule[BURS_N_NT];
+} burs_state_t;
+
+typedef struct burs_states_t {
+	burs_state_t *full;  /**< all patterns, valid in epoch */
+	burs_state_t *leaf;  /**< the node as a leaf of another pattern */
+	unsigned      epoch; /**< labeling, which full and fold belong to */
+	bool          fold;  /**< may be covered by a pattern of its user */
+} burs_states_t;
+
+static struct obstack  obst;
+static burs_states_t  *states;
+static unsigned        epoch;
+static unsigned        depth;
+
+static const ${arch}_burs_action_t rule_actions[] = {
+${obst_rule_actions}
+};
+
+static const bool rule_chain[] = {
+${obst_rule_chain}
+};
+
+static char const *const rule_names[] = {
+${obst_rule_names}
+};
+
+static burs_state_t *new_state(void)
+{
+	burs_state_t *const s = OALLOC(&obst, burs_state_t);
+	for (unsigned i = 0; i < BURS_N_NT; ++i) {
+		s->cost[i] = BURS_INF;
+		s->rule[i] = ${uarch}_BURS_RULE_NONE;
+	}
+	return s;
+}
+
+static bool record(burs_state_t *const s, ${arch}_burs_nt_t const nt,
+                   unsigned const cost, unsigned const rule)
+{
+	if (cost >= s->cost[nt])
+		return false;
+	s->cost[nt] = cost;
+	s->rule[nt] = rule;
+	return true;
+}
+
+static void closure(ir_node *const node, burs_state_t *const s)
+{
+	(void)node;
+	bool changed;
+	do {
+		changed = false;
+${obst_closure}	} while (changed);
+}
+
+static burs_states_t *get_states(ir_node const *const node)
+{
+	unsigned const idx = get_irn_idx(node);
+	size_t   const len = ARR_LEN(states);
+	if (idx >= len) {
+		ARR_RESIZE(burs_states_t, states, idx + 1);
+		memset(&states[len], 0, (idx + 1 - len) * sizeof(*states));
+	}
+	return &states[idx];
+}
+
+/**
+ * Returns the labels of \@p node. Whether a node may be folded changes while
+ * the graph is transformed, so it is decided once per labeling of a tree and
+ * reducing the tree sees the same decisions as labeling it.
+ */
+static burs_states_t *get_labels(ir_node *const node)
+{
+	burs_states_t *const ss = get_states(node);
+	if (ss->epoch != epoch) {
+		ss->epoch = epoch;
+		ss->full  = NULL;
+		ss->fold  = ${arch}_burs_can_fold(node);
+	}
+	return ss;
+}
+
+static bool can_fold(ir_node *const node)
+{
+	return get_labels(node)->fold;
+}
+
+static burs_state_t *label(ir_node *node);
+
+static burs_state_t *label_leaf(ir_node *const node)
+{
+	burs_states_t *const ss = get_states(node);
+	if (ss->leaf != NULL)
+		return ss->leaf;
+	burs_state_t *const s  = new_state();
+	${arch}_burs_nt_t const nt = ${arch}_burs_leaf_nt(node);
+	if (nt != ${arch}_burs_nt_none)
+		record(s, nt, 0, ${uarch}_BURS_RULE_LEAF);
+	closure(node, s);
+	get_states(node)->leaf = s;
+	return s;
+}
+
+static unsigned kid_cost(ir_node *const kid, ${arch}_burs_nt_t const nt)
+{
+	burs_state_t const *const s = can_fold(kid) ? label(kid) : label_leaf(kid);
+	return s->cost[nt];
+}
+
+${obst_label_funcs}static burs_state_t *label(ir_node *const node)
+{
+	burs_states_t *const ss = get_labels(node);
+	burs_state_t        *s  = ss->full;
+	if (s != NULL)
+		return s;
+	s = new_state();
+${obst_custom}	switch (get_irn_opcode(node)) {
+${obst_dispatch}	default:
+		break;
+	}
+	closure(node, s);
+	/* a node can always be transformed on its own, patterns win ties */
+	${arch}_burs_nt_t const nt = ${arch}_burs_leaf_nt(node);
+	if (nt != ${arch}_burs_nt_none && record(s, nt, 1, ${uarch}_BURS_RULE_LEAF))
+		closure(node, s);
+	get_labels(node)->full = s;
+	return s;
+}
+
+void ${arch}_burs_init(ir_graph *const irg)
+{
+	obstack_init(&obst);
+	unsigned const n = get_irg_last_idx(irg);
+	states = NEW_ARR_FZ(burs_states_t, n);
+	epoch  = 1;
+	depth  = 0;
+}
+
+void ${arch}_burs_free(void)
+{
+	DEL_ARR_F(states);
+	states = NULL;
+	obstack_free(&obst, NULL);
+}
+
+void ${arch}_burs_begin(void)
+{
+	if (depth++ == 0)
+		++epoch;
+}
+
+void ${arch}_burs_end(void)
+{
+	assert(depth > 0);
+	--depth;
+}
+
+unsigned ${arch}_burs_rule(ir_node *const node, ${arch}_burs_nt_t const nt,
+                          bool const root)
+{
+	burs_state_t const *const s
+		= root || can_fold(node) ? label(node) : label_leaf(node);
+	return s->rule[nt];
+}
+
+unsigned ${arch}_burs_kids(ir_node *const node, unsigned const rule,
+                          ir_node **const kids)
+{
+	switch (rule) {
+${obst_kids}	default:
+		return 0;
+	}
+}
+
+${arch}_burs_action_t ${arch}_burs_get_action(unsigned const rule)
+{
+	return rule_actions[rule];
+}
+
+bool ${arch}_burs_is_chain_rule(unsigned const rule)
+{
+	return rule_chain[rule];
+}
+
+char const *${arch}_burs_get_rule_name(unsigned const rule)
+{
+	return rule_names[rule];
+}
+EOF
+close($out_c);
@@ -0,0 +1,412 @@
+#! /usr/bin/env perl
+
+#
+# This file is part of libFirm.
+# Copyright (C) 2018 University of Karlsruhe.
+#
+
+# This script generates peephole matchers from the rules in the
+# @peephole_rules list of a spec. The rules of all root operations are merged
+# into one decision tree per operation, which is registered as peephole
+# function of the operation, so be_peephole_opt() reaches it with a single
+# dispatch for each node it visits.
+#
+# A rule looks like
+#   { match => "amd64_mov_gp(p:Proj(op:amd64_mov_gp))", action => "..." }
+# The pattern is a tree of operations (like amd64_lea or be_IncSP) over the
+# operands of the root node. Proj matches a Proj, its operand is the
+# predecessor of the Proj. "_" matches any operand. "name:" binds the matched
+# node to name. Optional keys are
+#   free        registers, which must not hold a live value after the root
+#   one_user    bound nodes, which must have a single user
+#   same_reg    bound nodes (or "node" for the root), which must be assigned
+#               the same register (the register of the first result)
+#   cond        a C expression, which may refer to "node" and the bound nodes
+# The replacement is either declarative
+#   replace     a bound node, which replaces the first result of the root
+#   code        C statements, which are executed before the replacement
+# or an action
+#   action      the backend has to provide
+#               bool ${arch}_peephole_<action>(ir_node *node, <bound nodes>...)
+#               which is called if the pattern matches and returns whether it
+#               changed the graph
+# If the rule does not apply, the next rule is tried: rules with larger
+# patterns first, rules with equal patterns in the order of the spec.
+# Functions used in conditions and code have to be declared in
+# ${arch}_optimize.h.
+
+use strict;
+use warnings;
+
+our $specfile   = $ARGV[0];
+our $target_dir = $ARGV[1];
+
+our $arch;
+our @peephole_rules;
+
+unless (my $return = do "${specfile}") {
+	die "Fatal error: couldn't parse $specfile: $@" if $@;
+	die "Fatal error: couldn't do $specfile: $!"    unless defined $return;
+	die "Fatal error: couldn't run $specfile"       unless $return;
+}
+
+my $uarch = uc($arch);
+
+# Parses a pattern like "be_IncSP(pred:be_IncSP)" into a tree of
+# { bind => ..., op => ..., kids => [...] }.
+sub parse_pattern
+{
+	my ($text) = @_;
+	my @tokens = $text =~ /\s*([A-Za-z_][A-Za-z0-9_]*|[(),:])/g;
+	my $pos    = 0;
+
+	my $parse;
+	$parse = sub {
+		my $name = $tokens[$pos++];
+		die "Fatal error: expected name in pattern \"$text\"\n"
+			if !defined($name) || $name !~ /^[A-Za-z_]/;
+		my $bind;
+		if (defined($tokens[$pos]) && $tokens[$pos] eq ":") {
+			$bind = $name;
+			++$pos;
+			$name = $tokens[$pos++];
+			die "Fatal error: expected operation after $bind: in pattern \"$text\"\n"
+				if !defined($name) || $name !~ /^[A-Za-z_]/;
+		}
+		my @kids;
+		if (defined($tokens[$pos]) && $tokens[$pos] eq "(") {
+			die "Fatal error: wildcard with operands in pattern \"$text\"\n"
+				if $name eq "_";
+			++$pos;
+			for (;;) {
+				push(@kids, $parse->());
+				my $sep = $tokens[$pos++] // "";
+				last if $sep eq ")";
+				die "Fatal error: expected , or ) in pattern \"$text\"\n"
+					if $sep ne ",";
+			}
+		}
+		die "Fatal error: Proj needs exactly one operand in pattern \"$text\"\n"
+			if $name eq "Proj" && scalar(@kids) != 1;
+		return { bind => $bind, op => $name, kids => \@kids };
+	};
+
+	my $tree = $parse->();
+	die "Fatal error: trailing input in pattern \"$text\"\n"
+		if $pos != scalar(@tokens);
+	return $tree;
+}
+
+# Flattens the operand patterns below the node in variable $var into a list of
+# tests { var, parent, pos, op } in preorder and collects the bound variables.
+sub flatten
+{
+	my ($tree, $var, $tests, $binds) = @_;
+	my $n = 0;
+	foreach my $kid (@{$tree->{kids}}) {
+		# an unbound wildcard does not need to be looked at
+		if ($kid->{op} eq "_" && !defined($kid->{bind})) {
+			++$n;
+			next;
+		}
+		my $kid_var = $var eq "node" ? "in$n" : "${var}_$n";
+		push(@$tests, {
+			var    => $kid_var,
+			parent => $var,
+			proj   => $tree->{op} eq "Proj",
+			pos    => $n,
+			op     => $kid->{op},
+		});
+		push(@$binds, [ $kid->{bind}, $kid_var ]) if defined($kid->{bind});
+		flatten($kid, $kid_var, $tests, $binds);
+		++$n;
+	}
+}
+
+# Builds a trie of tests per root operation. Each trie node has a list of
+# children (in order of appearance) and a list of rules ending there.
+my %roots;
+my @root_order;
+my %action_params;
+my $rule_nr = 0;
+foreach my $r (@peephole_rules) {
+	my $text   = $r->{match} // die "Fatal error: rule without match\n";
+	my $action = $r->{action};
+	die "Fatal error: rule \"$text\" needs either action or replace\n"
+		if defined($action) == defined($r->{replace});
+	die "Fatal error: code without replace in rule \"$text\"\n"
+		if defined($r->{code}) && !defined($r->{replace});
+	my $tree   = parse_pattern($text);
+	my $op     = $tree->{op};
+	die "Fatal error: root of rule \"$text\" must be an operation\n"
+		if $op eq "_" || $op eq "Proj";
+	die "Fatal error: root of rule \"$text\" is always bound to node\n"
+		if defined($tree->{bind});
+
+	my @tests;
+	my @binds;
+	flatten($tree, "node", \@tests, \@binds);
+	my %bound = ( node => "node" );
+	foreach my $b (@binds) {
+		die "Fatal error: $b->[0] bound twice in rule \"$text\"\n"
+			if defined($bound{$b->[0]});
+		$bound{$b->[0]} = $b->[1];
+	}
+	foreach my $key ("one_user", "same_reg") {
+		foreach my $name (@{$r->{$key} // []}) {
+			die "Fatal error: unbound $name in $key of rule \"$text\"\n"
+				if !defined($bound{$name});
+		}
+	}
+	die "Fatal error: unbound $r->{replace} in replace of rule \"$text\"\n"
+		if defined($r->{replace}) && !defined($bound{$r->{replace}});
+
+	if (defined($action)) {
+		my @params = map { $_->[0] } @binds;
+		if (defined($action_params{$action})
+		    && scalar(@{$action_params{$action}}) != scalar(@params)) {
+			die "Fatal error: action $action used with different operands in rule \"$text\"\n";
+		}
+		$action_params{$action} //= \@params;
+	}
+
+	if (!defined($roots{$op})) {
+		$roots{$op} = { children => [], rules => [] };
+		push(@root_order, $op);
+	}
+	my $trie = $roots{$op};
+	foreach my $test (@tests) {
+		my $key = "$test->{var}=$test->{op}";
+		my ($child) = grep { $_->{key} eq $key } @{$trie->{children}};
+		if (!defined($child)) {
+			$child = { key => $key, test => $test, children => [], rules => [] };
+			push(@{$trie->{children}}, $child);
+		}
+		$trie = $child;
+	}
+	push(@{$trie->{rules}}, {
+		nr     => $rule_nr++,
+		text   => $text,
+		rule   => $r,
+		binds  => \@binds,
+		bound  => \%bound,
+		action => $action,
+	});
+}
+
+my $uses_same_reg = grep { defined($_->{same_reg}) } @peephole_rules;
+my $uses_replace  = grep { defined($_->{replace}) } @peephole_rules;
+
+# Emits a rule. If it is the $last statement of the matcher, it does not need
+# to return after applying.
+sub emit_rule
+{
+	my ($rule, $ind, $last) = @_;
+	my $r = $rule->{rule};
+	my @conds;
+	foreach my $reg (@{$r->{free} // []}) {
+		push(@conds, "be_peephole_get_value(REG_" . uc($reg) . ") == NULL");
+	}
+	foreach my $name (@{$r->{one_user} // []}) {
+		push(@conds, "be_has_only_one_user($name)");
+	}
+	my @same = @{$r->{same_reg} // []};
+	for (my $i = 1; $i < scalar(@same); ++$i) {
+		push(@conds, "peephole_get_reg($same[0]) == peephole_get_reg($same[$i])");
+	}
+	push(@conds, "($r->{cond})") if defined($r->{cond});
+
+	my @stmts;
+	if (defined($rule->{action})) {
+		my $args = join("", map { ", $_->[0]" } @{$rule->{binds}});
+		my $call = "${arch}_peephole_$rule->{action}(node$args)";
+		if ($last) {
+			push(@stmts, "$call;");
+		} else {
+			push(@conds, $call);
+			push(@stmts, "return;");
+		}
+	} else {
+		push(@stmts, $r->{code}) if defined($r->{code});
+		push(@stmts, "peephole_replace(node, $r->{replace});");
+		push(@stmts, "return;") if !$last;
+	}
+
+	my $res = "$ind/* $rule->{text} */\n";
+	my $body_ind = $ind;
+	if (scalar(@{$rule->{binds}}) > 0) {
+		$res .= "$ind\{\n";
+		$body_ind = "$ind\t";
+		foreach my $b (@{$rule->{binds}}) {
+			$res .= "${body_ind}ir_node *const $b->[0] = $b->[1];\n";
+		}
+	}
+	if (scalar(@conds) == 0) {
+		$res .= "${body_ind}$_\n" foreach @stmts;
+	} else {
+		my $sep = "\n$body_ind    && ";
+		$res .= "${body_ind}if (" . join($sep, @conds) . ")";
+		if (scalar(@stmts) == 1) {
+			$res .= "\n${body_ind}\t$stmts[0]\n";
+		} else {
+			$res .= " {\n";
+			$res .= "${body_ind}\t$_\n" foreach @stmts;
+			$res .= "${body_ind}}\n";
+		}
+	}
+	$res .= "$ind}\n" if scalar(@{$rule->{binds}}) > 0;
+	return $res;
+}
+
+sub op_test
+{
+	my ($var, $op) = @_;
+	return "is_Proj($var)" if $op eq "Proj";
+	return "get_irn_op($var) == op_$op";
+}
+
+# Emits the children of a trie node followed by the rules ending there. The
+# children testing the same operand share the access of the operand. If the
+# trie is emitted $last in the matcher, its final statement needs no return.
+sub emit_trie
+{
+	my ($trie, $ind, $last) = @_;
+	my $res = "";
+	my %done;
+	my @vars = grep { !$done{$_}++ } map { $_->{test}{var} } @{$trie->{children}};
+	my $n_rules = scalar(@{$trie->{rules}});
+	for (my $v = 0; $v < scalar(@vars); ++$v) {
+		my $var        = $vars[$v];
+		my @group      = grep { $_->{test}{var} eq $var } @{$trie->{children}};
+		my $test       = $group[0]{test};
+		my @wildcards  = grep { $_->{test}{op} eq "_" } @group;
+		my $group_last = $last && $v == $#vars && $n_rules == 0;
+		my $inner = "$ind\t";
+		if ($test->{proj}) {
+			# the only operand of a Proj, no need for a new block
+			$inner = $ind;
+			$res  .= "${ind}ir_node *const $var = get_Proj_pred($test->{parent});\n";
+		} else {
+			$res .= "${ind}if (get_irn_arity($test->{parent}) > $test->{pos}) {\n";
+			$res .= "${inner}ir_node *const $var = get_irn_n($test->{parent}, $test->{pos});\n";
+		}
+		my $first = 1;
+		foreach my $g (grep { $_->{test}{op} ne "_" } @group) {
+			$res .= ($first ? $inner : " else ") . "if (" . op_test($var, $g->{test}{op}) . ") {\n";
+			$res .= emit_trie($g, "$inner\t", $group_last && !@wildcards);
+			$res .= "$inner}";
+			$first = 0;
+		}
+		$res .= "\n" if !$first;
+		for (my $w = 0; $w < scalar(@wildcards); ++$w) {
+			$res .= emit_trie($wildcards[$w], $inner, $group_last && $w == $#wildcards);
+		}
+		$res .= "$ind}\n" if !$test->{proj};
+	}
+	for (my $i = 0; $i < $n_rules; ++$i) {
+		$res .= emit_rule($trie->{rules}[$i], $ind, $last && $i == $n_rules - 1);
+	}
+	return $res;
+}
+
+my $obst_matchers = "";
+my $obst_register = "";
+foreach my $op (@root_order) {
+	$obst_matchers .= "\nstatic void peephole_$op(ir_node *const node)\n{\n";
+	$obst_matchers .= emit_trie($roots{$op}, "\t", 1);
+	$obst_matchers .= "}\n";
+	$obst_register .= "\tregister_peephole_optimization(op_$op, peephole_$op);\n";
+}
+
+my $obst_actions = "";
+foreach my $action (sort keys %action_params) {
+	my $params = join("", map { ", ir_node *$_" } @{$action_params{$action}});
+	$obst_actions .= "bool ${arch}_peephole_${action}(ir_node *node$params);\n";
+}
+
+my $obst_get_reg = "";
+if ($uses_same_reg) {
+	$obst_get_reg = <<EOF;
+
+static arch_register_t const *peephole_get_reg(ir_node const *const node)
+{
+	if (is_Proj(node))
+		return arch_get_irn_register(node);
+	return arch_get_irn_register_out(node, 0);
+}
+EOF
+}
+
+my $obst_replace = "";
+if ($uses_replace) {
+	$obst_replace = <<EOF;
+
+/** Replaces the first result of \@p node by \@p value. */
+static void peephole_replace(ir_node *const node, ir_node *const value)
+{
+	if (get_irn_mode(node) == mode_T) {
+		ir_node *const res = be_get_or_make_Proj_for_pn(node, 0);
+		be_peephole_exchange_using_proj(res, value);
+	} else {
+		be_peephole_exchange(node, value);
+	}
+}
+EOF
+}
+
+my $creation_time = localtime(time());
+
+sub create_with_header
+{
+	my ($name, $brief) = @_;
+
+	open(my $out, ">", $name) // die("Could not open $name, reason: $!\n");
+	print $out <<EOF;
+/**
+ * \@file
+ * \@brief $brief
+ * \@note  DO NOT EDIT THIS FILE, your changes will be lost.
+ *         Edit $specfile instead.
+ *         created by: $0 $specfile $target_dir
+ * \@date  $creation_time
+ */
+EOF
+	return $out;
+}
+
+my $out_h = create_with_header("$target_dir/gen_${arch}_peephole.h", "Peephole matchers.");
+print $out_h <<EOF;
+#ifndef FIRM_BE_${uarch}_GEN_${uarch}_PEEPHOLE_H
+#define FIRM_BE_${uarch}_GEN_${uarch}_PEEPHOLE_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/**
+ * Registers the peephole matchers with their root operations. Must be called
+ * after ir_clear_opcodes_generic_func() and before be_peephole_opt().
+ */
+void ${arch}_register_peephole_rules(void);
+
+/* provided by the backend */
+${obst_actions}
+#endif
+EOF
+close($out_h);
+
+my $out_c = create_with_header("$target_dir/gen_${arch}_peephole.c", "Peephole matchers.");
+print $out_c <<EOF;
+#include "gen_${arch}_peephole.h"
+
+#include "${arch}_new_nodes.h"
+#include "${arch}_optimize.h"
+#include "benode.h"
+#include "bepeephole.h"
+#include "gen_${arch}_regalloc_if.h"
+${obst_get_reg}${obst_replace}${obst_matchers}
+void ${arch}_register_peephole_rules(void)
+{
+${obst_register}}
+EOF
+close($out_c);
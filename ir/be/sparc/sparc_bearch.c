@@ -13,6 +13,7 @@
 #include "be_t.h"
 #include "beflags.h"
 #include "begnuas.h"
+#include "beipra.h"
 #include "beirg.h"
 #include "bemodule.h"
 #include "bera.h"
@@ -440,7 +441,9 @@ static void sparc_generate_code(FILE *output, const char *cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_SPARC_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_SP);
 
-	foreach_irp_irg(i, irg) {
+	ir_graph **const irgs = be_get_irg_compile_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!be_step_first(irg))
 			continue;
 
@@ -466,6 +469,7 @@ static void sparc_generate_code(FILE *output, const char *cup_name)
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
 
 	be_finish();
 	pmap_destroy(sparc_constants);
@@ -155,6 +155,12 @@ char const *ir_target_experimental(void)
 	return ir_target.experimental;
 }
 
+unsigned ir_target_vector_size(void)
+{
+	assert(ir_target.isa_initialized);
+	return ir_target.vector_size;
+}
+
 ir_mode *ir_target_float_arithmetic_mode(void)
 {
 	assert(ir_target.isa_initialized);
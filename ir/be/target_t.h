@@ -21,6 +21,10 @@ typedef struct target_info_t {
 	char const            *experimental;
 	arch_allow_ifconv_func allow_ifconv;
 	ir_mode               *mode_float_arithmetic;
+	/** Returns true if @p op can be executed lane-wise in vector mode @p mode.
+	 * A Mux stands for a lane-wise minimum or maximum. */
+	bool                 (*allow_vector_op)(ir_op const *op, ir_mode const *mode);
+	unsigned               vector_size; /**< vector register size in bytes */
 	bool isa_initialized          : 1;
 	bool fast_unaligned_memaccess : 1;
 	ENUMBF(float_int_conversion_overflow_style_t) float_int_overflow : 2;
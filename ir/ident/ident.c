@@ -7,32 +7,161 @@
  * @file
  * @brief     Hash table to store names.
  * @author    Goetz Lindenmaier
+ *
+ * Idents live in an open addressing table which stores the hash and length
+ * next to the string pointer, so probing and rehashing never touch the
+ * string data of non-matching entries. The table is split into stripes
+ * selected by the upper hash bits; each stripe has its own slot array and
+ * string arena, so it is the unit to lock or to give to a thread should
+ * the ident module ever be used concurrently.
  */
 #include "ident_t.h"
 
+#include "bitfiddle.h"
 #include "hashptr.h"
 #include "obst.h"
-#include "set.h"
+#include "panic.h"
+#include "util.h"
+#include "xmalloc.h"
 #include <stdio.h>
 #include <string.h>
 
-static set *id_set;
+#define ID_STRIPE_BITS     4
+#define ID_N_STRIPES       (1u << ID_STRIPE_BITS)
+#define ID_MIN_SLOTS       64
+/** Expected average length of an ident, used to size arena chunks. */
+#define ID_AVG_LEN         32
+#define ID_MAX_CHUNK_SIZE  (1u << 20)
+
+typedef struct id_entry {
+	unsigned    hash; /**< hash of the string, 0 marks an empty slot */
+	size_t      len;  /**< length of the string without terminating 0 */
+	char const *str;
+} id_entry;
+
+typedef struct id_stripe {
+	id_entry       *entries;
+	unsigned        mask;     /**< number of slots - 1 */
+	unsigned        n_used;
+	struct obstack  arena;    /**< holds the string data */
+} id_stripe;
+
+static id_stripe id_stripes[ID_N_STRIPES];
 
 /** An obstack used for temporary space */
 static struct obstack id_obst;
 
+static unsigned id_hash(char const *const str, size_t const len)
+{
+	unsigned const hash = hash_data((unsigned char const*)str, len);
+	/* 0 marks empty slots */
+	return hash != 0 ? hash : 1;
+}
+
+static id_stripe *get_stripe(unsigned const hash)
+{
+	return &id_stripes[hash >> (32 - ID_STRIPE_BITS)];
+}
+
+static void stripe_resize(id_stripe *const stripe, unsigned const n_slots)
+{
+	id_entry *const old_entries = stripe->entries;
+	unsigned  const old_n_slots = old_entries != NULL ? stripe->mask + 1 : 0;
+	id_entry *const entries     = XMALLOCNZ(id_entry, n_slots);
+	unsigned  const mask        = n_slots - 1;
+
+	for (unsigned i = 0; i < old_n_slots; ++i) {
+		id_entry const *const entry = &old_entries[i];
+		if (entry->hash == 0)
+			continue;
+		/* triangular probing visits every slot of a power of two table */
+		unsigned slot = entry->hash & mask;
+		for (unsigned step = 1; entries[slot].hash != 0; ++step)
+			slot = (slot + step) & mask;
+		entries[slot] = *entry;
+	}
+
+	free(old_entries);
+	stripe->entries = entries;
+	stripe->mask    = mask;
+}
+
+/** Number of slots needed to hold @p n_entries below the maximum load. */
+static unsigned get_n_slots(size_t const n_entries)
+{
+	size_t const n = n_entries + n_entries / 3 + 1;
+	if (n >= (size_t)1 << 31)
+		panic("too many idents");
+	return MAX(ceil_po2((uint32_t)n), (unsigned)ID_MIN_SLOTS);
+}
+
 void init_ident(void)
 {
-	/* it's ok to use memcmp here, we check only strings */
-	id_set = new_set(memcmp, 128);
+	for (unsigned i = 0; i < ID_N_STRIPES; ++i) {
+		id_stripe *const stripe = &id_stripes[i];
+		stripe->entries = NULL;
+		stripe->n_used  = 0;
+		stripe_resize(stripe, ID_MIN_SLOTS);
+		obstack_init(&stripe->arena);
+		/* strings need no alignment */
+		obstack_alignment_mask(&stripe->arena) = 0;
+	}
 	obstack_init(&id_obst);
 }
 
+void id_reserve(size_t const n_idents)
+{
+	size_t   const per_stripe = n_idents / ID_N_STRIPES + 1;
+	unsigned const n_slots    = get_n_slots(per_stripe);
+	size_t   const chunk_size = MIN(per_stripe * ID_AVG_LEN,
+	                                (size_t)ID_MAX_CHUNK_SIZE);
+	for (unsigned i = 0; i < ID_N_STRIPES; ++i) {
+		id_stripe *const stripe = &id_stripes[i];
+		if (stripe->mask + 1 < n_slots)
+			stripe_resize(stripe, n_slots);
+		/* takes effect when the arena allocates its next chunk */
+		if ((size_t)obstack_chunk_size(&stripe->arena) < chunk_size)
+			obstack_chunk_size(&stripe->arena) = chunk_size;
+	}
+}
+
 ident *new_id_from_chars(const char *str, size_t len)
 {
-	unsigned   hash   = hash_data((const unsigned char*)str, len);
-	set_entry *result = set_hinsert0(id_set, str, len, hash);
-	return (ident*)result->dptr;
+	unsigned   const hash   = id_hash(str, len);
+	id_stripe *const stripe = get_stripe(hash);
+
+	id_entry *entries = stripe->entries;
+	unsigned  mask    = stripe->mask;
+	unsigned  slot    = hash & mask;
+	for (unsigned step = 1;; ++step) {
+		id_entry const *const entry = &entries[slot];
+		if (entry->hash == 0)
+			break;
+		if (entry->hash == hash && entry->len == len
+		    && memcmp(entry->str, str, len) == 0)
+			return entry->str;
+		slot = (slot + step) & mask;
+	}
+
+	/* not found, keep the load factor below 3/4 */
+	if (++stripe->n_used > mask - (mask >> 2)) {
+		stripe_resize(stripe, (mask + 1) * 2);
+		entries = stripe->entries;
+		mask    = stripe->mask;
+		slot    = hash & mask;
+		for (unsigned step = 1; entries[slot].hash != 0; ++step)
+			slot = (slot + step) & mask;
+	}
+
+	char *const copy = (char*)obstack_alloc(&stripe->arena, len + 1);
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+
+	id_entry *const entry = &entries[slot];
+	entry->hash = hash;
+	entry->len  = len;
+	entry->str  = copy;
+	return copy;
 }
 
 ident *new_id_from_str(const char *str)
@@ -66,12 +195,36 @@ const char *(get_id_str)(ident *id)
 void finish_ident(void)
 {
 	obstack_free(&id_obst, NULL);
-	del_set(id_set);
-	id_set = NULL;
+	for (unsigned i = 0; i < ID_N_STRIPES; ++i) {
+		id_stripe *const stripe = &id_stripes[i];
+		obstack_free(&stripe->arena, NULL);
+		free(stripe->entries);
+		stripe->entries = NULL;
+		stripe->mask    = 0;
+		stripe->n_used  = 0;
+	}
 }
 
 ident *id_unique(const char *tag)
 {
 	static unsigned unique_id = 0;
-	return new_id_fmt("%s.%u", tag, unique_id++);
+
+	char         buf[128];
+	size_t const tag_len = strlen(tag);
+	if (tag_len + 12 > sizeof(buf))
+		return new_id_fmt("%s.%u", tag, unique_id++);
+
+	/* build "<tag>.<counter>" directly instead of going through printf */
+	char  digits[10];
+	char *d = digits + sizeof(digits);
+	for (unsigned n = unique_id++;; n /= 10) {
+		*--d = '0' + n % 10;
+		if (n < 10)
+			break;
+	}
+	size_t const n_digits = digits + sizeof(digits) - d;
+	memcpy(buf, tag, tag_len);
+	buf[tag_len] = '.';
+	memcpy(buf + tag_len + 1, d, n_digits);
+	return new_id_from_chars(buf, tag_len + 1 + n_digits);
 }
@@ -21,6 +21,7 @@
 #include "iredgekinds.h"
 #include "iredgeset.h"
 #include "irgwalk.h"
+#include "irhooks.h"
 #include "irnode_t.h"
 #include "irnodemap.h"
 #include "iropt_t.h"
@@ -328,6 +329,9 @@ static void edges_notify_edge_kind(ir_node *src, int pos, ir_node *tgt, ir_node
 void edges_notify_edge(ir_node *src, int pos, ir_node *tgt, ir_node *old_tgt,
                        ir_graph *irg)
 {
+	/* all changes of node inputs pass through here */
+	hook_set_irn_n(src, pos, tgt, old_tgt);
+
 	if (edges_activated_kind(irg, EDGE_KIND_NORMAL)) {
 		edges_notify_edge_kind(src, pos, tgt, old_tgt, EDGE_KIND_NORMAL, irg);
 	}
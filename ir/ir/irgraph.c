@@ -19,13 +19,14 @@
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irhooks.h"
-#include "irmemory.h"
+#include "irmemory_t.h"
 #include "irnode_t.h"
 #include "iropt_t.h"
 #include "iroptimize.h"
 #include "irouts.h"
 #include "irprog_t.h"
 #include "irtools.h"
+#include "irverify_t.h"
 #include "type_t.h"
 #include "util.h"
 #include "xmalloc.h"
@@ -275,6 +276,8 @@ void free_ir_graph(ir_graph *irg)
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
 
 	free_irg_outs(irg);
+	free_irg_alias_cache(irg);
+	free_irg_verify_info(irg);
 	del_identities(irg);
 	if (irg->ent) {
 		set_entity_irg(irg->ent, NULL);  /* not set in const code irg */
@@ -143,6 +143,8 @@ struct ir_graph {
 	bool                out_obst_allocated;
 	ir_bitinfo          bitinfo;     /**< bit info */
 	ir_vrp_info         vrp;         /**< vrp info */
+	struct ir_alias_cache_t *alias_cache; /**< memoized alias queries */
+	struct ir_verify_info_t *verify_info; /**< changes since the last verification */
 	ir_loop            *loop;        /**< The outermost loop for this graph. */
 	ir_dom_front_info_t domfront;    /**< dominance frontier analysis data */
 	irg_edges_info_t    edge_info;   /**< edge info for automatic outs */
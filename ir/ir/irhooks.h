@@ -31,6 +31,17 @@ struct hook_entry {
 		/** This hook is called, before a node is replaced (exchange()) by another. */
 		void (*_hook_replace)(void *context, ir_node *old_node, ir_node *new_node);
 
+		/** This hook is called, before input @p pos of a node is changed
+		 * (-1 is the block input). */
+		void (*_hook_set_irn_n)(void *context, ir_node *node, int pos, ir_node *new_pred, ir_node *old_pred);
+
+		/** This hook is called, before the mode of a node is changed. */
+		void (*_hook_set_irn_mode)(void *context, ir_node *node, ir_mode *mode);
+
+		/** This hook is called, before an attribute of a node is changed
+		 * through its setter. */
+		void (*_hook_set_irn_attr)(void *context, ir_node *node);
+
 		/** This hook is called, after a new graph was created and before the first block
 		 * on this graph is built. */
 		void (*_hook_new_graph)(void *context, ir_graph *irg, ir_entity *ent);
@@ -64,6 +75,9 @@ struct hook_entry {
 typedef enum {
 	hook_new_node,             /**< type for hook_new_node() hook */
 	hook_replace,              /**< type for hook_replace() hook */
+	hook_set_irn_n,            /**< type for hook_set_irn_n() hook */
+	hook_set_irn_mode,         /**< type for hook_set_irn_mode() hook */
+	hook_set_irn_attr,         /**< type for hook_set_irn_attr() hook */
 	hook_new_graph,            /**< type for hook_new_graph() hook */
 	hook_lower,                /**< type for hook_lower() hook */
 	hook_new_mode,             /**< type for hook_new_mode() hook */
@@ -108,6 +122,12 @@ extern hook_entry_t *hooks[hook_last];
 #define hook_new_node(node)               hook_exec(hook_new_node, (hook_ctx_, node))
 /** Called when a node is replaced */
 #define hook_replace(old, nw)             hook_exec(hook_replace, (hook_ctx_, old, nw))
+/** Called before an input of a node is changed */
+#define hook_set_irn_n(node, pos, nw, old) hook_exec(hook_set_irn_n, (hook_ctx_, node, pos, nw, old))
+/** Called before the mode of a node is changed */
+#define hook_set_irn_mode(node, mode)     hook_exec(hook_set_irn_mode, (hook_ctx_, node, mode))
+/** Called before an attribute of a node is changed */
+#define hook_set_irn_attr(node)           hook_exec(hook_set_irn_attr, (hook_ctx_, node))
 /** Called after a new graph has been created */
 #define hook_new_graph(irg, ent)          hook_exec(hook_new_graph, (hook_ctx_, irg, ent))
 /** Called before a node gets lowered */
@@ -16,11 +16,14 @@
 #include "irgmod.h"
 #include "irgraph_t.h"
 #include "irgwalk.h"
+#include "irmemory.h"
 #include "irprintf.h"
 #include "irprog_t.h"
+#include "irsummary_t.h"
 #include "obst.h"
 #include "panic.h"
 #include "pmap.h"
+#include "pset_new.h"
 #include "tv_t.h"
 #include "util.h"
 #include <ctype.h>
@@ -41,6 +44,7 @@ typedef enum typetag_t {
 	tt_mode_arithmetic,
 	tt_pin_state,
 	tt_segment,
+	tt_summary_flag,
 	tt_throws,
 	tt_tpo,
 	tt_type_state,
@@ -50,10 +54,12 @@ typedef enum typetag_t {
 
 typedef enum keyword_t {
 	kw_asm,
+	kw_call,
 	kw_compound_member,
 	kw_constirg,
 	kw_entity,
 	kw_float_mode,
+	kw_function,
 	kw_int_mode,
 	kw_irg,
 	kw_alias,
@@ -65,9 +71,11 @@ typedef enum keyword_t {
 	kw_program,
 	kw_reference_mode,
 	kw_segment_type,
+	kw_summary,
 	kw_type,
 	kw_typegraph,
 	kw_unknown,
+	kw_vector_mode,
 } keyword_t;
 
 typedef struct symbol_t {
@@ -200,12 +208,17 @@ static void symtbl_init(void)
 	INSERT(tt_throws, "throw",   true);
 	INSERT(tt_throws, "nothrow", false);
 
+	INSERT(tt_summary_flag, "importable",    summary_flag_importable);
+	INSERT(tt_summary_flag, "address_taken", summary_flag_address_taken);
+
 	INSERTKEYWORD(alias);
 	INSERTKEYWORD(asm);
+	INSERTKEYWORD(call);
 	INSERTKEYWORD(compound_member);
 	INSERTKEYWORD(constirg);
 	INSERTKEYWORD(entity);
 	INSERTKEYWORD(float_mode);
+	INSERTKEYWORD(function);
 	INSERTKEYWORD(gotentry);
 	INSERTKEYWORD(int_mode);
 	INSERTKEYWORD(irg);
@@ -216,9 +229,11 @@ static void symtbl_init(void)
 	INSERTKEYWORD(program);
 	INSERTKEYWORD(reference_mode);
 	INSERTKEYWORD(segment_type);
+	INSERTKEYWORD(summary);
 	INSERTKEYWORD(type);
 	INSERTKEYWORD(typegraph);
 	INSERTKEYWORD(unknown);
+	INSERTKEYWORD(vector_mode);
 
 	INSERTENUM(tt_align, align_non_aligned);
 	INSERTENUM(tt_align, align_is_aligned);
@@ -552,7 +567,7 @@ static void write_type(write_env_t *env, ir_type *tp);
 static bool is_internal_mode(ir_mode *mode)
 {
 	return !mode_is_int(mode) && !mode_is_reference(mode)
-	    && !mode_is_float(mode);
+	    && !mode_is_float(mode) && !mode_is_vector(mode);
 }
 
 static bool is_default_mode(ir_mode *mode)
@@ -957,6 +972,10 @@ static void write_mode(write_env_t *env, ir_mode *mode)
 		write_unsigned(env, get_mode_exponent_size(mode));
 		write_unsigned(env, get_mode_mantissa_size(mode));
 		write_unsigned(env, get_mode_float_int_overflow(mode));
+	} else if (mode_is_vector(mode)) {
+		write_symbol(env, "vector_mode");
+		write_mode_ref(env, get_mode_vector_element_mode(mode));
+		write_unsigned(env, get_mode_vector_n_elements(mode));
 	} else {
 		panic("cannot write internal modes");
 	}
@@ -1034,31 +1053,41 @@ static void write_node_cb(ir_node *node, void *ctx)
 	write_node(node, env);
 }
 
+static void write_queued_entities(write_env_t *env)
+{
+	while (!deq_empty(&env->entity_queue)) {
+		ir_entity *entity = deq_pop_pointer_left(ir_entity, &env->entity_queue);
+		write_entity(env, entity);
+	}
+}
+
 static void write_typegraph(write_env_t *env)
 {
 	write_symbol(env, "typegraph");
 	write_scope_begin(env);
-	irp_reserve_resources(irp, IRP_RESOURCE_TYPE_VISITED);
-	inc_master_type_visited();
 	for (size_t i = 0, n_types = get_irp_n_types(); i < n_types; ++i) {
 		ir_type *type = get_irp_type(i);
+		/* frame types are written with their graph */
+		if (is_frame_type(type))
+			continue;
 		write_type(env, type);
 	}
-
-	while (!deq_empty(&env->entity_queue)) {
-		ir_entity *entity = deq_pop_pointer_left(ir_entity, &env->entity_queue);
-		write_entity(env, entity);
-	}
-
-	irp_free_resources(irp, IRP_RESOURCE_TYPE_VISITED);
+	write_queued_entities(env);
 	write_scope_end(env);
 }
 
 static void write_irg(write_env_t *env, ir_graph *irg)
 {
+	ir_type *frame = get_irg_frame_type(irg);
 	write_symbol(env, "irg");
 	write_entity_ref(env, get_irg_entity(irg));
-	write_type_ref(env, get_irg_frame_type(irg));
+	/* the frame type and its members, so a reader can skip them together
+	 * with the graph */
+	write_scope_begin(env);
+	write_type(env, frame);
+	write_queued_entities(env);
+	write_scope_end(env);
+	write_type_ref(env, frame);
 	write_scope_begin(env);
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
 	inc_irg_visited(irg);
@@ -1086,11 +1115,14 @@ void ir_export_file(FILE *file)
 	writers_init();
 	write_modes(env);
 
+	irp_reserve_resources(irp, IRP_RESOURCE_TYPE_VISITED);
+	inc_master_type_visited();
 	write_typegraph(env);
 
 	foreach_irp_irg(i, irg) {
 		write_irg(env, irg);
 	}
+	irp_free_resources(irp, IRP_RESOURCE_TYPE_VISITED);
 
 	write_symbol(env, "constirg");
 	write_node_ref(env, get_const_code_irg()->current_block);
@@ -1104,6 +1136,73 @@ void ir_export_file(FILE *file)
 	deq_free(&env->write_queue);
 }
 
+int ir_export_summary(const char *filename, const char *ir_filename)
+{
+	FILE *file = fopen(filename, "wt");
+	if (file == NULL) {
+		perror(filename);
+		return 1;
+	}
+
+	ir_export_summary_file(file, ir_filename);
+	int res = ferror(file);
+	fclose(file);
+	return res;
+}
+
+static void write_summary_function(write_env_t *env,
+                                   const summary_function_t *summary)
+{
+	fputc('\t', env->file);
+	write_symbol(env, "function");
+	write_ident(env, summary->ld_name);
+	write_unsigned(env, summary->n_nodes);
+	write_unsigned(env, summary->n_blocks);
+	write_long(env, (long)summary->props);
+	write_list_begin(env);
+	if (summary->flags & summary_flag_importable)
+		write_symbol(env, "importable");
+	if (summary->flags & summary_flag_address_taken)
+		write_symbol(env, "address_taken");
+	write_list_end(env);
+	fputc('\n', env->file);
+
+	for (size_t i = 0, n = ARR_LEN(summary->calls); i < n; ++i) {
+		const summary_call_t *call = &summary->calls[i];
+		fputs("\t\t", env->file);
+		write_symbol(env, "call");
+		write_ident(env, call->callee);
+		write_unsigned(env, call->n_sites);
+		fputc('\n', env->file);
+	}
+}
+
+/* Exports a summary of the irp in a textual form. */
+void ir_export_summary_file(FILE *file, const char *ir_filename)
+{
+	write_env_t my_env;
+	write_env_t *env = &my_env;
+
+	memset(env, 0, sizeof(*env));
+	env->file = file;
+
+	assure_irp_globals_entity_usage_computed();
+
+	write_symbol(env, "summary");
+	write_string(env, ir_filename);
+	write_scope_begin(env);
+	foreach_irp_irg(i, irg) {
+		if (!entity_has_definition(get_irg_entity(irg)))
+			continue;
+
+		summary_function_t summary;
+		summarize_irg(irg, &summary);
+		write_summary_function(env, &summary);
+		DEL_ARR_F(summary.calls);
+	}
+	write_scope_end(env);
+}
+
 
 
 static void read_c(read_env_t *env)
@@ -1139,6 +1238,37 @@ static void skip_to(read_env_t *env, char to_ch)
 	}
 }
 
+static bool expect_char(read_env_t *env, char ch);
+
+/** Skips a scope including all nested scopes and strings in it. */
+static void skip_scope(read_env_t *env)
+{
+	if (!expect_char(env, '{'))
+		return;
+
+	for (unsigned depth = 1; depth > 0; read_c(env)) {
+		switch (env->c) {
+		case EOF:
+			parse_error(env, "Unexpected EOF while skipping scope\n");
+			return;
+		case '{':
+			++depth;
+			break;
+		case '}':
+			--depth;
+			break;
+		case '"':
+			read_c(env);
+			while (env->c != '"' && env->c != EOF) {
+				if (env->c == '\\')
+					read_c(env);
+				read_c(env);
+			}
+			break;
+		}
+	}
+}
+
 static bool expect_char(read_env_t *env, char ch)
 {
 	skip_ws(env);
@@ -1447,6 +1577,7 @@ static const char *get_typetag_name(typetag_t typetag)
 	case tt_mode_arithmetic:     return "mode_arithmetic";
 	case tt_pin_state:           return "pin state";
 	case tt_segment:             return "segment";
+	case tt_summary_flag:        return "summary flag";
 	case tt_throws:              return "throws";
 	case tt_tpo:                 return "type";
 	case tt_type_state:          return "type state";
@@ -1622,6 +1753,16 @@ static bool streq_null(const char *a, const char *b)
 	return a == b || (!a == !b && streq(a, b));
 }
 
+static ir_type *find_segment_type(ident *id)
+{
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *segment_type = get_segment_type(s);
+		if (segment_type != NULL && get_compound_ident(segment_type) == id)
+			return segment_type;
+	}
+	return NULL;
+}
+
 /** Reads a type description and remembers it by its id. */
 static void read_type(read_env_t *env)
 {
@@ -1638,7 +1779,7 @@ static void read_type(read_env_t *env)
 	// That would destroy idempotency for `ir_export . ir_import`
 	// and bloat the resulting IR files.
 
-	if (maybe_initial_type) {
+	if (maybe_initial_type && env->filter == NULL) {
 		ir_type *candidate = NULL;
 		for (int i = 0; i < n_initial_types; ++i) {
 			ir_type *t = get_irp_type(i);
@@ -1730,6 +1871,14 @@ static void read_type(read_env_t *env)
 
 	case tpo_segment: {
 		ident *id = read_ident_null(env);
+		if (env->filter != NULL) {
+			/* merge with the segments of the existing program */
+			ir_type *existing = find_segment_type(id);
+			if (existing != NULL) {
+				type = existing;
+				goto extend_env;
+			}
+		}
 		type = new_type_segment(id, 0);
 		goto finish_type;
 	}
@@ -1763,6 +1912,67 @@ static void read_unknown_entity(read_env_t *env)
 	set_id(env, entnr, entity);
 }
 
+/**
+ * Reads the remainder of a global entity description when merging into the
+ * existing program. Entities are identified by their linker name. Other
+ * entities become declarations, definitions (initializers) are dropped.
+ * Entities local to the other module cannot be referenced from this module,
+ * they are represented by private placeholders.
+ */
+static ir_entity *read_merged_entity(read_env_t *env, ir_entity_kind kind,
+                                     ident *name, ident *ld_name,
+                                     ir_visibility visibility, ir_type *type,
+                                     ir_type *owner)
+{
+	mtp_additional_properties props = mtp_no_property;
+	switch (kind) {
+	case IR_ENTITY_ALIAS:
+		(void)read_entity_ref(env);
+		break;
+	case IR_ENTITY_NORMAL: {
+		char *str = read_word(env);
+		if (streq(str, "initializer")) {
+			(void)read_initializer(env);
+		} else if (!streq(str, "none")) {
+			parse_error(env, "expected 'initializer' or 'none' got '%s'\n", str);
+		}
+		break;
+	}
+	case IR_ENTITY_METHOD:
+		props = (mtp_additional_properties)read_long(env);
+		props &= SUMMARY_TRANSFERABLE_PROPERTIES;
+		break;
+	default:
+		panic("unexpected global entity kind");
+	}
+
+	ident     *id       = ld_name != NULL ? ld_name : name;
+	bool       external = visibility != ir_visibility_local
+	                   && visibility != ir_visibility_private;
+	ir_entity *existing = external ? ir_get_global(id) : NULL;
+	if (existing != NULL && entity_is_externally_visible(existing)
+	 && is_method_entity(existing) == is_Method_type(type)) {
+		/* the description of a definition elsewhere also holds for our
+		 * declaration */
+		if (is_method_entity(existing) && get_entity_irg(existing) == NULL)
+			add_entity_additional_properties(existing, props);
+		return existing;
+	}
+
+	ir_entity *entity;
+	if (external && existing == NULL) {
+		entity = new_global_entity(owner, id, type, ir_visibility_external,
+		                           IR_LINKAGE_DEFAULT);
+		if (is_method_entity(entity))
+			add_entity_additional_properties(entity, props);
+	} else {
+		entity = new_global_entity(owner, id, type, ir_visibility_private,
+		                           IR_LINKAGE_DEFAULT);
+	}
+	ARR_APP1(ir_entity*, env->new_globals, entity);
+	return entity;
+}
+
 /** Reads an entity description and remembers it by its id. */
 static void read_entity(read_env_t *env, ir_entity_kind kind)
 {
@@ -1791,6 +2001,15 @@ static void read_entity(read_env_t *env, ir_entity_kind kind)
 
 	ir_volatility volatility = read_volatility(env);
 
+	if (env->filter != NULL && owner != NULL && is_segment_type(owner)
+	 && (kind == IR_ENTITY_NORMAL || kind == IR_ENTITY_METHOD
+	     || kind == IR_ENTITY_ALIAS)) {
+		ir_entity *merged = read_merged_entity(env, kind, name, ld_name,
+		                                       visibility, type, owner);
+		set_id(env, entnr, merged);
+		return;
+	}
+
 	switch (kind) {
 	case IR_ENTITY_ALIAS: {
 		ir_entity *aliased = read_entity_ref(env);
@@ -1879,7 +2098,8 @@ skip_init:
 	set_id(env, entnr, entity);
 }
 
-/** Parses the whole type graph. */
+/** Parses a scope of type and entity descriptions: The type graph or the
+ * frame type of a graph. */
 static void read_typegraph(read_env_t *env)
 {
 	ir_graph *old_irg = env->irg;
@@ -2128,9 +2348,26 @@ next_delayed_pred: ;
 	env->delayed_preds = NULL;
 }
 
+/** Returns true if the graph of @p entity should be read while merging. */
+static bool merge_graph(read_env_t *env, ir_entity *entity)
+{
+	return get_entity_irg(entity) == NULL
+	    && entity_is_externally_visible(entity)
+	    && env->filter(get_entity_ld_ident(entity), env->filter_data);
+}
+
 static ir_graph *read_irg(read_env_t *env)
 {
-	ir_entity *irgent    = get_entity(env, read_long(env));
+	ir_entity *irgent = get_entity(env, read_long(env));
+	if (env->filter != NULL && !merge_graph(env, irgent)) {
+		/* neither the frame type nor the graph is created */
+		skip_scope(env);
+		(void)read_long(env);
+		skip_scope(env);
+		return NULL;
+	}
+
+	read_typegraph(env);
 	ir_graph  *irg       = new_ir_graph(irgent, 0);
 	ir_type   *frame     = read_type_ref(env);
 	ir_type   *old_frame = get_irg_frame_type(irg);
@@ -2139,6 +2376,12 @@ static ir_graph *read_irg(read_env_t *env)
 	free_type(old_frame);
 	read_graph(env, irg);
 	irg_finalize_cons(irg);
+
+	if (env->filter != NULL) {
+		/* only available for inlining, the definition is elsewhere */
+		add_entity_linkage(irgent, IR_LINKAGE_NO_CODEGEN);
+		ARR_APP1(ir_graph*, env->imported_irgs, irg);
+	}
 	return irg;
 }
 
@@ -2193,6 +2436,12 @@ static void read_modes(read_env_t *env)
 			               overflow);
 			break;
 		}
+		case kw_vector_mode: {
+			ir_mode *element_mode = read_mode_ref(env);
+			unsigned n_elements   = read_long(env);
+			new_vector_mode(element_mode, n_elements);
+			break;
+		}
 
 		default:
 			skip_to(env, '\n');
@@ -2217,12 +2466,14 @@ static void read_program(read_env_t *env)
 		case kw_segment_type: {
 			ir_segment_t  segment = (ir_segment_t) read_enum(env, tt_segment);
 			ir_type      *type    = read_type_ref(env);
-			set_segment_type(segment, type);
+			if (env->filter == NULL)
+				set_segment_type(segment, type);
 			break;
 		}
 		case kw_asm: {
 			ident *text = read_ident(env);
-			add_irp_asm(text);
+			if (env->filter == NULL)
+				add_irp_asm(text);
 			break;
 		}
 		default:
@@ -2245,7 +2496,42 @@ int ir_import(const char *filename)
 	return res;
 }
 
-int ir_import_file(FILE *input, const char *inputname)
+static void collect_entity_refs(ir_node *node, void *data)
+{
+	pset_new_t *referenced = (pset_new_t*)data;
+	ir_entity  *entity     = get_irn_entity_attr(node);
+	if (entity != NULL)
+		pset_new_insert(referenced, entity);
+}
+
+/**
+ * Removes the globals created while merging which are not referenced by
+ * the imported graphs.
+ */
+static void finish_merge(read_env_t *env)
+{
+	pset_new_t referenced;
+	pset_new_init(&referenced);
+	for (size_t i = 0, n = ARR_LEN(env->imported_irgs); i < n; ++i) {
+		ir_graph *irg = env->imported_irgs[i];
+		pset_new_insert(&referenced, get_irg_entity(irg));
+		irg_walk_graph(irg, NULL, collect_entity_refs, &referenced);
+	}
+
+	for (size_t i = 0, n = ARR_LEN(env->new_globals); i < n; ++i) {
+		ir_entity *entity = env->new_globals[i];
+		if (!pset_new_contains(&referenced, entity)) {
+			free_entity(entity);
+		} else if (get_entity_visibility(entity) == ir_visibility_private) {
+			parse_error(env, "imported graph references \"%s\" which is local to its module\n",
+			            get_entity_name(entity));
+		}
+	}
+	pset_new_destroy(&referenced);
+}
+
+static int import_file(FILE *input, const char *inputname,
+                       ir_import_filter_func *filter, void *filter_data)
 {
 	read_env_t          myenv;
 	int                 oldoptimize = get_optimize();
@@ -2263,6 +2549,12 @@ int ir_import_file(FILE *input, const char *inputname)
 	env->file       = input;
 	env->line       = 1;
 	env->delayed_initializers = NEW_ARR_F(delayed_initializer_t, 0);
+	env->filter      = filter;
+	env->filter_data = filter_data;
+	if (filter != NULL) {
+		env->new_globals   = NEW_ARR_F(ir_entity*, 0);
+		env->imported_irgs = NEW_ARR_F(ir_graph*, 0);
+	}
 
 	/* read first character */
 	read_c(env);
@@ -2274,7 +2566,7 @@ int ir_import_file(FILE *input, const char *inputname)
 	set_optimize(0);
 
 	n_initial_types = get_irp_n_types();
-	maybe_initial_type = true;
+	maybe_initial_type = filter == NULL;
 
 	while (true) {
 		keyword_t kw;
@@ -2300,6 +2592,11 @@ int ir_import_file(FILE *input, const char *inputname)
 		case kw_constirg: {
 			ir_graph *constirg = get_const_code_irg();
 			long bodyblockid = read_long(env);
+			if (filter != NULL) {
+				/* only needed for initializers, which are not merged */
+				skip_scope(env);
+				break;
+			}
 			set_id(env, bodyblockid, constirg->current_block);
 			read_graph(env, constirg);
 			break;
@@ -2322,7 +2619,8 @@ int ir_import_file(FILE *input, const char *inputname)
 	DEL_ARR_F(env->fixedtypes);
 
 	/* resolve delayed initializers */
-	for (size_t i = 0, n = ARR_LEN(env->delayed_initializers); i < n; ++i) {
+	size_t n_delayed = filter == NULL ? ARR_LEN(env->delayed_initializers) : 0;
+	for (size_t i = 0, n = n_delayed; i < n; ++i) {
 		const delayed_initializer_t *di   = &env->delayed_initializers[i];
 		ir_node                     *node = get_node_or_null(env, di->node_nr);
 		if (node == NULL) {
@@ -2336,6 +2634,12 @@ int ir_import_file(FILE *input, const char *inputname)
 	DEL_ARR_F(env->delayed_initializers);
 	env->delayed_initializers = NULL;
 
+	if (filter != NULL) {
+		finish_merge(env);
+		DEL_ARR_F(env->imported_irgs);
+		DEL_ARR_F(env->new_globals);
+	}
+
 	del_set(env->idset);
 
 	set_optimize(oldoptimize);
@@ -2348,3 +2652,125 @@ int ir_import_file(FILE *input, const char *inputname)
 
 	return env->read_errors;
 }
+
+int ir_import_file(FILE *input, const char *inputname)
+{
+	return import_file(input, inputname, NULL, NULL);
+}
+
+int ir_import_functions(const char *filename, ir_import_filter_func *filter,
+                        void *data)
+{
+	FILE *file = fopen(filename, "rt");
+	if (file == NULL) {
+		perror(filename);
+		return 1;
+	}
+
+	int res = ir_import_functions_file(file, filename, filter, data);
+	fclose(file);
+	return res;
+}
+
+int ir_import_functions_file(FILE *input, const char *inputname,
+                             ir_import_filter_func *filter, void *data)
+{
+	assert(filter != NULL);
+	return import_file(input, inputname, filter, data);
+}
+
+static void read_summary(read_env_t *env, ir_summary_index *index)
+{
+	char             *ir_filename = read_string(env);
+	summary_module_t *module      = summary_new_module(index, ir_filename);
+	obstack_free(&env->obst, ir_filename);
+
+	EXPECT('{');
+
+	summary_function_t *function = NULL;
+	while (true) {
+		skip_ws(env);
+		if (env->c == '}' || env->c == EOF) {
+			read_c(env);
+			break;
+		}
+
+		keyword_t kwkind = read_keyword(env);
+		switch (kwkind) {
+		case kw_function: {
+			ident *ld_name = read_ident(env);
+			function = summary_new_function(index, module, ld_name);
+			function->n_nodes  = read_unsigned(env);
+			function->n_blocks = read_unsigned(env);
+			function->props    = (mtp_additional_properties)read_long(env);
+			expect_list_begin(env);
+			while (list_has_next(env)) {
+				function->flags
+					|= (summary_flags_t)read_enum(env, tt_summary_flag);
+			}
+			break;
+		}
+		case kw_call: {
+			ident    *callee  = read_ident(env);
+			unsigned  n_sites = read_unsigned(env);
+			if (function == NULL) {
+				parse_error(env, "call edge outside of a function\n");
+				break;
+			}
+			summary_add_call(function, callee, n_sites);
+			break;
+		}
+		default:
+			parse_error(env, "unexpected keyword %d\n", kwkind);
+			skip_to(env, '\n');
+		}
+	}
+}
+
+int ir_summary_index_add(ir_summary_index *index, const char *filename)
+{
+	FILE *file = fopen(filename, "rt");
+	if (file == NULL) {
+		perror(filename);
+		return 1;
+	}
+
+	int res = ir_summary_index_add_file(index, file, filename);
+	fclose(file);
+	return res;
+}
+
+int ir_summary_index_add_file(ir_summary_index *index, FILE *input,
+                              const char *inputname)
+{
+	read_env_t  myenv;
+	read_env_t *env = &myenv;
+
+	symtbl_init();
+
+	memset(env, 0, sizeof(*env));
+	obstack_init(&env->obst);
+	env->inputname = inputname;
+	env->file      = input;
+	env->line      = 1;
+
+	read_c(env);
+	if (env->c == '#')
+		skip_to(env, '\n');
+
+	while (true) {
+		skip_ws(env);
+		if (env->c == EOF)
+			break;
+
+		keyword_t kw = read_keyword(env);
+		if (kw != kw_summary) {
+			parse_error(env, "Unexpected keyword %d at toplevel\n", kw);
+			break;
+		}
+		read_summary(env, index);
+	}
+
+	obstack_free(&env->obst, NULL);
+	return env->read_errors;
+}
@@ -37,6 +37,12 @@ typedef struct read_env_t {
 	struct obstack preds_obst;
 	delayed_initializer_t *delayed_initializers;
 	const delayed_pred_t **delayed_preds;
+	/** Selects the graphs to read when merging into the existing program
+	 * (see ir_import_functions()), NULL for a normal import. */
+	ir_import_filter_func *filter;
+	void                  *filter_data;
+	ir_entity            **new_globals;   /**< globals created while merging */
+	ir_graph             **imported_irgs; /**< graphs read while merging */
 } read_env_t;
 
 typedef struct write_env_t {
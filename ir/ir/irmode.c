@@ -32,6 +32,8 @@ static bool modes_are_equal(const ir_mode *m, const ir_mode *n)
 {
 	if (m->sort != n->sort)
 		return false;
+	if (m->sort == irms_data && (m->element_mode != NULL || n->element_mode != NULL))
+		return m->element_mode == n->element_mode && m->size == n->size;
 	if (m->sort == irms_auxiliary || m->sort == irms_data)
 		return streq(m->name, n->name);
 	return m->arithmetic        == n->arithmetic
@@ -206,6 +208,18 @@ ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size)
 	return register_mode(result);
 }
 
+ir_mode *new_vector_mode(ir_mode *const element_mode, unsigned const n_elements)
+{
+	assert(mode_is_int(element_mode) || mode_is_float(element_mode));
+	assert(n_elements > 1);
+	char buf[32];
+	snprintf(buf, sizeof(buf), "V%u%s", n_elements, get_mode_name(element_mode));
+	unsigned const bit_size = get_mode_size_bits(element_mode) * n_elements;
+	ir_mode *const result   = alloc_mode(buf, irms_data, irma_none, bit_size, 0, 0);
+	result->element_mode = element_mode;
+	return register_mode(result);
+}
+
 static ir_mode *new_non_data_mode(const char *name)
 {
 	ir_mode *result = alloc_mode(name, irms_auxiliary, irma_none, 0, 0, 0);
@@ -310,6 +324,23 @@ int (mode_is_data)(const ir_mode *mode)
 	return mode_is_data_(mode);
 }
 
+int (mode_is_vector)(const ir_mode *mode)
+{
+	return mode_is_vector_(mode);
+}
+
+ir_mode *get_mode_vector_element_mode(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return mode->element_mode;
+}
+
+unsigned get_mode_vector_n_elements(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return mode->size / mode->element_mode->size;
+}
+
 unsigned (get_mode_mantissa_size)(const ir_mode *mode)
 {
 	return get_mode_mantissa_size_(mode);
@@ -30,6 +30,7 @@
 #define mode_is_reference(mode)        mode_is_reference_(mode)
 #define mode_is_num(mode)              mode_is_num_(mode)
 #define mode_is_data(mode)             mode_is_data_(mode)
+#define mode_is_vector(mode)           mode_is_vector_(mode)
 #define get_type_for_mode(mode)        get_type_for_mode_(mode)
 #define get_mode_mantissa_size(mode)   get_mode_mantissa_size_(mode)
 #define get_mode_exponent_size(mode)   get_mode_exponent_size_(mode)
@@ -92,6 +93,8 @@ struct ir_mode {
 	/** For reference modes, a signed integer mode used to add/subtract
 	 * offsets. */
 	ir_mode            *offset_mode;
+	/** For vector modes, the mode of a single element. */
+	ir_mode            *element_mode;
 };
 
 static inline ident *get_mode_ident_(const ir_mode *mode)
@@ -156,6 +159,11 @@ static inline int mode_is_data_(const ir_mode *mode)
 	return (get_mode_sort(mode) & irmsh_is_data) != 0;
 }
 
+static inline int mode_is_vector_(const ir_mode *mode)
+{
+	return mode->element_mode != NULL;
+}
+
 static inline ir_type *get_type_for_mode_(const ir_mode *mode)
 {
 	return mode->type;
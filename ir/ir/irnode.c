@@ -335,6 +335,7 @@ void set_irn_pinned(ir_node *node, int pinned)
 {
 	assert(get_op_pinned(get_irn_op(node)) >= op_pin_state_exc_pinned);
 
+	hook_set_irn_attr(node);
 	node->attr.except.pinned = (pinned != 0);
 }
 
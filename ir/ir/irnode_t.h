@@ -17,6 +17,7 @@
 #include "iredgekinds.h"
 #include "irflag_t.h"
 #include "irgraph.h"
+#include "irhooks.h"
 #include "irnode.h"
 #include "irop_t.h"
 #include "list.h"
@@ -424,6 +425,7 @@ static inline ir_mode *get_irn_mode_(const ir_node *node)
  */
 static inline void set_irn_mode_(ir_node *node, ir_mode *mode)
 {
+	hook_set_irn_mode(node, mode);
 	node->mode = mode;
 }
 
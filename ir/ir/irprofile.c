@@ -11,6 +11,7 @@
  */
 #include "irprofile.h"
 
+#include "array.h"
 #include "debug.h"
 #include "execfreq_t.h"
 #include "hashptr.h"
@@ -28,8 +29,13 @@
 
 /* Instrument blocks walker. */
 typedef struct block_id_walker_data_t {
-	unsigned int  id;       /**< current block id number */
-	ir_node      *counters; /**< the node representing the counter array */
+	unsigned int  id;               /**< current block id number */
+	ir_node      *counters;         /**< the node representing the counter array */
+	ir_node     **sites;            /**< value profiling sites of all irgs */
+	size_t        site;             /**< current site id number */
+	ir_entity    *records;          /**< the value record array */
+	ir_entity    *record_value;     /**< the value recording function */
+	bool          profile_operands; /**< instrument Div, Mod and Switch sites */
 } block_id_walker_data_t;
 
 /* Associate counters with blocks. */
@@ -41,6 +47,10 @@ typedef struct block_assoc_t {
 /* minimal execution frequency (an execfreq of 0 confuses algos) */
 #define MIN_EXECFREQ 0.00001
 
+/* A value record consists of the number of executions of the site followed by
+ * IR_PROFILE_VALUE_TOP_N value, count pairs. */
+#define VALUE_RECORD_WORDS (1 + 2 * IR_PROFILE_VALUE_TOP_N)
+
 /* keep the execcounts here because they are only read once per compiler run */
 static set *profile = NULL;
 
@@ -71,8 +81,43 @@ static int cmp_execcount(const void *a, const void *b, size_t size)
 	return ea->block != eb->block;
 }
 
+/**
+ * Value profiles are associated with node ids like the block execution counts.
+ */
+typedef struct value_profile_t {
+	unsigned long      node;    /**< node id */
+	ir_value_profile_t profile; /**< the most frequent values */
+} value_profile_t;
+
+/* the value profiles read together with the execcounts */
+static set *value_profiles = NULL;
+
+/**
+ * Compare two value_profile_t entries.
+ */
+static int cmp_value_profile(const void *a, const void *b, size_t size)
+{
+	const value_profile_t *va = (const value_profile_t*)a;
+	const value_profile_t *vb = (const value_profile_t*)b;
+	(void)size;
+	return va->node != vb->node;
+}
+
+/**
+ * The raw value profiling data of a profile file.
+ */
+typedef struct value_data_t {
+	uint64_t *records;     /**< VALUE_RECORD_WORDS words per site */
+	uint32_t  n_sites;
+	uint64_t *functions;   /**< function addresses in the profiled run */
+	uint32_t  n_functions;
+} value_data_t;
+
 uint32_t ir_profile_get_block_execcount(const ir_node *block)
 {
+	if (profile == NULL)
+		return 0;
+
 	execcount_t  const query = { .block = get_irn_node_nr(block), .count = 0 };
 	execcount_t *const ec    = set_find(execcount_t, profile, &query, sizeof(query), query.block);
 
@@ -84,6 +129,98 @@ uint32_t ir_profile_get_block_execcount(const ir_node *block)
 	}
 }
 
+void ir_profile_set_block_execcount(const ir_node *block, uint32_t count)
+{
+	if (profile == NULL)
+		return;
+
+	execcount_t  const query = { .block = get_irn_node_nr(block), .count = count };
+	execcount_t *const ec    = set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+	ec->count = count;
+}
+
+ir_value_profile_t const *ir_profile_get_value_profile(const ir_node *node)
+{
+	if (value_profiles == NULL)
+		return NULL;
+
+	value_profile_t  const query = { .node = get_irn_node_nr(node) };
+	value_profile_t *const vp    = set_find(value_profile_t, value_profiles, &query, sizeof(query), query.node);
+	return vp != NULL ? &vp->profile : NULL;
+}
+
+/**
+ * Returns the value profiled at node or NULL if node is no value profiling
+ * site.
+ */
+static ir_node *get_profiled_value(const ir_node *node)
+{
+	ir_node *value;
+	switch (get_irn_opcode(node)) {
+	case iro_Call:
+		value = get_Call_ptr(node);
+		/* only indirect calls */
+		if (is_Address(value))
+			return NULL;
+		break;
+	case iro_Div:
+		value = get_Div_right(node);
+		break;
+	case iro_Mod:
+		value = get_Mod_right(node);
+		break;
+	case iro_Switch:
+		value = get_Switch_selector(node);
+		break;
+	default:
+		return NULL;
+	}
+
+	ir_mode *const mode = get_irn_mode(value);
+	if (is_Const(value) || !(mode_is_int(mode) || mode_is_reference(mode))
+	    || get_mode_size_bits(mode) > get_mode_size_bits(mode_P))
+		return NULL;
+	return value;
+}
+
+/**
+ * Node walker, collect value profiling sites.
+ */
+static void collect_value_sites(ir_node *node, void *data)
+{
+	ir_node ***const sites = (ir_node***)data;
+	if (get_profiled_value(node) != NULL)
+		ARR_APP1(ir_node*, *sites, node);
+}
+
+/**
+ * Returns the value profiling sites of the current ir program. The site ids
+ * are the indices in the returned flexible array.
+ */
+static ir_node **get_irp_value_sites(void)
+{
+	ir_node **sites = NEW_ARR_F(ir_node*, 0);
+	foreach_irp_irg_r(i, irg) {
+		irg_walk_graph(irg, NULL, collect_value_sites, &sites);
+	}
+	return sites;
+}
+
+/**
+ * Returns the functions of the current ir program, whose addresses are
+ * recorded to identify the targets of indirect calls.
+ */
+static ir_entity **get_irp_functions(void)
+{
+	ir_entity **functions = NEW_ARR_F(ir_entity*, 0);
+	foreach_irp_irg(i, irg) {
+		ir_entity *const ent = get_irg_entity(irg);
+		if (!(get_entity_linkage(ent) & IR_LINKAGE_NO_CODEGEN))
+			ARR_APP1(ir_entity*, functions, ent);
+	}
+	return functions;
+}
+
 /**
  * Block walker, count number of blocks.
  */
@@ -123,6 +260,20 @@ static void dump_profile_node_info(void *ctx, FILE *f, const ir_node *irn)
 	if (is_Block(irn)) {
 		unsigned int execcount = ir_profile_get_block_execcount(irn);
 		fprintf(f, "profiled execution count: %u\n", execcount);
+		return;
+	}
+
+	ir_value_profile_t const *const vp = ir_profile_get_value_profile(irn);
+	if (vp == NULL)
+		return;
+	fprintf(f, "profiled executions: %u\n", vp->total);
+	for (unsigned i = 0; i < vp->n_entries; ++i) {
+		ir_value_profile_entry_t const *const entry = &vp->entries[i];
+		if (entry->target != NULL) {
+			fprintf(f, "profiled target: %s (%u)\n", get_entity_ld_name(entry->target), entry->count);
+		} else {
+			fprintf(f, "profiled value: 0x%llx (%u)\n", (unsigned long long)entry->value, entry->count);
+		}
 	}
 }
 
@@ -164,6 +315,49 @@ static ir_entity *get_init_firmprof_ref(void)
 	return new_entity(get_glob_type(), init_name, init_type);
 }
 
+/**
+ * Returns an entity representing the __init_firmprof_values function from
+ * libfirmprof. This is the equivalent of:
+ * extern void __init_firmprof_values(uint *counters, uintptr_t *records,
+ *                                    uint n_sites, void **functions,
+ *                                    uint n_functions)
+ */
+static ir_entity *get_init_firmprof_values_ref(ir_mode *const mode_word)
+{
+	ident   *const init_name = new_id_from_str("__init_firmprof_values");
+	ir_type *const init_type = new_type_method(5, 0, false, cc_cdecl_set, mtp_no_property);
+	ir_type *const uint      = get_type_for_mode(mode_Iu);
+	ir_type *const uintptr   = new_type_pointer(uint);
+	ir_type *const wordptr   = new_type_pointer(get_type_for_mode(mode_word));
+	ir_type *const funcptr   = new_type_pointer(get_type_for_mode(mode_P));
+
+	set_method_param_type(init_type, 0, uintptr);
+	set_method_param_type(init_type, 1, wordptr);
+	set_method_param_type(init_type, 2, uint);
+	set_method_param_type(init_type, 3, funcptr);
+	set_method_param_type(init_type, 4, uint);
+
+	return new_entity(get_glob_type(), init_name, init_type);
+}
+
+/**
+ * Returns an entity representing the __firmprof_value function from
+ * libfirmprof. This is the equivalent of:
+ * extern void __firmprof_value(uintptr_t *record, uintptr_t value)
+ */
+static ir_entity *get_firmprof_value_ref(ir_mode *const mode_word)
+{
+	ident   *const name    = new_id_from_str("__firmprof_value");
+	ir_type *const type    = new_type_method(2, 0, false, cc_cdecl_set, mtp_no_property);
+	ir_type *const word    = get_type_for_mode(mode_word);
+	ir_type *const wordptr = new_type_pointer(word);
+
+	set_method_param_type(type, 0, wordptr);
+	set_method_param_type(type, 1, word);
+
+	return new_entity(get_glob_type(), name, type);
+}
+
 /**
  * Generates a new irg which calls the initializer
  *
@@ -171,9 +365,12 @@ static ir_entity *get_init_firmprof_ref(void)
  *    static void __firmprof_initializer(void) __attribute__ ((constructor))
  *    {
  *        __init_firmprof(ent_filename, bblock_counts, n_blocks);
+ *        if (n_sites > 0)
+ *            __init_firmprof_values(bblock_counts, value_records, n_sites,
+ *                                   functions, n_functions);
  *    }
  */
-static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_counts, int n_blocks)
+static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_counts, int n_blocks, ir_entity *value_records, size_t n_sites, ir_entity *functions, size_t n_functions)
 {
 	ident     *const name  = new_id_from_str("__firmprof_initializer");
 	ir_type   *const owner = get_glob_type();
@@ -191,7 +388,23 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 	ir_node   *const ins[]     = { filename, counters, size };
 	ir_type   *const call_type = get_entity_type(init_ent);
 	ir_node   *const call      = new_r_Call(bb, init_mem, callee, ARRAY_SIZE(ins), ins, call_type);
-	ir_node   *const call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node         *call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
+
+	if (n_sites > 0) {
+		ir_type   *const rec_type = get_entity_type(value_records);
+		ir_mode   *const mode_rec = get_type_mode(get_array_element_type(rec_type));
+		ir_entity *const vals_ent = get_init_firmprof_values_ref(mode_rec);
+		ir_node   *const vals     = new_r_Address(irg, vals_ent);
+		ir_node   *const records  = new_r_Address(irg, value_records);
+		ir_node   *const n_rec    = new_r_Const_long(irg, mode_Iu, n_sites);
+		ir_node   *const funcs    = new_r_Address(irg, functions);
+		ir_node   *const n_funcs  = new_r_Const_long(irg, mode_Iu, n_functions);
+		ir_node   *const vins[]   = { counters, records, n_rec, funcs, n_funcs };
+		ir_type   *const vtype    = get_entity_type(vals_ent);
+		ir_node   *const vcall    = new_r_Call(bb, call_mem, vals, ARRAY_SIZE(vins), vins, vtype);
+		call_mem = new_r_Proj(vcall, mode_M, pn_Call_M);
+	}
+
 	ir_node   *const ret       = new_r_Return(bb, call_mem, 0, NULL);
 
 	add_immBlock_pred(get_irg_end_block(irg), ret);
@@ -274,6 +487,39 @@ static void fix_ssa(ir_node *const bb, void *const data)
 	set_Load_mem(load, mem);
 }
 
+/**
+ * Instrument a value profiling site with a call recording the value. The call
+ * is appended to the instrumentation code of the block.
+ */
+static void instrument_value_site(ir_node *const node, size_t const id, block_id_walker_data_t const *const wd)
+{
+	/* Other sites keep their record, so site ids do not depend on the
+	 * instrumented kinds. */
+	if (!is_Call(node) && !wd->profile_operands)
+		return;
+
+	ir_graph *const irg       = get_irn_irg(node);
+	ir_node  *const bb        = get_nodes_block(node);
+	ir_type  *const type_rec  = get_entity_type(wd->records);
+	ir_mode  *const mode_word = get_type_mode(get_array_element_type(type_rec));
+	ir_node  *const address   = new_r_Address(irg, wd->records);
+	ir_mode  *const mode_off  = get_reference_offset_mode(get_irn_mode(address));
+	ir_node  *const cnst      = new_r_Const_long(irg, mode_off, get_mode_size_bytes(mode_word) * VALUE_RECORD_WORDS * id);
+	ir_node  *const record    = new_r_Add(bb, address, cnst);
+	ir_node  *const value     = new_r_Conv(bb, get_profiled_value(node), mode_word);
+	ir_node  *const callee    = new_r_Address(irg, wd->record_value);
+	ir_node  *const ins[]     = { record, value };
+	ir_type  *const call_type = get_entity_type(wd->record_value);
+	ir_node  *const mem       = (ir_node*)get_irn_link(bb);
+	ir_node  *const call      = new_r_Call(bb, mem, callee, ARRAY_SIZE(ins), ins, call_type);
+	ir_node  *const cmem      = new_r_Proj(call, mode_M, pn_Call_M);
+
+	/* The new memory takes over the link to the initial load of the block,
+	 * see fix_ssa(). */
+	set_irn_link(cmem, get_irn_link(mem));
+	set_irn_link(bb, cmem);
+}
+
 /**
  * Instrument a single block.
  */
@@ -307,6 +553,15 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
 
 	/* instrument each block in the current irg */
 	irg_block_walk_graph(irg, block_instrument_walker, NULL, wd);
+
+	/* the value profiling sites of the irg are consecutive */
+	for (size_t const n_sites = ARR_LEN(wd->sites); wd->site < n_sites; ++wd->site) {
+		ir_node *const site = wd->sites[wd->site];
+		if (get_irn_irg(site) != irg)
+			break;
+		instrument_value_site(site, wd->site, wd);
+	}
+
 	irg_block_walk_graph(irg, fix_ssa, NULL, NULL);
 
 	/* connect the new memory nodes to the return nodes */
@@ -356,11 +611,14 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
  */
 static ir_entity *new_array_entity(ident *const name, ir_mode *const element_mode, unsigned const length, ir_linkage const linkage)
 {
-	ir_type *const element_type = get_type_for_mode(element_mode);
-	ir_type *const array_type   = new_type_array(element_type, length);
-	ident   *const id           = new_id_from_str(name);
-	ir_type *const owner        = get_glob_type();
-	return new_global_entity(owner, id, array_type, ir_visibility_private, linkage);
+	ir_type   *const element_type = get_type_for_mode(element_mode);
+	ir_type   *const array_type   = new_type_array(element_type, length);
+	ident     *const id           = new_id_from_str(name);
+	ir_type   *const owner        = get_glob_type();
+	ir_entity *const result       = new_global_entity(owner, id, array_type, ir_visibility_private, linkage);
+	/* without initializer the entity would only be a declaration */
+	set_entity_initializer(result, get_initializer_null());
+	return result;
 }
 
 /**
@@ -387,7 +645,28 @@ static ir_entity *new_static_string_entity(char const *const name, char const *c
 	return result;
 }
 
-ir_graph *ir_profile_instrument(const char *filename)
+/**
+ * Creates a new entity representing the equivalent of
+ * static void *name[] = { functions };
+ */
+static ir_entity *new_function_table_entity(char const *const name, ir_entity **const functions)
+{
+	size_t     const length = ARR_LEN(functions);
+	ir_entity *const result = new_array_entity(name, mode_P, length, IR_LINKAGE_CONSTANT);
+
+	ir_graph         *const irg      = get_const_code_irg();
+	ir_initializer_t *const contents = create_initializer_compound(length);
+	for (size_t i = 0; i < length; ++i) {
+		ir_node          *const addr = new_r_Address(irg, functions[i]);
+		ir_initializer_t *const init = create_initializer_const(addr);
+		set_initializer_compound_value(contents, i, init);
+	}
+	set_entity_initializer(result, contents);
+
+	return result;
+}
+
+ir_graph *ir_profile_instrument(const char *filename, int profile_operands)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 
@@ -406,16 +685,108 @@ ir_graph *ir_profile_instrument(const char *filename)
 
 	ir_entity *const ent_filename = new_static_string_entity("__FIRMPROF__FILE_NAME", filename);
 
+	/* collect the value profiling sites before instrumenting anything */
+	ir_node  **const sites       = get_irp_value_sites();
+	size_t     const n_sites     = ARR_LEN(sites);
+	ir_entity      *records      = NULL;
+	ir_entity      *record_value = NULL;
+	ir_entity      *functions    = NULL;
+	size_t          n_functions  = 0;
+	if (n_sites > 0) {
+		ir_mode   *const mode_word = find_unsigned_mode(get_reference_offset_mode(mode_P));
+		ir_entity **const funcs    = get_irp_functions();
+		n_functions  = ARR_LEN(funcs);
+		functions    = new_function_table_entity("__FIRMPROF__FUNCTIONS", funcs);
+		records      = new_array_entity("__FIRMPROF__VALUE_RECORDS", mode_word, n_sites * VALUE_RECORD_WORDS, IR_LINKAGE_DEFAULT);
+		record_value = get_firmprof_value_ref(mode_word);
+		DEL_ARR_F(funcs);
+	}
+
 	/* initialize block id array and instrument blocks */
-	block_id_walker_data_t wd = { .id = 0 };
+	block_id_walker_data_t wd = {
+		.id               = 0,
+		.sites            = sites,
+		.site             = 0,
+		.records          = records,
+		.record_value     = record_value,
+		.profile_operands = profile_operands,
+	};
 	foreach_irp_irg_r(i, irg) {
 		instrument_irg(irg, bblock_counts, &wd);
 	}
+	DEL_ARR_F(sites);
+
+	return gen_initializer_irg(ent_filename, bblock_counts, n_blocks, records, n_sites, functions, n_functions);
+}
+
+/**
+ * Reads an unsigned integer of size bytes stored in little endian format.
+ */
+static bool read_little_endian(FILE *const f, unsigned const size, uint64_t *const res)
+{
+	unsigned char bytes[8];
+	if (fread(bytes, 1, size, f) != size)
+		return false;
+
+	uint64_t value = 0;
+	for (unsigned i = size; i-- > 0;)
+		value = value << 8 | bytes[i];
+	*res = value;
+	return true;
+}
+
+/**
+ * Reads an array of n 64 bit integers stored in little endian format.
+ */
+static uint64_t *read_words(FILE *const f, size_t const n)
+{
+	uint64_t *const result = XMALLOCN(uint64_t, n);
+	for (size_t i = 0; i < n; ++i) {
+		if (!read_little_endian(f, 8, &result[i])) {
+			free(result);
+			return NULL;
+		}
+	}
+	return result;
+}
+
+/**
+ * Reads the value profiling data following the block counters. Profiles of
+ * programs without value profiling sites do not contain it.
+ */
+static void parse_values(FILE *const f, value_data_t *const values)
+{
+	char     buf[8];
+	uint64_t n_sites;
+	uint64_t n_words;
+	uint64_t n_functions;
+	if (fread(buf, 8, 1, f) == 0 || strncmp(buf, "firmvals", 8) != 0
+	    || !read_little_endian(f, 4, &n_sites)
+	    || !read_little_endian(f, 4, &n_words) || n_words != VALUE_RECORD_WORDS) {
+		DBG((dbg, LEVEL_2, "No value profile\n"));
+		return;
+	}
+
+	uint64_t *const records = read_words(f, n_sites * VALUE_RECORD_WORDS);
+	if (records == NULL || !read_little_endian(f, 4, &n_functions)) {
+		DBG((dbg, LEVEL_2, "Broken value profile\n"));
+		free(records);
+		return;
+	}
+	uint64_t *const functions = read_words(f, n_functions);
+	if (functions == NULL) {
+		DBG((dbg, LEVEL_2, "Broken function addresses in value profile\n"));
+		free(records);
+		return;
+	}
 
-	return gen_initializer_irg(ent_filename, bblock_counts, n_blocks);
+	values->records     = records;
+	values->n_sites     = n_sites;
+	values->functions   = functions;
+	values->n_functions = n_functions;
 }
 
-static unsigned int *parse_profile(const char *filename, unsigned int num_blocks)
+static unsigned int *parse_profile(const char *filename, unsigned int num_blocks, value_data_t *values)
 {
 	FILE *const f = fopen(filename, "rb");
 	if (!f) {
@@ -450,6 +821,8 @@ static unsigned int *parse_profile(const char *filename, unsigned int num_blocks
 			sizeof(unsigned int) * num_blocks));
 		free(result);
 		result = NULL;
+	} else {
+		parse_values(f, values);
 	}
 
 end:
@@ -478,6 +851,70 @@ static void irp_associate_blocks(block_assoc_t *env)
 	}
 }
 
+static int cmp_value_entry(const void *p1, const void *p2)
+{
+	ir_value_profile_entry_t const *const e1 = (ir_value_profile_entry_t const*)p1;
+	ir_value_profile_entry_t const *const e2 = (ir_value_profile_entry_t const*)p2;
+	return QSORT_CMP(e2->count, e1->count);
+}
+
+/**
+ * Associates the value records with the value profiling sites. The targets
+ * of indirect calls are identified by comparing the recorded values with the
+ * function addresses of the profiled run.
+ */
+static void irp_associate_values(value_data_t const *const values)
+{
+	ir_node   **const sites     = get_irp_value_sites();
+	ir_entity **const functions = get_irp_functions();
+	size_t      const n_sites   = ARR_LEN(sites);
+	if (n_sites != values->n_sites) {
+		DBG((dbg, LEVEL_2, "Value profile does not match program\n"));
+		goto end;
+	}
+
+	bool const has_targets = ARR_LEN(functions) == values->n_functions;
+	value_profiles = new_set(cmp_value_profile, 16);
+	for (size_t i = 0; i < n_sites; ++i) {
+		ir_node        *const site   = sites[i];
+		uint64_t const *const record = &values->records[i * VALUE_RECORD_WORDS];
+		if (record[0] == 0)
+			continue;
+
+		value_profile_t query = { .node = get_irn_node_nr(site) };
+		ir_value_profile_t *const vp = &query.profile;
+		vp->total = MIN(record[0], UINT32_MAX);
+		for (unsigned e = 0; e < IR_PROFILE_VALUE_TOP_N; ++e) {
+			uint64_t const value = record[1 + 2 * e];
+			uint64_t const count = record[2 + 2 * e];
+			if (count == 0)
+				continue;
+
+			ir_entity *target = NULL;
+			if (is_Call(site) && has_targets) {
+				for (size_t f = 0; f < values->n_functions; ++f) {
+					if (values->functions[f] == value) {
+						target = functions[f];
+						break;
+					}
+				}
+			}
+			vp->entries[vp->n_entries++] = (ir_value_profile_entry_t) {
+				.value  = value,
+				.count  = MIN(count, UINT32_MAX),
+				.target = target,
+			};
+		}
+		QSORT(vp->entries, vp->n_entries, cmp_value_entry);
+		DBG((dbg, LEVEL_4, "value profile(%+F): %u executions\n", site, vp->total));
+		(void)set_insert(value_profile_t, value_profiles, &query, sizeof(query), query.node);
+	}
+
+end:
+	DEL_ARR_F(functions);
+	DEL_ARR_F(sites);
+}
+
 void ir_profile_free(void)
 {
 	if (profile) {
@@ -485,20 +922,26 @@ void ir_profile_free(void)
 		profile = NULL;
 	}
 
+	if (value_profiles != NULL) {
+		del_set(value_profiles);
+		value_profiles = NULL;
+	}
+
 	if (hook != NULL) {
 		dump_remove_node_info_callback(hook);
 		hook = NULL;
 	}
 }
 
-bool ir_profile_read(const char *filename)
+int ir_profile_read(const char *filename)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 
-	unsigned n_blocks = get_irp_n_blocks();
+	unsigned     n_blocks = get_irp_n_blocks();
+	value_data_t values   = { .records = NULL };
 	block_assoc_t env = {
 		.i        = 0,
-		.counters = parse_profile(filename, n_blocks)
+		.counters = parse_profile(filename, n_blocks, &values)
 	};
 	if (!env.counters)
 		return false;
@@ -509,6 +952,12 @@ bool ir_profile_read(const char *filename)
 	irp_associate_blocks(&env);
 	free(env.counters);
 
+	if (values.records != NULL) {
+		irp_associate_values(&values);
+		free(values.records);
+		free(values.functions);
+	}
+
 	/* register the vcg hook */
 	hook = dump_add_node_info_callback(dump_profile_node_info, NULL);
 	return 1;
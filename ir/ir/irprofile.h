@@ -15,27 +15,25 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "execfreq.h"
 #include "firm_types.h"
 
-/**
- * Instruments all irgs in the program with profile code.
- * The final code will have a counter for each basic block which is
- * incremented in that block. After the program has run the info is written
- * to @p filename.
- */
-ir_graph *ir_profile_instrument(const char *filename);
+/** Number of most frequent values recorded per value profiling site. */
+#define IR_PROFILE_VALUE_TOP_N 4
 
-/**
- * Reads the corresponding profile info file if it exists and returns a
- * profile info struct
- * @param filename The name of the file containing profile information
- */
-bool ir_profile_read(const char *filename);
+/** A value observed at a value profiling site. */
+typedef struct ir_value_profile_entry_t {
+	uint64_t   value;  /**< the value */
+	uint32_t   count;  /**< how often the value was observed */
+	ir_entity *target; /**< the function at address value for Call sites */
+} ir_value_profile_entry_t;
 
-/**
- * Frees the profile info
- */
-void ir_profile_free(void);
+/** The most frequent values of a value profiling site. */
+typedef struct ir_value_profile_t {
+	uint32_t                 total;   /**< executions of the site */
+	unsigned                 n_entries;
+	ir_value_profile_entry_t entries[IR_PROFILE_VALUE_TOP_N]; /**< sorted by descending count */
+} ir_value_profile_t;
 
 /**
  * Get block execution count as determined be profiling
@@ -43,8 +41,14 @@ void ir_profile_free(void);
 uint32_t ir_profile_get_block_execcount(const ir_node *block);
 
 /**
- * Initializes exec_freq structure for an irg based on profile data
+ * Set block execution count of a block created after the profile was read
+ */
+void ir_profile_set_block_execcount(const ir_node *block, uint32_t count);
+
+/**
+ * Get the value profile of an indirect Call, a Div, a Mod or a Switch.
+ * Returns NULL if there is no value profile for the node.
  */
-void ir_create_execfreqs_from_profile(void);
+ir_value_profile_t const *ir_profile_get_value_profile(const ir_node *node);
 
 #endif
@@ -18,12 +18,16 @@
 #include "irflag_t.h"
 #include "irgraph_t.h"
 #include "irgwalk.h"
+#include "irhooks.h"
 #include "irnode_t.h"
 #include "irnodeset.h"
 #include "irop_t.h"
 #include "irouts.h"
 #include "irprintf.h"
-#include "irprog.h"
+#include "irprog_t.h"
+#include "raw_bitset.h"
+#include "util.h"
+#include "xmalloc.h"
 
 static void warn(const ir_node *n, const char *format, ...)
 {
@@ -641,7 +645,7 @@ static int verify_node_Add(const ir_node *n)
 {
 	bool     fine = true;
 	ir_mode *mode = get_irn_mode(n);
-	if (mode_is_num(mode)) {
+	if (mode_is_num(mode) || mode_is_vector(mode)) {
 		fine &= check_mode_same_input(n, n_Add_left, "left");
 		fine &= check_mode_same_input(n, n_Add_right, "right");
 	} else if (mode_is_reference(mode)) {
@@ -683,6 +687,9 @@ static int verify_node_Sub(const ir_node *n)
 		fine &= check_mode_same_input(n, n_Sub_left, "left");
 		ir_mode *offset_mode = get_reference_offset_mode(mode);
 		fine &= check_input_mode(n, n_Sub_right, "right", offset_mode);
+	} else if (mode_is_vector(mode)) {
+		fine &= check_mode_same_input(n, n_Sub_left, "left");
+		fine &= check_mode_same_input(n, n_Sub_right, "right");
 	}
 	return fine;
 }
@@ -694,9 +701,14 @@ static int verify_node_Minus(const ir_node *n)
 	return fine;
 }
 
+static int mode_is_num_or_vector(const ir_mode *mode)
+{
+	return mode_is_num(mode) || mode_is_vector(mode);
+}
+
 static int verify_node_Mul(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_num, "numeric");
+	bool fine = check_mode_func(n, mode_is_num_or_vector, "numeric or vector");
 	fine &= check_mode_same_input(n, n_Mul_left, "left");
 	fine &= check_mode_same_input(n, n_Mul_right, "right");
 	return fine;
@@ -743,9 +755,15 @@ static int mode_is_intb(const ir_mode *mode)
 	return mode_is_int(mode) || mode == mode_b;
 }
 
+static int mode_is_intb_or_vector(const ir_mode *mode)
+{
+	return mode_is_intb(mode) || mode_is_vector(mode);
+}
+
 static int verify_node_And(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intb_or_vector,
+	                            "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_And_left, "left");
 	fine &= check_mode_same_input(n, n_And_right, "right");
 	return fine;
@@ -753,7 +771,8 @@ static int verify_node_And(const ir_node *n)
 
 static int verify_node_Or(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intb_or_vector,
+	                            "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_Or_left, "left");
 	fine &= check_mode_same_input(n, n_Or_right, "right");
 	return fine;
@@ -761,7 +780,8 @@ static int verify_node_Or(const ir_node *n)
 
 static int verify_node_Eor(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intb_or_vector,
+	                            "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_Eor_left, "left");
 	fine &= check_mode_same_input(n, n_Eor_right, "right");
 	return fine;
@@ -1268,6 +1288,7 @@ static bool check_has_memory(ir_graph *irg)
 }
 
 static bool check_graph_properties(ir_graph *irg);
+static void start_verify_info(ir_graph *irg);
 
 int irg_verify(ir_graph *irg)
 {
@@ -1290,12 +1311,13 @@ int irg_verify(ir_graph *irg)
 		fine &= check_has_memory(irg);
 	}
 
+	start_verify_info(irg);
 	return fine;
 }
 
 void irg_assert_verify(ir_graph *irg)
 {
-	bool fine = irg_verify(irg);
+	bool fine = irg_verify_incremental(irg);
 	if (!fine) {
 		dump_ir_graph(irg, "assert");
 		abort();
@@ -1472,3 +1494,237 @@ static bool check_graph_properties(ir_graph *irg)
 	check_consistent_out_edges(irg);
 	return properties_fine;
 }
+
+/**
+ * Changes of a graph since its last verification.
+ */
+struct ir_verify_info_t {
+	unsigned *dirty;         /**< indices of created or changed nodes */
+	unsigned *marked;        /**< bitset of the indices in dirty */
+	unsigned  marked_size;
+	unsigned  n_incremental; /**< incremental verifications since the last
+	                              full one */
+	bool      full;          /**< the whole graph has to be verified */
+};
+
+static unsigned     full_verify_interval;
+static hook_entry_t verify_new_node_hook;
+static hook_entry_t verify_replace_hook;
+static hook_entry_t verify_set_irn_n_hook;
+static hook_entry_t verify_set_irn_mode_hook;
+static hook_entry_t verify_set_irn_attr_hook;
+
+static void mark_full(ir_graph *const irg)
+{
+	ir_verify_info_t *const info = irg->verify_info;
+	if (info != NULL)
+		info->full = true;
+}
+
+static void mark_dirty(ir_node *const node)
+{
+	ir_graph         *const irg  = get_irn_irg(node);
+	ir_verify_info_t *const info = irg->verify_info;
+	if (info == NULL || info->full)
+		return;
+
+	/* The control flow checks are global. */
+	if (is_Block(node) || is_Cond(node) || is_Switch(node)
+	    || (get_irn_mode(node) == mode_X && !is_End(node))) {
+		info->full = true;
+		return;
+	}
+
+	unsigned const idx = get_irn_idx(node);
+	if (idx >= info->marked_size) {
+		unsigned  const new_size   = MAX(idx + 1, info->marked_size * 2);
+		unsigned *const new_marked = rbitset_malloc(new_size);
+		rbitset_copy(new_marked, info->marked, info->marked_size);
+		free(info->marked);
+		info->marked      = new_marked;
+		info->marked_size = new_size;
+	} else if (rbitset_is_set(info->marked, idx)) {
+		return;
+	}
+	/* Verifying more than half of the nodes and their users is no longer
+	 * cheaper. */
+	if (ARR_LEN(info->dirty) >= get_irg_last_idx(irg) / 2) {
+		info->full = true;
+		return;
+	}
+	rbitset_set(info->marked, idx);
+	ARR_APP1(unsigned, info->dirty, idx);
+}
+
+static void clear_dirty(ir_verify_info_t *const info)
+{
+	for (size_t i = 0, n = ARR_LEN(info->dirty); i < n; ++i)
+		rbitset_clear(info->marked, info->dirty[i]);
+	ARR_SHRINKLEN(info->dirty, 0);
+}
+
+static void record_new_node(void *const ctx, ir_node *const node)
+{
+	(void)ctx;
+	mark_dirty(node);
+}
+
+static void record_replace(void *const ctx, ir_node *const old_node,
+                          ir_node *const new_node)
+{
+	(void)ctx;
+	/* kill_node() replaces by NULL */
+	if (new_node == NULL)
+		return;
+	mark_dirty(new_node);
+	/* Without out edges the users of old_node cannot be found. They only
+	 * notice a different mode. */
+	ir_graph *const irg = get_irn_irg(new_node);
+	if (!edges_activated(irg) && get_irn_mode(old_node) != get_irn_mode(new_node))
+		mark_full(irg);
+}
+
+static void record_set_irn_n(void *const ctx, ir_node *const node,
+                             int const pos, ir_node *const new_pred,
+                             ir_node *const old_pred)
+{
+	(void)ctx;
+	(void)pos;
+	(void)new_pred;
+	(void)old_pred;
+	mark_dirty(node);
+}
+
+static void record_set_irn_mode(void *const ctx, ir_node *const node,
+                                ir_mode *const mode)
+{
+	(void)ctx;
+	if (mode == get_irn_mode(node))
+		return;
+	/* Without out edges the users cannot be found. A node becoming control
+	 * flow needs the global checks, mark_dirty() notices the opposite. */
+	ir_graph *const irg = get_irn_irg(node);
+	if (!edges_activated(irg) || mode == mode_X)
+		mark_full(irg);
+	else
+		mark_dirty(node);
+}
+
+static void record_set_irn_attr(void *const ctx, ir_node *const node)
+{
+	(void)ctx;
+	mark_dirty(node);
+}
+
+static void start_verify_info(ir_graph *const irg)
+{
+	if (full_verify_interval == 0)
+		return;
+
+	ir_verify_info_t *info = irg->verify_info;
+	if (info == NULL) {
+		info              = XMALLOCZ(ir_verify_info_t);
+		info->dirty       = NEW_ARR_F(unsigned, 0);
+		info->marked_size = MAX(get_irg_last_idx(irg), 1);
+		info->marked      = rbitset_malloc(info->marked_size);
+		irg->verify_info = info;
+	}
+	clear_dirty(info);
+	info->n_incremental = 0;
+	info->full          = false;
+}
+
+void free_irg_verify_info(ir_graph *const irg)
+{
+	ir_verify_info_t *const info = irg->verify_info;
+	if (info == NULL)
+		return;
+	DEL_ARR_F(info->dirty);
+	free(info->marked);
+	free(info);
+	irg->verify_info = NULL;
+}
+
+void ir_set_verify_incremental(unsigned const full_interval)
+{
+	if ((full_verify_interval != 0) == (full_interval != 0)) {
+		full_verify_interval = full_interval;
+		return;
+	}
+
+	full_verify_interval = full_interval;
+	if (full_interval != 0) {
+		verify_new_node_hook.hook._hook_new_node   = record_new_node;
+		verify_replace_hook.hook._hook_replace     = record_replace;
+		verify_set_irn_n_hook.hook._hook_set_irn_n = record_set_irn_n;
+		verify_set_irn_mode_hook.hook._hook_set_irn_mode = record_set_irn_mode;
+		verify_set_irn_attr_hook.hook._hook_set_irn_attr = record_set_irn_attr;
+		register_hook(hook_new_node,     &verify_new_node_hook);
+		register_hook(hook_replace,      &verify_replace_hook);
+		register_hook(hook_set_irn_n,    &verify_set_irn_n_hook);
+		register_hook(hook_set_irn_mode, &verify_set_irn_mode_hook);
+		register_hook(hook_set_irn_attr, &verify_set_irn_attr_hook);
+	} else {
+		unregister_hook(hook_new_node,     &verify_new_node_hook);
+		unregister_hook(hook_replace,      &verify_replace_hook);
+		unregister_hook(hook_set_irn_n,    &verify_set_irn_n_hook);
+		unregister_hook(hook_set_irn_mode, &verify_set_irn_mode_hook);
+		unregister_hook(hook_set_irn_attr, &verify_set_irn_attr_hook);
+		/* changes are no longer recorded */
+		foreach_irp_irg(i, irg) {
+			free_irg_verify_info(irg);
+		}
+	}
+}
+
+static void verify_changed_node(ir_node *const node, bool const ssa,
+                                bool *const fine)
+{
+	if (irn_visited_else_mark(node) || is_Deleted(node) || is_Id(node))
+		return;
+
+	if (ssa)
+		verify_wrap_ssa(node, fine);
+	else
+		verify_wrap(node, fine);
+	properties_fine = true;
+	check_simple_properties(node, get_irn_irg(node));
+	*fine &= properties_fine;
+}
+
+int irg_verify_incremental(ir_graph *const irg)
+{
+	ir_verify_info_t *const info = irg->verify_info;
+	if (full_verify_interval == 0 || info == NULL || info->full
+	    || ++info->n_incremental >= full_verify_interval)
+		return irg_verify(irg);
+
+	bool const ssa = get_irg_pinned(irg) == op_pin_state_pinned
+	              && irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	bool const users = edges_activated(irg);
+	bool       fine  = true;
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	inc_irg_visited(irg);
+	unsigned const last_idx = get_irg_last_idx(irg);
+	for (size_t i = 0, n = ARR_LEN(info->dirty); i < n; ++i) {
+		unsigned const idx = info->dirty[i];
+		/* nodes may have been killed or renumbered since */
+		if (idx >= last_idx)
+			continue;
+		ir_node *const node = get_idx_irn(irg, idx);
+		if (node == NULL)
+			continue;
+
+		verify_changed_node(node, ssa, &fine);
+		if (users && !is_Deleted(node)) {
+			foreach_out_edge(node, edge) {
+				verify_changed_node(get_edge_src_irn(edge), ssa, &fine);
+			}
+		}
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+
+	clear_dirty(info);
+	return fine;
+}
@@ -13,9 +13,16 @@
 
 #include "irverify.h"
 
+typedef struct ir_verify_info_t ir_verify_info_t;
+
 /**
  * Set the default verify_node and verify_proj_node operations.
  */
 void ir_register_verify_node_ops(void);
 
+/**
+ * Frees the changes recorded for incremental verification of @p irg.
+ */
+void free_irg_verify_info(ir_graph *irg);
+
 #endif
@@ -44,7 +44,7 @@ static void apply_RN(pbqp_t *pbqp)
 	}
 #endif
 
-	unsigned min_index = get_local_minimal_alternative(pbqp, node);
+	unsigned min_index = get_local_minimal_alternative(node);
 
 #if KAPS_DUMP
 	if (pbqp->dump_file) {
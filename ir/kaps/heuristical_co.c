@@ -66,7 +66,7 @@ static void apply_RN_co(pbqp_t *pbqp)
 	}
 #endif
 
-	unsigned min_index = get_local_minimal_alternative(pbqp, node);
+	unsigned min_index = get_local_minimal_alternative(node);
 
 #if KAPS_DUMP
 	if (pbqp->dump_file) {
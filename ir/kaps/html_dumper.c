@@ -46,9 +46,9 @@ static void dump_vector(FILE *f, vector_t *vec)
 	for (unsigned index = 0; index < len; ++index) {
 #if KAPS_ENABLE_VECTOR_NAMES
 		fprintf(f, "<span title=\"%s\">%s</span> ",
-		        vec->entries[index].name, cost2a(vec->entries[index].data));
+		        vec->names[index], cost2a(vec->entries[index]));
 #else
-		fprintf(f, "%s ", cost2a(vec->entries[index].data));
+		fprintf(f, "%s ", cost2a(vec->entries[index]));
 #endif
 	}
 
@@ -47,9 +47,11 @@ pbqp_matrix_t *pbqp_matrix_copy_and_transpose(pbqp_t *pbqp, pbqp_matrix_t *m)
 	unsigned       len  = rows * cols;
 	pbqp_matrix_t *copy = (pbqp_matrix_t *)obstack_alloc(&pbqp->obstack, sizeof(*copy) + sizeof(*copy->entries) * len);
 
-	for (unsigned i = 0; i < rows; ++i) {
-		for (unsigned j = 0; j < cols; ++j) {
-			copy->entries[j * rows + i] = m->entries[i * cols + j];
+	/* Write the result row by row, so the stores stay contiguous. */
+	for (unsigned j = 0; j < cols; ++j) {
+		num *row = &copy->entries[j * rows];
+		for (unsigned i = 0; i < rows; ++i) {
+			row[i] = m->entries[i * cols + j];
 		}
 	}
 
@@ -120,14 +122,10 @@ num pbqp_matrix_get_col_min(pbqp_matrix_t *matrix, unsigned col_index, vector_t
 	assert(row_len == flags->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		/* Ignore virtual deleted columns. */
-		if (flags->entries[row_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * col_len + col_index];
+		/* Ignore virtual deleted rows. */
+		num elem = pbqp_mask_inf(flags->entries[row_index], matrix->entries[row_index * col_len + col_index]);
 
-		if (elem < min) {
-			min = elem;
-		}
+		min = elem < min ? elem : min;
 	}
 
 	return min;
@@ -144,7 +142,7 @@ unsigned pbqp_matrix_get_col_min_index(pbqp_matrix_t *matrix, unsigned col_index
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
 		/* Ignore virtual deleted columns. */
-		if (flags->entries[row_index].data == INF_COSTS) continue;
+		if (flags->entries[row_index] == INF_COSTS) continue;
 
 		num elem = matrix->entries[row_index * col_len + col_index];
 
@@ -165,16 +163,14 @@ void pbqp_matrix_sub_col_value(pbqp_matrix_t *matrix, unsigned col_index,
 
 	assert(row_len == flags->len);
 
+	/* inf - x = inf if x < inf */
+	num inf_value = value == INF_COSTS ? 0 : INF_COSTS;
+
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		if (flags->entries[row_index].data == INF_COSTS) {
-			matrix->entries[row_index * col_len + col_index] = 0;
-			continue;
-		}
-		/* inf - x = inf if x < inf */
-		if (matrix->entries[row_index * col_len + col_index] == INF_COSTS
-		    && value != INF_COSTS)
-			continue;
-		matrix->entries[row_index * col_len + col_index] -= value;
+		num elem = matrix->entries[row_index * col_len + col_index];
+		num res  = elem == INF_COSTS ? inf_value : elem - value;
+
+		matrix->entries[row_index * col_len + col_index] = flags->entries[row_index] == INF_COSTS ? 0 : res;
 	}
 }
 
@@ -185,15 +181,13 @@ num pbqp_matrix_get_row_min(pbqp_matrix_t *matrix, unsigned row_index, vector_t
 
 	assert(matrix->cols == len);
 
+	num const *row = &matrix->entries[row_index * len];
+
 	for (unsigned col_index = 0; col_index < len; ++col_index) {
 		/* Ignore virtual deleted columns. */
-		if (flags->entries[col_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * len + col_index];
+		num elem = pbqp_mask_inf(flags->entries[col_index], row[col_index]);
 
-		if (elem < min) {
-			min = elem;
-		}
+		min = elem < min ? elem : min;
 	}
 
 	return min;
@@ -209,7 +203,7 @@ unsigned pbqp_matrix_get_row_min_index(pbqp_matrix_t *matrix, unsigned row_index
 
 	for (unsigned col_index = 0; col_index < len; ++col_index) {
 		/* Ignore virtual deleted columns. */
-		if (flags->entries[col_index].data == INF_COSTS) continue;
+		if (flags->entries[col_index] == INF_COSTS) continue;
 
 		num elem = matrix->entries[row_index * len + col_index];
 
@@ -229,16 +223,15 @@ void pbqp_matrix_sub_row_value(pbqp_matrix_t *matrix, unsigned row_index,
 
 	assert(col_len == flags->len);
 
+	/* inf - x = inf if x < inf */
+	num  inf_value = value == INF_COSTS ? 0 : INF_COSTS;
+	num *row       = &matrix->entries[row_index * col_len];
+
 	for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-		if (flags->entries[col_index].data == INF_COSTS) {
-			matrix->entries[row_index * col_len + col_index] = 0;
-			continue;
-		}
-		/* inf - x = inf if x < inf */
-		if (matrix->entries[row_index * col_len + col_index] == INF_COSTS
-		    && value != INF_COSTS)
-			continue;
-		matrix->entries[row_index * col_len + col_index] -= value;
+		num elem = row[col_index];
+		num res  = elem == INF_COSTS ? inf_value : elem - value;
+
+		row[col_index] = flags->entries[col_index] == INF_COSTS ? 0 : res;
 	}
 }
 
@@ -251,17 +244,18 @@ int pbqp_matrix_is_zero(pbqp_matrix_t *mat, vector_t *src_vec, vector_t *tgt_vec
 	assert(row_len == src_vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		if (src_vec->entries[row_index].data == INF_COSTS)
+		if (src_vec->entries[row_index] == INF_COSTS)
 			continue;
 
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			if (tgt_vec->entries[col_index].data == INF_COSTS)
-				continue;
+		num const *row     = &mat->entries[row_index * col_len];
+		num        nonzero = 0;
 
-			if (mat->entries[row_index * col_len + col_index] != 0) {
-				return 0;
-			}
+		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+			nonzero |= tgt_vec->entries[col_index] == INF_COSTS ? 0 : row[col_index];
 		}
+
+		if (nonzero != 0)
+			return 0;
 	}
 
 	return 1;
@@ -275,10 +269,11 @@ void pbqp_matrix_add_to_all_cols(pbqp_matrix_t *mat, vector_t *vec)
 	assert(row_len == vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		num value = vec->entries[row_index].data;
+		num  value = vec->entries[row_index];
+		num *row   = &mat->entries[row_index * col_len];
 
 		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			mat->entries[row_index * col_len + col_index] = pbqp_add(mat->entries[row_index * col_len + col_index], value);
+			row[col_index] = pbqp_add(row[col_index], value);
 		}
 	}
 }
@@ -291,10 +286,10 @@ void pbqp_matrix_add_to_all_rows(pbqp_matrix_t *mat, vector_t *vec)
 	assert(col_len == vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			num value = vec->entries[col_index].data;
+		num *row = &mat->entries[row_index * col_len];
 
-			mat->entries[row_index * col_len + col_index] = pbqp_add(mat->entries[row_index * col_len + col_index], value);
+		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+			row[col_index] = pbqp_add(row[col_index], vec->entries[col_index]);
 		}
 	}
 }
@@ -24,6 +24,7 @@
 #include "vector.h"
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 
 #if KAPS_DUMP
 #include "html_dumper.h"
@@ -113,97 +114,124 @@ void fill_node_buckets(pbqp_t *pbqp)
 	#endif
 }
 
-static void normalize_towards_source(pbqp_edge_t *edge)
+/**
+ * Subtracts the minimum of each row of @p mat from the row and adds it to the
+ * corresponding entry of @p row_vec. Alternatives of @p col_vec with infinite
+ * costs are ignored.
+ * @return whether some entry of @p row_vec became infinite.
+ */
+static bool normalize_rows(pbqp_matrix_t *mat, vector_t *row_vec,
+                           vector_t *col_vec)
 {
-	pbqp_matrix_t *mat          = edge->costs;
-	pbqp_node_t   *src_node     = edge->src;
-	pbqp_node_t   *tgt_node     = edge->tgt;
-	vector_t      *src_vec      = src_node->costs;
-	vector_t      *tgt_vec      = tgt_node->costs;
-	unsigned       src_len      = src_vec->len;
-	unsigned       new_infinity = 0;
+	unsigned row_len      = row_vec->len;
+	bool     new_infinity = false;
 
-	assert(src_len > 0);
-	assert(tgt_vec->len > 0);
+	assert(row_len > 0);
+	assert(col_vec->len > 0);
 
-	/* Normalize towards source node. */
-	for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-		num min = pbqp_matrix_get_row_min(mat, src_index, tgt_vec);
+	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
+		num min = pbqp_matrix_get_row_min(mat, row_index, col_vec);
 
 		if (min != 0) {
-			if (src_vec->entries[src_index].data == INF_COSTS) {
-				pbqp_matrix_set_row_value(mat, src_index, 0);
+			if (row_vec->entries[row_index] == INF_COSTS) {
+				pbqp_matrix_set_row_value(mat, row_index, 0);
 				continue;
 			}
 
-			pbqp_matrix_sub_row_value(mat, src_index, tgt_vec, min);
-			src_vec->entries[src_index].data = pbqp_add(src_vec->entries[src_index].data, min);
+			pbqp_matrix_sub_row_value(mat, row_index, col_vec, min);
+			row_vec->entries[row_index] = pbqp_add(row_vec->entries[row_index], min);
 
 			if (min == INF_COSTS) {
-				new_infinity = 1;
+				new_infinity = true;
 			}
 		}
 	}
 
-	if (new_infinity) {
-		unsigned edge_len = pbqp_node_get_degree(src_node);
-
-		for (unsigned edge_index = 0; edge_index < edge_len; ++edge_index) {
-			pbqp_edge_t *edge_candidate = src_node->edges[edge_index];
-
-			if (edge_candidate != edge) {
-				insert_into_edge_bucket(edge_candidate);
-			}
-		}
-	}
+	return new_infinity;
 }
 
-static void normalize_towards_target(pbqp_edge_t *edge)
+/**
+ * Subtracts the minimum of each column of @p mat from the column and adds it
+ * to the corresponding entry of @p col_vec. Alternatives of @p row_vec with
+ * infinite costs are ignored.
+ * @return whether some entry of @p col_vec became infinite.
+ */
+static bool normalize_columns(pbqp_matrix_t *mat, vector_t *row_vec,
+                              vector_t *col_vec)
 {
-	pbqp_matrix_t *mat          = edge->costs;
-	pbqp_node_t   *src_node     = edge->src;
-	pbqp_node_t   *tgt_node     = edge->tgt;
-	vector_t      *src_vec      = src_node->costs;
-	vector_t      *tgt_vec      = tgt_node->costs;
-	unsigned       tgt_len      = tgt_vec->len;
-	unsigned       new_infinity = 0;
-
-	assert(src_vec->len > 0);
-	assert(tgt_len > 0);
-
+	unsigned row_len      = row_vec->len;
+	unsigned col_len      = col_vec->len;
+	bool     new_infinity = false;
+
+	assert(row_len > 0);
+	assert(col_len > 0);
+
+	/* Collect the minima row by row, so the accesses stay contiguous. This is
+	 * faster than transposing the matrix twice to reuse normalize_rows(). */
+	num *min = ALLOCAN(num, col_len);
+	for (unsigned col_index = 0; col_index < col_len; ++col_index)
+		min[col_index] = INF_COSTS;
+	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
+		num const *row  = &mat->entries[row_index * col_len];
+		num        flag = row_vec->entries[row_index];
+		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+			num elem = pbqp_mask_inf(flag, row[col_index]);
+			min[col_index] = elem < min[col_index] ? elem : min[col_index];
+		}
+	}
 
-	/* Normalize towards target node. */
-	for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-		num min = pbqp_matrix_get_col_min(mat, tgt_index, src_vec);
+	for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+		num col_min = min[col_index];
 
-		if (min != 0) {
-			if (tgt_vec->entries[tgt_index].data == INF_COSTS) {
-				pbqp_matrix_set_col_value(mat, tgt_index, 0);
+		if (col_min != 0) {
+			if (col_vec->entries[col_index] == INF_COSTS) {
+				pbqp_matrix_set_col_value(mat, col_index, 0);
 				continue;
 			}
 
-			pbqp_matrix_sub_col_value(mat, tgt_index, src_vec, min);
-			tgt_vec->entries[tgt_index].data = pbqp_add(tgt_vec->entries[tgt_index].data, min);
+			pbqp_matrix_sub_col_value(mat, col_index, row_vec, col_min);
+			col_vec->entries[col_index] = pbqp_add(col_vec->entries[col_index], col_min);
 
-			if (min == INF_COSTS) {
-				new_infinity = 1;
+			if (col_min == INF_COSTS) {
+				new_infinity = true;
 			}
 		}
 	}
 
-	if (new_infinity) {
-		unsigned edge_len = pbqp_node_get_degree(tgt_node);
+	return new_infinity;
+}
 
-		for (unsigned edge_index = 0; edge_index < edge_len; ++edge_index) {
-			pbqp_edge_t *edge_candidate = tgt_node->edges[edge_index];
+static void insert_other_edges_into_bucket(pbqp_node_t *node, pbqp_edge_t *edge)
+{
+	unsigned edge_len = pbqp_node_get_degree(node);
 
-			if (edge_candidate != edge) {
-				insert_into_edge_bucket(edge_candidate);
-			}
+	for (unsigned edge_index = 0; edge_index < edge_len; ++edge_index) {
+		pbqp_edge_t *edge_candidate = node->edges[edge_index];
+
+		if (edge_candidate != edge) {
+			insert_into_edge_bucket(edge_candidate);
 		}
 	}
 }
 
+static void normalize_towards_source(pbqp_edge_t *edge)
+{
+	pbqp_node_t *src_node = edge->src;
+
+	/* Normalize towards source node. */
+	if (normalize_rows(edge->costs, src_node->costs, edge->tgt->costs))
+		insert_other_edges_into_bucket(src_node, edge);
+}
+
+static void normalize_towards_target(pbqp_edge_t *edge)
+{
+	pbqp_node_t *tgt_node = edge->tgt;
+
+	/* Normalize towards target node. */
+	if (normalize_columns(edge->costs, edge->src->costs, tgt_node->costs))
+		insert_other_edges_into_bucket(tgt_node, edge);
+}
+
 /**
  * Tries to apply RM for the source node of the given edge.
  *
@@ -228,13 +256,13 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 
 	/* Check that each column has at most one zero entry. */
 	for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-		if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+		if (tgt_vec->entries[tgt_index] == INF_COSTS)
 			continue;
 
 		unsigned onlyOneZero = 0;
 
 		for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-			if (src_vec->entries[src_index].data == INF_COSTS)
+			if (src_vec->entries[src_index] == INF_COSTS)
 				continue;
 
 			if (mat->entries[src_index * tgt_len + tgt_index] == INF_COSTS)
@@ -292,13 +320,13 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 		/* Source node selects the column of the old_matrix. */
 		if (old_edge->tgt == src_node) {
 			for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-				if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+				if (tgt_vec->entries[tgt_index] == INF_COSTS)
 					continue;
 
 				unsigned src_index = mapping[tgt_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[tgt_index * other_len + other_index] = old_matrix->entries[other_index * src_len + src_index];
@@ -307,13 +335,13 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 		} else {
 			/* Source node selects the row of the old_matrix. */
 			for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-				if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+				if (tgt_vec->entries[tgt_index] == INF_COSTS)
 					continue;
 
 				unsigned src_index = mapping[tgt_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[tgt_index * other_len + other_index] = old_matrix->entries[src_index * other_len + other_index];
@@ -368,13 +396,13 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 
 	/* Check that each row has at most one zero entry. */
 	for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-		if (src_vec->entries[src_index].data == INF_COSTS)
+		if (src_vec->entries[src_index] == INF_COSTS)
 			continue;
 
 		unsigned onlyOneZero = 0;
 
 		for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-			if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+			if (tgt_vec->entries[tgt_index] == INF_COSTS)
 				continue;
 
 			if (mat->entries[src_index * tgt_len + tgt_index] == INF_COSTS)
@@ -432,13 +460,13 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 		/* Target node selects the column of the old_matrix. */
 		if (old_edge->tgt == tgt_node) {
 			for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-				if (src_vec->entries[src_index].data == INF_COSTS)
+				if (src_vec->entries[src_index] == INF_COSTS)
 					continue;
 
 				unsigned tgt_index = mapping[src_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[src_index * other_len + other_index] = old_matrix->entries[other_index * tgt_len + tgt_index];
@@ -447,13 +475,13 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 		} else {
 			/* Source node selects the row of the old_matrix. */
 			for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-				if (src_vec->entries[src_index].data == INF_COSTS)
+				if (src_vec->entries[src_index] == INF_COSTS)
 					continue;
 
 				unsigned tgt_index = mapping[src_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[src_index * other_len + other_index] = old_matrix->entries[tgt_index * other_len + other_index];
@@ -690,7 +718,7 @@ num determine_solution(pbqp_t *pbqp)
 		pbqp_node_t *node = node_buckets[0][node_index];
 
 		node->solution = vector_get_min_index(node->costs);
-		solution       = pbqp_add(solution, node->costs->entries[node->solution].data);
+		solution       = pbqp_add(solution, node->costs->entries[node->solution]);
 
 #if KAPS_DUMP
 		if (file) {
@@ -964,30 +992,29 @@ void apply_RII(pbqp_t *pbqp)
 	vector_t      *node_vec = node->costs;
 	unsigned       col_len  = tgt_vec->len;
 	unsigned       row_len  = src_vec->len;
+	unsigned       node_len = node_vec->len;
 	pbqp_matrix_t *mat      = pbqp_matrix_alloc(pbqp, row_len, col_len);
+	vector_t      *vec      = vector_copy(pbqp, node_vec);
 
-	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			vector_t *vec = vector_copy(pbqp, node_vec);
+	/* Orient both matrices such that the alternatives of node are the
+	 * columns, so the inner loops only access contiguous rows. */
+	if (src_is_src)
+		src_mat = pbqp_matrix_copy_and_transpose(pbqp, src_mat);
+	if (tgt_is_src)
+		tgt_mat = pbqp_matrix_copy_and_transpose(pbqp, tgt_mat);
 
-			if (src_is_src) {
-				vector_add_matrix_col(vec, src_mat, row_index);
-			} else {
-				vector_add_matrix_row(vec, src_mat, row_index);
-			}
-
-			if (tgt_is_src) {
-				vector_add_matrix_col(vec, tgt_mat, col_index);
-			} else {
-				vector_add_matrix_row(vec, tgt_mat, col_index);
-			}
-
-			mat->entries[row_index * col_len + col_index] = vector_get_min(vec);
+	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
+		memcpy(vec->entries, node_vec->entries, sizeof(*vec->entries) * node_len);
+		vector_add_matrix_row(vec, src_mat, row_index);
 
-			obstack_free(&pbqp->obstack, vec);
+		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+			mat->entries[row_index * col_len + col_index] = vector_get_min_with_matrix_row(vec, tgt_mat, col_index);
 		}
 	}
 
+	/* Free the temporary vector and the transposed matrices. */
+	obstack_free(&pbqp->obstack, vec);
+
 	pbqp_edge_t *edge = get_edge(pbqp, src_node->index, tgt_node->index);
 
 	/* Disconnect node. */
@@ -1044,10 +1071,10 @@ static void select_column(pbqp_edge_t *edge, unsigned col_index)
 		num elem = mat->entries[src_index * tgt_len + col_index];
 
 		if (elem != 0) {
-			if (elem == INF_COSTS && src_vec->entries[src_index].data != INF_COSTS)
+			if (elem == INF_COSTS && src_vec->entries[src_index] != INF_COSTS)
 				new_infinity = 1;
 
-			src_vec->entries[src_index].data = pbqp_add(src_vec->entries[src_index].data, elem);
+			src_vec->entries[src_index] = pbqp_add(src_vec->entries[src_index], elem);
 		}
 	}
 
@@ -1080,10 +1107,10 @@ static void select_row(pbqp_edge_t *edge, unsigned row_index)
 		num elem = mat->entries[row_index * tgt_len + tgt_index];
 
 		if (elem != 0) {
-			if (elem == INF_COSTS && tgt_vec->entries[tgt_index].data != INF_COSTS)
+			if (elem == INF_COSTS && tgt_vec->entries[tgt_index] != INF_COSTS)
 				new_infinity = 1;
 
-			tgt_vec->entries[tgt_index].data = pbqp_add(tgt_vec->entries[tgt_index].data, elem);
+			tgt_vec->entries[tgt_index] = pbqp_add(tgt_vec->entries[tgt_index], elem);
 		}
 	}
 
@@ -1114,7 +1141,7 @@ void select_alternative(pbqp_node_t *node, unsigned selected_index)
 	/* Set all other costs to infinity. */
 	for (unsigned node_index = 0; node_index < node_len; ++node_index) {
 		if (node_index != selected_index) {
-			node_vec->entries[node_index].data = INF_COSTS;
+			node_vec->entries[node_index] = INF_COSTS;
 		}
 	}
 
@@ -1149,7 +1176,7 @@ pbqp_node_t *get_node_with_max_degree(void)
 	return result;
 }
 
-unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
+unsigned get_local_minimal_alternative(pbqp_node_t *node)
 {
 	vector_t *node_vec   = node->costs;
 	unsigned  node_len   = node_vec->len;
@@ -1158,25 +1185,21 @@ unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 	num       min        = INF_COSTS;
 
 	for (unsigned node_index = 0; node_index < node_len; ++node_index) {
-		num value = node_vec->entries[node_index].data;
+		num value = node_vec->entries[node_index];
 
 		for (unsigned edge_index = 0; edge_index < max_degree; ++edge_index) {
 			pbqp_edge_t   *edge   = node->edges[edge_index];
 			pbqp_matrix_t *mat    = edge->costs;
 			bool           is_src = edge->src == node;
-			vector_t      *vec;
+			num            edge_min;
 
 			if (is_src) {
-				vec = vector_copy(pbqp, edge->tgt->costs);
-				vector_add_matrix_row(vec, mat, node_index);
+				edge_min = vector_get_min_with_matrix_row(edge->tgt->costs, mat, node_index);
 			} else {
-				vec = vector_copy(pbqp, edge->src->costs);
-				vector_add_matrix_col(vec, mat, node_index);
+				edge_min = vector_get_min_with_matrix_col(edge->src->costs, mat, node_index);
 			}
 
-			value = pbqp_add(value, vector_get_min(vec));
-
-			obstack_free(&pbqp->obstack, vec);
+			value = pbqp_add(value, edge_min);
 		}
 
 		if (value < min) {
@@ -29,7 +29,7 @@ void back_propagate(pbqp_t *pbqp);
 num determine_solution(pbqp_t *pbqp);
 void fill_node_buckets(pbqp_t *pbqp);
 void free_buckets(void);
-unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node);
+unsigned get_local_minimal_alternative(pbqp_node_t *node);
 pbqp_node_t *get_node_with_max_degree(void);
 void initial_simplify_edges(pbqp_t *pbqp);
 void select_alternative(pbqp_node_t *node, unsigned selected_index);
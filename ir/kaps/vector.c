@@ -14,29 +14,6 @@
 #include "adt/array.h"
 #include <string.h>
 
-num pbqp_add(num x, num y)
-{
-	if (x == INF_COSTS || y == INF_COSTS)
-		return INF_COSTS;
-
-	num res = x + y;
-
-#if !KAPS_USE_UNSIGNED
-	/* No positive overflow. */
-	assert(x < 0 || y < 0 || res >= x);
-	assert(x < 0 || y < 0 || res >= y);
-#endif
-
-	/* No negative overflow. */
-	assert(x > 0 || y > 0 || res <= x);
-	assert(x > 0 || y > 0 || res <= y);
-
-	/* Result is not infinity.*/
-	assert(res < INF_COSTS);
-
-	return res;
-}
-
 vector_t *vector_alloc(pbqp_t *pbqp, unsigned length)
 {
 	vector_t *vec = (vector_t *)obstack_alloc(&pbqp->obstack, sizeof(*vec) + sizeof(*vec->entries) * length);
@@ -44,6 +21,9 @@ vector_t *vector_alloc(pbqp_t *pbqp, unsigned length)
 
 	vec->len = length;
 	memset(vec->entries, 0, sizeof(*vec->entries) * length);
+#if KAPS_ENABLE_VECTOR_NAMES
+	vec->names = OALLOCNZ(&pbqp->obstack, const char*, length);
+#endif
 
 	return vec;
 }
@@ -53,6 +33,9 @@ vector_t *vector_copy(pbqp_t *pbqp, vector_t *v)
 	unsigned  len  = v->len;
 	vector_t *copy = (vector_t *)obstack_copy(&pbqp->obstack, v, sizeof(*copy) + sizeof(*copy->entries) * len);
 	assert(copy);
+#if KAPS_ENABLE_VECTOR_NAMES
+	copy->names = (const char **)obstack_copy(&pbqp->obstack, v->names, sizeof(*copy->names) * len);
+#endif
 
 	return copy;
 }
@@ -64,21 +47,21 @@ void vector_add(vector_t *sum, vector_t *summand)
 	assert(len == summand->len);
 
 	for (unsigned i = 0; i < len; ++i) {
-		sum->entries[i].data = pbqp_add(sum->entries[i].data, summand->entries[i].data);
+		sum->entries[i] = pbqp_add(sum->entries[i], summand->entries[i]);
 	}
 }
 
 void vector_set(vector_t *vec, unsigned index, num value)
 {
 	assert(index < vec->len);
-	vec->entries[index].data = value;
+	vec->entries[index] = value;
 }
 
 #if KAPS_ENABLE_VECTOR_NAMES
 void vector_set_description(vector_t *vec, unsigned index, const char *name)
 {
 	assert(index < vec->len);
-	vec->entries[index].name = name;
+	vec->names[index] = name;
 }
 #endif
 
@@ -87,7 +70,7 @@ void vector_add_value(vector_t *vec, num value)
 	unsigned len = vec->len;
 
 	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, value);
+		vec->entries[index] = pbqp_add(vec->entries[index], value);
 	}
 }
 
@@ -99,7 +82,7 @@ void vector_add_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index
 	assert(col_index < mat->cols);
 
 	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, mat->entries[index * mat->cols + col_index]);
+		vec->entries[index] = pbqp_add(vec->entries[index], mat->entries[index * mat->cols + col_index]);
 	}
 }
 
@@ -110,9 +93,10 @@ void vector_add_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index
 	assert(len == mat->cols);
 	assert(row_index < mat->rows);
 
+	num const *row = &mat->entries[row_index * len];
 
 	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, mat->entries[row_index * mat->cols + index]);
+		vec->entries[index] = pbqp_add(vec->entries[index], row[index]);
 	}
 }
 
@@ -124,11 +108,9 @@ num vector_get_min(vector_t *vec)
 	assert(len > 0);
 
 	for (unsigned index = 0; index < len; ++index) {
-		num elem = vec->entries[index].data;
+		num elem = vec->entries[index];
 
-		if (elem < min) {
-			min = elem;
-		}
+		min = elem < min ? elem : min;
 	}
 
 	return min;
@@ -143,7 +125,7 @@ unsigned vector_get_min_index(vector_t *vec)
 	assert(len > 0);
 
 	for (unsigned index = 0; index < len; ++index) {
-		num elem = vec->entries[index].data;
+		num elem = vec->entries[index];
 
 		if (elem < min) {
 			min = elem;
@@ -153,3 +135,40 @@ unsigned vector_get_min_index(vector_t *vec)
 
 	return min_index;
 }
+
+num vector_get_min_with_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index)
+{
+	unsigned len = vec->len;
+	num      min = INF_COSTS;
+
+	assert(len == mat->cols);
+	assert(row_index < mat->rows);
+
+	num const *row = &mat->entries[row_index * len];
+
+	for (unsigned index = 0; index < len; ++index) {
+		num elem = pbqp_add(vec->entries[index], row[index]);
+
+		min = elem < min ? elem : min;
+	}
+
+	return min;
+}
+
+num vector_get_min_with_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index)
+{
+	unsigned len  = vec->len;
+	unsigned cols = mat->cols;
+	num      min  = INF_COSTS;
+
+	assert(len == mat->rows);
+	assert(col_index < cols);
+
+	for (unsigned index = 0; index < len; ++index) {
+		num elem = pbqp_add(vec->entries[index], mat->entries[index * cols + col_index]);
+
+		min = elem < min ? elem : min;
+	}
+
+	return min;
+}
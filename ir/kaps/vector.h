@@ -12,9 +12,51 @@
 #ifndef KAPS_VECTOR_H
 #define KAPS_VECTOR_H
 
+#include <assert.h>
+
 #include "vector_t.h"
 
-num pbqp_add(num x, num y);
+/**
+ * Saturating addition of costs: the sum is INF_COSTS if one of the
+ * summands is infinite.
+ * The unsigned variant is free of branches, so loops using it can be
+ * vectorized.
+ */
+static inline num pbqp_add(num x, num y)
+{
+#if KAPS_USE_UNSIGNED
+	/* INF_COSTS is the largest value, so any overflow saturates to it. */
+	num res = x + y;
+	return res | -(num)(res < x);
+#else
+	if (x == INF_COSTS || y == INF_COSTS)
+		return INF_COSTS;
+
+	num res = x + y;
+
+	/* No positive overflow. */
+	assert(x < 0 || y < 0 || res >= x);
+	assert(x < 0 || y < 0 || res >= y);
+
+	/* No negative overflow. */
+	assert(x > 0 || y > 0 || res <= x);
+	assert(x > 0 || y > 0 || res <= y);
+
+	/* Result is not infinity.*/
+	assert(res < INF_COSTS);
+
+	return res;
+#endif
+}
+
+/**
+ * Returns @p value if @p flag is not infinite, otherwise INF_COSTS.
+ * Used to ignore alternatives which are virtually deleted.
+ */
+static inline num pbqp_mask_inf(num flag, num value)
+{
+	return flag == INF_COSTS ? INF_COSTS : value;
+}
 
 vector_t *vector_alloc(pbqp_t *pbqp, unsigned length);
 
@@ -38,4 +80,9 @@ void vector_add_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index
 num vector_get_min(vector_t *vec);
 unsigned vector_get_min_index(vector_t *vec);
 
+/* min_i (vec[i] + mat[row_index][i]) without materializing the sum */
+num vector_get_min_with_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index);
+/* min_i (vec[i] + mat[i][col_index]) without materializing the sum */
+num vector_get_min_with_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index);
+
 #endif
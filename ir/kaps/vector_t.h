@@ -14,20 +14,19 @@
 
 #include "pbqp_t.h"
 
-typedef struct vec_elem_t vec_elem_t;
-
-struct vec_elem_t {
-	num data;
-#if KAPS_ENABLE_VECTOR_NAMES
-	const char *name;
-#endif
-};
-
 typedef struct vector_t vector_t;
 
+/**
+ * A cost vector. The costs are stored as a plain array, so the kernels
+ * working on them can be vectorized by the compiler. Debug names are kept
+ * in a separate array.
+ */
 struct vector_t {
-	unsigned   len;
-	vec_elem_t entries[];
+	unsigned     len;
+#if KAPS_ENABLE_VECTOR_NAMES
+	const char **names;
+#endif
+	num          entries[];
 };
 
 #endif
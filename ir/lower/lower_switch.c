@@ -9,41 +9,58 @@
  * @author  Moritz Kroll
  */
 #include "array.h"
+#include "execfreq.h"
 #include "ircons.h"
+#include "irgmod.h"
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
-#include "irnodeset.h"
 #include "irouts_t.h"
 #include "lowering.h"
 #include "panic.h"
 #include "util.h"
+#include <math.h>
 #include <stdbool.h>
 
 typedef struct walk_env_t {
-	ir_nodeset_t  processed;
+	ir_node     **switches;
 	ir_mode      *selector_mode;
+	ir_mode      *bit_test_mode; /**< mode for (1 << x) & mask tests */
 	unsigned      spare_size; /**< the allowed spare size for table switches */
 	unsigned      small_switch;
 	bool          changed;    /**< indicates whether a change was performed */
 } walk_env_t;
 
 typedef struct target_t {
-	ir_node *block;     /**< block that is targetted */
-	uint16_t n_entries; /**< number of table entries targetting this block */
-	uint16_t i;
+	ir_node  *block; /**< block that is targetted */
+	ir_node **preds; /**< new control flow predecessors of the block */
 } target_t;
 
 typedef struct switch_info_t {
-	ir_node     *switchn;
-	ir_tarval   *switch_min;
-	ir_tarval   *switch_max;
-	ir_node     *default_block;
-	unsigned     num_cases;
-	target_t    *targets;
-	ir_node    **defusers;    /**< the Projs pointing to the default case */
+	ir_node               *switchn;
+	ir_tarval             *switch_min;
+	ir_tarval             *switch_max;
+	unsigned               num_cases;
+	target_t              *targets;
+	ir_switch_table_entry *entries; /**< the sorted table entries */
 } switch_info_t;
 
+typedef enum cluster_kind_t {
+	CLUSTER_CASE,     /**< a single entry, checked by a comparison */
+	CLUSTER_TABLE,    /**< dense entries, handled by a jump table */
+	CLUSTER_BIT_TEST, /**< entries to few targets, handled by bit tests */
+} cluster_kind_t;
+
+/** Consecutive table entries which are lowered together. */
+typedef struct cluster_t {
+	cluster_kind_t               kind;
+	ir_tarval                   *min;
+	ir_tarval                   *max;
+	const ir_switch_table_entry *entries;
+	size_t                       n_entries;
+	double                       weight; /**< probability of the entries */
+} cluster_t;
+
 /**
  * analyze enough to decide if we should lower the switch
  */
@@ -91,22 +108,10 @@ static void analyse_switch1(switch_info_t *info)
 		assert((unsigned)pn < n_outs);
 		assert(targets[(unsigned)pn].block == NULL);
 		targets[(unsigned)pn].block = target;
+		targets[(unsigned)pn].preds = NEW_ARR_F(ir_node*, 0);
 	}
 
-	const ir_switch_table *table = get_Switch_table(switchn);
-	for (size_t e = 0, n_entries = ir_switch_table_get_n_entries(table);
-	     e < n_entries; ++e) {
-		const ir_switch_table_entry *entry
-			= ir_switch_table_get_entry_const(table, e);
-		if (entry->pn == pn_Switch_default)
-			continue;
-
-		target_t *target = &targets[entry->pn];
-		++target->n_entries;
-	}
-
-	info->default_block = targets[pn_Switch_default].block;
-	info->targets       = targets;
+	info->targets = targets;
 }
 
 static int compare_entries(const void *a, const void *b)
@@ -269,170 +274,517 @@ static bool normalize_switch(switch_info_t *info, ir_mode *selector_mode)
 	return true;
 }
 
+/** Returns max - min, saturated to UINT64_MAX. */
+static uint64_t get_distance(ir_tarval *const min, ir_tarval *const max)
+{
+	ir_mode   *const umode = find_unsigned_mode(get_tarval_mode(min));
+	ir_tarval *const diff  = tarval_sub(tarval_convert_to(max, umode),
+	                                    tarval_convert_to(min, umode));
+	return tarval_is_long(diff) ? (uint64_t)get_tarval_long(diff) : UINT64_MAX;
+}
+
 /**
- * Create an if (selector == caseval) Cond node (and handle the special case
- * of ranged cases)
+ * Distributes the execution frequencies of the target blocks over the table
+ * entries. Without frequencies all entries are equally likely.
  */
-static ir_node *create_case_cond(const ir_switch_table_entry *entry,
-                                 dbg_info *dbgi, ir_node *block,
-                                 ir_node *selector)
+static double *compute_entry_weights(const switch_info_t *info,
+                                     const ir_switch_table *table)
 {
-	ir_graph *irg      = get_irn_irg(block);
-	ir_node  *minconst = new_r_Const(irg, entry->min);
-
-	ir_node  *cmp;
-	if (entry->min == entry->max) {
-		cmp = new_rd_Cmp(dbgi, block, selector, minconst, ir_relation_equal);
-	} else {
-		ir_tarval *adjusted_max = tarval_sub(entry->max, entry->min);
-		ir_node   *sub          = new_rd_Sub(dbgi, block, selector, minconst);
-		ir_node   *maxconst     = new_r_Const(irg, adjusted_max);
-		cmp = new_rd_Cmp(dbgi, block, sub, maxconst, ir_relation_less_equal);
+	size_t   const n_entries = ir_switch_table_get_n_entries(table);
+	double  *const weights   = NEW_ARR_F(double, n_entries);
+	unsigned const n_outs    = get_Switch_n_outs(info->switchn);
+	double  *const widths    = ALLOCANZ(double, n_outs);
+	bool           have_freq = false;
+	for (size_t e = 0; e < n_entries; ++e) {
+		const ir_switch_table_entry *entry
+			= ir_switch_table_get_entry_const(table, e);
+		widths[entry->pn] += (double)get_distance(entry->min, entry->max) + 1;
+		ir_node const *const block = info->targets[entry->pn].block;
+		if (block != NULL && get_block_execfreq(block) > 0)
+			have_freq = true;
 	}
-	return new_rd_Cond(dbgi, block, cmp);
+	for (size_t e = 0; e < n_entries; ++e) {
+		const ir_switch_table_entry *entry
+			= ir_switch_table_get_entry_const(table, e);
+		if (!have_freq) {
+			weights[e] = 1.0;
+			continue;
+		}
+		ir_node const *const block = info->targets[entry->pn].block;
+		double         const width = (double)get_distance(entry->min, entry->max) + 1;
+		double         const freq  = block != NULL ? get_block_execfreq(block) : 0;
+		weights[e] = freq * width / widths[entry->pn];
+	}
+	return weights;
 }
 
-static void connect_to_target(target_t *target, ir_node *cf)
+/**
+ * Checks whether a bit test is profitable for @p n_cmps case comparisons
+ * jumping to @p n_dests different targets.
+ */
+static bool is_bit_test_profitable(unsigned const n_dests, unsigned const n_cmps)
 {
-	ir_node *block     = target->block;
-	unsigned n_entries = target->n_entries;
-	if (get_Block_n_cfgpreds(block) != (int)n_entries) {
-		ir_node **new_in = ALLOCAN(ir_node*, n_entries);
-		ir_graph *irg    = get_irn_irg(block);
-		ir_node  *dummy  = new_r_Dummy(irg, mode_X);
-		for (unsigned i = 0; i < n_entries; ++i) {
-			new_in[i] = dummy;
+	return (n_dests == 1 && n_cmps >= 3)
+	    || (n_dests == 2 && n_cmps >= 5)
+	    || (n_dests == 3 && n_cmps >= 6);
+}
+
+/**
+ * Partitions the sorted table entries into as few clusters as possible with
+ * dynamic programming. The spare entries of jump table clusters and the
+ * range of bit test clusters are monotonic in the cluster size, which bounds
+ * the inner loop.
+ */
+static cluster_t *partition_cases(const walk_env_t *env,
+                                  ir_switch_table_entry *entries,
+                                  size_t n_entries, const double *weights)
+{
+	size_t         *const cost = NEW_ARR_F(size_t, n_entries + 1);
+	size_t         *const last = NEW_ARR_F(size_t, n_entries);
+	cluster_kind_t *const kind = NEW_ARR_F(cluster_kind_t, n_entries);
+	unsigned        const bits = get_mode_size_bits(env->bit_test_mode);
+
+	cost[n_entries] = 0;
+	for (size_t i = n_entries; i-- > 0;) {
+		cost[i] = cost[i + 1] + 1;
+		last[i] = i;
+		kind[i] = CLUSTER_CASE;
+
+		unsigned dests[4];
+		unsigned n_dests = 0;
+		unsigned n_cmps  = 0;
+		for (size_t j = i; j < n_entries; ++j) {
+			const ir_switch_table_entry *entry = &entries[j];
+			uint64_t const range = get_distance(entries[i].min, entry->max);
+			uint64_t const spare = range - (j - i);
+			bool const table_ok = spare < env->spare_size;
+			bool const range_ok = range < bits;
+			if (!table_ok && !range_ok)
+				break;
+
+			if (n_dests <= 3) {
+				bool found = false;
+				for (unsigned d = 0; d < n_dests; ++d)
+					found |= dests[d] == entry->pn;
+				if (!found)
+					dests[n_dests++] = entry->pn;
+			}
+			n_cmps += entry->min == entry->max ? 1 : 2;
+
+			size_t const n = j - i + 1;
+			if (cost[j + 1] + 1 > cost[i] || n == 1)
+				continue;
+			/* bit tests avoid the indirect jump, prefer them */
+			if (range_ok && is_bit_test_profitable(n_dests, n_cmps)) {
+				cost[i] = cost[j + 1] + 1;
+				last[i] = j;
+				kind[i] = CLUSTER_BIT_TEST;
+			} else if (table_ok && n > env->small_switch
+			        && cost[j + 1] + 1 < cost[i]) {
+				cost[i] = cost[j + 1] + 1;
+				last[i] = j;
+				kind[i] = CLUSTER_TABLE;
+			}
 		}
-		set_irn_in(block, n_entries, new_in);
-		assert(target->i == 0);
 	}
-	assert(target->i < n_entries);
-	set_Block_cfgpred(target->block, target->i++, cf);
+
+	cluster_t *clusters = NEW_ARR_F(cluster_t, 0);
+	for (size_t i = 0; i < n_entries; i = last[i] + 1) {
+		double weight = 0;
+		for (size_t j = i; j <= last[i]; ++j)
+			weight += weights[j];
+		cluster_t const cluster = {
+			.kind      = kind[i],
+			.min       = entries[i].min,
+			.max       = entries[last[i]].max,
+			.entries   = &entries[i],
+			.n_entries = last[i] - i + 1,
+			.weight    = weight,
+		};
+		ARR_APP1(cluster_t, clusters, cluster);
+	}
+	DEL_ARR_F(kind);
+	DEL_ARR_F(last);
+	DEL_ARR_F(cost);
+	return clusters;
+}
+
+static void add_target_pred(switch_info_t *info, unsigned pn, ir_node *cf)
+{
+	ARR_APP1(ir_node*, info->targets[pn].preds, cf);
 }
 
 /**
- * Creates an if cascade realizing binary search.
+ * Creates a Cond, which jumps to the target of @p pn if @p cmp holds and
+ * returns the block reached otherwise.
  */
-static void create_if_cascade(switch_info_t *info, ir_node *block,
-                              ir_switch_table_entry *curcases,
-                              unsigned numcases)
+static ir_node *create_branch(switch_info_t *info, ir_node *block,
+                              ir_node *cmp, unsigned pn)
 {
-	ir_graph      *irg      = get_irn_irg(block);
-	const ir_node *switchn  = info->switchn;
-	dbg_info      *dbgi     = get_irn_dbg_info(switchn);
-	ir_node       *selector = get_Switch_selector(switchn);
-
-	if (numcases == 0) {
-		/* zero cases: "goto default;" */
-		ARR_APP1(ir_node*, info->defusers, new_r_Jmp(block));
-	} else if (numcases == 1) {
-		/*only one case: "if (sel == val) goto target else goto default;"*/
-		const ir_switch_table_entry *entry = &curcases[0];
-		ir_node *cond      = create_case_cond(entry, dbgi, block, selector);
-		ir_node *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
-		ir_node *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
-
-		connect_to_target(&info->targets[entry->pn], trueproj);
-		ARR_APP1(ir_node*, info->defusers, falseproj);
-	} else if (numcases == 2) {
-		/* only two cases: "if (sel == val[0]) goto target[0];" */
-		const ir_switch_table_entry *entry0 = &curcases[0];
-		const ir_switch_table_entry *entry1 = &curcases[1];
-		ir_node *cond      = create_case_cond(entry0, dbgi, block, selector);
-		ir_node *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
-		ir_node *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
-		connect_to_target(&info->targets[entry0->pn], trueproj);
-
-		ir_node *in[]    = { falseproj };
-		ir_node *neblock = new_r_Block(irg, ARRAY_SIZE(in), in);
-
-		/* second part: "else if (sel == val[1]) goto target[1] else goto default;" */
-		ir_node *cond1      = create_case_cond(entry1, dbgi, neblock, selector);
-		ir_node *trueproj1  = new_r_Proj(cond1, mode_X, pn_Cond_true);
-		ir_node *falseproj1 = new_r_Proj(cond1, mode_X, pn_Cond_false);
-		connect_to_target(&info->targets[entry1->pn], trueproj1);
-		ARR_APP1(ir_node*, info->defusers, falseproj1);
-	} else {
-		/* recursive case: split cases in the middle */
-		unsigned midcase = numcases / 2;
-		const ir_switch_table_entry *entry = &curcases[midcase];
-		ir_node *val = new_r_Const(irg, entry->min);
-		ir_node *cmp = new_rd_Cmp(dbgi, block, selector, val, ir_relation_less);
-		ir_node *cond = new_rd_Cond(dbgi, block, cmp);
+	dbg_info *dbgi      = get_irn_dbg_info(info->switchn);
+	ir_node  *cond      = new_rd_Cond(dbgi, block, cmp);
+	ir_node  *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node  *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
+	add_target_pred(info, pn, trueproj);
+
+	ir_node *in[] = { falseproj };
+	return new_r_Block(get_irn_irg(block), ARRAY_SIZE(in), in);
+}
+
+/**
+ * Creates a comparison checking that the selector is in [min, max], knowing
+ * that it is in [lo, hi]. Returns NULL if no check is necessary.
+ */
+static ir_node *create_range_cmp(switch_info_t *info, ir_node *block,
+                                 ir_tarval *min, ir_tarval *max,
+                                 ir_tarval *lo, ir_tarval *hi)
+{
+	ir_graph *irg      = get_irn_irg(block);
+	dbg_info *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_node  *selector = get_Switch_selector(info->switchn);
+	bool      min_ok   = tarval_cmp(lo, min) != ir_relation_less;
+	bool      max_ok   = tarval_cmp(hi, max) != ir_relation_greater;
+	if (min_ok && max_ok)
+		return NULL;
+	if (min == max)
+		return new_rd_Cmp(dbgi, block, selector, new_r_Const(irg, min),
+		                  ir_relation_equal);
+	if (min_ok)
+		return new_rd_Cmp(dbgi, block, selector, new_r_Const(irg, max),
+		                  ir_relation_less_equal);
+	if (max_ok)
+		return new_rd_Cmp(dbgi, block, selector, new_r_Const(irg, min),
+		                  ir_relation_greater_equal);
+
+	/* (unsigned)(selector - min) <= max - min */
+	ir_mode   *umode    = find_unsigned_mode(get_irn_mode(selector));
+	ir_node   *sub      = new_rd_Sub(dbgi, block, selector, new_r_Const(irg, min));
+	ir_node   *conv     = new_rd_Conv(dbgi, block, sub, umode);
+	ir_tarval *range    = tarval_convert_to(tarval_sub(max, min), umode);
+	ir_node   *maxconst = new_r_Const(irg, range);
+	return new_rd_Cmp(dbgi, block, conv, maxconst, ir_relation_less_equal);
+}
+
+/**
+ * Ensures that the selector is in the range of @p cluster and returns the
+ * unsigned distance of the selector from the cluster minimum.
+ */
+static ir_node *create_cluster_index(switch_info_t *info, ir_node **block,
+                                     const cluster_t *cluster,
+                                     ir_tarval *lo, ir_tarval *hi)
+{
+	ir_node *cmp = create_range_cmp(info, *block, cluster->min, cluster->max,
+	                                lo, hi);
+	if (cmp != NULL) {
+		dbg_info *dbgi      = get_irn_dbg_info(info->switchn);
+		ir_node  *cond      = new_rd_Cond(dbgi, *block, cmp);
+		ir_node  *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
+		ir_node  *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
+		add_target_pred(info, pn_Switch_default, falseproj);
+		ir_node *in[] = { trueproj };
+		*block = new_r_Block(get_irn_irg(*block), ARRAY_SIZE(in), in);
+	}
 
-		ir_node *ltin[]  = { new_r_Proj(cond, mode_X, pn_Cond_true) };
-		ir_node *ltblock = new_r_Block(irg, ARRAY_SIZE(ltin), ltin);
+	ir_graph *irg      = get_irn_irg(*block);
+	dbg_info *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_node  *selector = get_Switch_selector(info->switchn);
+	ir_mode  *umode    = find_unsigned_mode(get_irn_mode(selector));
+	ir_node  *index    = new_rd_Conv(dbgi, *block, selector, umode);
+	ir_tarval *min     = tarval_convert_to(cluster->min, umode);
+	if (!tarval_is_null(min))
+		index = new_rd_Sub(dbgi, *block, index, new_r_Const(irg, min));
+	return index;
+}
 
-		ir_node *gein[]  = { new_r_Proj(cond, mode_X, pn_Cond_false) };
-		ir_node *geblock = new_r_Block(irg, ARRAY_SIZE(gein), gein);
+/** Creates a Switch for the entries of a dense cluster. */
+static void create_table_cluster(switch_info_t *info, walk_env_t *env,
+                                 ir_node *block, const cluster_t *cluster,
+                                 ir_tarval *lo, ir_tarval *hi)
+{
+	ir_node  *index = create_cluster_index(info, &block, cluster, lo, hi);
+	ir_graph *irg   = get_irn_irg(block);
+	dbg_info *dbgi  = get_irn_dbg_info(info->switchn);
+	ir_mode  *umode = get_irn_mode(index);
+	ir_mode  *mode  = env->selector_mode;
+	ir_node  *sel   = new_rd_Conv(dbgi, block, index, mode);
+
+	/* number the targets of the cluster, 0 is the default */
+	unsigned  n_outs  = get_Switch_n_outs(info->switchn);
+	unsigned *new_pns = ALLOCANZ(unsigned, n_outs);
+	unsigned *old_pns = ALLOCAN(unsigned, cluster->n_entries + 1);
+	unsigned  n_pns   = 1;
+	old_pns[0] = pn_Switch_default;
+
+	ir_tarval       *min   = tarval_convert_to(cluster->min, umode);
+	ir_switch_table *table = ir_new_switch_table(irg, cluster->n_entries);
+	for (size_t e = 0; e < cluster->n_entries; ++e) {
+		const ir_switch_table_entry *entry = &cluster->entries[e];
+		if (new_pns[entry->pn] == 0) {
+			new_pns[entry->pn] = n_pns;
+			old_pns[n_pns++]   = entry->pn;
+		}
+		ir_tarval *emin = tarval_sub(tarval_convert_to(entry->min, umode), min);
+		ir_tarval *emax = tarval_sub(tarval_convert_to(entry->max, umode), min);
+		ir_switch_table_set(table, e, tarval_convert_to(emin, mode),
+		                    tarval_convert_to(emax, mode), new_pns[entry->pn]);
+	}
 
-		create_if_cascade(info, ltblock, curcases, midcase);
-		create_if_cascade(info, geblock, curcases + midcase, numcases - midcase);
+	ir_node *switchn = new_rd_Switch(dbgi, block, sel, n_pns, table);
+	/* holes in the table jump to the default */
+	for (unsigned pn = 0; pn < n_pns; ++pn) {
+		ir_node *proj = new_r_Proj(switchn, mode_X, pn);
+		add_target_pred(info, old_pns[pn], proj);
 	}
 }
 
-/**
- * Block-Walker: searches for Switch nodes
- */
-static void find_switch_nodes(ir_node *block, void *ctx)
+/** Creates (1 << index) & mask tests for the entries of a small cluster. */
+static void create_bit_test_cluster(switch_info_t *info, walk_env_t *env,
+                                    ir_node *block, const cluster_t *cluster,
+                                    const double *weights,
+                                    ir_tarval *lo, ir_tarval *hi)
 {
-	walk_env_t *env = (walk_env_t*)ctx;
+	ir_node   *index = create_cluster_index(info, &block, cluster, lo, hi);
+	ir_graph  *irg   = get_irn_irg(block);
+	dbg_info  *dbgi  = get_irn_dbg_info(info->switchn);
+	ir_mode   *mode  = env->bit_test_mode;
+	ir_tarval *one   = get_mode_one(mode);
+	ir_node   *amount = new_rd_Conv(dbgi, block, index, mode_Iu);
+	ir_node   *bit    = new_rd_Shl(dbgi, block, new_r_Const(irg, one), amount);
+
+	/* collect a mask per target */
+	typedef struct bit_test_t {
+		unsigned   pn;
+		ir_tarval *mask;
+		double     weight;
+	} bit_test_t;
+	bit_test_t tests[3];
+	unsigned   n_tests  = 0;
+	uint64_t   n_values = 0;
+	for (size_t e = 0; e < cluster->n_entries; ++e) {
+		const ir_switch_table_entry *entry = &cluster->entries[e];
+		bit_test_t *test = NULL;
+		for (unsigned t = 0; t < n_tests; ++t) {
+			if (tests[t].pn == entry->pn)
+				test = &tests[t];
+		}
+		if (test == NULL) {
+			assert(n_tests < ARRAY_SIZE(tests));
+			test = &tests[n_tests++];
+			test->pn     = entry->pn;
+			test->mask   = get_mode_null(mode);
+			test->weight = 0;
+		}
+		uint64_t const first = get_distance(cluster->min, entry->min);
+		uint64_t const last  = get_distance(cluster->min, entry->max);
+		for (uint64_t b = first; b <= last; ++b)
+			test->mask = tarval_or(test->mask, tarval_shl_unsigned(one, b));
+		test->weight += weights[cluster->entries - info->entries + e];
+		n_values     += last - first + 1;
+	}
 
-	/* because we split critical blocks only blocks with 1 predecessors may
-	 * contain Proj->Cond nodes */
-	if (get_Block_n_cfgpreds(block) != 1)
-		return;
+	/* test the most likely targets first */
+	for (unsigned t = 1; t < n_tests; ++t) {
+		bit_test_t const test = tests[t];
+		unsigned         u    = t;
+		for (; u > 0 && tests[u - 1].weight < test.weight; --u)
+			tests[u] = tests[u - 1];
+		tests[u] = test;
+	}
 
-	ir_node *projx = get_Block_cfgpred(block, 0);
-	if (!is_Proj(projx))
-		return;
-	assert(get_irn_mode(projx) == mode_X);
+	bool const no_holes = n_values > get_distance(cluster->min, cluster->max);
+	for (unsigned t = 0; t < n_tests; ++t) {
+		if (no_holes && t == n_tests - 1) {
+			add_target_pred(info, tests[t].pn, new_r_Jmp(block));
+			return;
+		}
+		ir_node *mask = new_r_Const(irg, tests[t].mask);
+		ir_node *and  = new_rd_And(dbgi, block, bit, mask);
+		ir_node *zero = new_r_Const(irg, get_mode_null(mode));
+		ir_node *cmp  = new_rd_Cmp(dbgi, block, and, zero,
+		                           ir_relation_less_greater);
+		block = create_branch(info, block, cmp, tests[t].pn);
+	}
+	add_target_pred(info, pn_Switch_default, new_r_Jmp(block));
+}
 
-	ir_node *switchn = get_Proj_pred(projx);
-	if (!is_Switch(switchn))
+static void create_cluster(switch_info_t *info, walk_env_t *env, ir_node *block,
+                           const cluster_t *cluster, const double *weights,
+                           ir_tarval *lo, ir_tarval *hi)
+{
+	switch (cluster->kind) {
+	case CLUSTER_CASE: {
+		unsigned const pn  = cluster->entries[0].pn;
+		ir_node *const cmp = create_range_cmp(info, block, cluster->min,
+		                                      cluster->max, lo, hi);
+		if (cmp != NULL) {
+			block = create_branch(info, block, cmp, pn);
+			add_target_pred(info, pn_Switch_default, new_r_Jmp(block));
+		} else {
+			add_target_pred(info, pn, new_r_Jmp(block));
+		}
 		return;
-	if (!ir_nodeset_insert(&env->processed, switchn))
+	}
+	case CLUSTER_TABLE:
+		create_table_cluster(info, env, block, cluster, lo, hi);
+		return;
+	case CLUSTER_BIT_TEST:
+		create_bit_test_cluster(info, env, block, cluster, weights, lo, hi);
 		return;
+	}
+	panic("invalid cluster kind");
+}
 
-	switch_info_t info;
-	analyse_switch0(&info, switchn);
+static bool is_case_cluster(const cluster_t *cluster)
+{
+	return cluster->kind == CLUSTER_CASE;
+}
 
-	/*
-	 * Here we have: num_cases and [switch_min, switch_max] interval.
-	 * We do an if-cascade if there are too many spare numbers.
-	 */
-	ir_mode   *selector_mode = get_irn_mode(get_Switch_selector(switchn));
-	ir_tarval *spare = tarval_sub(info.switch_max, info.switch_min);
-	ir_mode   *mode  = find_unsigned_mode(selector_mode);
-	spare = tarval_convert_to(spare, mode);
-	ir_tarval *num_cases_minus_one
-		= new_tarval_from_long(info.num_cases-1, mode);
-	spare = tarval_sub(spare, num_cases_minus_one);
-	ir_tarval *spare_size = new_tarval_from_long(env->spare_size, mode);
-	bool lower_switch = info.num_cases <= env->small_switch
-		|| (tarval_cmp(spare, spare_size) & ir_relation_greater_equal);
-
-	if (!lower_switch) {
-		/* we won't decompose the switch. But we must add an out-of-bounds
-		 * check */
-		env->changed |= normalize_switch(&info, env->selector_mode);
+/**
+ * Creates a search tree over the clusters, which splits them at the point
+ * balancing the weights of both halves. Knowing that the selector is in
+ * [lo, hi] saves range checks at the leaves.
+ */
+static void create_search_tree(switch_info_t *info, walk_env_t *env,
+                               ir_node *block, cluster_t *clusters,
+                               size_t n_clusters, const double *weights,
+                               ir_tarval *lo, ir_tarval *hi)
+{
+	if (n_clusters == 0) {
+		add_target_pred(info, pn_Switch_default, new_r_Jmp(block));
+		return;
+	} else if (n_clusters == 1) {
+		create_cluster(info, env, block, &clusters[0], weights, lo, hi);
 		return;
 	}
 
+	/* few single cases: compare them in order of decreasing weight */
+	if (n_clusters <= 3 && is_case_cluster(&clusters[0])
+	    && is_case_cluster(&clusters[1])
+	    && (n_clusters == 2 || is_case_cluster(&clusters[2]))) {
+		cluster_t *order[3];
+		for (size_t c = 0; c < n_clusters; ++c) {
+			size_t u = c;
+			for (; u > 0 && order[u - 1]->weight < clusters[c].weight; --u)
+				order[u] = order[u - 1];
+			order[u] = &clusters[c];
+		}
+		for (size_t c = 0; c < n_clusters; ++c) {
+			const cluster_t *cluster = order[c];
+			ir_node *cmp = create_range_cmp(info, block, cluster->min,
+			                                cluster->max, lo, hi);
+			assert(cmp != NULL);
+			block = create_branch(info, block, cmp, cluster->entries[0].pn);
+		}
+		add_target_pred(info, pn_Switch_default, new_r_Jmp(block));
+		return;
+	}
+
+	double total = 0;
+	for (size_t c = 0; c < n_clusters; ++c)
+		total += clusters[c].weight;
+	size_t split     = 1;
+	double left      = clusters[0].weight;
+	double best_diff = fabs(2 * left - total);
+	for (size_t c = 2; c < n_clusters; ++c) {
+		left += clusters[c - 1].weight;
+		double const diff = fabs(2 * left - total);
+		if (diff < best_diff) {
+			best_diff = diff;
+			split     = c;
+		}
+	}
+
+	/* if (sel < clusters[split].min) left half else right half */
+	ir_graph  *irg      = get_irn_irg(block);
+	dbg_info  *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_node   *selector = get_Switch_selector(info->switchn);
+	ir_tarval *pivot    = clusters[split].min;
+	ir_node   *val      = new_r_Const(irg, pivot);
+	ir_node   *cmp      = new_rd_Cmp(dbgi, block, selector, val, ir_relation_less);
+	ir_node   *cond     = new_rd_Cond(dbgi, block, cmp);
+
+	ir_node *ltin[]  = { new_r_Proj(cond, mode_X, pn_Cond_true) };
+	ir_node *ltblock = new_r_Block(irg, ARRAY_SIZE(ltin), ltin);
+
+	ir_node *gein[]  = { new_r_Proj(cond, mode_X, pn_Cond_false) };
+	ir_node *geblock = new_r_Block(irg, ARRAY_SIZE(gein), gein);
+
+	ir_tarval *below = tarval_sub(pivot, get_mode_one(get_tarval_mode(pivot)));
+	create_search_tree(info, env, ltblock, clusters, split, weights, lo, below);
+	create_search_tree(info, env, geblock, clusters + split,
+	                   n_clusters - split, weights, pivot, hi);
+}
+
+/**
+ * Walker: collects Switch nodes
+ */
+static void find_switch_nodes(ir_node *node, void *ctx)
+{
+	walk_env_t *env = (walk_env_t*)ctx;
+	if (is_Switch(node))
+		ARR_APP1(ir_node*, env->switches, node);
+}
+
+/** Checks whether a block of the collected Switches has no frequency. */
+static bool lacks_execfreq(ir_node *const *const switches)
+{
+	for (size_t i = 0, n = ARR_LEN(switches); i < n; ++i) {
+		if (get_block_execfreq(get_nodes_block(switches[i])) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void lower_switch_node(walk_env_t *env, ir_node *switchn)
+{
+	switch_info_t info;
+	analyse_switch0(&info, switchn);
+
+	unsigned n_outs        = get_Switch_n_outs(switchn);
+	ir_mode *selector_mode = get_irn_mode(get_Switch_selector(switchn));
 	normalize_table(switchn, selector_mode, NULL);
 	analyse_switch1(&info);
 
-	/* Now create the if cascade */
-	env->changed  = true;
-	info.defusers = NEW_ARR_F(ir_node*, 0);
-	block         = get_nodes_block(switchn);
-	ir_switch_table *table = get_Switch_table(switchn);
-	create_if_cascade(&info, block, table->entries, table->n_entries);
+	ir_switch_table *table     = get_Switch_table(switchn);
+	size_t           n_entries = ir_switch_table_get_n_entries(table);
+	double          *weights   = compute_entry_weights(&info, table);
+	info.entries = table->entries;
+	cluster_t *clusters = partition_cases(env, table->entries, n_entries,
+	                                      weights);
 
-	/* Connect new default case users */
-	set_irn_in(info.default_block, ARR_LEN(info.defusers), info.defusers);
+	size_t n_clusters = ARR_LEN(clusters);
+	if (n_clusters == 1 && clusters[0].kind == CLUSTER_TABLE) {
+		/* we won't decompose the switch. But we must add an out-of-bounds
+		 * check */
+		env->changed |= normalize_switch(&info, env->selector_mode);
+	} else {
+		env->changed = true;
+		ir_node   *block = get_nodes_block(switchn);
+		ir_tarval *lo = get_mode_min(selector_mode);
+		ir_tarval *hi = get_mode_max(selector_mode);
+		create_search_tree(&info, env, block, clusters, n_clusters, weights,
+		                   lo, hi);
+
+		/* Connect the new control flow to the targets */
+		ir_graph *irg = get_irn_irg(switchn);
+		foreach_irn_out_r(switchn, i, proj) {
+			unsigned  pn     = get_Proj_num(proj);
+			target_t *target = &info.targets[pn];
+			/* targets without table entries become unreachable */
+			if (ARR_LEN(target->preds) == 0)
+				ARR_APP1(ir_node*, target->preds, new_r_Bad(irg, mode_X));
+			set_irn_in(target->block, ARR_LEN(target->preds), target->preds);
+			kill_node(proj);
+		}
+		kill_node(switchn);
+	}
 
-	DEL_ARR_F(info.defusers);
+	for (unsigned pn = 0; pn < n_outs; ++pn) {
+		if (info.targets[pn].preds != NULL)
+			DEL_ARR_F(info.targets[pn].preds);
+	}
+	DEL_ARR_F(clusters);
+	DEL_ARR_F(weights);
 	free(info.targets);
 }
 
@@ -444,16 +796,31 @@ void lower_switch(ir_graph *irg, unsigned small_switch, unsigned spare_size,
 
 	walk_env_t env;
 	env.selector_mode       = selector_mode;
+	env.bit_test_mode       = find_unsigned_mode(get_reference_offset_mode(mode_P));
 	env.spare_size          = spare_size;
 	env.small_switch        = small_switch;
 	env.changed             = false;
-	ir_nodeset_init(&env.processed);
+	env.switches            = NEW_ARR_F(ir_node*, 0);
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES);
+
+	/* the lowering creates new Switches, so collect the old ones first */
+	irg_walk_graph(irg, NULL, find_switch_nodes, &env);
+
+	/* Target lowering runs before the backend reads the profile or estimates
+	 * execution frequencies, so estimate them here to weight the search
+	 * trees. The estimation may remove unreachable code, collect again. */
+	if (lacks_execfreq(env.switches)) {
+		ir_estimate_execfreq(irg);
+		ARR_SHRINKLEN(env.switches, 0);
+		irg_walk_graph(irg, NULL, find_switch_nodes, &env);
+	}
 
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
 	                         | IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
-
-	irg_block_walk_graph(irg, find_switch_nodes, NULL, &env);
-	ir_nodeset_destroy(&env.processed);
+	for (size_t i = 0, n = ARR_LEN(env.switches); i < n; ++i)
+		lower_switch_node(&env, env.switches[i]);
+	DEL_ARR_F(env.switches);
 
 	confirm_irg_properties(irg, env.changed ? IR_GRAPH_PROPERTIES_NONE
 	                                        : IR_GRAPH_PROPERTIES_ALL);
@@ -0,0 +1,773 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Built-in ILP solver which needs no external library.
+ *
+ * The LP relaxations are solved by a bounded primal simplex. The constraint
+ * matrix is kept column-wise as taken from the sparse lpp matrix, the basis
+ * inverse is kept in product form (a file of eta vectors) which is rebuilt
+ * from time to time. Binary variables are handled by a depth-first branch and
+ * bound which reuses the basis of the previous node. The start values of the
+ * variables (see lpp_set_start_value()) serve as initial incumbent and as
+ * starting point of the first simplex run.
+ */
+#include "lpp_simplex.h"
+
+#include "array.h"
+#include "obst.h"
+#include "panic.h"
+#include "sp_matrix.h"
+#include "timing.h"
+#include "xmalloc.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#define EPS_PIVOT           1e-9  /**< smallest usable pivot element */
+#define EPS_FEAS            1e-7  /**< tolerance for bound violations */
+#define EPS_OPT             1e-7  /**< tolerance for reduced costs */
+#define EPS_INT             1e-6  /**< tolerance for integrality */
+#define EPS_DROP            1e-12 /**< smaller eta entries are dropped */
+#define REFACTOR_INTERVAL   100   /**< pivots before the basis is reinverted */
+#define DEGENERATE_LIMIT    50    /**< degenerate pivots before Bland's rule */
+#define TIME_CHECK_INTERVAL 32    /**< iterations between time checks */
+
+/** An elementary transformation of the basis inverse. */
+typedef struct eta_t {
+	int    row;   /**< the pivot row */
+	double pivot; /**< the pivot element */
+	int    begin; /**< first off-pivot entry in eta_index/eta_value */
+	int    end;   /**< end of the off-pivot entries */
+} eta_t;
+
+typedef enum lp_result_t {
+	lp_optimal,
+	lp_infeasible,
+	lp_unbounded,
+	lp_timeout,
+} lp_result_t;
+
+/**
+ * An LP in the form min c^T x s.t. A x + s = b, l <= (x, s) <= u.
+ * Columns 0..n_structs-1 are the lpp variables, the remaining n_rows columns
+ * are the slack variables of the constraints.
+ */
+typedef struct simplex_t {
+	lpp_t      *lpp;
+	int         n_rows;
+	int         n_structs;
+	int         n_cols;
+	int        *col_start;  /**< start of each structural column */
+	int        *row_index;  /**< row of each nonzero */
+	double     *col_value;  /**< value of each nonzero */
+	double     *cost;       /**< objective in minimization form */
+	double     *rhs;
+	double     *lower;      /**< current lower bounds */
+	double     *upper;      /**< current upper bounds */
+	double     *orig_lower; /**< bounds without branching decisions */
+	double     *orig_upper;
+	bool       *is_int;
+	double     *x;          /**< current values of all columns */
+	int        *head;       /**< the basic column of each row */
+	int        *basis_pos;  /**< row of a basic column, -1 for nonbasic */
+	eta_t      *etas;       /**< flexible array */
+	size_t      n_factor;   /**< number of etas created by refactor() */
+	int        *eta_index;  /**< flexible array */
+	double     *eta_value;  /**< flexible array */
+	double     *work;       /**< dense scratch vector */
+	double     *dual;       /**< dense scratch vector */
+	ir_timer_t *timer;
+	unsigned    iterations;
+	bool        timeout;
+} simplex_t;
+
+static bool time_exceeded(simplex_t *s)
+{
+	double limit = s->lpp->time_limit_secs;
+	if (limit > 0.0 && ir_timer_elapsed_sec(s->timer) > limit)
+		s->timeout = true;
+	return s->timeout;
+}
+
+/** Stores column @p col of [A I] into the dense vector @p v. */
+static void load_column(const simplex_t *s, int col, double *v)
+{
+	memset(v, 0, s->n_rows * sizeof(*v));
+	if (col >= s->n_structs) {
+		v[col - s->n_structs] = 1.0;
+		return;
+	}
+	for (int k = s->col_start[col]; k < s->col_start[col + 1]; ++k)
+		v[s->row_index[k]] = s->col_value[k];
+}
+
+/** Returns the scalar product of column @p col of [A I] and @p y. */
+static double dot_column(const simplex_t *s, int col, const double *y)
+{
+	if (col >= s->n_structs)
+		return y[col - s->n_structs];
+	double sum = 0.0;
+	for (int k = s->col_start[col]; k < s->col_start[col + 1]; ++k)
+		sum += s->col_value[k] * y[s->row_index[k]];
+	return sum;
+}
+
+/** Computes v := B^-1 v. */
+static void ftran(const simplex_t *s, double *v)
+{
+	for (size_t e = 0, n = ARR_LEN(s->etas); e < n; ++e) {
+		const eta_t *eta = &s->etas[e];
+		double       t   = v[eta->row];
+		if (t == 0.0)
+			continue;
+		t /= eta->pivot;
+		v[eta->row] = t;
+		for (int k = eta->begin; k < eta->end; ++k)
+			v[s->eta_index[k]] -= s->eta_value[k] * t;
+	}
+}
+
+/** Computes y^T := y^T B^-1. */
+static void btran(const simplex_t *s, double *y)
+{
+	for (size_t e = ARR_LEN(s->etas); e-- > 0;) {
+		const eta_t *eta = &s->etas[e];
+		double       t   = y[eta->row];
+		for (int k = eta->begin; k < eta->end; ++k)
+			t -= s->eta_value[k] * y[s->eta_index[k]];
+		y[eta->row] = t / eta->pivot;
+	}
+}
+
+/** Appends the eta vector for pivoting on row @p row of @p alpha. */
+static void add_eta(simplex_t *s, int row, const double *alpha)
+{
+	eta_t eta = {
+		.row   = row,
+		.pivot = alpha[row],
+		.begin = ARR_LEN(s->eta_index),
+	};
+	for (int i = 0; i < s->n_rows; ++i) {
+		if (i == row || fabs(alpha[i]) < EPS_DROP)
+			continue;
+		ARR_APP1(int, s->eta_index, i);
+		ARR_APP1(double, s->eta_value, alpha[i]);
+	}
+	eta.end = ARR_LEN(s->eta_index);
+	ARR_APP1(eta_t, s->etas, eta);
+}
+
+/** Returns the finite bound closest to @p value. */
+static double nearest_bound(const simplex_t *s, int col, double value)
+{
+	double lower = s->lower[col];
+	double upper = s->upper[col];
+	if (upper == INFINITY)
+		return lower;
+	if (lower == -INFINITY)
+		return upper;
+	return value - lower <= upper - value ? lower : upper;
+}
+
+/** Recomputes the values of the basic columns from the nonbasic ones. */
+static void compute_basic_values(simplex_t *s)
+{
+	double *v = s->work;
+	memcpy(v, s->rhs, s->n_rows * sizeof(*v));
+	for (int col = 0; col < s->n_cols; ++col) {
+		double value = s->x[col];
+		if (s->basis_pos[col] >= 0 || value == 0.0)
+			continue;
+		if (col >= s->n_structs) {
+			v[col - s->n_structs] -= value;
+			continue;
+		}
+		for (int k = s->col_start[col]; k < s->col_start[col + 1]; ++k)
+			v[s->row_index[k]] -= s->col_value[k] * value;
+	}
+	ftran(s, v);
+	for (int i = 0; i < s->n_rows; ++i)
+		s->x[s->head[i]] = v[i];
+}
+
+/**
+ * Rebuilds the eta file for the current basis. Columns which turn out to be
+ * linearly dependent are replaced by slack columns.
+ */
+static void refactor(simplex_t *s)
+{
+	int   n_rows = s->n_rows;
+	int  *old    = XMALLOCN(int, n_rows);
+	bool *keep   = XMALLOCNZ(bool, n_rows);
+	memcpy(old, s->head, n_rows * sizeof(*old));
+
+	ARR_SHRINKLEN(s->etas, 0);
+	ARR_SHRINKLEN(s->eta_index, 0);
+	ARR_SHRINKLEN(s->eta_value, 0);
+
+	/* start from the slack basis and keep the slacks which are basic */
+	for (int i = 0; i < n_rows; ++i) {
+		s->basis_pos[old[i]] = -1;
+		if (old[i] >= s->n_structs)
+			keep[old[i] - s->n_structs] = true;
+	}
+	for (int i = 0; i < n_rows; ++i)
+		s->head[i] = s->n_structs + i;
+
+	double *alpha = s->work;
+	for (int i = 0; i < n_rows; ++i) {
+		int col = old[i];
+		if (col >= s->n_structs)
+			continue;
+
+		load_column(s, col, alpha);
+		ftran(s, alpha);
+		int    row  = -1;
+		double best = EPS_PIVOT;
+		for (int r = 0; r < n_rows; ++r) {
+			if (keep[r] || s->head[r] < s->n_structs)
+				continue;
+			if (fabs(alpha[r]) > best) {
+				best = fabs(alpha[r]);
+				row  = r;
+			}
+		}
+		if (row < 0) {
+			/* singular, leave the column out of the basis */
+			s->x[col] = nearest_bound(s, col, s->x[col]);
+			continue;
+		}
+		add_eta(s, row, alpha);
+		s->head[row] = col;
+	}
+
+	for (int i = 0; i < n_rows; ++i) {
+		int col = s->head[i];
+		s->basis_pos[col] = i;
+	}
+	s->n_factor = ARR_LEN(s->etas);
+
+	free(keep);
+	free(old);
+	compute_basic_values(s);
+}
+
+/**
+ * Solves the LP for the current bounds, starting from the current basis.
+ * Infeasible starting points are handled by minimizing the sum of the bound
+ * violations first.
+ */
+static lp_result_t solve_lp(simplex_t *s)
+{
+	int     n_rows     = s->n_rows;
+	double *x          = s->x;
+	double *lower      = s->lower;
+	double *upper      = s->upper;
+	int     degenerate = 0;
+	bool    fresh      = false;
+
+	for (;;) {
+		if (ARR_LEN(s->etas) - s->n_factor >= REFACTOR_INTERVAL) {
+			refactor(s);
+			fresh = true;
+		}
+		if (s->iterations % TIME_CHECK_INTERVAL == 0 && time_exceeded(s))
+			return lp_timeout;
+
+		/* the costs of phase 1 penalize bound violations of basic columns */
+		double *y        = s->dual;
+		bool    feasible = true;
+		for (int i = 0; i < n_rows; ++i) {
+			int col = s->head[i];
+			if (x[col] < lower[col] - EPS_FEAS) {
+				y[i]     = -1.0;
+				feasible = false;
+			} else if (x[col] > upper[col] + EPS_FEAS) {
+				y[i]     = 1.0;
+				feasible = false;
+			} else {
+				y[i] = 0.0;
+			}
+		}
+		if (feasible) {
+			for (int i = 0; i < n_rows; ++i)
+				y[i] = s->cost[s->head[i]];
+		}
+		btran(s, y);
+
+		/* pricing: Dantzig's rule, Bland's rule when stalling */
+		bool   bland = degenerate > DEGENERATE_LIMIT;
+		int    enter = -1;
+		int    dir   = 0;
+		double best  = 0.0;
+		for (int col = 0; col < s->n_cols; ++col) {
+			if (s->basis_pos[col] >= 0 || lower[col] == upper[col])
+				continue;
+			double d = (feasible ? s->cost[col] : 0.0) - dot_column(s, col, y);
+			int    col_dir;
+			if (d < -EPS_OPT && x[col] < upper[col])
+				col_dir = 1;
+			else if (d > EPS_OPT && x[col] > lower[col])
+				col_dir = -1;
+			else
+				continue;
+			if (fabs(d) > best) {
+				best  = fabs(d);
+				enter = col;
+				dir   = col_dir;
+				if (bland)
+					break;
+			}
+		}
+		if (enter < 0) {
+			/* verify the result with a fresh basis inverse */
+			if (!fresh) {
+				refactor(s);
+				fresh = true;
+				continue;
+			}
+			return feasible ? lp_optimal : lp_infeasible;
+		}
+		fresh = false;
+
+		/* ratio test */
+		double *alpha = s->work;
+		load_column(s, enter, alpha);
+		ftran(s, alpha);
+		double step        = upper[enter] - lower[enter];
+		int    leave_row   = -1;
+		double leave_value = 0.0;
+		for (int i = 0; i < n_rows; ++i) {
+			double a = dir * alpha[i];
+			if (fabs(a) < EPS_PIVOT)
+				continue;
+
+			/* the basic column changes by -step * a */
+			int    col = s->head[i];
+			double bound;
+			if (a > 0.0) {
+				if (x[col] > upper[col] + EPS_FEAS)
+					bound = upper[col];
+				else if (x[col] < lower[col] - EPS_FEAS)
+					continue;
+				else
+					bound = lower[col];
+			} else {
+				if (x[col] < lower[col] - EPS_FEAS)
+					bound = lower[col];
+				else if (x[col] > upper[col] + EPS_FEAS)
+					continue;
+				else
+					bound = upper[col];
+			}
+			if (isinf(bound))
+				continue;
+
+			double limit = (x[col] - bound) / a;
+			if (limit < 0.0)
+				limit = 0.0;
+			/* prefer large pivots among ties for numerical stability */
+			if (limit < step - EPS_DROP
+			    || (leave_row >= 0 && limit <= step + EPS_DROP && !bland
+			        && fabs(alpha[i]) > fabs(alpha[leave_row]))) {
+				step        = limit;
+				leave_row   = i;
+				leave_value = bound;
+			}
+		}
+		if (leave_row < 0 && isinf(step))
+			return lp_unbounded;
+
+		++s->iterations;
+		if (step < EPS_FEAS)
+			++degenerate;
+		else
+			degenerate = 0;
+
+		x[enter] += dir * step;
+		for (int i = 0; i < n_rows; ++i)
+			x[s->head[i]] -= dir * step * alpha[i];
+
+		if (leave_row < 0) {
+			/* the entering column just moves to its other bound */
+			x[enter] = dir > 0 ? upper[enter] : lower[enter];
+			continue;
+		}
+
+		int leave = s->head[leave_row];
+		x[leave]              = leave_value;
+		s->basis_pos[leave]   = -1;
+		s->head[leave_row]    = enter;
+		s->basis_pos[enter]   = leave_row;
+		add_eta(s, leave_row, alpha);
+	}
+}
+
+static double objective_value(const simplex_t *s, const double *x)
+{
+	double sum = 0.0;
+	for (int col = 0; col < s->n_structs; ++col)
+		sum += s->cost[col] * x[col];
+	return sum;
+}
+
+/** Returns whether the structural values @p x satisfy all constraints. */
+static bool is_feasible_solution(const simplex_t *s, const double *x)
+{
+	double *activity = XMALLOCNZ(double, s->n_rows);
+	bool    feasible = true;
+	for (int col = 0; col < s->n_structs; ++col) {
+		double value = x[col];
+		if (value < s->orig_lower[col] - EPS_FEAS
+		    || value > s->orig_upper[col] + EPS_FEAS
+		    || (s->is_int[col] && fabs(value - round(value)) > EPS_INT))
+			feasible = false;
+		for (int k = s->col_start[col]; k < s->col_start[col + 1]; ++k)
+			activity[s->row_index[k]] += s->col_value[k] * value;
+	}
+	for (int i = 0; feasible && i < s->n_rows; ++i) {
+		/* the slack has to be within its bounds */
+		double slack = s->rhs[i] - activity[i];
+		int    col   = s->n_structs + i;
+		if (slack < s->orig_lower[col] - EPS_FEAS
+		    || slack > s->orig_upper[col] + EPS_FEAS)
+			feasible = false;
+	}
+	free(activity);
+	return feasible;
+}
+
+/** A node of the branch and bound tree. */
+typedef struct bb_node_t bb_node_t;
+struct bb_node_t {
+	bb_node_t *parent;
+	int        col;   /**< the column fixed by this node, -1 for the root */
+	double     value; /**< the value the column is fixed to */
+	double     bound; /**< lower bound for the objective in this subtree */
+};
+
+/** Sets the bounds of the structural columns for solving @p node. */
+static void apply_node(simplex_t *s, const bb_node_t *node)
+{
+	memcpy(s->lower, s->orig_lower, s->n_structs * sizeof(*s->lower));
+	memcpy(s->upper, s->orig_upper, s->n_structs * sizeof(*s->upper));
+	for (; node != NULL; node = node->parent) {
+		if (node->col < 0)
+			continue;
+		s->lower[node->col] = node->value;
+		s->upper[node->col] = node->value;
+	}
+	/* nonbasic columns have to be at one of their bounds */
+	for (int col = 0; col < s->n_structs; ++col) {
+		if (s->basis_pos[col] < 0)
+			s->x[col] = nearest_bound(s, col, s->x[col]);
+	}
+	compute_basic_values(s);
+}
+
+/** Returns the most fractional integer column or -1 if there is none. */
+static int select_branch_col(const simplex_t *s)
+{
+	int    branch = -1;
+	double best   = EPS_INT;
+	for (int col = 0; col < s->n_structs; ++col) {
+		if (!s->is_int[col])
+			continue;
+		double frac = s->x[col] - floor(s->x[col]);
+		double dist = frac < 0.5 ? frac : 1.0 - frac;
+		if (dist > best) {
+			best   = dist;
+			branch = col;
+		}
+	}
+	return branch;
+}
+
+static void simplex_init(simplex_t *s, lpp_t *lpp, double *start)
+{
+	sp_matrix_t *m         = lpp->m;
+	int          n_rows    = lpp->cst_next - 1;
+	int          n_structs = lpp->var_next - 1;
+	int          n_cols    = n_structs + n_rows;
+	double       sign      = lpp->opt_type == lpp_minimize ? 1.0 : -1.0;
+
+	memset(s, 0, sizeof(*s));
+	s->lpp        = lpp;
+	s->n_rows     = n_rows;
+	s->n_structs  = n_structs;
+	s->n_cols     = n_cols;
+	s->col_start  = XMALLOCN(int, n_structs + 1);
+	s->cost       = XMALLOCNZ(double, n_cols);
+	s->rhs        = XMALLOCNZ(double, n_rows);
+	s->lower      = XMALLOCN(double, n_cols);
+	s->upper      = XMALLOCN(double, n_cols);
+	s->orig_lower = XMALLOCN(double, n_cols);
+	s->orig_upper = XMALLOCN(double, n_cols);
+	s->is_int     = XMALLOCNZ(bool, n_structs);
+	s->x          = XMALLOCNZ(double, n_cols);
+	s->head       = XMALLOCN(int, n_rows);
+	s->basis_pos  = XMALLOCN(int, n_cols);
+	s->work       = XMALLOCN(double, n_rows);
+	s->dual       = XMALLOCN(double, n_rows);
+	s->etas       = NEW_ARR_F(eta_t, 0);
+	s->eta_index  = NEW_ARR_F(int, 0);
+	s->eta_value  = NEW_ARR_F(double, 0);
+
+	/* copy the constraint matrix column by column, row 0 is the objective */
+	int n_entries = matrix_get_entries(m);
+	s->row_index = XMALLOCN(int, n_entries);
+	s->col_value = XMALLOCN(double, n_entries);
+	int o = 0;
+	for (int col = 0; col < n_structs; ++col) {
+		s->col_start[col] = o;
+		matrix_foreach_in_col(m, 1 + col, elem) {
+			if (elem->row == 0) {
+				s->cost[col] = sign * elem->val;
+				continue;
+			}
+			s->row_index[o] = elem->row - 1;
+			s->col_value[o] = elem->val;
+			++o;
+		}
+	}
+	s->col_start[n_structs] = o;
+
+	matrix_foreach_in_col(m, 0, elem) {
+		if (elem->row > 0)
+			s->rhs[elem->row - 1] = elem->val;
+	}
+
+	for (int col = 0; col < n_structs; ++col) {
+		const lpp_name_t *var = lpp->vars[1 + col];
+		bool is_binary = var->type.var_type == lpp_binary;
+		s->is_int[col]     = is_binary;
+		s->orig_lower[col] = 0.0;
+		s->orig_upper[col] = is_binary ? 1.0 : INFINITY;
+		start[col]         = var->value_kind == lpp_value_start ? var->value : 0.0;
+	}
+	for (int i = 0; i < n_rows; ++i) {
+		int col = n_structs + i;
+		switch (lpp->csts[1 + i]->type.cst_type) {
+		case lpp_equal:
+			s->orig_lower[col] = 0.0;
+			s->orig_upper[col] = 0.0;
+			break;
+		case lpp_less_equal:
+			s->orig_lower[col] = 0.0;
+			s->orig_upper[col] = INFINITY;
+			break;
+		case lpp_greater_equal:
+			s->orig_lower[col] = -INFINITY;
+			s->orig_upper[col] = 0.0;
+			break;
+		default:
+			panic("invalid constraint type");
+		}
+	}
+	memcpy(s->lower, s->orig_lower, n_cols * sizeof(*s->lower));
+	memcpy(s->upper, s->orig_upper, n_cols * sizeof(*s->upper));
+
+	/* start with the slack basis and the start values as nonbasic values,
+	 * so a feasible start solution needs no phase 1 */
+	for (int col = 0; col < n_structs; ++col) {
+		s->basis_pos[col] = -1;
+		s->x[col]         = nearest_bound(s, col, start[col]);
+	}
+	for (int i = 0; i < n_rows; ++i) {
+		s->head[i]                   = n_structs + i;
+		s->basis_pos[n_structs + i]  = i;
+	}
+	compute_basic_values(s);
+}
+
+static void simplex_free(simplex_t *s)
+{
+	DEL_ARR_F(s->etas);
+	DEL_ARR_F(s->eta_index);
+	DEL_ARR_F(s->eta_value);
+	free(s->col_start);
+	free(s->row_index);
+	free(s->col_value);
+	free(s->cost);
+	free(s->rhs);
+	free(s->lower);
+	free(s->upper);
+	free(s->orig_lower);
+	free(s->orig_upper);
+	free(s->is_int);
+	free(s->x);
+	free(s->head);
+	free(s->basis_pos);
+	free(s->work);
+	free(s->dual);
+}
+
+/** Returns whether all objective coefficients are integers on integer
+ * columns and zero on continuous ones, so objective values are integral. */
+static bool has_integral_objective(const simplex_t *s)
+{
+	for (int col = 0; col < s->n_structs; ++col) {
+		double c = s->cost[col];
+		if (s->is_int[col] ? c != round(c) : c != 0.0)
+			return false;
+	}
+	return true;
+}
+
+void lpp_solve_simplex(lpp_t *lpp)
+{
+	simplex_t s;
+	double   *start = XMALLOCN(double, lpp->var_next);
+	double    fix   = matrix_get(lpp->m, 0, 0);
+	double    sign  = lpp->opt_type == lpp_minimize ? 1.0 : -1.0;
+	simplex_init(&s, lpp, start);
+	lpp_free_matrix(lpp);
+
+	s.timer = ir_timer_new();
+	ir_timer_start(s.timer);
+
+	if (lpp->log != NULL) {
+		fprintf(lpp->log, "simplex: %d rows, %d columns, %d nonzeros\n",
+		        s.n_rows, s.n_structs, s.col_start[s.n_structs]);
+	}
+
+	/* the start values are the first incumbent if they are feasible */
+	double *best     = XMALLOCN(double, s.n_structs);
+	double  best_obj = INFINITY;
+	if (is_feasible_solution(&s, start)) {
+		memcpy(best, start, s.n_structs * sizeof(*best));
+		best_obj = objective_value(&s, best);
+		if (lpp->log != NULL)
+			fprintf(lpp->log, "simplex: start solution %g\n", sign * best_obj + fix);
+	}
+
+	/* a user supplied bound is reached by any solution as good as it */
+	double target = -INFINITY;
+	if (lpp->set_bound)
+		target = sign * lpp->bound;
+	bool integral = has_integral_objective(&s);
+
+	struct obstack obst;
+	obstack_init(&obst);
+	bb_node_t **stack = NEW_ARR_F(bb_node_t*, 0);
+	bb_node_t  *root  = OALLOC(&obst, bb_node_t);
+	root->parent = NULL;
+	root->col    = -1;
+	root->value  = 0.0;
+	root->bound  = -INFINITY;
+	ARR_APP1(bb_node_t*, stack, root);
+
+	unsigned n_nodes   = 0;
+	bool     unbounded = false;
+	bool     finished  = true;
+	while (ARR_LEN(stack) > 0) {
+		/* the open subtrees may still contain better solutions */
+		if (best_obj <= target + EPS_FEAS) {
+			finished = false;
+			break;
+		}
+		if (time_exceeded(&s)) {
+			finished = false;
+			break;
+		}
+
+		size_t     n_open = ARR_LEN(stack);
+		bb_node_t *node   = stack[n_open - 1];
+		ARR_SHRINKLEN(stack, n_open - 1);
+
+		/* only subtrees which can improve the incumbent are explored */
+		double cutoff = INFINITY;
+		if (best_obj < INFINITY) {
+			cutoff = integral ? best_obj - 1.0 + EPS_INT
+			                  : best_obj - EPS_INT * fmax(1.0, fabs(best_obj));
+		}
+		if (node->bound > cutoff)
+			continue;
+
+		++n_nodes;
+		apply_node(&s, node);
+		lp_result_t res = solve_lp(&s);
+		if (res == lp_timeout) {
+			ARR_APP1(bb_node_t*, stack, node);
+			finished = false;
+			break;
+		} else if (res == lp_unbounded) {
+			unbounded = true;
+			break;
+		} else if (res == lp_infeasible) {
+			continue;
+		}
+
+		double obj = objective_value(&s, s.x);
+		if (obj > cutoff)
+			continue;
+
+		int col = select_branch_col(&s);
+		if (col < 0) {
+			for (int c = 0; c < s.n_structs; ++c)
+				best[c] = s.is_int[c] ? round(s.x[c]) : s.x[c];
+			best_obj = objective_value(&s, best);
+			if (lpp->log != NULL) {
+				fprintf(lpp->log, "simplex: solution %g at node %u\n",
+				        sign * best_obj + fix, n_nodes);
+			}
+			continue;
+		}
+
+		/* explore the branch towards the start value (or the rounded LP
+		 * value) first, so it is pushed last */
+		double first = s.x[col] >= 0.5 ? 1.0 : 0.0;
+		if (lpp->vars[1 + col]->value_kind == lpp_value_start)
+			first = start[col] >= 0.5 ? 1.0 : 0.0;
+		for (int i = 0; i < 2; ++i) {
+			bb_node_t *child = OALLOC(&obst, bb_node_t);
+			child->parent = node;
+			child->col    = col;
+			child->value  = i == 0 ? 1.0 - first : first;
+			child->bound  = obj;
+			ARR_APP1(bb_node_t*, stack, child);
+		}
+	}
+
+	/* the best bound is the weakest bound of the unexplored subtrees */
+	double bound = best_obj;
+	if (!finished) {
+		for (size_t i = 0, n = ARR_LEN(stack); i < n; ++i) {
+			if (stack[i]->bound < bound)
+				bound = stack[i]->bound;
+		}
+	}
+
+	if (unbounded) {
+		lpp->sol_state = lpp_inforunb;
+	} else if (best_obj < INFINITY) {
+		lpp->sol_state = finished ? lpp_optimal : lpp_feasible;
+		for (int col = 0; col < s.n_structs; ++col) {
+			lpp->vars[1 + col]->value      = best[col];
+			lpp->vars[1 + col]->value_kind = lpp_value_solution;
+		}
+		lpp->objval     = sign * best_obj + fix;
+		lpp->best_bound = sign * bound + fix;
+	} else {
+		lpp->sol_state = finished ? lpp_infeasible : lpp_unknown;
+	}
+
+	ir_timer_stop(s.timer);
+	lpp->iterations = s.iterations;
+	lpp->sol_time   = ir_timer_elapsed_sec(s.timer);
+	if (lpp->log != NULL) {
+		fprintf(lpp->log, "simplex: %u nodes, %u iterations, %.2f sec\n",
+		        n_nodes, s.iterations, lpp->sol_time);
+	}
+
+	ir_timer_free(s.timer);
+	DEL_ARR_F(stack);
+	obstack_free(&obst, NULL);
+	free(best);
+	free(start);
+	simplex_free(&s);
+}
@@ -0,0 +1,17 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Built-in ILP solver which needs no external library.
+ */
+#ifndef LPP_SIMPLEX_H
+#define LPP_SIMPLEX_H
+
+#include "lpp.h"
+
+void lpp_solve_simplex(lpp_t *lpp);
+
+#endif
@@ -11,6 +11,7 @@
 
 #include "lpp_cplex.h"
 #include "lpp_gurobi.h"
+#include "lpp_simplex.h"
 #include "util.h"
 
 typedef struct lpp_solver_t {
@@ -26,6 +27,7 @@ static lpp_solver_t const lpp_solvers[] = {
 #ifdef WITH_GUROBI
 	{ lpp_solve_gurobi,  "gurobi",  1 },
 #endif
+	{ lpp_solve_simplex, "simplex", 1 },
 	{ NULL,              NULL,      0 }
 };
 
@@ -0,0 +1,207 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Promotion of indirect calls to guarded direct calls based on
+ *          value profiles.
+ *
+ * An indirect call, whose profiled callee is mostly the same function, is
+ * rewritten into
+ *
+ *   if (ptr == hot_target) hot_target(...); else ptr(...);
+ *
+ * so the hot target is called directly and may be inlined.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprofile.h"
+#include "typerep.h"
+#include "util.h"
+
+/** Minimum share of the executions of a call site a target must have. */
+#define MIN_TARGET_PERCENT 30
+/** Maximum number of targets promoted per call site. */
+#define MAX_PROMOTED_TARGETS 2
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/**
+ * Walker, collects the indirect calls with value profile.
+ */
+static void collect_indirect_calls(ir_node *node, void *data)
+{
+	if (!is_Call(node) || is_Address(get_Call_ptr(node)))
+		return;
+	/* No control flow may leave the call except by falling through. */
+	if (ir_throws_exception(node))
+		return;
+	ir_type *const type = get_Call_type(node);
+	if (get_method_additional_properties(type) & mtp_property_noreturn)
+		return;
+	if (ir_profile_get_value_profile(node) == NULL)
+		return;
+
+	ir_node ***const calls = (ir_node***)data;
+	ARR_APP1(ir_node*, *calls, node);
+}
+
+/**
+ * Returns true if values of type @p a are passed like values of type @p b.
+ */
+static bool is_compatible_type(ir_type *const a, ir_type *const b)
+{
+	if (a == b)
+		return true;
+	ir_mode *const mode = get_type_mode(a);
+	return mode != NULL && mode == get_type_mode(b);
+}
+
+/**
+ * Returns true if @p target can be called with the call type of @p call.
+ */
+static bool is_compatible_target(ir_node const *const call, ir_entity *const target)
+{
+	ir_type *const call_type   = get_Call_type(call);
+	ir_type *const target_type = get_entity_type(target);
+	size_t   const n_params    = get_method_n_params(call_type);
+	size_t   const n_ress      = get_method_n_ress(call_type);
+	if (!is_Method_type(target_type)
+	    || n_params != get_method_n_params(target_type)
+	    || n_ress != get_method_n_ress(target_type)
+	    || is_method_variadic(call_type) != is_method_variadic(target_type))
+		return false;
+
+	for (size_t i = 0; i < n_params; ++i) {
+		if (!is_compatible_type(get_method_param_type(call_type, i), get_method_param_type(target_type, i)))
+			return false;
+	}
+	for (size_t i = 0; i < n_ress; ++i) {
+		if (!is_compatible_type(get_method_res_type(call_type, i), get_method_res_type(target_type, i)))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Moves node and all its Projs into block.
+ */
+static void move_with_projs(ir_node *const node, ir_node *const block)
+{
+	set_nodes_block(node, block);
+	if (get_irn_mode(node) != mode_T)
+		return;
+
+	foreach_out_edge(node, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (is_Proj(proj))
+			move_with_projs(proj, block);
+	}
+}
+
+/**
+ * Merges the results of the indirect and the direct call in block.
+ */
+static void merge_results(ir_node *const block, ir_node *const indirect, ir_node *const direct)
+{
+	foreach_out_edge_safe(indirect, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (!is_Proj(proj))
+			continue;
+
+		ir_mode *const mode  = get_irn_mode(proj);
+		ir_node *const dproj = new_r_Proj(direct, mode, get_Proj_num(proj));
+		if (mode == mode_T) {
+			merge_results(block, proj, dproj);
+			continue;
+		}
+
+		ir_node *const ins[] = { dproj, proj };
+		ir_node *const phi   = new_r_Phi(block, ARRAY_SIZE(ins), ins, mode);
+		edges_reroute_except(proj, phi, phi);
+	}
+}
+
+/**
+ * Guards a direct call of @p target by a comparison with the callee of the
+ * indirect @p call. Afterwards call is in the block of the failing guard.
+ */
+static void promote_call(ir_node *const call, ir_entity *const target, uint32_t const count)
+{
+	ir_graph *const irg   = get_irn_irg(call);
+	ir_node  *const lower = part_block_edges(call);
+	ir_node  *const upper = get_nodes_block(call);
+
+	ir_node *const callee         = new_r_Address(irg, target);
+	ir_node *const cmp            = new_r_Cmp(upper, get_Call_ptr(call), callee, ir_relation_equal);
+	ir_node *const cond           = new_r_Cond(upper, cmp);
+	ir_node *const proj_true      = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *const proj_false     = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ir_node *const direct_block   = new_r_Block(irg, 1, &proj_true);
+	ir_node *const indirect_block = new_r_Block(irg, 1, &proj_false);
+
+	move_with_projs(call, indirect_block);
+	ir_node *const direct = exact_copy(call);
+	set_nodes_block(direct, direct_block);
+	set_Call_ptr(direct, callee);
+
+	ir_node *const lower_in[] = { new_r_Jmp(direct_block), new_r_Jmp(indirect_block) };
+	set_irn_in(lower, ARRAY_SIZE(lower_in), lower_in);
+	merge_results(lower, call, direct);
+
+	/* The lower block keeps the id and thus the count of the original block,
+	 * the new blocks need counts as they were not instrumented. */
+	uint32_t const block_count  = ir_profile_get_block_execcount(lower);
+	uint32_t const direct_count = MIN(count, block_count);
+	ir_profile_set_block_execcount(upper, block_count);
+	ir_profile_set_block_execcount(direct_block, direct_count);
+	ir_profile_set_block_execcount(indirect_block, block_count - direct_count);
+
+	DB((dbg, LEVEL_2, "promoted %+F to call %s\n", call, get_entity_ld_name(target)));
+}
+
+void promote_indirect_calls(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.call_promotion");
+
+	ir_node **calls = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, NULL, collect_indirect_calls, &calls);
+
+	bool changed = false;
+	if (ARR_LEN(calls) > 0) {
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+
+		for (size_t i = 0, n = ARR_LEN(calls); i < n; ++i) {
+			ir_node                  *const call = calls[i];
+			ir_value_profile_t const *const vp   = ir_profile_get_value_profile(call);
+
+			unsigned n_promoted = 0;
+			for (unsigned e = 0; e < vp->n_entries; ++e) {
+				ir_value_profile_entry_t const *const entry = &vp->entries[e];
+				/* entries are sorted by count */
+				if ((uint64_t)entry->count * 100 < (uint64_t)vp->total * MIN_TARGET_PERCENT)
+					break;
+				if (entry->target == NULL || !is_compatible_target(call, entry->target))
+					continue;
+
+				promote_call(call, entry->target, entry->count);
+				changed = true;
+				if (++n_promoted == MAX_PROMOTED_TARGETS)
+					break;
+			}
+		}
+	}
+	DEL_ARR_F(calls);
+
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,582 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 Karlsruhe Institute of Technology
+ */
+
+/**
+ * @file
+ * @brief   Identical code folding.
+ *
+ * Functions are grouped by a structural hash of their graphs, equivalence
+ * within a group is confirmed by walking both graphs in lockstep. Local
+ * entities of the frame are matched by their position, a recursive call of
+ * one function matches the corresponding call of the other.
+ *
+ * A duplicate is removed if its address cannot be compared with the address
+ * of the remaining function: References are redirected and an externally
+ * visible duplicate is replaced by an alias. Otherwise it becomes a thunk
+ * calling the remaining function, calls to it are still redirected.
+ */
+#include "array.h"
+#include "cgana.h"
+#include "callgraph.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "hashptr.h"
+#include "ircons.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irop_t.h"
+#include "iroptimize.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "platform_t.h"
+#include "pset_new.h"
+#include "statev_t.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+typedef struct function_t {
+	ir_graph *irg;
+	unsigned  hash;
+	unsigned  n_nodes;
+	bool      folded;
+} function_t;
+
+typedef struct compare_env_t {
+	ir_graph  *irg_a;
+	ir_graph  *irg_b;
+	ir_node  **stack;  /**< pairs of nodes still to compare */
+} compare_env_t;
+
+typedef struct fold_env_t {
+	pset_new_t thunks;  /**< entities replaced by thunks */
+	unsigned   n_redirected;
+	unsigned   n_aliases;
+	unsigned   n_thunks;
+} fold_env_t;
+
+static bool is_candidate(fold_env_t *const env, ir_graph *const irg)
+{
+	ir_entity *const entity = get_irg_entity(irg);
+	return !pset_new_contains(&env->thunks, entity)
+	    && !(get_entity_linkage(entity) & (IR_LINKAGE_NO_CODEGEN | IR_LINKAGE_WEAK))
+	    && !irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION)
+	    && is_segment_type(get_entity_owner(entity))
+	    && get_entity_n_overwrites(entity) == 0
+	    && get_entity_n_overwrittenby(entity) == 0;
+}
+
+/**
+ * Returns the position of a local entity of the frame of @p irg or -1.
+ */
+static long get_frame_position(ir_graph *const irg, ir_entity const *const entity)
+{
+	ir_type *const frame = get_irg_frame_type(irg);
+	if (get_entity_owner(entity) != frame)
+		return -1;
+	return (long)get_compound_member_index(frame, entity);
+}
+
+static unsigned hash_entity(ir_graph *const irg, ir_entity const *const entity)
+{
+	if (entity == get_irg_entity(irg))
+		return 1;
+	long const pos = get_frame_position(irg, entity);
+	return pos >= 0 ? (unsigned)pos + 2 : hash_ptr(entity);
+}
+
+static void hash_node(ir_node *node, void *data)
+{
+	function_t *const function = (function_t*)data;
+	unsigned          hash     = get_irn_opcode(node);
+	hash = hash_combine(hash, hash_ptr(get_irn_mode(node)));
+	hash = hash_combine(hash, get_irn_arity(node));
+
+	ir_graph *const irg = function->irg;
+	switch (get_irn_opcode(node)) {
+	case iro_Address:
+	case iro_Offset:
+		hash = hash_combine(hash, hash_entity(irg, get_irn_entity_attr(node)));
+		break;
+	case iro_Member:
+		hash = hash_combine(hash, hash_entity(irg, get_Member_entity(node)));
+		break;
+	case iro_Const:
+		hash = hash_combine(hash, hash_ptr(get_Const_tarval(node)));
+		break;
+	case iro_Proj:
+		hash = hash_combine(hash, get_Proj_num(node));
+		break;
+	case iro_Call:
+		hash = hash_combine(hash, hash_ptr(get_Call_type(node)));
+		break;
+	case iro_Cmp:
+		hash = hash_combine(hash, get_Cmp_relation(node));
+		break;
+	default:
+		break;
+	}
+	function->hash = hash_combine(function->hash, hash);
+	++function->n_nodes;
+}
+
+static int cmp_function(void const *const p1, void const *const p2)
+{
+	function_t const *const f1 = (function_t const*)p1;
+	function_t const *const f2 = (function_t const*)p2;
+	if (f1->hash != f2->hash)
+		return f1->hash < f2->hash ? -1 : 1;
+	if (f1->n_nodes != f2->n_nodes)
+		return f1->n_nodes < f2->n_nodes ? -1 : 1;
+	return 0;
+}
+
+/**
+ * Returns true if both entities of method type are called the same way.
+ */
+static bool equal_signatures(ir_entity const *const a, ir_entity const *const b)
+{
+	ir_type *const type_a = get_entity_type(a);
+	ir_type *const type_b = get_entity_type(b);
+	if (get_entity_additional_properties(a) != get_entity_additional_properties(b))
+		return false;
+	if (type_a == type_b)
+		return true;
+
+	size_t const n_params = get_method_n_params(type_a);
+	size_t const n_ress   = get_method_n_ress(type_a);
+	if (n_params != get_method_n_params(type_b)
+	 || n_ress != get_method_n_ress(type_b)
+	 || is_method_variadic(type_a) != is_method_variadic(type_b)
+	 || get_method_calling_convention(type_a) != get_method_calling_convention(type_b))
+		return false;
+	for (size_t i = 0; i < n_params; ++i) {
+		if (get_method_param_type(type_a, i) != get_method_param_type(type_b, i))
+			return false;
+	}
+	for (size_t i = 0; i < n_ress; ++i) {
+		if (get_method_res_type(type_a, i) != get_method_res_type(type_b, i))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Returns true if the local entities of both frames correspond by position.
+ */
+static bool equal_frames(ir_graph *const irg_a, ir_graph *const irg_b)
+{
+	ir_type *const frame_a = get_irg_frame_type(irg_a);
+	ir_type *const frame_b = get_irg_frame_type(irg_b);
+	size_t   const n       = get_compound_n_members(frame_a);
+	if (n != get_compound_n_members(frame_b))
+		return false;
+
+	for (size_t i = 0; i < n; ++i) {
+		ir_entity *const a = get_compound_member(frame_a, i);
+		ir_entity *const b = get_compound_member(frame_b, i);
+		if (get_entity_kind(a) != get_entity_kind(b)
+		 || get_entity_type(a) != get_entity_type(b)
+		 || get_entity_alignment(a) != get_entity_alignment(b))
+			return false;
+		if (is_parameter_entity(a)
+		 && get_entity_parameter_number(a) != get_entity_parameter_number(b))
+			return false;
+	}
+	return true;
+}
+
+static bool equal_entities(compare_env_t const *const env,
+                           ir_entity const *const a, ir_entity const *const b)
+{
+	if (a == get_irg_entity(env->irg_a))
+		return b == a || b == get_irg_entity(env->irg_b);
+	long const pos = get_frame_position(env->irg_a, a);
+	if (pos >= 0)
+		return pos == get_frame_position(env->irg_b, b);
+	return a == b;
+}
+
+static bool equal_switch_tables(ir_node const *const a, ir_node const *const b)
+{
+	ir_switch_table const *const table_a = get_Switch_table(a);
+	ir_switch_table const *const table_b = get_Switch_table(b);
+	size_t                 const n       = ir_switch_table_get_n_entries(table_a);
+	if (get_Switch_n_outs(a) != get_Switch_n_outs(b)
+	 || n != ir_switch_table_get_n_entries(table_b))
+		return false;
+	for (size_t i = 0; i < n; ++i) {
+		if (ir_switch_table_get_min(table_a, i) != ir_switch_table_get_min(table_b, i)
+		 || ir_switch_table_get_max(table_a, i) != ir_switch_table_get_max(table_b, i)
+		 || ir_switch_table_get_pn(table_a, i) != ir_switch_table_get_pn(table_b, i))
+			return false;
+	}
+	return true;
+}
+
+static bool equal_nodes(compare_env_t const *const env, ir_node *const a,
+                        ir_node *const b)
+{
+	if (get_irn_op(a) != get_irn_op(b)
+	 || get_irn_mode(a) != get_irn_mode(b)
+	 || get_irn_arity(a) != get_irn_arity(b)
+	 || get_irn_pinned(a) != get_irn_pinned(b))
+		return false;
+	if (is_fragile_op(a) && ir_throws_exception(a) != ir_throws_exception(b))
+		return false;
+
+	switch (get_irn_opcode(a)) {
+	case iro_Block:
+		/* labels may be referenced from outside */
+		return get_Block_entity(a) == NULL && get_Block_entity(b) == NULL;
+	case iro_Address:
+	case iro_Offset:
+		return equal_entities(env, get_irn_entity_attr(a), get_irn_entity_attr(b));
+	case iro_Member:
+		return equal_entities(env, get_Member_entity(a), get_Member_entity(b));
+	case iro_Cond:
+		return get_Cond_jmp_pred(a) == get_Cond_jmp_pred(b);
+	case iro_Switch:
+		return equal_switch_tables(a, b);
+	default:
+		return get_irn_op(a)->ops.attrs_equal(a, b);
+	}
+}
+
+static ir_node *pop_node(compare_env_t *const env)
+{
+	size_t   const n    = ARR_LEN(env->stack) - 1;
+	ir_node *const node = env->stack[n];
+	ARR_SHRINKLEN(env->stack, n);
+	return node;
+}
+
+static void push_pair(compare_env_t *const env, ir_node *const a, ir_node *const b)
+{
+	ARR_APP1(ir_node*, env->stack, a);
+	ARR_APP1(ir_node*, env->stack, b);
+}
+
+/**
+ * Walks both graphs in lockstep from their End nodes and checks that the
+ * reached nodes correspond one to one.
+ */
+static bool equal_graphs(compare_env_t *const env)
+{
+	ir_graph *const irg_a = env->irg_a;
+	ir_graph *const irg_b = env->irg_b;
+	if (!equal_signatures(get_irg_entity(irg_a), get_irg_entity(irg_b))
+	 || !equal_frames(irg_a, irg_b))
+		return false;
+
+	ir_reserve_resources(irg_a, IR_RESOURCE_IRN_LINK);
+	ir_reserve_resources(irg_b, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg_a, firm_clear_link, NULL, NULL);
+	irg_walk_graph(irg_b, firm_clear_link, NULL, NULL);
+
+	bool equal = true;
+	ARR_RESIZE(ir_node*, env->stack, 0);
+	push_pair(env, get_irg_end(irg_a), get_irg_end(irg_b));
+	while (ARR_LEN(env->stack) > 0) {
+		ir_node *const b = pop_node(env);
+		ir_node *const a = pop_node(env);
+		ir_node *const link_a = (ir_node*)get_irn_link(a);
+		ir_node *const link_b = (ir_node*)get_irn_link(b);
+		if (link_a != NULL || link_b != NULL) {
+			if (link_a != b || link_b != a) {
+				equal = false;
+				break;
+			}
+			continue;
+		}
+		if (!equal_nodes(env, a, b)) {
+			equal = false;
+			break;
+		}
+		set_irn_link(a, b);
+		set_irn_link(b, a);
+
+		if (!is_Block(a))
+			push_pair(env, get_nodes_block(a), get_nodes_block(b));
+		foreach_irn_in(a, i, pred) {
+			push_pair(env, pred, get_irn_n(b, i));
+		}
+	}
+
+	ir_free_resources(irg_b, IR_RESOURCE_IRN_LINK);
+	ir_free_resources(irg_a, IR_RESOURCE_IRN_LINK);
+	return equal;
+}
+
+/**
+ * Returns true if the address of @p entity may be compared with others.
+ */
+static bool has_identity(ir_entity const *const entity)
+{
+	return (get_entity_usage(entity) & ir_usage_address_taken)
+	    && !(get_entity_linkage(entity) & IR_LINKAGE_NO_IDENTITY);
+}
+
+static bool can_alias(ir_entity const *const dup, ir_entity const *const canon)
+{
+	ir_linkage const comdat = IR_LINKAGE_MERGE | IR_LINKAGE_GARBAGE_COLLECT;
+	return ir_platform.object_format == OBJECT_FORMAT_ELF
+	    && !(get_entity_linkage(dup) & comdat)
+	    && !(get_entity_linkage(canon) & comdat);
+}
+
+static bool can_thunk(ir_entity const *const entity)
+{
+	ir_type *const type = get_entity_type(entity);
+	if (is_method_variadic(type))
+		return false;
+	for (size_t i = 0, n = get_method_n_params(type); i < n; ++i) {
+		if (get_type_mode(get_method_param_type(type, i)) == NULL)
+			return false;
+	}
+	for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i) {
+		if (get_type_mode(get_method_res_type(type, i)) == NULL)
+			return false;
+	}
+	return true;
+}
+
+typedef struct redirect_env_t {
+	ir_entity *from;
+	ir_entity *to;
+	bool       calls_only;
+} redirect_env_t;
+
+static void redirect_node(ir_node *node, void *data)
+{
+	redirect_env_t const *const env = (redirect_env_t const*)data;
+	if (env->calls_only) {
+		if (!is_Call(node))
+			return;
+		ir_node *const ptr = get_Call_ptr(node);
+		if (is_Address(ptr) && get_Address_entity(ptr) == env->from)
+			set_Call_ptr(node, new_r_Address(get_irn_irg(node), env->to));
+	} else if (is_Address(node) && get_Address_entity(node) == env->from) {
+		set_Address_entity(node, env->to);
+	}
+}
+
+static void redirect_initializer(ir_initializer_t *const initializer,
+                                 redirect_env_t *const env)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_CONST:
+		irg_walk(get_initializer_const_value(initializer), redirect_node, NULL, env);
+		return;
+	case IR_INITIALIZER_TARVAL:
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_COMPOUND:
+		for (size_t i = 0, n = get_initializer_compound_n_entries(initializer); i < n; ++i)
+			redirect_initializer(get_initializer_compound_value(initializer, i), env);
+		return;
+	}
+	panic("invalid initializer found");
+}
+
+/**
+ * Redirects the references to @p from to @p to. If @p calls_only is set,
+ * only calls are redirected.
+ */
+static void redirect_references(ir_entity *const from, ir_entity *const to,
+                                bool const calls_only)
+{
+	redirect_env_t env = { .from = from, .to = to, .calls_only = calls_only };
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, redirect_node, NULL, &env);
+	}
+	if (calls_only)
+		return;
+
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i < n; ++i) {
+			ir_entity *const entity = get_compound_member(segment, i);
+			if (get_entity_kind(entity) == IR_ENTITY_ALIAS
+			 && get_entity_alias(entity) == from)
+				set_entity_alias(entity, to);
+			if (get_entity_kind(entity) != IR_ENTITY_NORMAL)
+				continue;
+			ir_initializer_t *const initializer = get_entity_initializer(entity);
+			if (initializer != NULL)
+				redirect_initializer(initializer, &env);
+		}
+	}
+}
+
+/**
+ * Replaces the graph of @p entity by a call of @p target.
+ */
+static void create_thunk(ir_entity *const entity, ir_entity *const target)
+{
+	ir_type  *const type  = get_entity_type(entity);
+	size_t    const n_in  = get_method_n_params(type);
+	size_t    const n_res = get_method_n_ress(type);
+	ir_graph *const irg   = new_ir_graph(entity, 0);
+	ir_node  *const block = get_r_cur_block(irg);
+	ir_node  *const args  = get_irg_args(irg);
+
+	ir_node **const in = ALLOCAN(ir_node*, n_in);
+	for (size_t i = 0; i < n_in; ++i)
+		in[i] = new_r_Proj(args, get_type_mode(get_method_param_type(type, i)), i);
+
+	dbg_info *const dbgi   = get_entity_dbg_info(entity);
+	ir_node  *const callee = new_r_Address(irg, target);
+	ir_node  *const call   = new_rd_Call(dbgi, block, get_irg_initial_mem(irg), callee, n_in, in, get_entity_type(target));
+	ir_node  *const mem    = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node  *const ress   = new_r_Proj(call, mode_T, pn_Call_T_result);
+
+	ir_node **const res = ALLOCAN(ir_node*, n_res);
+	for (size_t i = 0; i < n_res; ++i)
+		res[i] = new_r_Proj(ress, get_type_mode(get_method_res_type(type, i)), i);
+
+	ir_node *const ret = new_rd_Return(dbgi, block, mem, n_res, res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	mature_immBlock(block);
+	irg_finalize_cons(irg);
+}
+
+/**
+ * Replaces the function @p dup by the identical function @p canon.
+ */
+static void fold_function(ir_graph *const dup, ir_graph *const canon,
+                          fold_env_t *const fenv)
+{
+	ir_entity *const dup_entity   = get_irg_entity(dup);
+	ir_entity *const canon_entity = get_irg_entity(canon);
+
+	if (!has_identity(dup_entity) || !has_identity(canon_entity)) {
+		if (!entity_is_externally_visible(dup_entity)) {
+			DB((dbg, LEVEL_2, "redirect %+F to %+F\n", dup_entity, canon_entity));
+			redirect_references(dup_entity, canon_entity, false);
+			free_ir_graph(dup);
+			free_entity(dup_entity);
+			++fenv->n_redirected;
+			return;
+		}
+		if (can_alias(dup_entity, canon_entity)) {
+			DB((dbg, LEVEL_2, "alias %+F to %+F\n", dup_entity, canon_entity));
+			ir_type      *const owner      = get_entity_owner(dup_entity);
+			ident        *const id         = get_entity_ident(dup_entity);
+			ident        *const ld_id      = get_entity_ld_ident(dup_entity);
+			ir_type      *const type       = get_entity_type(dup_entity);
+			ir_visibility const visibility = get_entity_visibility(dup_entity);
+			ir_linkage    const linkage    = get_entity_linkage(dup_entity);
+			dbg_info     *const dbgi       = get_entity_dbg_info(dup_entity);
+			redirect_references(dup_entity, canon_entity, false);
+			free_ir_graph(dup);
+			/* the alias takes over the name, so the duplicate has to go first */
+			free_entity(dup_entity);
+			ir_entity *const alias = new_alias_entity(owner, id, canon_entity,
+			                                          type, visibility);
+			set_entity_ld_ident(alias, ld_id);
+			add_entity_linkage(alias, linkage);
+			set_entity_dbg_info(alias, dbgi);
+			++fenv->n_aliases;
+			return;
+		}
+	}
+
+	DB((dbg, LEVEL_2, "replace %+F by thunk to %+F\n", dup_entity, canon_entity));
+	redirect_references(dup_entity, canon_entity, true);
+	free_ir_graph(dup);
+	create_thunk(dup_entity, canon_entity);
+	pset_new_insert(&fenv->thunks, dup_entity);
+	++fenv->n_thunks;
+}
+
+static bool can_fold(ir_graph *const dup, ir_graph *const canon)
+{
+	if (dup == get_irp_main_irg())
+		return false;
+	ir_entity *const dup_entity   = get_irg_entity(dup);
+	ir_entity *const canon_entity = get_irg_entity(canon);
+	if (!has_identity(dup_entity) || !has_identity(canon_entity)) {
+		if (!entity_is_externally_visible(dup_entity)
+		 || can_alias(dup_entity, canon_entity))
+			return true;
+	}
+	return can_thunk(dup_entity);
+}
+
+/**
+ * Performs one round of folding, returns the number of folded functions.
+ */
+static unsigned fold_round(fold_env_t *const fenv)
+{
+	function_t *functions = NEW_ARR_F(function_t, 0);
+	foreach_irp_irg(i, irg) {
+		if (!is_candidate(fenv, irg))
+			continue;
+		function_t function = { .irg = irg };
+		irg_walk_graph(irg, NULL, hash_node, &function);
+		ARR_APP1(function_t, functions, function);
+	}
+	size_t const n = ARR_LEN(functions);
+	QSORT_ARR(functions, cmp_function);
+
+	unsigned      n_folded = 0;
+	compare_env_t env      = { .stack = NEW_ARR_F(ir_node*, 0) };
+	for (size_t i = 0; i < n; ++i) {
+		function_t *const canon = &functions[i];
+		if (canon->folded)
+			continue;
+		for (size_t j = i + 1; j < n && cmp_function(canon, &functions[j]) == 0; ++j) {
+			function_t *const dup = &functions[j];
+			if (dup->folded)
+				continue;
+			env.irg_a = canon->irg;
+			env.irg_b = dup->irg;
+			if (!equal_graphs(&env) || !can_fold(dup->irg, canon->irg))
+				continue;
+
+			if (n_folded++ == 0) {
+				free_irp_callee_info();
+				if (get_irp_callgraph_state() != irp_callgraph_none)
+					free_callgraph();
+			}
+			fold_function(dup->irg, canon->irg, fenv);
+			dup->folded = true;
+		}
+	}
+	DEL_ARR_F(env.stack);
+	DEL_ARR_F(functions);
+	return n_folded;
+}
+
+void fold_identical_functions(void)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.icf");
+
+	stat_ev_ull("icf_functions", get_irp_n_irgs());
+
+	/* Folding makes callers of different functions identical, so repeat
+	 * until nothing changes. */
+	fold_env_t env = { .n_redirected = 0 };
+	pset_new_init(&env.thunks);
+	for (;;) {
+		assure_irp_globals_entity_usage_computed();
+		unsigned const n_folded = fold_round(&env);
+		set_irp_globals_entity_usage_state(ir_entity_usage_not_computed);
+		if (n_folded == 0)
+			break;
+	}
+
+	DB((dbg, LEVEL_1, "folded %u functions: %u redirected, %u aliases, %u thunks\n",
+	    env.n_redirected + env.n_aliases + env.n_thunks,
+	    env.n_redirected, env.n_aliases, env.n_thunks));
+	stat_ev_ull("icf_redirected", env.n_redirected);
+	stat_ev_ull("icf_aliases", env.n_aliases);
+	stat_ev_ull("icf_thunks", env.n_thunks);
+	pset_new_destroy(&env.thunks);
+}
@@ -1002,6 +1002,17 @@ static ir_tarval *computed_value_Proj(const ir_node *proj)
 	return tarval_unknown;
 }
 
+/**
+ * Returns true if @p n computes on vector values. The local optimizations
+ * assume scalar operands, so these nodes are only subject to CSE.
+ */
+static bool is_vector_node(const ir_node *n)
+{
+	if (is_Cmp(n))
+		return mode_is_vector(get_irn_mode(get_Cmp_left(n)));
+	return mode_is_vector(get_irn_mode(n));
+}
+
 /**
  * If the parameter n can be computed, return its value, else tarval_unknown.
  * Performs constant folding.
@@ -1010,6 +1021,9 @@ static ir_tarval *computed_value_Proj(const ir_node *proj)
  */
 ir_tarval *computed_value(const ir_node *n)
 {
+	if (is_vector_node(n))
+		return tarval_unknown;
+
 	const vrp_attr *vrp = vrp_get_info(n);
 	if (vrp != NULL && vrp->bits_set == vrp->bits_not_set)
 		return vrp->bits_set;
@@ -1760,6 +1774,8 @@ static ir_node *equivalent_node_Confirm(ir_node *n)
  */
 ir_node *equivalent_node(ir_node *n)
 {
+	if (is_vector_node(n))
+		return n;
 	if (n->op->ops.equivalent_node)
 		return n->op->ops.equivalent_node(n);
 	return n;
@@ -7596,6 +7612,8 @@ static ir_node *transform_node(ir_node *n)
 restart:;
 	ir_node  *old_n = n;
 	unsigned  iro   = get_irn_opcode_(n);
+	if (is_vector_node(n))
+		return n;
 	/* constant expression evaluation / constant folding */
 	if (get_opt_constant_folding()) {
 		/* neither constants nor Tuple values can be evaluated */
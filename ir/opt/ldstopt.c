@@ -20,7 +20,8 @@
 #include "irgraph_t.h"
 #include "irgwalk.h"
 #include "irhooks.h"
-#include "irmemory.h"
+#include "irmemory_t.h"
+#include "irmemssa.h"
 #include "irmode_t.h"
 #include "irnode_t.h"
 #include "irnodehashmap.h"
@@ -95,6 +96,8 @@ typedef struct block_info_t {
 
 /** the master visited flag for loop detection. */
 static unsigned master_visited;
+/** alias classes to skip unrelated parts of memory chains */
+static memssa_t *memssa;
 
 #define INC_MASTER()       ++master_visited
 #define MARK_NODE(info)    (info)->visited = master_visited
@@ -378,6 +381,9 @@ static bool is_contained_in(ir_mode *const load_mode, const base_offset_t *const
 	/* simple case: previous value has the same mode */
 	if (load_mode == prev_mode)
 		return true;
+	/* lanes of vector values cannot be extracted with bitops */
+	if (mode_is_vector(load_mode) || mode_is_vector(prev_mode))
+		return false;
 
 	ir_mode_arithmetic prev_arithmetic = get_mode_arithmetic(prev_mode);
 	ir_mode_arithmetic load_arithmetic = get_mode_arithmetic(load_mode);
@@ -633,6 +639,7 @@ static changes_t follow_load_mem_chain(track_load_env_t *env, ir_node *start)
 	ir_node  *load      = env->load;
 	ir_type  *load_type = get_Load_type(load);
 	unsigned  load_size = get_mode_size_bytes(get_Load_mode(load));
+	unsigned  cls       = memssa_get_class(memssa, load);
 
 	ir_node   *node = start;
 	changes_t  res  = NO_CHANGES;
@@ -656,14 +663,14 @@ static changes_t follow_load_mem_chain(track_load_env_t *env, ir_node *start)
 			/* if the might be an alias, we cannot pass this Store */
 			if (rel != ir_no_alias)
 				break;
-			node = skip_Proj(get_Store_mem(node));
+			node = memssa_skip(memssa, get_Store_mem(node), cls);
 		} else if (is_Load(node)) {
 			/* try load-after-load */
 			changes_t changes = try_load_after_load(env, node);
 			if (changes != NO_CHANGES)
 				return changes | res;
 			/* we can skip any load */
-			node = skip_Proj(get_Load_mem(node));
+			node = memssa_skip(memssa, get_Load_mem(node), cls);
 		} else if (is_CopyB(node)) {
 			/*
 			 * We cannot replace the Load with another
@@ -696,9 +703,9 @@ static changes_t follow_load_mem_chain(track_load_env_t *env, ir_node *start)
 			/* possible alias => we cannot continue */
 			if (rel != ir_no_alias)
 				break;
-			node = skip_Proj(get_CopyB_mem(node));
+			node = memssa_skip(memssa, get_CopyB_mem(node), cls);
 		} else if (is_irn_const_memory(node)) {
-			node = skip_Proj(get_memop_mem(node));
+			node = memssa_skip(memssa, get_memop_mem(node), cls);
 		} else {
 			/* be conservative about any other node and assume aliasing
 			 * that changes the loaded value */
@@ -714,7 +721,7 @@ static changes_t follow_load_mem_chain(track_load_env_t *env, ir_node *start)
 	if (is_Sync(node)) {
 		/* handle all Sync predecessors */
 		foreach_irn_in(node, i, in) {
-			ir_node *skipped = skip_Proj(in);
+			ir_node *skipped = memssa_skip(memssa, in, cls);
 			res |= follow_load_mem_chain(env, skipped);
 			if ((res & ~NODES_CREATED) != NO_CHANGES)
 				break;
@@ -839,7 +846,8 @@ static changes_t optimize_load(ir_node *load)
 	 */
 	INC_MASTER();
 	env.load = load;
-	res = follow_load_mem_chain(&env, skip_Proj(mem));
+	unsigned const cls = memssa_get_class(memssa, load);
+	res = follow_load_mem_chain(&env, memssa_skip(memssa, mem, cls));
 	return res;
 }
 
@@ -874,6 +882,7 @@ static changes_t follow_store_mem_chain(ir_node *store, ir_node *start,
 	ir_type     *type  = get_Store_type(store);
 	unsigned     size  = get_mode_size_bytes(get_irn_mode(value));
 	ir_node     *block = get_nodes_block(store);
+	unsigned     cls   = memssa_get_class(memssa, store);
 
 	ir_node *node = start;
 	while (node != store) {
@@ -967,7 +976,7 @@ static changes_t follow_store_mem_chain(ir_node *store, ir_node *start,
 			/* if the might be an alias, we cannot pass this Store */
 			if (rel != ir_no_alias)
 				break;
-			node = skip_Proj(get_Store_mem(node));
+			node = memssa_skip(memssa, get_Store_mem(node), cls);
 		} else if (is_Load(node)) {
 			ir_node           *load_ptr  = get_Load_ptr(node);
 			ir_type           *load_type = get_Load_type(node);
@@ -978,7 +987,7 @@ static changes_t follow_store_mem_chain(ir_node *store, ir_node *start,
 			if (rel != ir_no_alias)
 				break;
 
-			node = skip_Proj(get_Load_mem(node));
+			node = memssa_skip(memssa, get_Load_mem(node), cls);
 		} else if (is_CopyB(node)) {
 			ir_node           *copyb_src  = get_CopyB_src(node);
 			ir_type           *copyb_type = get_CopyB_type(node);
@@ -1008,7 +1017,7 @@ static changes_t follow_store_mem_chain(ir_node *store, ir_node *start,
 	if (is_Sync(node)) {
 		/* handle all Sync predecessors */
 		foreach_irn_in(node, i, in) {
-			ir_node *skipped = skip_Proj(in);
+			ir_node *skipped = memssa_skip(memssa, in, cls);
 			res |= follow_store_mem_chain(store, skipped, true);
 			if (res != NO_CHANGES)
 				break;
@@ -1038,7 +1047,8 @@ static changes_t optimize_store(ir_node *store)
 	/* follow the memory chain as long as there are only Loads */
 	INC_MASTER();
 
-	return follow_store_mem_chain(store, skip_Proj(mem), false);
+	unsigned const cls = memssa_get_class(memssa, store);
+	return follow_store_mem_chain(store, memssa_skip(memssa, mem, cls), false);
 }
 
 /**
@@ -1394,8 +1404,10 @@ static changes_t optimize_phi(ir_node *phi, walk_env_t *wenv)
 	ir_node *phiD = new_r_Phi(phi_block, n, inD, mode);
 
 	/* fourth step: create the Store */
+	unsigned const cls = memssa_get_class(memssa, store);
 	store = new_r_Store(phi_block, phiM, ptr, phiD, type, cons);
 	projM = new_r_Proj(store, mode_M, pn_Store_M);
+	memssa_add_access(memssa, store, cls);
 
 	/* rewire memory and kill the old nodes */
 	for (int i = n; i-- > 0; ) {
@@ -2322,15 +2334,22 @@ void optimize_load_store(ir_graph *irg)
 	irg_walk_graph(irg, firm_clear_link, collect_nodes, &env);
 
 	/* now we have collected enough information, optimize */
+	assure_irg_alias_cache(irg);
+	memssa = memssa_new(irg);
 	irg_walk_graph(irg, NULL, do_load_store_optimize, &env);
+	memssa_free(memssa);
+	memssa = NULL;
+	free_irg_alias_cache(irg);
 
 	/* optimize_load can introduce dead stores. They are
-	 * eliminated now. */
+	 * eliminated now. Entity usage changes, so start a new alias cache. */
 	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
 	assure_irg_entity_usage_computed(irg);
+	assure_irg_alias_cache(irg);
 	irg_walk_graph(irg, NULL, do_eliminate_dead_stores, &env);
 
 	env.changes |= optimize_loops(irg);
+	free_irg_alias_cache(irg);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 
 	obstack_free(&env.obst, NULL);
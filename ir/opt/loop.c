@@ -6,7 +6,7 @@
 /**
  * @file
  * @author   Christian Helmer
- * @brief    loop inversion and loop unrolling
+ * @brief    loop inversion, loop unrolling and loop unswitching
  *
  */
 
@@ -25,8 +25,10 @@
 #include "iroptimize.h"
 #include "irouts.h"
 #include "irtools.h"
+#include "lcssa_t.h"
 #include "opt_init.h"
 #include "panic.h"
+#include "tv.h"
 #include "util.h"
 #include <math.h>
 #include <stdbool.h>
@@ -90,6 +92,8 @@ typedef struct loop_stats_t {
 	unsigned constant_unroll;
 	unsigned invariant_unroll;
 
+	unsigned unswitched;
+
 	unsigned unhandled;
 } loop_stats_t;
 
@@ -114,6 +118,7 @@ static void print_stats(void)
 	DB((dbg, LEVEL_2, "u_simple_counting :   %d\n", stats.u_simple_counting_loop));
 	DB((dbg, LEVEL_2, "constant_unroll   :   %d\n", stats.constant_unroll));
 	DB((dbg, LEVEL_2, "invariant_unroll  :   %d\n", stats.invariant_unroll));
+	DB((dbg, LEVEL_2, "unswitched        :   %d\n", stats.unswitched));
 	DB((dbg, LEVEL_2, "=======================================\n"));
 }
 
@@ -131,6 +136,8 @@ typedef struct loop_opt_params_t {
 	bool     allow_const_unrolling;
 	bool     allow_invar_unrolling;
 	unsigned invar_unrolling_min_size;  /* [nodes] */
+
+	unsigned max_unswitch_rounds; /* Unswitchings of a loop nest [number] */
 } loop_opt_params_t;
 
 static loop_opt_params_t opt_params;
@@ -188,7 +195,8 @@ static struct obstack obst;
 typedef enum loop_op_t {
 	loop_op_inversion,
 	loop_op_unrolling,
-	loop_op_peeling
+	loop_op_peeling,
+	loop_op_unswitching
 } loop_op_t;
 
 /* Returns the maximum nodes for the given nest depth */
@@ -2223,6 +2231,373 @@ static void unroll_loop(ir_graph *const irg)
 	}
 }
 
+/***** Unswitching *****/
+
+/* Maximum depth of an invariant condition computed inside the loop. */
+#define MAX_INVARIANT_DEPTH 8
+
+/* Kinds of branches on loop invariant conditions. */
+typedef enum unswitch_kind_t {
+	unswitch_cond,   /* Cond on an invariant condition */
+	unswitch_and,    /* Cond on And(invariant, other) */
+	unswitch_or,     /* Cond on Or(invariant, other) */
+	unswitch_switch, /* Switch on an invariant selector, one entry is hoisted */
+} unswitch_kind_t;
+
+typedef struct unswitch_candidate_t {
+	unswitch_kind_t kind;
+	ir_node        *branch;    /* the Cond or Switch */
+	ir_node        *invariant; /* the invariant condition or selector */
+	ir_node        *other;     /* the operand of And/Or depending on the loop */
+	size_t          entry;     /* the hoisted Switch table entry */
+} unswitch_candidate_t;
+
+/* Returns true if node is computed from loop invariant values only. */
+static bool is_invariant_expr(ir_node *const node, unsigned const depth)
+{
+	if (!is_in_loop(node))
+		return true;
+
+	ir_mode *const mode = get_irn_mode(node);
+	if (depth >= MAX_INVARIANT_DEPTH || is_Phi(node) || get_irn_pinned(node)
+	    || mode == mode_T || mode == mode_M)
+		return false;
+
+	foreach_irn_in(node, i, pred) {
+		if (!is_invariant_expr(pred, depth + 1))
+			return false;
+	}
+	return true;
+}
+
+/* Returns true if node is a loop invariant condition worth unswitching. */
+static bool is_unswitch_condition(ir_node *const node)
+{
+	return !is_Const(node) && is_invariant_expr(node, 0);
+}
+
+/* Checks if the Cond or Switch branch is unswitchable and fills cand.
+ * Conds on completely invariant conditions are preferred. */
+static bool check_unswitch_branch(ir_node *const branch, unswitch_candidate_t *const cand)
+{
+	if (is_Switch(branch)) {
+		ir_node *const selector = get_Switch_selector(branch);
+		if (!is_unswitch_condition(selector))
+			return false;
+
+		ir_switch_table const *const table = get_Switch_table(branch);
+		for (size_t e = 0, n = ir_switch_table_get_n_entries(table); e < n; ++e) {
+			ir_switch_table_entry const *const entry = ir_switch_table_get_entry_const(table, e);
+			if (entry->pn == pn_Switch_default || entry->min == NULL)
+				continue;
+			*cand = (unswitch_candidate_t) {
+				.kind      = unswitch_switch,
+				.branch    = branch,
+				.invariant = selector,
+				.entry     = e,
+			};
+			return true;
+		}
+		return false;
+	}
+
+	ir_node *const selector = get_Cond_selector(branch);
+	if (is_unswitch_condition(selector)) {
+		*cand = (unswitch_candidate_t) {
+			.kind      = unswitch_cond,
+			.branch    = branch,
+			.invariant = selector,
+		};
+		return true;
+	}
+
+	/* Partially invariant condition. */
+	if (!is_And(selector) && !is_Or(selector))
+		return false;
+	ir_node *const left  = get_binop_left(selector);
+	ir_node *const right = get_binop_right(selector);
+	ir_node       *invariant;
+	ir_node       *other;
+	if (is_unswitch_condition(left)) {
+		invariant = left;
+		other     = right;
+	} else if (is_unswitch_condition(right)) {
+		invariant = right;
+		other     = left;
+	} else {
+		return false;
+	}
+	*cand = (unswitch_candidate_t) {
+		.kind      = is_And(selector) ? unswitch_and : unswitch_or,
+		.branch    = branch,
+		.invariant = invariant,
+		.other     = other,
+	};
+	return true;
+}
+
+/* Searches the loop for a branch on a loop invariant condition. */
+static bool find_unswitch_candidate(unswitch_candidate_t *const cand)
+{
+	bool found = false;
+	for (size_t i = 0, n = get_loop_n_elements(cur_loop); i < n; ++i) {
+		loop_element const element = get_loop_element(cur_loop, i);
+		if (*element.kind != k_ir_node)
+			continue;
+
+		foreach_out_edge(element.node, edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			if (!is_Cond(node) && !is_Switch(node))
+				continue;
+
+			unswitch_candidate_t c;
+			if (!check_unswitch_branch(node, &c))
+				continue;
+			if (c.kind == unswitch_cond) {
+				*cand = c;
+				return true;
+			}
+			if (!found) {
+				*cand = c;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+/* Copies the invariant expression node into block. */
+static ir_node *copy_invariant_expr(ir_node *const node, ir_node *const block)
+{
+	if (!is_in_loop(node))
+		return node;
+
+	ir_node *const cp = exact_copy(node);
+	set_nodes_block(cp, block);
+	foreach_irn_in(node, i, pred) {
+		set_irn_n(cp, i, copy_invariant_expr(pred, block));
+	}
+	return cp;
+}
+
+/* Creates the condition selecting the original loop in the guard block. */
+static ir_node *create_unswitch_guard(unswitch_candidate_t const *const cand, ir_node *const block)
+{
+	ir_node *const invariant = copy_invariant_expr(cand->invariant, block);
+	if (cand->kind != unswitch_switch)
+		return invariant;
+
+	ir_graph                    *const irg   = get_irn_irg(block);
+	ir_switch_table const       *const table = get_Switch_table(cand->branch);
+	ir_switch_table_entry const *const entry = ir_switch_table_get_entry_const(table, cand->entry);
+	if (entry->min == entry->max) {
+		ir_node *const value = new_r_Const(irg, entry->min);
+		return new_r_Cmp(block, invariant, value, ir_relation_equal);
+	}
+
+	/* (selector - min) <= (max - min) as unsigned comparison */
+	ir_mode   *const umode = find_unsigned_mode(get_irn_mode(invariant));
+	ir_tarval *const min   = tarval_convert_to(entry->min, umode);
+	ir_tarval *const max   = tarval_convert_to(entry->max, umode);
+	ir_node   *const conv  = new_r_Conv(block, invariant, umode);
+	ir_node   *const sub   = new_r_Sub(block, conv, new_r_Const(irg, min));
+	ir_node   *const range = new_r_Const(irg, tarval_sub(max, min));
+	return new_r_Cmp(block, sub, range, ir_relation_less_equal);
+}
+
+/* Replaces the branch by a Jmp to the target of pn. */
+static void fold_branch(ir_node *const branch, unsigned const pn)
+{
+	ir_graph *const irg   = get_irn_irg(branch);
+	ir_node  *const block = get_nodes_block(branch);
+	foreach_out_edge_safe(branch, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (get_Proj_num(proj) == pn) {
+			exchange(proj, new_r_Jmp(block));
+		} else {
+			exchange(proj, new_r_Bad(irg, mode_X));
+		}
+	}
+}
+
+/* Removes the hoisted entry from the table of the Switch copy. */
+static void remove_switch_entry(ir_node *const sw, size_t const removed)
+{
+	ir_graph              *const irg   = get_irn_irg(sw);
+	ir_switch_table const *const table = get_Switch_table(sw);
+	size_t                 const n     = ir_switch_table_get_n_entries(table);
+	ir_switch_table       *const res   = ir_new_switch_table(irg, n - 1);
+	unsigned               const pn    = ir_switch_table_get_pn(table, removed);
+
+	bool   pn_used = false;
+	size_t r       = 0;
+	for (size_t e = 0; e < n; ++e) {
+		if (e == removed)
+			continue;
+		ir_switch_table_entry const *const entry = ir_switch_table_get_entry_const(table, e);
+		ir_switch_table_set(res, r++, entry->min, entry->max, entry->pn);
+		pn_used |= entry->pn == pn;
+	}
+	set_Switch_table(sw, res);
+
+	if (pn_used)
+		return;
+	foreach_out_edge_safe(sw, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (get_Proj_num(proj) == pn)
+			exchange(proj, new_r_Bad(irg, mode_X));
+	}
+}
+
+/* Specializes the branch of the original loop, which is entered if the
+ * guard holds, and its copy in the other loop. */
+static void specialize_unswitched_branches(unswitch_candidate_t const *const cand)
+{
+	ir_node *const branch = cand->branch;
+	ir_node *const copy   = get_inversion_copy(branch);
+	switch (cand->kind) {
+	case unswitch_cond:
+		fold_branch(branch, pn_Cond_true);
+		fold_branch(copy,   pn_Cond_false);
+		return;
+	case unswitch_and:
+		set_Cond_selector(branch, cand->other);
+		fold_branch(copy, pn_Cond_false);
+		return;
+	case unswitch_or: {
+		ir_node *const other_cp = get_inversion_copy(cand->other);
+		fold_branch(branch, pn_Cond_true);
+		set_Cond_selector(copy, other_cp != NULL ? other_cp : cand->other);
+		return;
+	}
+	case unswitch_switch: {
+		ir_switch_table const *const table = get_Switch_table(branch);
+		fold_branch(branch, ir_switch_table_get_pn(table, cand->entry));
+		remove_switch_entry(copy, cand->entry);
+		return;
+	}
+	}
+	panic("invalid unswitch kind");
+}
+
+/* Returns true if all edges leaving the loop are control flow edges,
+ * Phis on these edges or keep-alives, as in LCSSA form. */
+static bool check_unswitch_exits(void)
+{
+	for (size_t i = 0, n = ARR_LEN(loop_entries); i < n; ++i) {
+		entry_edge const *const entry = &loop_entries[i];
+		ir_node          *const node  = entry->node;
+		if (is_Block(node) || is_End(node))
+			continue;
+		if (!is_Phi(node)
+		    || !is_in_loop(get_Block_cfgpred(get_nodes_block(node), entry->pos)))
+			return false;
+	}
+	return true;
+}
+
+/* Adds the exits of the loop copy to the exit blocks and their Phis. */
+static void connect_unswitched_exits(ir_graph *const irg)
+{
+	for (size_t i = 0, n = ARR_LEN(loop_entries); i < n; ++i) {
+		entry_edge const *const entry = &loop_entries[i];
+		ir_node          *const node  = entry->node;
+		ir_node          *const cp    = get_inversion_copy(entry->pred);
+		if (is_End(node)) {
+			add_End_keepalive(get_irg_end(irg), cp);
+		} else if (is_Block(node)) {
+			for_each_phi(node, phi) {
+				ir_node *const pred    = get_Phi_pred(phi, entry->pos);
+				ir_node *const pred_cp = get_inversion_copy(pred);
+				extend_irn(phi, pred_cp != NULL ? pred_cp : pred, false);
+			}
+			extend_irn(node, cp, false);
+		}
+	}
+}
+
+/* Hoists a branch on a loop invariant condition out of the loop by creating
+ * a copy of the loop. The original loop is entered if the condition holds,
+ * the copy otherwise:
+ *
+ *         guard              guard
+ *           |               /     \
+ *         loop      =>   loop     loop'
+ *           |               \     /
+ *          exit              exit
+ */
+static void unswitch_loop(ir_graph *const irg)
+{
+	/* Depth of 0 is the procedure and 1 a topmost loop. */
+	int const loop_depth = get_loop_depth(cur_loop) - 1;
+	if (loop_info.nodes == 0 || loop_info.cf_outs == 0)
+		return;
+	if (loop_info.nodes > get_max_nodes_adapted(loop_depth)) {
+		DB((dbg, LEVEL_1, "Nodes %d > allowed nodes (depth %d adapted)\n",
+		    loop_info.nodes, loop_depth));
+		++stats.too_large_adapted;
+		return;
+	}
+
+	/* The loop must have a single entry edge. */
+	int entry_pos = -1;
+	for (int i = 0, n = get_Block_n_cfgpreds(loop_head); i < n; ++i) {
+		if (is_in_loop(get_Block_cfgpred(loop_head, i)))
+			continue;
+		if (entry_pos >= 0)
+			return;
+		entry_pos = i;
+	}
+	if (entry_pos < 0)
+		return;
+
+	unswitch_candidate_t cand;
+	if (!find_unswitch_candidate(&cand))
+		return;
+
+	loop_entries = NEW_ARR_F(entry_edge, 0);
+	irg_walk_graph(irg, get_loop_entries, NULL, NULL);
+	if (!check_unswitch_exits()) {
+		DB((dbg, LEVEL_2, "Loop is not in LCSSA form\n"));
+		DEL_ARR_F(loop_entries);
+		return;
+	}
+
+	DB((dbg, LEVEL_2, "Unswitch %+F in loop with head %N\n", cand.branch, loop_head));
+
+	/* Copy the whole loop. */
+	ir_nodemap_init(&map, irg);
+	obstack_init(&obst);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	inc_irg_visited(irg);
+	for (size_t i = 0, n = ARR_LEN(loop_entries); i < n; ++i)
+		copy_walk(loop_entries[i].pred, is_in_loop, cur_loop);
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+
+	/* Select the loop version in front of the loop. */
+	ir_node *const entry_pred = get_Block_cfgpred(loop_head, entry_pos);
+	ir_node *const guard_ins[] = { entry_pred };
+	ir_node *const guard_block = new_r_Block(irg, ARRAY_SIZE(guard_ins), guard_ins);
+	ir_node *const guard       = create_unswitch_guard(&cand, guard_block);
+	ir_node *const cond        = new_r_Cond(guard_block, guard);
+	ir_node *const proj_true   = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *const proj_false  = new_r_Proj(cond, mode_X, pn_Cond_false);
+	set_Block_cfgpred(loop_head, entry_pos, proj_true);
+	set_Block_cfgpred(get_inversion_copy(loop_head), entry_pos, proj_false);
+
+	connect_unswitched_exits(irg);
+	specialize_unswitched_branches(&cand);
+
+	++stats.unswitched;
+
+	DEL_ARR_F(loop_entries);
+	obstack_free(&obst, NULL);
+	ir_nodemap_destroy(&map);
+
+	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+	                   | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+}
+
 /* Analyzes the loop, and checks if size is within allowed range.
  * Decides if loop will be processed. */
 static void init_analyze(ir_graph *const irg, ir_loop *const loop, loop_op_t const loop_op)
@@ -2254,8 +2629,9 @@ static void init_analyze(ir_graph *const irg, ir_loop *const loop, loop_op_t con
 	}
 
 	switch (loop_op) {
-		case loop_op_inversion: loop_inversion(irg); break;
-		case loop_op_unrolling: unroll_loop(irg);    break;
+		case loop_op_inversion:   loop_inversion(irg); break;
+		case loop_op_unrolling:   unroll_loop(irg);    break;
+		case loop_op_unswitching: unswitch_loop(irg);  break;
 		default: panic("loop optimization not implemented");
 	}
 	DB((dbg, LEVEL_1, "       <<<< end of loop with node %ld >>>>\n", get_loop_loop_nr(loop)));
@@ -2290,6 +2666,7 @@ static void set_loop_params(void)
 	opt_params.invar_unrolling_min_size =   20;
 	opt_params.max_unrolled_loop_size   =  400;
 	opt_params.max_branches             = 9999;
+	opt_params.max_unswitch_rounds      =    3;
 }
 
 /**
@@ -2371,6 +2748,23 @@ void do_loop_peeling(ir_graph *const irg)
 	loop_optimization(irg, loop_op_peeling);
 }
 
+void do_loop_unswitching(ir_graph *const irg)
+{
+	set_loop_params();
+
+	/* Every round unswitches each innermost loop at most once, so the
+	 * versions created in a round are unswitched on nested conditions in the
+	 * next one. */
+	for (unsigned i = 0; i < opt_params.max_unswitch_rounds; ++i) {
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		                         | IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
+		assure_lcssa(irg);
+		loop_optimization(irg, loop_op_unswitching);
+		if (stats.unswitched == 0)
+			break;
+	}
+}
+
 void firm_init_loop_opt(void)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.opt.loop");
@@ -0,0 +1,607 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 Karlsruhe Institute of Technology
+ */
+
+/**
+ * @file
+ * @brief   Promotion of loop invariant memory locations to registers.
+ *
+ * Loads and Stores of an innermost loop, whose address is loop invariant,
+ * are promoted if get_alias_relation() shows that all other memory
+ * operations of the loop access different memory. The location is loaded
+ * once in the preheader, the value is kept in SSA values inside of the loop
+ * and it is stored on the loop exits, if the loop contains a Store to it:
+ *
+ *   preheader:  v0 = Load(p)
+ *   loop:       v1 = Phi(v0, v2)  ...  v2 = v1 + x
+ *   exit:       Store(p, v1)
+ *
+ * The Load in the preheader must not trap if the loop did not access the
+ * location, so either the address is the address of an entity or one of the
+ * accesses is executed whenever the loop is left. A location, which is
+ * written, is only promoted if one of its Stores is executed whenever the loop
+ * is left, so the Stores on the exits never write memory the program did not
+ * write and thus cannot introduce a data race.
+ */
+#include "lcssa_t.h"
+
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "irdom.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irouts_t.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+/** Maximum depth of a loop invariant address computation inside the loop. */
+#define MAX_ADDRESS_DEPTH 8
+
+typedef struct promotion_t {
+	ir_node  *ptr;
+	ir_mode  *mode;
+	ir_type  *type;
+	ir_node  *first;     /**< the first access, provides debug info */
+	unsigned  vnum;      /**< value number for the SSA construction */
+	bool      has_store;
+	bool      unaligned;
+	bool      invalid;
+} promotion_t;
+
+typedef struct access_t {
+	ir_node *node;
+	ir_node *ptr;
+	ir_type *type;
+	unsigned size;
+	bool     is_write;
+	size_t   promotion;  /**< index of the promotion or SIZE_MAX */
+} access_t;
+
+typedef struct exit_t {
+	ir_node  *block;     /**< the block outside of the loop */
+	int       pos;       /**< the predecessor inside of the loop */
+	ir_node **mem_phis;  /**< memory Phis of the block */
+} exit_t;
+
+typedef struct loop_env_t {
+	ir_loop     *loop;
+	ir_node     *header;
+	ir_node     *preheader;
+	int          entry_pos;
+	ir_node     *mem_phi;
+	exit_t      *exits;
+	access_t    *accesses;
+	promotion_t *promotions;
+} loop_env_t;
+
+static bool is_in_loop(loop_env_t const *const env, ir_node const *const block)
+{
+	return get_irn_loop(block) == env->loop;
+}
+
+/**
+ * Checks whether @p node is loop invariant. Floating nodes count as invariant
+ * if their operands are, they are moved to the preheader when they are used
+ * there.
+ */
+static bool is_invariant(loop_env_t const *const env, ir_node *const node,
+                         unsigned const depth)
+{
+	if (!is_in_loop(env, get_nodes_block(node)))
+		return true;
+	if (depth > MAX_ADDRESS_DEPTH || is_Phi(node) || get_irn_pinned(node)
+	 || get_irn_mode(node) == mode_T)
+		return false;
+	foreach_irn_in(node, i, pred) {
+		if (!is_invariant(env, pred, depth + 1))
+			return false;
+	}
+	return true;
+}
+
+static void move_to_preheader(loop_env_t const *const env, ir_node *const node)
+{
+	if (!is_in_loop(env, get_nodes_block(node)))
+		return;
+	set_nodes_block(node, env->preheader);
+	foreach_irn_in(node, i, pred) {
+		move_to_preheader(env, pred);
+	}
+}
+
+/** Checks whether @p ptr is the address of an entity, which can be read. */
+static bool is_entity_address(ir_graph *const irg, ir_node *ptr)
+{
+	while (is_Member(ptr))
+		ptr = get_Member_ptr(ptr);
+	if (ptr == get_irg_frame(irg))
+		return true;
+	if (!is_Address(ptr))
+		return false;
+	ir_entity const *const entity = get_Address_entity(ptr);
+	return !(get_entity_linkage(entity) & IR_LINKAGE_WEAK);
+}
+
+static promotion_t *find_promotion(loop_env_t *const env, ir_node *const ptr,
+                                   size_t *const index)
+{
+	for (size_t i = 0, n = ARR_LEN(env->promotions); i < n; ++i) {
+		if (env->promotions[i].ptr == ptr) {
+			*index = i;
+			return &env->promotions[i];
+		}
+	}
+	promotion_t const promotion = { .ptr = ptr };
+	*index = ARR_LEN(env->promotions);
+	ARR_APP1(promotion_t, env->promotions, promotion);
+	return &env->promotions[*index];
+}
+
+static void add_access(loop_env_t *const env, ir_node *const node,
+                       ir_node *const ptr, ir_type *const type,
+                       unsigned const size, bool const is_write)
+{
+	access_t const access = {
+		.node      = node,
+		.ptr       = ptr,
+		.type      = type,
+		.size      = size,
+		.is_write  = is_write,
+		.promotion = SIZE_MAX,
+	};
+	ARR_APP1(access_t, env->accesses, access);
+}
+
+/**
+ * Records a Load or Store and adds it to the promotion of its address if it
+ * is a candidate.
+ */
+static void add_load_store(loop_env_t *const env, ir_node *const node)
+{
+	bool      const is_store = is_Store(node);
+	ir_node  *const ptr      = is_store ? get_Store_ptr(node) : get_Load_ptr(node);
+	ir_type  *const type     = is_store ? get_Store_type(node) : get_Load_type(node);
+	ir_mode  *const mode     = is_store ? get_irn_mode(get_Store_value(node))
+	                                    : get_Load_mode(node);
+	add_access(env, node, ptr, type, get_mode_size_bytes(mode), is_store);
+
+	ir_volatility const volatility = is_store ? get_Store_volatility(node)
+	                                          : get_Load_volatility(node);
+	if (volatility == volatility_is_volatile || ir_throws_exception(node)
+	 || !is_invariant(env, ptr, 0))
+		return;
+
+	size_t       index;
+	promotion_t *promotion = find_promotion(env, ptr, &index);
+	if (promotion->mode == NULL) {
+		promotion->mode  = mode;
+		promotion->type  = type;
+		promotion->first = node;
+	} else if (promotion->mode != mode) {
+		promotion->invalid = true;
+	}
+	ir_align const align = is_store ? get_Store_unaligned(node)
+	                                : get_Load_unaligned(node);
+	promotion->unaligned |= align == align_non_aligned;
+	promotion->has_store |= is_store;
+	env->accesses[ARR_LEN(env->accesses) - 1].promotion = index;
+}
+
+/**
+ * Checks that memory defined in the loop is only used by memory Phis on the
+ * loop exits, so the exit Stores can be ordered before all later accesses.
+ */
+static bool check_memory_users(loop_env_t const *const env, ir_node *const node)
+{
+	for (unsigned i = 0, n = get_irn_n_outs(node); i < n; ++i) {
+		int            pos;
+		ir_node *const user = get_irn_out_ex(node, i, &pos);
+		if (is_End(user))
+			continue;
+		ir_node *const block = get_nodes_block(user);
+		if (is_in_loop(env, block))
+			continue;
+		if (!is_Phi(user) || !is_in_loop(env, get_Block_cfgpred_block(block, pos)))
+			return false;
+	}
+	return true;
+}
+
+static bool collect_block(loop_env_t *const env, ir_node *const block)
+{
+	foreach_irn_out_r(block, i, node) {
+		if (is_Block(node) || get_nodes_block(node) != block)
+			continue;
+		if (get_irn_mode(node) == mode_M && !check_memory_users(env, node))
+			return false;
+		switch (get_irn_opcode(node)) {
+		case iro_Load:
+		case iro_Store:
+			add_load_store(env, node);
+			continue;
+		case iro_CopyB: {
+			ir_type *const type = get_CopyB_type(node);
+			unsigned const size = get_type_size(type);
+			add_access(env, node, get_CopyB_src(node), type, size, false);
+			add_access(env, node, get_CopyB_dst(node), type, size, true);
+			continue;
+		}
+		case iro_Div:
+		case iro_Mod:
+		case iro_Phi:
+		case iro_Proj:
+		case iro_Sync:
+			continue;
+		default:
+			/* anything else using memory may access the locations */
+			foreach_irn_in(node, j, pred) {
+				if (get_irn_mode(pred) == mode_M) {
+					DB((dbg, LEVEL_3, "\tmemory operation %+F\n", node));
+					return false;
+				}
+			}
+			continue;
+		}
+	}
+	return true;
+}
+
+static bool add_exit(loop_env_t *const env, ir_node *const block, int const pos)
+{
+	ir_node *const cfop = get_Block_cfgpred(block, pos);
+	if (!is_Jmp(cfop)) {
+		ir_node *const pred = is_Proj(cfop) ? get_Proj_pred(cfop) : cfop;
+		if (!is_Cond(pred) && !is_Switch(pred))
+			return false;
+	}
+
+	exit_t exit = {
+		.block    = block,
+		.pos      = pos,
+		.mem_phis = NEW_ARR_F(ir_node*, 0),
+	};
+	foreach_irn_out_r(block, i, node) {
+		if (is_Phi(node) && get_irn_mode(node) == mode_M)
+			ARR_APP1(ir_node*, exit.mem_phis, node);
+	}
+	ARR_APP1(exit_t, env->exits, exit);
+	return true;
+}
+
+/** Finds the header, the preheader and the exits of the loop. */
+static bool analyze_cfg(loop_env_t *const env)
+{
+	ir_loop *const loop = env->loop;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		ir_node *const block = get_loop_element(loop, i).node;
+		for (int p = 0, n_preds = get_Block_n_cfgpreds(block); p < n_preds; ++p) {
+			ir_node *const pred = get_Block_cfgpred_block(block, p);
+			if (is_in_loop(env, pred))
+				continue;
+			if (env->header != NULL)
+				return false;
+			env->header    = block;
+			env->preheader = pred;
+			env->entry_pos = p;
+		}
+
+		for (unsigned s = 0, n_succs = get_Block_n_cfg_outs(block); s < n_succs; ++s) {
+			ir_node *const succ = get_Block_cfg_out(block, s);
+			if (is_in_loop(env, succ))
+				continue;
+			for (int p = 0, n_preds = get_Block_n_cfgpreds(succ); p < n_preds; ++p) {
+				if (get_Block_cfgpred_block(succ, p) != block)
+					continue;
+				bool seen = false;
+				for (size_t e = 0, n_exits = ARR_LEN(env->exits); e < n_exits; ++e)
+					seen |= env->exits[e].block == succ && env->exits[e].pos == p;
+				if (!seen && !add_exit(env, succ, p))
+					return false;
+			}
+		}
+	}
+	if (env->header == NULL || ARR_LEN(env->exits) == 0
+	 || !is_Jmp(get_Block_cfgpred(env->header, env->entry_pos)))
+		return false;
+
+	foreach_irn_out_r(env->header, i, node) {
+		if (is_Phi(node) && get_irn_mode(node) == mode_M) {
+			if (env->mem_phi != NULL)
+				return false;
+			env->mem_phi = node;
+		}
+	}
+	return env->mem_phi != NULL;
+}
+
+/**
+ * Checks whether an access of @p promotion is executed on every exit. If
+ * @p is_write is set, only Stores are considered.
+ */
+static bool is_executed_on_exit(loop_env_t const *const env,
+                                promotion_t const *const promotion,
+                                bool const is_write)
+{
+	for (size_t i = 0, n = ARR_LEN(env->accesses); i < n; ++i) {
+		access_t const *const access = &env->accesses[i];
+		if (access->promotion == SIZE_MAX
+		 || &env->promotions[access->promotion] != promotion
+		 || (is_write && !access->is_write))
+			continue;
+		ir_node *const block = get_nodes_block(access->node);
+		bool dominates = true;
+		for (size_t e = 0, n_exits = ARR_LEN(env->exits); e < n_exits; ++e) {
+			exit_t const *const exit = &env->exits[e];
+			ir_node      *const pred = get_Block_cfgpred_block(exit->block, exit->pos);
+			dominates &= block_dominates(block, pred);
+		}
+		if (dominates)
+			return true;
+	}
+	return false;
+}
+
+static void check_promotion(loop_env_t const *const env, size_t const index)
+{
+	promotion_t *const promotion = &env->promotions[index];
+	if (promotion->invalid)
+		return;
+
+	unsigned const size = get_mode_size_bytes(promotion->mode);
+	for (size_t i = 0, n = ARR_LEN(env->accesses); i < n; ++i) {
+		access_t const *const access = &env->accesses[i];
+		if (access->promotion == index
+		 || (!access->is_write && !promotion->has_store))
+			continue;
+		ir_alias_relation const rel = get_alias_relation(
+			promotion->ptr, promotion->type, size,
+			access->ptr, access->type, access->size);
+		if (rel != ir_no_alias) {
+			DB((dbg, LEVEL_3, "\t%+F may alias %+F\n", promotion->ptr, access->node));
+			promotion->invalid = true;
+			return;
+		}
+	}
+
+	ir_graph *const irg = get_irn_irg(env->header);
+	if (promotion->has_store) {
+		if (!is_executed_on_exit(env, promotion, true)) {
+			DB((dbg, LEVEL_3, "\t%+F not written on every exit\n", promotion->ptr));
+			promotion->invalid = true;
+		}
+	} else if (!is_entity_address(irg, promotion->ptr)
+	        && !is_executed_on_exit(env, promotion, false)) {
+		DB((dbg, LEVEL_3, "\t%+F may trap\n", promotion->ptr));
+		promotion->invalid = true;
+	}
+}
+
+static bool analyze_loop(loop_env_t *const env)
+{
+	if (!analyze_cfg(env))
+		return false;
+
+	ir_loop *const loop = env->loop;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		if (!collect_block(env, get_loop_element(loop, i).node))
+			return false;
+	}
+
+	bool found = false;
+	for (size_t i = 0, n = ARR_LEN(env->promotions); i < n; ++i) {
+		check_promotion(env, i);
+		found |= !env->promotions[i].invalid;
+	}
+	return found;
+}
+
+/**
+ * Topological walker, which replaces the promoted accesses by the values of
+ * the SSA construction.
+ */
+static void replace_access(ir_node *const node, void *const ctx)
+{
+	(void)ctx;
+	if (!is_Load(node) && !is_Store(node))
+		return;
+	promotion_t const *const promotion = (promotion_t const*)get_irn_link(node);
+	if (promotion == NULL)
+		return;
+
+	ir_graph *const irg = get_irn_irg(node);
+	set_r_cur_block(irg, get_nodes_block(node));
+	if (is_Load(node)) {
+		ir_node *const in[] = {
+			[pn_Load_M]   = get_Load_mem(node),
+			[pn_Load_res] = get_r_value(irg, promotion->vnum, promotion->mode),
+		};
+		turn_into_tuple(node, ARRAY_SIZE(in), in);
+	} else {
+		set_r_value(irg, promotion->vnum, get_Store_value(node));
+		ir_node *const in[] = {
+			[pn_Store_M] = get_Store_mem(node),
+		};
+		turn_into_tuple(node, ARRAY_SIZE(in), in);
+	}
+}
+
+static ir_cons_flags get_cons_flags(promotion_t const *const promotion)
+{
+	return promotion->unaligned ? cons_unaligned : cons_none;
+}
+
+/** Loads the promoted locations in the preheader. */
+static void create_loads(loop_env_t const *const env)
+{
+	ir_graph *const irg       = get_irn_irg(env->header);
+	ir_node  *const preheader = env->preheader;
+	ir_node        *mem       = get_irn_n(env->mem_phi, env->entry_pos);
+	set_r_cur_block(irg, preheader);
+	for (size_t i = 0, n = ARR_LEN(env->promotions); i < n; ++i) {
+		promotion_t const *const promotion = &env->promotions[i];
+		if (promotion->invalid)
+			continue;
+		move_to_preheader(env, promotion->ptr);
+		dbg_info *const dbgi = get_irn_dbg_info(promotion->first);
+		ir_node  *const load = new_rd_Load(dbgi, preheader, mem, promotion->ptr,
+		                                   promotion->mode, promotion->type,
+		                                   get_cons_flags(promotion));
+		mem = new_r_Proj(load, mode_M, pn_Load_M);
+		set_r_value(irg, promotion->vnum,
+		            new_r_Proj(load, promotion->mode, pn_Load_res));
+	}
+	set_irn_n(env->mem_phi, env->entry_pos, mem);
+}
+
+/**
+ * Stores the promoted locations on the loop exits. The Stores are placed in
+ * a new block on each exit edge, which is merged by later control flow
+ * optimization.
+ */
+static void create_stores(loop_env_t const *const env)
+{
+	ir_graph *const irg = get_irn_irg(env->header);
+	for (size_t e = 0, n_exits = ARR_LEN(env->exits); e < n_exits; ++e) {
+		exit_t const *const exit     = &env->exits[e];
+		size_t        const n_phis   = ARR_LEN(exit->mem_phis);
+		/* memory, which does not reach a Phi, is never observed */
+		if (n_phis == 0)
+			continue;
+
+		ir_node *const pred_block = get_Block_cfgpred_block(exit->block, exit->pos);
+		ir_node *const cfop       = get_Block_cfgpred(exit->block, exit->pos);
+		ir_node       *in[]       = { cfop };
+		ir_node *const block      = new_r_Block_noopt(irg, ARRAY_SIZE(in), in);
+		ir_node      **ins        = ALLOCAN(ir_node*, n_phis);
+		for (size_t i = 0; i < n_phis; ++i)
+			ins[i] = get_irn_n(exit->mem_phis[i], exit->pos);
+		ir_node *mem = n_phis == 1 ? ins[0] : new_r_Sync(block, n_phis, ins);
+
+		set_r_cur_block(irg, pred_block);
+		for (size_t i = 0, n = ARR_LEN(env->promotions); i < n; ++i) {
+			promotion_t const *const promotion = &env->promotions[i];
+			if (promotion->invalid || !promotion->has_store)
+				continue;
+			ir_node  *const value = get_r_value(irg, promotion->vnum,
+			                                    promotion->mode);
+			dbg_info *const dbgi  = get_irn_dbg_info(promotion->first);
+			ir_node  *const store = new_rd_Store(dbgi, block, mem, promotion->ptr,
+			                                     value, promotion->type,
+			                                     get_cons_flags(promotion));
+			mem = new_r_Proj(store, mode_M, pn_Store_M);
+		}
+
+		for (size_t i = 0; i < n_phis; ++i)
+			set_irn_n(exit->mem_phis[i], exit->pos, mem);
+		set_Block_cfgpred(exit->block, exit->pos, new_r_Jmp(block));
+	}
+}
+
+static void free_loop_env(loop_env_t *const env)
+{
+	for (size_t e = 0, n = ARR_LEN(env->exits); e < n; ++e)
+		DEL_ARR_F(env->exits[e].mem_phis);
+	DEL_ARR_F(env->promotions);
+	DEL_ARR_F(env->accesses);
+	DEL_ARR_F(env->exits);
+}
+
+static void collect_innermost_loops(ir_loop *const loop, ir_loop ***const loops,
+                                    bool const container)
+{
+	bool innermost = true;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			collect_innermost_loops(element.son, loops, false);
+			innermost = false;
+		}
+	}
+	if (innermost && !container)
+		ARR_APP1(ir_loop*, *loops, loop);
+}
+
+void promote_loop_memory(ir_graph *const irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop_promotion");
+
+	assure_lcssa(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_NO_TUPLES
+		| IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+		| IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **loops = NEW_ARR_F(ir_loop*, 0);
+	collect_innermost_loops(get_irg_loop(irg), &loops, true);
+
+	loop_env_t *envs = NEW_ARR_F(loop_env_t, 0);
+	unsigned    n_values = 0;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		loop_env_t env = {
+			.loop       = loops[i],
+			.exits      = NEW_ARR_F(exit_t, 0),
+			.accesses   = NEW_ARR_F(access_t, 0),
+			.promotions = NEW_ARR_F(promotion_t, 0),
+		};
+		DB((dbg, LEVEL_3, "inspect %+F\n", loops[i]));
+		if (!analyze_loop(&env)) {
+			free_loop_env(&env);
+			continue;
+		}
+		for (size_t p = 0, n_promotions = ARR_LEN(env.promotions); p < n_promotions; ++p) {
+			promotion_t *const promotion = &env.promotions[p];
+			if (promotion->invalid)
+				continue;
+			DB((dbg, LEVEL_2, "promote %+F in %+F\n", promotion->ptr, env.header));
+			promotion->vnum = n_values++;
+		}
+		ARR_APP1(loop_env_t, envs, env);
+	}
+	DEL_ARR_F(loops);
+
+	size_t const n_envs = ARR_LEN(envs);
+	if (n_envs > 0) {
+		ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+		irg_walk_graph(irg, firm_clear_link, NULL, NULL);
+		for (size_t i = 0; i < n_envs; ++i) {
+			loop_env_t const *const env = &envs[i];
+			for (size_t a = 0, n = ARR_LEN(env->accesses); a < n; ++a) {
+				access_t const *const access = &env->accesses[a];
+				if (access->promotion == SIZE_MAX)
+					continue;
+				promotion_t *const promotion = &env->promotions[access->promotion];
+				if (!promotion->invalid)
+					set_irn_link(access->node, promotion);
+			}
+		}
+
+		ssa_cons_start(irg, n_values);
+		for (size_t i = 0; i < n_envs; ++i)
+			create_loads(&envs[i]);
+		irg_walk_blkwise_graph(irg, NULL, replace_access, NULL);
+		for (size_t i = 0; i < n_envs; ++i)
+			create_stores(&envs[i]);
+		ssa_cons_finish(irg);
+		ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	}
+
+	for (size_t i = 0; i < n_envs; ++i)
+		free_loop_env(&envs[i]);
+	DEL_ARR_F(envs);
+
+	DB((dbg, LEVEL_1, "%+F: %u locations promoted\n", irg, n_values));
+	confirm_irg_properties(irg, n_values > 0 ? IR_GRAPH_PROPERTIES_NONE
+	                                         : IR_GRAPH_PROPERTIES_ALL);
+}
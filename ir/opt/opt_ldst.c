@@ -18,7 +18,7 @@
 #include "irgmod.h"
 #include "irgopt.h"
 #include "irgwalk.h"
-#include "irmemory.h"
+#include "irmemory_t.h"
 #include "irnode_t.h"
 #include "irnodehashmap.h"
 #include "iropt.h"
@@ -1769,6 +1769,7 @@ void opt_ldst(ir_graph *irg)
 	if ((opts & aa_opt_always_alias) == 0) {
 		assure_irp_globals_entity_usage_computed();
 	}
+	assure_irg_alias_cache(irg);
 
 	obstack_init(&env.obst);
 	ir_nodehashmap_init(&env.adr_map);
@@ -1876,6 +1877,7 @@ no_changes:
 		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_ALL);
 	}
 
+	free_irg_alias_cache(irg);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK);
 	ir_nodehashmap_destroy(&env.adr_map);
 	obstack_free(&env.obst, NULL);
@@ -17,7 +17,7 @@
 #include "irgopt.h"
 #include "irgraph_t.h"
 #include "irgwalk.h"
-#include "irmemory.h"
+#include "irmemory_t.h"
 #include "irnode_t.h"
 #include "irnodeset.h"
 #include "iroptimize.h"
@@ -496,7 +496,9 @@ void opt_parallelize_mem(ir_graph *irg)
 {
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
 	                           | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	assure_irg_alias_cache(irg);
 	irg_walk_blkwise_dom_top_down(irg, NULL, walker, NULL);
+	free_irg_alias_cache(irg);
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 	eliminate_sync_edges(irg);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
@@ -0,0 +1,572 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 Karlsruhe Institute of Technology
+ */
+
+/**
+ * @file
+ * @brief   Insertion of software prefetches for strided loop accesses.
+ *
+ * Loads and Stores of innermost loops are inspected for addresses of the form
+ *
+ *   base + coef * iv + offset
+ *
+ * where base is loop invariant and iv is an induction variable with constant
+ * step, or base is itself a pointer induction variable with loop invariant
+ * step. Such an access moves by a fixed stride per iteration, so the address
+ * it uses some iterations later is known. A prefetch of that address is
+ * inserted in front of the access. The number of iterations is chosen such
+ * that the estimated execution time of the loop body covers the configured
+ * memory latency.
+ *
+ * Accesses with a stride smaller than a cache line are left to the hardware
+ * prefetchers, as consecutive iterations touch the same line anyway. Of the
+ * accesses of one stream, i.e. with the same base and stride, only one per
+ * cache line is prefetched.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons.h"
+#include "irdom.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "irouts_t.h"
+#include "iroptimize.h"
+#include "tv_t.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+/** Assumed size of a cache line in bytes. */
+#define CACHE_LINE_SIZE       64
+/** Maximum number of iterations to prefetch ahead. */
+#define MAX_PREFETCH_DISTANCE 64
+/** Maximum step of an integer induction variable. */
+#define MAX_STEP              (1 << 16)
+
+typedef struct induction_t {
+	ir_node *phi;
+	ir_node *step;   /**< loop invariant step of a pointer induction variable */
+	long     step_c; /**< constant step, if step is NULL */
+} induction_t;
+
+typedef struct stream_t {
+	ir_node     *node;   /**< the Load or Store */
+	ir_node     *base;   /**< loop invariant base or pointer induction variable */
+	induction_t *iv;
+	long         coef;   /**< factor of an integer induction variable */
+	long         offset; /**< constant offset in bytes */
+	long         stride; /**< constant stride per iteration, 0 if not constant */
+} stream_t;
+
+typedef struct prefetch_env_t {
+	ir_loop     *loop;
+	ir_node     *header;
+	ir_node    **latches;  /**< blocks jumping back to the header */
+	induction_t *ivs;
+	stream_t    *streams;
+	unsigned     cost;     /**< estimated cost of one iteration */
+} prefetch_env_t;
+
+static bool is_in_loop(prefetch_env_t const *const env, ir_node const *const node)
+{
+	ir_node const *const block = is_Block(node) ? node : get_nodes_block(node);
+	return get_irn_loop(block) == env->loop;
+}
+
+static induction_t *find_induction(prefetch_env_t const *const env, ir_node const *const node)
+{
+	for (size_t i = 0, n = ARR_LEN(env->ivs); i < n; ++i) {
+		if (env->ivs[i].phi == node)
+			return &env->ivs[i];
+	}
+	return NULL;
+}
+
+/**
+ * Finds the single header of the loop and the blocks of its back edges.
+ */
+static bool find_header(prefetch_env_t *const env)
+{
+	for (size_t i = 0, n = get_loop_n_elements(env->loop); i < n; ++i) {
+		loop_element const element = get_loop_element(env->loop, i);
+		if (*element.kind != k_ir_node || !is_Block(element.node))
+			continue;
+		ir_node *const block = element.node;
+		for (int p = 0, arity = get_Block_n_cfgpreds(block); p < arity; ++p) {
+			if (is_in_loop(env, get_Block_cfgpred_block(block, p)))
+				continue;
+			if (env->header != NULL && env->header != block)
+				return false;
+			env->header = block;
+		}
+	}
+	if (env->header == NULL)
+		return false;
+
+	for (int p = 0, arity = get_Block_n_cfgpreds(env->header); p < arity; ++p) {
+		ir_node *const pred = get_Block_cfgpred_block(env->header, p);
+		if (is_in_loop(env, pred))
+			ARR_APP1(ir_node*, env->latches, pred);
+	}
+	return ARR_LEN(env->latches) > 0;
+}
+
+/**
+ * Checks whether @p phi is an induction variable and records it.
+ */
+static void analyze_phi(prefetch_env_t *const env, ir_node *const phi)
+{
+	ir_mode *const mode = get_irn_mode(phi);
+	if (!mode_is_int(mode) && !mode_is_reference(mode))
+		return;
+
+	ir_node *next = NULL;
+	foreach_irn_in(phi, i, pred) {
+		if (!is_in_loop(env, get_Block_cfgpred_block(env->header, i)))
+			continue;
+		if (next != NULL && next != pred)
+			return;
+		next = pred;
+	}
+
+	induction_t iv = { .phi = phi };
+	if (is_Add(next)) {
+		ir_node *step = get_Add_right(next);
+		if (get_Add_left(next) != phi) {
+			if (step != phi)
+				return;
+			step = get_Add_left(next);
+		}
+		if (is_in_loop(env, step))
+			return;
+		if (is_Const(step) && tarval_is_long(get_Const_tarval(step)))
+			iv.step_c = get_Const_long(step);
+		else if (mode_is_reference(mode))
+			iv.step = step;
+		else
+			return;
+	} else if (is_Sub(next) && get_Sub_left(next) == phi) {
+		ir_node *const step = get_Sub_right(next);
+		if (!is_Const(step) || !tarval_is_long(get_Const_tarval(step)))
+			return;
+		iv.step_c = -get_Const_long(step);
+	} else {
+		return;
+	}
+	if (iv.step == NULL && (iv.step_c == 0 || iv.step_c > MAX_STEP || iv.step_c < -MAX_STEP))
+		return;
+
+	DB((dbg, LEVEL_3, "  induction variable %+F\n", phi));
+	ARR_APP1(induction_t, env->ivs, iv);
+}
+
+/**
+ * Decomposes the integer @p node into coef * iv + offset.
+ */
+static bool get_affine(prefetch_env_t const *const env, ir_node const *const node,
+                       induction_t **const iv, long *const coef,
+                       long *const offset)
+{
+	if (is_Const(node)) {
+		ir_tarval *const tv = get_Const_tarval(node);
+		if (!tarval_is_long(tv))
+			return false;
+		*coef   = 0;
+		*offset = get_tarval_long(tv);
+		return true;
+	}
+	ir_mode *const mode = get_irn_mode(node);
+	if (!is_in_loop(env, node) || !mode_is_int(mode))
+		return false;
+
+	long c0;
+	long o0;
+	long c1;
+	long o1;
+	switch (get_irn_opcode(node)) {
+	case iro_Phi: {
+		induction_t *const found = find_induction(env, node);
+		if (found == NULL || found->step != NULL || (*iv != NULL && *iv != found))
+			return false;
+		*iv     = found;
+		*coef   = 1;
+		*offset = 0;
+		return true;
+	}
+
+	case iro_Add:
+		if (!get_affine(env, get_Add_left(node), iv, &c0, &o0)
+		 || !get_affine(env, get_Add_right(node), iv, &c1, &o1))
+			return false;
+		*coef   = c0 + c1;
+		*offset = o0 + o1;
+		return true;
+
+	case iro_Sub:
+		if (!get_affine(env, get_Sub_left(node), iv, &c0, &o0)
+		 || !get_affine(env, get_Sub_right(node), iv, &c1, &o1))
+			return false;
+		*coef   = c0 - c1;
+		*offset = o0 - o1;
+		return true;
+
+	case iro_Minus:
+		if (!get_affine(env, get_Minus_op(node), iv, &c0, &o0))
+			return false;
+		*coef   = -c0;
+		*offset = -o0;
+		return true;
+
+	case iro_Mul: {
+		ir_node *left  = get_Mul_left(node);
+		ir_node *right = get_Mul_right(node);
+		if (is_Const(left)) {
+			ir_node *const t = left;
+			left  = right;
+			right = t;
+		}
+		if (!is_Const(right) || !tarval_is_long(get_Const_tarval(right))
+		 || !get_affine(env, left, iv, &c0, &o0))
+			return false;
+		long const factor = get_tarval_long(get_Const_tarval(right));
+		*coef   = c0 * factor;
+		*offset = o0 * factor;
+		return true;
+	}
+
+	case iro_Shl: {
+		ir_node *const amount = get_Shl_right(node);
+		if (!is_Const(amount) || !get_affine(env, get_Shl_left(node), iv, &c0, &o0))
+			return false;
+		long const shift = get_Const_long(amount);
+		if (shift < 0 || shift >= 32)
+			return false;
+		*coef   = c0 << shift;
+		*offset = o0 << shift;
+		return true;
+	}
+
+	case iro_Conv: {
+		ir_node *const op      = get_Conv_op(node);
+		ir_mode *const op_mode = get_irn_mode(op);
+		if (!mode_is_int(op_mode)
+		 || get_mode_size_bits(op_mode) > get_mode_size_bits(mode))
+			return false;
+		return get_affine(env, op, iv, coef, offset);
+	}
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Decomposes the address @p ptr into base + coef * iv + offset.
+ */
+static bool get_address(prefetch_env_t const *const env, ir_node *const ptr,
+                        stream_t *const stream)
+{
+	if (!is_in_loop(env, ptr)) {
+		stream->base = ptr;
+		return true;
+	}
+
+	long c;
+	long o;
+	switch (get_irn_opcode(ptr)) {
+	case iro_Phi: {
+		induction_t *const found = find_induction(env, ptr);
+		if (found == NULL || stream->iv != NULL)
+			return false;
+		stream->base = ptr;
+		stream->iv   = found;
+		return true;
+	}
+
+	case iro_Add: {
+		ir_node *pointer = get_Add_left(ptr);
+		ir_node *index   = get_Add_right(ptr);
+		if (!mode_is_reference(get_irn_mode(pointer))) {
+			ir_node *const t = pointer;
+			pointer = index;
+			index   = t;
+		}
+		if (!get_address(env, pointer, stream)
+		 || !get_affine(env, index, &stream->iv, &c, &o))
+			return false;
+		stream->coef   += c;
+		stream->offset += o;
+		return true;
+	}
+
+	case iro_Sub: {
+		ir_node *const index = get_Sub_right(ptr);
+		if (!mode_is_int(get_irn_mode(index))
+		 || !get_address(env, get_Sub_left(ptr), stream)
+		 || !get_affine(env, index, &stream->iv, &c, &o))
+			return false;
+		stream->coef   -= c;
+		stream->offset -= o;
+		return true;
+	}
+
+	case iro_Member: {
+		ir_entity *const entity = get_Member_entity(ptr);
+		if (get_type_state(get_entity_owner(entity)) != layout_fixed
+		 || !get_address(env, get_Member_ptr(ptr), stream))
+			return false;
+		stream->offset += get_entity_offset(entity);
+		return true;
+	}
+
+	case iro_Sel: {
+		ir_type *const element = get_array_element_type(get_Sel_type(ptr));
+		if (get_type_state(element) != layout_fixed
+		 || !get_address(env, get_Sel_ptr(ptr), stream)
+		 || !get_affine(env, get_Sel_index(ptr), &stream->iv, &c, &o))
+			return false;
+		long const size = get_type_size(element);
+		stream->coef   += c * size;
+		stream->offset += o * size;
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Returns true if @p block is executed in every iteration of the loop.
+ */
+static bool is_executed_always(prefetch_env_t const *const env, ir_node const *const block)
+{
+	for (size_t i = 0, n = ARR_LEN(env->latches); i < n; ++i) {
+		if (!block_dominates(block, env->latches[i]))
+			return false;
+	}
+	return true;
+}
+
+static void analyze_access(prefetch_env_t *const env, ir_node *const node)
+{
+	ir_node *ptr;
+	if (is_Load(node)) {
+		if (get_Load_volatility(node) == volatility_is_volatile)
+			return;
+		ptr = get_Load_ptr(node);
+	} else {
+		if (get_Store_volatility(node) == volatility_is_volatile)
+			return;
+		ptr = get_Store_ptr(node);
+	}
+	if (!is_executed_always(env, get_nodes_block(node)))
+		return;
+
+	stream_t stream = { .node = node };
+	if (!get_address(env, ptr, &stream) || stream.iv == NULL)
+		return;
+
+	induction_t const *const iv = stream.iv;
+	if (iv->phi == stream.base) {
+		stream.stride = iv->step_c;
+	} else {
+		stream.stride = stream.coef * iv->step_c;
+		if (stream.stride == 0)
+			return;
+	}
+	if (iv->step == NULL && stream.stride > -CACHE_LINE_SIZE && stream.stride < CACHE_LINE_SIZE)
+		return;
+
+	DB((dbg, LEVEL_3, "  stream %+F: base %+F, iv %+F, stride %ld, offset %ld\n",
+	    node, stream.base, iv->phi, stream.stride, stream.offset));
+	ARR_APP1(stream_t, env->streams, stream);
+}
+
+/**
+ * Collects the induction variables and accesses of the loop and estimates
+ * the cost of an iteration.
+ */
+static void analyze_loop(prefetch_env_t *const env)
+{
+	foreach_irn_out_r(env->header, i, node) {
+		if (is_Phi(node))
+			analyze_phi(env, node);
+	}
+
+	for (size_t i = 0, n = get_loop_n_elements(env->loop); i < n; ++i) {
+		loop_element const element = get_loop_element(env->loop, i);
+		if (*element.kind != k_ir_node || !is_Block(element.node))
+			continue;
+		ir_node *const block = element.node;
+		foreach_irn_out_r(block, j, node) {
+			switch (get_irn_opcode(node)) {
+			case iro_Phi:
+			case iro_Proj:
+			case iro_Const:
+			case iro_Address:
+			case iro_Jmp:
+				break;
+			case iro_Load:
+			case iro_Store:
+				env->cost += 4;
+				if (ARR_LEN(env->ivs) > 0)
+					analyze_access(env, node);
+				break;
+			case iro_Div:
+			case iro_Mod:
+			case iro_Call:
+				env->cost += 20;
+				break;
+			default:
+				env->cost += 1;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Returns true if @p stream accesses a cache line, which is already
+ * prefetched for one of the first @p n streams.
+ */
+static bool is_covered(prefetch_env_t const *const env, size_t const n,
+                       stream_t const *const stream)
+{
+	for (size_t i = 0; i < n; ++i) {
+		stream_t const *const other = &env->streams[i];
+		if (other->node != NULL
+		 && other->base == stream->base && other->iv == stream->iv
+		 && other->coef == stream->coef
+		 && other->offset - stream->offset > -CACHE_LINE_SIZE
+		 && other->offset - stream->offset < CACHE_LINE_SIZE)
+			return true;
+	}
+	return false;
+}
+
+static ir_type *new_prefetch_type(void)
+{
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const type     = new_type_method(3, 0, false, cc_cdecl_set, mtp_no_property);
+	set_method_param_type(type, 0, get_type_for_mode(mode_P));
+	set_method_param_type(type, 1, int_type);
+	set_method_param_type(type, 2, int_type);
+	return type;
+}
+
+/**
+ * Inserts a prefetch @p distance iterations ahead in front of the access of
+ * @p stream.
+ */
+static void insert_prefetch(stream_t const *const stream, long const distance,
+                            ir_type *const type)
+{
+	ir_node  *const node   = stream->node;
+	ir_graph *const irg    = get_irn_irg(node);
+	ir_node  *const block  = get_nodes_block(node);
+	bool      const store  = is_Store(node);
+	ir_node  *const ptr    = store ? get_Store_ptr(node) : get_Load_ptr(node);
+	ir_node  *const mem    = store ? get_Store_mem(node) : get_Load_mem(node);
+	ir_mode  *const mode   = get_reference_offset_mode(get_irn_mode(ptr));
+
+	ir_node *ahead;
+	if (stream->iv->step != NULL) {
+		ir_node *const step = new_r_Conv(block, stream->iv->step, mode);
+		ahead = new_r_Mul(block, step, new_r_Const_long(irg, mode, distance));
+	} else {
+		ahead = new_r_Const_long(irg, mode, distance * stream->stride);
+	}
+
+	ir_node *const in[] = {
+		new_r_Add(block, ptr, ahead),
+		new_r_Const_long(irg, mode_Is, store),
+		new_r_Const_long(irg, mode_Is, 3),
+	};
+	ir_node *const prefetch = new_r_Builtin(block, mem, ARRAY_SIZE(in), in, ir_bk_prefetch, type);
+	ir_node *const new_mem  = new_r_Proj(prefetch, mode_M, pn_Builtin_M);
+	if (store)
+		set_Store_mem(node, new_mem);
+	else
+		set_Load_mem(node, new_mem);
+
+	DB((dbg, LEVEL_2, "prefetch for %+F %ld iterations ahead\n", node, distance));
+}
+
+static void collect_innermost_loops(ir_loop *const loop, ir_loop ***const loops,
+                                    bool const container)
+{
+	bool innermost = true;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			collect_innermost_loops(element.son, loops, false);
+			innermost = false;
+		}
+	}
+	if (innermost && !container)
+		ARR_APP1(ir_loop*, *loops, loop);
+}
+
+void insert_prefetches(ir_graph *const irg, unsigned const latency)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.prefetch");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+		| IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **loops = NEW_ARR_F(ir_loop*, 0);
+	collect_innermost_loops(get_irg_loop(irg), &loops, true);
+
+	/* Analyze all loops first, as the outs get invalid by the insertion. */
+	prefetch_env_t *envs = NEW_ARR_F(prefetch_env_t, 0);
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		prefetch_env_t env = {
+			.loop    = loops[i],
+			.latches = NEW_ARR_F(ir_node*, 0),
+			.ivs     = NEW_ARR_F(induction_t, 0),
+			.streams = NEW_ARR_F(stream_t, 0),
+		};
+		DB((dbg, LEVEL_3, "inspect %+F\n", loops[i]));
+		if (find_header(&env))
+			analyze_loop(&env);
+		DEL_ARR_F(env.latches);
+		ARR_APP1(prefetch_env_t, envs, env);
+	}
+	DEL_ARR_F(loops);
+
+	ir_type *type         = NULL;
+	unsigned n_prefetches = 0;
+	for (size_t i = 0, n = ARR_LEN(envs); i < n; ++i) {
+		prefetch_env_t *const env = &envs[i];
+		if (ARR_LEN(env->streams) > 0) {
+			unsigned const cost     = MAX(env->cost, 1u);
+			unsigned const distance = MIN((latency + cost - 1) / cost, (unsigned)MAX_PREFETCH_DISTANCE);
+			for (size_t s = 0, n_streams = ARR_LEN(env->streams); s < n_streams; ++s) {
+				stream_t *const stream = &env->streams[s];
+				if (is_covered(env, s, stream)) {
+					stream->node = NULL;
+					continue;
+				}
+				if (type == NULL)
+					type = new_prefetch_type();
+				insert_prefetch(stream, MAX(distance, 1u), type);
+				++n_prefetches;
+			}
+		}
+		DEL_ARR_F(env->streams);
+		DEL_ARR_F(env->ivs);
+	}
+	DEL_ARR_F(envs);
+
+	DB((dbg, LEVEL_1, "%+F: %u prefetches inserted\n", irg, n_prefetches));
+	confirm_irg_properties(irg, n_prefetches > 0
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW | IR_GRAPH_PROPERTY_NO_BADS
+		: IR_GRAPH_PROPERTIES_ALL);
+}
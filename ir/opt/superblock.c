@@ -0,0 +1,618 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 Karlsruhe Institute of Technology
+ */
+
+/**
+ * @file
+ * @brief   Superblock formation by tail duplication.
+ *
+ * Traces are selected along the most frequent control flow edges, starting
+ * with the most frequent block not yet in a trace. A trace is extended to the
+ * most likely successor of its last block as long as the last block is also
+ * the most likely predecessor of this successor (mutual most likely).
+ *
+ * A trace block with predecessors outside of the trace (a side entrance)
+ * ends the single entry region. The blocks from the first side entrance to
+ * the end of the trace are duplicated once, the copies take over all side
+ * entrances. Afterwards the trace is a chain of blocks with a single
+ * predecessor each, which control flow optimization merges into one block.
+ * Uses of values defined in duplicated blocks are rewired by SSA
+ * reconstruction.
+ */
+#include "array.h"
+#include "debug.h"
+#include "execfreq_t.h"
+#include "ircons_t.h"
+#include "irdom.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprofile.h"
+#include "obst.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+/** Minimum probability of an edge to continue a trace, in percent. */
+#define MIN_TRACE_PERCENT 60
+/** Maximum number of blocks in a trace. */
+#define MAX_TRACE_LENGTH  16
+
+typedef struct block_info_t {
+	double   freq;
+	unsigned n_nodes;
+	unsigned trace;      /**< number of the containing trace, 0 if none */
+	bool     duplicable;
+	bool     in_tail;    /**< in the tail currently duplicated */
+	ir_node *copy;       /**< the copy of a duplicated block */
+} block_info_t;
+
+typedef struct use_t {
+	ir_node *user;
+	int      pos;
+	ir_node *block;      /**< block, where the used value must be available */
+	unsigned vnum;
+} use_t;
+
+typedef struct superblock_env_t {
+	struct obstack obst;
+	ir_node      **blocks;      /**< original blocks of the graph */
+	ir_node      **trace;
+	ir_node      **values;      /**< duplicated nodes, the copy is the link */
+	uint32_t       entry_count; /**< profiled entry count, 0 if estimated */
+	unsigned       budget;      /**< number of nodes, which may be copied */
+	unsigned       n_traces;
+} superblock_env_t;
+
+static block_info_t *get_block_info(ir_node const *const block)
+{
+	return (block_info_t*)get_irn_link(block);
+}
+
+static block_info_t *new_block_info(superblock_env_t *const env,
+                                    ir_node *const block)
+{
+	block_info_t *const info = OALLOCZ(&env->obst, block_info_t);
+	set_irn_link(block, info);
+	return info;
+}
+
+static void set_freq(superblock_env_t const *const env, ir_node *const block,
+                     double const freq)
+{
+	get_block_info(block)->freq = freq;
+	set_block_execfreq(block, freq);
+	if (env->entry_count != 0)
+		ir_profile_set_block_execcount(block, (uint32_t)(freq * env->entry_count + 0.5));
+}
+
+/**
+ * Returns whether @p node is in a block of the tail currently duplicated.
+ */
+static bool is_in_tail(ir_node const *const node)
+{
+	return get_block_info(get_nodes_block(node))->in_tail;
+}
+
+/**
+ * Returns the estimated frequency of the control flow edge from @p pred to
+ * @p block. As there are no critical edges, either @p pred has a single
+ * successor or @p block has a single predecessor.
+ */
+static double get_edge_freq(ir_node const *const pred,
+                            ir_node const *const block)
+{
+	if (get_Block_n_cfgpreds(block) == 1)
+		return get_block_info(block)->freq;
+	return get_block_info(pred)->freq;
+}
+
+static void init_block(ir_node *const block, void *const data)
+{
+	superblock_env_t *const env  = (superblock_env_t*)data;
+	block_info_t     *const info = new_block_info(env, block);
+	ir_graph         *const irg  = get_irn_irg(block);
+
+	if (env->entry_count != 0) {
+		info->freq = (double)ir_profile_get_block_execcount(block)
+		           / env->entry_count;
+	} else {
+		info->freq = get_block_execfreq(block);
+	}
+
+	/* blocks, whose address is taken, must stay unique. mode_b values must not
+	 * get Phis, so they must not be used outside of a duplicated block. */
+	bool duplicable = block != get_irg_start_block(irg)
+		&& block != get_irg_end_block(irg)
+		&& get_Block_entity(block) == NULL;
+	foreach_out_edge(block, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (is_End(node))
+			continue;
+		++info->n_nodes;
+		if (get_irn_mode(node) != mode_b)
+			continue;
+		foreach_out_edge(node, use_edge) {
+			if (get_nodes_block(get_edge_src_irn(use_edge)) != block)
+				duplicable = false;
+		}
+	}
+	info->duplicable = duplicable;
+	ARR_APP1(ir_node*, env->blocks, block);
+}
+
+static int cmp_block_freq(void const *const p1, void const *const p2)
+{
+	double const freq1 = get_block_info(*(ir_node *const*)p1)->freq;
+	double const freq2 = get_block_info(*(ir_node *const*)p2)->freq;
+	return QSORT_CMP(freq2, freq1);
+}
+
+static bool in_current_trace(superblock_env_t const *const env,
+                             ir_node const *const block)
+{
+	return get_block_info(block)->trace == env->n_traces;
+}
+
+/**
+ * Returns whether @p block may follow @p pred in the current trace: The edge
+ * between them must be the only one, be the most frequent successor edge of
+ * @p pred as well as the most frequent predecessor edge of @p block, and have
+ * at least frequency @p min_freq. Loop headers and edges into the trace end
+ * the trace.
+ */
+static bool is_trace_edge(superblock_env_t const *const env,
+                          ir_node *const pred, ir_node *const block,
+                          double const min_freq)
+{
+	double const freq = get_edge_freq(pred, block);
+	if (freq < min_freq || !get_block_info(block)->duplicable)
+		return false;
+
+	foreach_block_succ(pred, edge) {
+		ir_node *const succ = get_edge_src_irn(edge);
+		if (succ != block && (get_edge_freq(pred, succ) > freq
+		                      || in_current_trace(env, succ)))
+			return false;
+	}
+
+	unsigned n_edges = 0;
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		ir_node *const other = get_Block_cfgpred_block(block, i);
+		if (block_dominates(block, other))
+			return false;
+		if (other == pred) {
+			++n_edges;
+		} else if (in_current_trace(env, other)
+		           || get_edge_freq(other, block) > freq) {
+			return false;
+		}
+	}
+	return n_edges == 1;
+}
+
+/**
+ * Returns the block continuing a trace ending with @p block, or NULL if the
+ * trace ends here.
+ */
+static ir_node *select_successor(superblock_env_t const *const env,
+                                 ir_node *const block)
+{
+	ir_node *best      = NULL;
+	double   best_freq = 0.0;
+	foreach_block_succ(block, edge) {
+		ir_node *const succ = get_edge_src_irn(edge);
+		double   const freq = get_edge_freq(block, succ);
+		if (best == NULL || freq > best_freq) {
+			best      = succ;
+			best_freq = freq;
+		}
+	}
+	double const min_freq = get_block_info(block)->freq * MIN_TRACE_PERCENT / 100;
+	if (best == NULL || get_block_info(best)->trace != 0
+	    || !is_trace_edge(env, block, best, min_freq))
+		return NULL;
+	foreach_block_succ(best, edge) {
+		if (in_current_trace(env, get_edge_src_irn(edge)))
+			return NULL;
+	}
+	return best;
+}
+
+/**
+ * Returns the block preceding a trace starting with @p block, or NULL if the
+ * trace starts here.
+ */
+static ir_node *select_predecessor(superblock_env_t const *const env,
+                                   ir_node *const block)
+{
+	ir_node *best      = NULL;
+	double   best_freq = 0.0;
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		ir_node *const pred = get_Block_cfgpred_block(block, i);
+		double   const freq = get_edge_freq(pred, block);
+		if (best == NULL || freq > best_freq) {
+			best      = pred;
+			best_freq = freq;
+		}
+	}
+	double const min_freq = get_block_info(block)->freq * MIN_TRACE_PERCENT / 100;
+	if (best == NULL || get_block_info(best)->trace != 0
+	    || !is_trace_edge(env, best, block, min_freq))
+		return NULL;
+	for (int i = 0, n = get_Block_n_cfgpreds(best); i < n; ++i) {
+		if (in_current_trace(env, get_Block_cfgpred_block(best, i)))
+			return NULL;
+	}
+	return best;
+}
+
+static void append_input(ir_node *const node, ir_node *const in)
+{
+	int       const arity = get_irn_arity(node);
+	ir_node **const ins   = ALLOCAN(ir_node*, arity + 1);
+	foreach_irn_in(node, i, pred) {
+		ins[i] = pred;
+	}
+	ins[arity] = in;
+	set_irn_in(node, arity + 1, ins);
+}
+
+/**
+ * Creates the copy of the tail block @p block, which takes over all
+ * predecessors except the one from the trace predecessor @p pred. Except for
+ * the first tail block, the copy gets the edge from the copy of @p pred as
+ * first predecessor, which is set when control flow is rewired.
+ */
+static void copy_block(superblock_env_t *const env, ir_node *const block,
+                       ir_node *const pred, bool const first)
+{
+	int       const n_preds  = get_Block_n_cfgpreds(block);
+	int      *const copy_pos = ALLOCAN(int, n_preds);
+	int             n_copy   = 0;
+	int             pos      = -1;
+	for (int i = 0; i < n_preds; ++i) {
+		if (get_Block_cfgpred_block(block, i) == pred) {
+			pos = i;
+			if (!first)
+				copy_pos[n_copy++] = i;
+		}
+	}
+	for (int i = 0; i < n_preds; ++i) {
+		if (i != pos)
+			copy_pos[n_copy++] = i;
+	}
+
+	ir_graph *const irg = get_irn_irg(block);
+	ir_node **const in  = ALLOCAN(ir_node*, n_copy);
+	for (int i = 0; i < n_copy; ++i)
+		in[i] = get_Block_cfgpred(block, copy_pos[i]);
+	ir_node *const copy = new_r_Block_noopt(irg, n_copy, in);
+	set_irn_dbg_info(copy, get_irn_dbg_info(block));
+	new_block_info(env, copy)->trace = env->n_traces;
+	get_block_info(block)->copy = copy;
+
+	/* collect first, as copying adds users of the block */
+	ir_node **nodes = NEW_ARR_F(ir_node*, 0);
+	foreach_out_edge(block, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (!is_End(node))
+			ARR_APP1(ir_node*, nodes, node);
+	}
+
+	for (size_t i = 0, n = ARR_LEN(nodes); i < n; ++i) {
+		ir_node *const node      = nodes[i];
+		ir_node *const node_copy = exact_copy(node);
+		set_nodes_block(node_copy, copy);
+		set_irn_link(node, node_copy);
+		ARR_APP1(ir_node*, env->values, node);
+		if (!is_Phi(node))
+			continue;
+
+		/* the operand from the trace is defined before this block, so its
+		 * copy already exists */
+		for (int p = 0; p < n_copy; ++p) {
+			ir_node *op = get_Phi_pred(node, copy_pos[p]);
+			if (!first && p == 0 && is_in_tail(op))
+				op = (ir_node*)get_irn_link(op);
+			in[p] = op;
+		}
+		set_irn_in(node_copy, n_copy, in);
+		ir_node *const phi_in[] = { get_Phi_pred(node, pos) };
+		set_irn_in(node, ARRAY_SIZE(phi_in), phi_in);
+	}
+	DEL_ARR_F(nodes);
+
+	ir_node *const block_in[] = { get_Block_cfgpred(block, pos) };
+	set_irn_in(block, ARRAY_SIZE(block_in), block_in);
+}
+
+/**
+ * Connects the copy of the tail block @p block to the successors of
+ * @p block. The copy of @p next, the next block in the trace, is entered from
+ * the copy only, all other successors get an additional predecessor.
+ */
+static void connect_copy(ir_node *const block, ir_node *const next)
+{
+	ir_node *const next_copy = next != NULL ? get_block_info(next)->copy : NULL;
+
+	typedef struct succ_edge_t {
+		ir_node *succ;
+		int      pos;
+	} succ_edge_t;
+	succ_edge_t *succs = NEW_ARR_F(succ_edge_t, 0);
+	foreach_block_succ(block, edge) {
+		succ_edge_t const succ = {
+			.succ = get_edge_src_irn(edge),
+			.pos  = get_edge_src_pos(edge),
+		};
+		/* the copy of next still uses our edge as placeholder */
+		if (succ.succ != next_copy)
+			ARR_APP1(succ_edge_t, succs, succ);
+	}
+
+	for (size_t i = 0, n = ARR_LEN(succs); i < n; ++i) {
+		ir_node *const succ = succs[i].succ;
+		int      const pos  = succs[i].pos;
+		ir_node *const x    = (ir_node*)get_irn_link(get_Block_cfgpred(succ, pos));
+		if (succ == next) {
+			set_Block_cfgpred(next_copy, 0, x);
+			continue;
+		}
+
+		append_input(succ, x);
+		foreach_out_edge(succ, edge) {
+			ir_node *const phi = get_edge_src_irn(edge);
+			if (!is_Phi(phi))
+				continue;
+			ir_node *op = get_Phi_pred(phi, pos);
+			if (is_in_tail(op))
+				op = (ir_node*)get_irn_link(op);
+			append_input(phi, op);
+		}
+	}
+	DEL_ARR_F(succs);
+}
+
+/**
+ * Duplicates the blocks of the current trace starting at @p first.
+ */
+static void duplicate_tail(superblock_env_t *const env, size_t const first)
+{
+	ir_node **const trace   = env->trace;
+	size_t    const n       = ARR_LEN(trace);
+	size_t    const n_start = ARR_LEN(env->values);
+	for (size_t k = first; k < n; ++k)
+		get_block_info(trace[k])->in_tail = true;
+
+	/* the copies take over the side entrances together with their flow */
+	double pred_freq = get_block_info(trace[first - 1])->freq;
+	double copy_freq = 0.0;
+	for (size_t k = first; k < n; ++k) {
+		ir_node      *const block = trace[k];
+		ir_node      *const pred  = trace[k - 1];
+		block_info_t *const info  = get_block_info(block);
+		double        const freq  = info->freq;
+		double        const trace_freq = get_edge_freq(pred, block);
+		if (pred_freq > 0.0)
+			copy_freq *= trace_freq / pred_freq;
+		copy_freq += freq - trace_freq;
+		copy_freq  = MIN(MAX(copy_freq, 0.0), freq);
+		pred_freq  = freq;
+
+		DB((dbg, LEVEL_2, "duplicate %+F\n", block));
+		copy_block(env, block, pred, k == first);
+		set_freq(env, block, freq - copy_freq);
+		set_freq(env, info->copy, copy_freq);
+	}
+
+	/* copies of nodes still use the original operands */
+	for (size_t i = n_start, n_values = ARR_LEN(env->values); i < n_values; ++i) {
+		ir_node *const node = env->values[i];
+		if (is_Phi(node))
+			continue;
+		ir_node *const copy = (ir_node*)get_irn_link(node);
+		foreach_irn_in(copy, p, pred) {
+			if (is_in_tail(pred))
+				set_irn_n(copy, p, (ir_node*)get_irn_link(pred));
+		}
+	}
+
+	for (size_t k = first; k < n; ++k)
+		connect_copy(trace[k], k + 1 < n ? trace[k + 1] : NULL);
+
+	/* exact_copy does not reproduce keep-alive edges */
+	ir_graph *const irg = get_irn_irg(trace[first]);
+	ir_node  *const end = get_irg_end(irg);
+	for (int i = 0, n_keeps = get_End_n_keepalives(end); i < n_keeps; ++i) {
+		ir_node *const keep = get_End_keepalive(end, i);
+		if (is_Block(keep)) {
+			block_info_t const *const info = get_block_info(keep);
+			if (info->in_tail)
+				add_End_keepalive(end, info->copy);
+		} else if (is_in_tail(keep)) {
+			add_End_keepalive(end, (ir_node*)get_irn_link(keep));
+		}
+	}
+
+	for (size_t k = first; k < n; ++k)
+		get_block_info(trace[k])->in_tail = false;
+}
+
+/**
+ * Selects a trace through @p seed and duplicates its tail, if it fits into
+ * the remaining budget.
+ */
+static void form_superblock(superblock_env_t *const env, ir_node *const seed)
+{
+	++env->n_traces;
+	get_block_info(seed)->trace = env->n_traces;
+
+	/* grow the trace backwards first, collecting it in reverse order */
+	ARR_SHRINKLEN(env->trace, 0);
+	ARR_APP1(ir_node*, env->trace, seed);
+	for (ir_node *block = seed; ARR_LEN(env->trace) < MAX_TRACE_LENGTH;) {
+		block = select_predecessor(env, block);
+		if (block == NULL)
+			break;
+		get_block_info(block)->trace = env->n_traces;
+		ARR_APP1(ir_node*, env->trace, block);
+	}
+	ir_node **const trace = env->trace;
+	for (size_t i = 0, j = ARR_LEN(trace) - 1; i < j; ++i, --j) {
+		ir_node *const tmp = trace[i];
+		trace[i] = trace[j];
+		trace[j] = tmp;
+	}
+	for (ir_node *block = seed; ARR_LEN(env->trace) < MAX_TRACE_LENGTH;) {
+		block = select_successor(env, block);
+		if (block == NULL)
+			break;
+		get_block_info(block)->trace = env->n_traces;
+		ARR_APP1(ir_node*, env->trace, block);
+	}
+
+	size_t n     = ARR_LEN(env->trace);
+	size_t first = 1;
+	while (first < n && get_Block_n_cfgpreds(env->trace[first]) == 1)
+		++first;
+	if (first == n)
+		return;
+
+	/* shorten the trace until its tail fits into the budget */
+	unsigned cost = 0;
+	for (size_t k = first; k < n; ++k)
+		cost += get_block_info(env->trace[k])->n_nodes;
+	while (n > first && cost > env->budget)
+		cost -= get_block_info(env->trace[--n])->n_nodes;
+	if (n == first)
+		return;
+
+	ARR_SHRINKLEN(env->trace, n);
+	env->budget -= cost;
+	DB((dbg, LEVEL_1, "superblock through %+F, %zu blocks, %u nodes duplicated\n",
+	    seed, n, cost));
+	duplicate_tail(env, first);
+}
+
+/**
+ * Rewires uses of duplicated values outside of their blocks to the reaching
+ * definition of the original or the copy.
+ */
+static void repair_ssa(superblock_env_t const *const env, ir_graph *const irg)
+{
+	ir_node **defs = NEW_ARR_F(ir_node*, 0);
+	use_t    *uses = NEW_ARR_F(use_t, 0);
+	for (size_t i = 0, n = ARR_LEN(env->values); i < n; ++i) {
+		ir_node *const node = env->values[i];
+		ir_mode *const mode = get_irn_mode(node);
+		if (mode == mode_X || mode == mode_T)
+			continue;
+
+		ir_node *const block  = get_nodes_block(node);
+		unsigned const trace  = get_block_info(block)->trace;
+		unsigned const vnum   = ARR_LEN(defs);
+		size_t   const n_uses = ARR_LEN(uses);
+		foreach_out_edge(node, edge) {
+			ir_node *const user = get_edge_src_irn(edge);
+			if (is_End(user))
+				continue;
+			int      const pos       = get_edge_src_pos(edge);
+			ir_node *const use_block = is_Phi(user)
+				? get_Block_cfgpred_block(get_nodes_block(user), pos)
+				: get_nodes_block(user);
+			/* later blocks of the original tail are only reached through the
+			 * original definition */
+			block_info_t const *const use_info = get_block_info(use_block);
+			if (use_block == block
+			    || (use_info->copy != NULL && use_info->trace == trace))
+				continue;
+
+			use_t const use = {
+				.user  = user,
+				.pos   = pos,
+				.block = use_block,
+				.vnum  = vnum,
+			};
+			ARR_APP1(use_t, uses, use);
+		}
+		if (ARR_LEN(uses) > n_uses)
+			ARR_APP1(ir_node*, defs, node);
+	}
+
+	size_t const n_defs = ARR_LEN(defs);
+	DB((dbg, LEVEL_1, "%+F: reconstruct SSA for %zu values\n", irg, n_defs));
+	if (n_defs > 0) {
+		ssa_cons_start(irg, n_defs);
+		for (size_t i = 0; i < n_defs; ++i) {
+			ir_node *const node = defs[i];
+			ir_node *const copy = (ir_node*)get_irn_link(node);
+			set_r_cur_block(irg, get_nodes_block(node));
+			set_r_value(irg, i, node);
+			set_r_cur_block(irg, get_nodes_block(copy));
+			set_r_value(irg, i, copy);
+		}
+		for (size_t i = 0, n = ARR_LEN(uses); i < n; ++i) {
+			use_t   const *const use  = &uses[i];
+			ir_mode       *const mode = get_irn_mode(defs[use->vnum]);
+			set_r_cur_block(irg, use->block);
+			set_irn_n(use->user, use->pos, get_r_value(irg, use->vnum, mode));
+		}
+		ssa_cons_finish(irg);
+	}
+	DEL_ARR_F(uses);
+	DEL_ARR_F(defs);
+}
+
+void form_superblocks(ir_graph *irg, unsigned max_growth)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.superblock");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+		| IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+		| IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+
+	superblock_env_t env = {
+		.blocks      = NEW_ARR_F(ir_node*, 0),
+		.trace       = NEW_ARR_F(ir_node*, 0),
+		.values      = NEW_ARR_F(ir_node*, 0),
+		.entry_count = ir_profile_get_block_execcount(get_irg_start_block(irg)),
+	};
+	obstack_init(&env.obst);
+	if (env.entry_count == 0)
+		ir_estimate_execfreq(irg);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, NULL, init_block, &env);
+
+	unsigned n_nodes = 0;
+	for (size_t i = 0, n = ARR_LEN(env.blocks); i < n; ++i)
+		n_nodes += get_block_info(env.blocks[i])->n_nodes;
+	env.budget = (unsigned)((uint64_t)n_nodes * max_growth / 100);
+
+	QSORT_ARR(env.blocks, cmp_block_freq);
+	for (size_t i = 0, n = ARR_LEN(env.blocks); i < n; ++i) {
+		ir_node *const block = env.blocks[i];
+		if (get_block_info(block)->trace == 0)
+			form_superblock(&env, block);
+	}
+
+	bool const changed = ARR_LEN(env.values) > 0;
+	if (changed)
+		repair_ssa(&env, irg);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	DEL_ARR_F(env.values);
+	DEL_ARR_F(env.trace);
+	DEL_ARR_F(env.blocks);
+	obstack_free(&env.obst, NULL);
+
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_NONE
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,1200 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2018 Karlsruhe Institute of Technology
+ */
+
+/**
+ * @file
+ * @brief   Vectorization of innermost counted loops.
+ *
+ * Handles loops made of a header, which only compares an induction variable
+ * against a loop invariant limit, and a single body block. All Loads and
+ * Stores of the body must access elements of one size which are consecutive
+ * in consecutive iterations. The body is widened by the number of lanes of a
+ * target vector register into a new loop, which is placed in front of the
+ * original one:
+ *
+ *   guards -> preheader -> vector loop -> reduction -> merge -> loop
+ *        \_________________________________________/
+ *
+ * The guards ensure that at least one full vector iteration is executed and
+ * that accesses, whose independence cannot be shown by get_alias_relation(),
+ * do not overlap. The original loop executes the remaining iterations as
+ * scalar epilogue, or all of them if a guard fails.
+ *
+ * There are no shuffle nodes, so loop invariant operands are broadcast and
+ * reductions (sum, minimum, maximum) are folded through a frame slot.
+ */
+#include "lcssa_t.h"
+
+#include "array.h"
+#include "bitfiddle.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "irflag_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "irouts_t.h"
+#include "iropt_t.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "pmap.h"
+#include "target_t.h"
+#include "tv_t.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+/** Maximum number of runtime overlap checks guarding a vector loop. */
+#define MAX_OVERLAP_CHECKS 8
+/** Maximum step of the induction variable. */
+#define MAX_STEP           (1 << 16)
+
+typedef struct reduction_t {
+	ir_node    *phi;
+	ir_node    *vphi;     /**< the accumulator of the vector loop */
+	bool        is_add;
+	ir_relation relation; /**< less for minimum, greater for maximum */
+} reduction_t;
+
+typedef struct access_t {
+	ir_node *node;     /**< the Load or Store */
+	ir_node *base;     /**< loop invariant base address */
+	long     offset;   /**< constant offset from the base in bytes */
+	bool     is_store;
+} access_t;
+
+typedef struct overlap_check_t {
+	ir_node *ptr_a;
+	ir_node *ptr_b;
+} overlap_check_t;
+
+typedef enum node_kind_t {
+	kind_scalar = 1, /**< computes addresses, copied into the vector loop */
+	kind_vector = 2, /**< widened to a vector value */
+} node_kind_t;
+
+typedef struct vec_env_t {
+	ir_graph        *irg;
+	ir_node         *header;
+	ir_node         *body;
+	int              entry_pos;    /**< header predecessor outside the loop */
+	int              back_pos;
+	ir_node         *iv;           /**< the induction variable Phi */
+	long             step;
+	ir_node         *limit;
+	ir_relation      relation;     /**< iv relation limit, less or less_equal */
+	ir_node         *mem_phi;
+	ir_node         *mem_in;       /**< memory entering the loop */
+	reduction_t     *reductions;
+	access_t        *accesses;
+	overlap_check_t *checks;
+	ir_node        **vector_ops;
+	pmap            *kinds;
+	unsigned         elem_size;
+	unsigned         n_lanes;
+	/* construction */
+	ir_entity       *slot;
+	ir_node         *preheader;
+	ir_node         *preheader_mem;
+	ir_node         *vloop;
+	ir_node         *viv;
+	ir_node         *vmem_phi;
+	pmap            *scalars;      /**< address computations of the vector loop */
+	pmap            *vectors;      /**< widened nodes of the vector loop */
+} vec_env_t;
+
+static bool is_in_loop(vec_env_t const *const env, ir_node const *const node)
+{
+	ir_node const *const block = get_nodes_block(node);
+	return block == env->header || block == env->body;
+}
+
+/**
+ * Records that @p node is used as @p kind. Returns false if it is already
+ * used differently, sets @p visited if it was seen before.
+ */
+static bool mark_kind(vec_env_t *const env, ir_node *const node,
+                      node_kind_t const kind, bool *const visited)
+{
+	node_kind_t const old = (node_kind_t)PTR_TO_INT(pmap_get(void, env->kinds, node));
+	*visited = old != 0;
+	if (old != 0)
+		return old == kind;
+	pmap_insert(env->kinds, node, INT_TO_PTR(kind));
+	return true;
+}
+
+static bool check_element_mode(vec_env_t *const env, ir_mode *const mode)
+{
+	if (!mode_is_int(mode) && !mode_is_float(mode))
+		return false;
+	unsigned const size = get_mode_size_bytes(mode);
+	if (env->elem_size == 0)
+		env->elem_size = size;
+	return size == env->elem_size;
+}
+
+static ir_mode *get_vector_mode(vec_env_t const *const env, ir_mode *const mode)
+{
+	return new_vector_mode(mode, env->n_lanes);
+}
+
+/**
+ * Matches a lane-wise minimum or maximum, normalized to
+ * Mux(left REL right, right, left) with REL being less or greater.
+ */
+static bool get_minmax(ir_node const *const mux, ir_node **const left,
+                       ir_node **const right, ir_relation *const relation)
+{
+	ir_node *const sel = get_Mux_sel(mux);
+	if (!is_Cmp(sel))
+		return false;
+
+	ir_node    *const a   = get_Cmp_left(sel);
+	ir_node    *const b   = get_Cmp_right(sel);
+	ir_relation       rel = get_Cmp_relation(sel);
+	if (mode_is_int(get_irn_mode(a))) {
+		/* equal values make the selection irrelevant */
+		rel &= ~ir_relation_unordered;
+		if (rel == ir_relation_less_equal)
+			rel = ir_relation_less;
+		else if (rel == ir_relation_greater_equal)
+			rel = ir_relation_greater;
+	}
+	if (rel != ir_relation_less && rel != ir_relation_greater)
+		return false;
+
+	ir_node *const t = get_Mux_true(mux);
+	ir_node *const f = get_Mux_false(mux);
+	if (t == a && f == b) {
+		*left     = a;
+		*right    = b;
+		*relation = rel;
+	} else if (t == b && f == a) {
+		*left     = b;
+		*right    = a;
+		*relation = get_inversed_relation(rel);
+	} else {
+		return false;
+	}
+	return *left != *right;
+}
+
+/**
+ * Decomposes an integer value into coef * iv + offset.
+ */
+static bool get_affine(vec_env_t const *const env, ir_node const *const node,
+                       long *const coef, long *const offset)
+{
+	if (node == env->iv) {
+		*coef   = 1;
+		*offset = 0;
+		return true;
+	} else if (is_Const(node)) {
+		ir_tarval *const tv = get_Const_tarval(node);
+		if (!tarval_is_long(tv))
+			return false;
+		*coef   = 0;
+		*offset = get_tarval_long(tv);
+		return true;
+	}
+	ir_mode *const mode = get_irn_mode(node);
+	if (!is_in_loop(env, node) || !mode_is_int(mode))
+		return false;
+
+	long c0;
+	long o0;
+	long c1;
+	long o1;
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+		if (!get_affine(env, get_Add_left(node), &c0, &o0)
+		 || !get_affine(env, get_Add_right(node), &c1, &o1))
+			return false;
+		*coef   = c0 + c1;
+		*offset = o0 + o1;
+		return true;
+
+	case iro_Sub:
+		if (!get_affine(env, get_Sub_left(node), &c0, &o0)
+		 || !get_affine(env, get_Sub_right(node), &c1, &o1))
+			return false;
+		*coef   = c0 - c1;
+		*offset = o0 - o1;
+		return true;
+
+	case iro_Minus:
+		if (!get_affine(env, get_Minus_op(node), &c0, &o0))
+			return false;
+		*coef   = -c0;
+		*offset = -o0;
+		return true;
+
+	case iro_Mul: {
+		ir_node *left  = get_Mul_left(node);
+		ir_node *right = get_Mul_right(node);
+		if (is_Const(left)) {
+			ir_node *const t = left;
+			left  = right;
+			right = t;
+		}
+		if (!is_Const(right) || !tarval_is_long(get_Const_tarval(right))
+		 || !get_affine(env, left, &c0, &o0))
+			return false;
+		long const factor = get_tarval_long(get_Const_tarval(right));
+		*coef   = c0 * factor;
+		*offset = o0 * factor;
+		return true;
+	}
+
+	case iro_Shl: {
+		ir_node *const amount = get_Shl_right(node);
+		if (!is_Const(amount) || !get_affine(env, get_Shl_left(node), &c0, &o0))
+			return false;
+		long const shift = get_Const_long(amount);
+		if (shift < 0 || shift >= 32)
+			return false;
+		*coef   = c0 << shift;
+		*offset = o0 << shift;
+		return true;
+	}
+
+	case iro_Conv: {
+		ir_node *const op      = get_Conv_op(node);
+		ir_mode *const op_mode = get_irn_mode(op);
+		if (!mode_is_int(op_mode)
+		 || get_mode_size_bits(op_mode) > get_mode_size_bits(mode))
+			return false;
+		return get_affine(env, op, coef, offset);
+	}
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Decomposes an address into base + coef * iv + offset with a loop invariant
+ * base.
+ */
+static bool get_address(vec_env_t const *const env, ir_node *const ptr,
+                        ir_node **const base, long *const coef,
+                        long *const offset)
+{
+	if (!is_in_loop(env, ptr)) {
+		*base   = ptr;
+		*coef   = 0;
+		*offset = 0;
+		return true;
+	}
+
+	long c;
+	long o;
+	switch (get_irn_opcode(ptr)) {
+	case iro_Add: {
+		ir_node *pointer = get_Add_left(ptr);
+		ir_node *index   = get_Add_right(ptr);
+		if (!mode_is_reference(get_irn_mode(pointer))) {
+			ir_node *const t = pointer;
+			pointer = index;
+			index   = t;
+		}
+		if (!get_address(env, pointer, base, coef, offset)
+		 || !get_affine(env, index, &c, &o))
+			return false;
+		*coef   += c;
+		*offset += o;
+		return true;
+	}
+
+	case iro_Sub: {
+		ir_node *const index = get_Sub_right(ptr);
+		if (!mode_is_int(get_irn_mode(index))
+		 || !get_address(env, get_Sub_left(ptr), base, coef, offset)
+		 || !get_affine(env, index, &c, &o))
+			return false;
+		*coef   -= c;
+		*offset -= o;
+		return true;
+	}
+
+	case iro_Member: {
+		ir_entity *const entity = get_Member_entity(ptr);
+		if (get_type_state(get_entity_owner(entity)) != layout_fixed
+		 || get_entity_bitfield_size(entity) != 0
+		 || !get_address(env, get_Member_ptr(ptr), base, coef, offset))
+			return false;
+		*offset += get_entity_offset(entity);
+		return true;
+	}
+
+	case iro_Sel: {
+		ir_type *const element = get_array_element_type(get_Sel_type(ptr));
+		if (get_type_state(element) != layout_fixed
+		 || !get_address(env, get_Sel_ptr(ptr), base, coef, offset)
+		 || !get_affine(env, get_Sel_index(ptr), &c, &o))
+			return false;
+		long const size = get_type_size(element);
+		*coef   += c * size;
+		*offset += o * size;
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+/** Checks that @p node can be copied into the vector loop as it is. */
+static bool check_scalar(vec_env_t *const env, ir_node *const node)
+{
+	if (!is_in_loop(env, node) || node == env->iv)
+		return true;
+	bool visited;
+	if (!mark_kind(env, node, kind_scalar, &visited))
+		return false;
+	if (visited)
+		return true;
+
+	ir_mode *const mode = get_irn_mode(node);
+	if (!mode_is_int(mode) && !mode_is_reference(mode))
+		return false;
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+	case iro_Conv:
+	case iro_Member:
+	case iro_Minus:
+	case iro_Mul:
+	case iro_Sel:
+	case iro_Shl:
+	case iro_Sub:
+		break;
+	default:
+		DB((dbg, LEVEL_3, "\tcannot copy address computation %+F\n", node));
+		return false;
+	}
+	foreach_irn_in(node, i, pred) {
+		if (!check_scalar(env, pred))
+			return false;
+	}
+	return true;
+}
+
+static reduction_t *find_reduction(vec_env_t const *const env,
+                                   ir_node const *const phi)
+{
+	for (size_t i = 0, n = ARR_LEN(env->reductions); i < n; ++i) {
+		if (env->reductions[i].phi == phi)
+			return &env->reductions[i];
+	}
+	return NULL;
+}
+
+static bool check_mem(vec_env_t *env, ir_node *mem);
+static bool check_access(vec_env_t *env, ir_node *node);
+
+/** Checks that @p node can be widened to a vector value. */
+static bool check_vector(vec_env_t *const env, ir_node *const node)
+{
+	if (!check_element_mode(env, get_irn_mode(node)))
+		return false;
+	/* loop invariant values are broadcast */
+	if (!is_in_loop(env, node))
+		return true;
+	bool visited;
+	if (!mark_kind(env, node, kind_vector, &visited))
+		return false;
+	if (visited)
+		return true;
+
+	switch (get_irn_opcode(node)) {
+	case iro_Phi:
+		return find_reduction(env, node) != NULL;
+
+	case iro_Proj: {
+		ir_node *const pred = get_Proj_pred(node);
+		return is_Load(pred) && get_Proj_num(node) == pn_Load_res
+		    && check_access(env, pred);
+	}
+
+	case iro_Add:
+	case iro_And:
+	case iro_Eor:
+	case iro_Mul:
+	case iro_Or:
+	case iro_Sub:
+		ARR_APP1(ir_node*, env->vector_ops, node);
+		return check_vector(env, get_binop_left(node))
+		    && check_vector(env, get_binop_right(node));
+
+	case iro_Mux: {
+		ir_node    *left;
+		ir_node    *right;
+		ir_relation relation;
+		if (!get_minmax(node, &left, &right, &relation))
+			return false;
+		ARR_APP1(ir_node*, env->vector_ops, node);
+		return check_vector(env, left) && check_vector(env, right);
+	}
+
+	default:
+		DB((dbg, LEVEL_3, "\tcannot widen %+F\n", node));
+		return false;
+	}
+}
+
+/** Checks that the Load or Store @p node accesses consecutive elements. */
+static bool check_access(vec_env_t *const env, ir_node *const node)
+{
+	bool visited;
+	if (!mark_kind(env, node, kind_vector, &visited))
+		return false;
+	if (visited)
+		return true;
+	if (get_nodes_block(node) != env->body || ir_throws_exception(node))
+		return false;
+
+	ir_node *ptr;
+	ir_node *mem;
+	ir_mode *mode;
+	bool     is_store;
+	if (is_Load(node)) {
+		if (get_Load_volatility(node) == volatility_is_volatile)
+			return false;
+		ptr      = get_Load_ptr(node);
+		mem      = get_Load_mem(node);
+		mode     = get_Load_mode(node);
+		is_store = false;
+	} else {
+		if (get_Store_volatility(node) == volatility_is_volatile)
+			return false;
+		ir_node *const value = get_Store_value(node);
+		if (!check_vector(env, value))
+			return false;
+		ptr      = get_Store_ptr(node);
+		mem      = get_Store_mem(node);
+		mode     = get_irn_mode(value);
+		is_store = true;
+	}
+	if (!check_element_mode(env, mode))
+		return false;
+
+	ir_node *base;
+	long     coef;
+	long     offset;
+	if (!check_scalar(env, ptr) || !get_address(env, ptr, &base, &coef, &offset)) {
+		DB((dbg, LEVEL_3, "\tunknown address of %+F\n", node));
+		return false;
+	}
+	if (coef * env->step != (long)get_mode_size_bytes(mode)) {
+		DB((dbg, LEVEL_3, "\t%+F does not access consecutive elements\n", node));
+		return false;
+	}
+	access_t const access = {
+		.node     = node,
+		.base     = base,
+		.offset   = offset,
+		.is_store = is_store,
+	};
+	ARR_APP1(access_t, env->accesses, access);
+	return check_mem(env, mem);
+}
+
+static bool check_mem(vec_env_t *const env, ir_node *const mem)
+{
+	if (mem == env->mem_phi)
+		return true;
+	if (!is_in_loop(env, mem)) {
+		/* a loop without Stores has Loads of the memory before the loop */
+		if (env->mem_in == NULL)
+			env->mem_in = mem;
+		return mem == env->mem_in;
+	}
+
+	if (is_Proj(mem)) {
+		ir_node *const pred = get_Proj_pred(mem);
+		return (is_Load(pred) || is_Store(pred)) && check_access(env, pred);
+	} else if (is_Sync(mem)) {
+		bool visited;
+		if (!mark_kind(env, mem, kind_vector, &visited))
+			return false;
+		if (visited)
+			return true;
+		foreach_irn_in(mem, i, pred) {
+			if (!check_mem(env, pred))
+				return false;
+		}
+		return true;
+	}
+	DB((dbg, LEVEL_3, "\tunsupported memory operation %+F\n", mem));
+	return false;
+}
+
+/**
+ * Checks whether @p phi accumulates a sum, minimum or maximum, which is only
+ * used after the loop.
+ */
+static bool add_reduction(vec_env_t *const env, ir_node *const phi)
+{
+	ir_mode *const mode = get_irn_mode(phi);
+	if (!mode_is_int(mode) && !mode_is_float(mode))
+		return false;
+	/* vectorized reductions combine the values in a different order */
+	if (mode_is_float(mode) && !ir_imprecise_float_transforms_allowed())
+		return false;
+
+	ir_node *const back = get_irn_n(phi, env->back_pos);
+	if (get_nodes_block(back) != env->body || get_irn_n_outs(back) != 1)
+		return false;
+
+	reduction_t red = { .phi = phi };
+	ir_node    *cmp = NULL;
+	if (is_Add(back)) {
+		if ((get_Add_left(back) == phi) == (get_Add_right(back) == phi))
+			return false;
+		red.is_add = true;
+	} else if (is_Mux(back)) {
+		ir_node *left;
+		ir_node *right;
+		if (!get_minmax(back, &left, &right, &red.relation)
+		 || (left != phi && right != phi))
+			return false;
+		cmp = get_Mux_sel(back);
+	} else {
+		return false;
+	}
+
+	foreach_irn_out_r(phi, i, user) {
+		if (user != back && user != cmp && is_in_loop(env, user))
+			return false;
+	}
+	ARR_APP1(reduction_t, env->reductions, red);
+	return true;
+}
+
+static bool find_induction_variable(vec_env_t *const env, ir_node *const cmp,
+                                    bool const exit_on_true)
+{
+	ir_node    *iv       = get_Cmp_left(cmp);
+	ir_node    *limit    = get_Cmp_right(cmp);
+	ir_relation relation = get_Cmp_relation(cmp);
+	if (!is_Phi(iv) || get_nodes_block(iv) != env->header) {
+		ir_node *const t = iv;
+		iv       = limit;
+		limit    = t;
+		relation = get_inversed_relation(relation);
+	}
+	if (!is_Phi(iv) || get_nodes_block(iv) != env->header
+	 || is_in_loop(env, limit) || !mode_is_int(get_irn_mode(iv)))
+		return false;
+	if (exit_on_true)
+		relation = get_negated_relation(relation);
+	relation &= ~ir_relation_unordered;
+	if (relation != ir_relation_less && relation != ir_relation_less_equal)
+		return false;
+
+	/* iv = iv + step */
+	ir_node *const next = get_irn_n(iv, env->back_pos);
+	if (!is_Add(next) || get_nodes_block(next) != env->body)
+		return false;
+	ir_node *const step = get_Add_left(next) == iv ? get_Add_right(next)
+	                                               : get_Add_left(next);
+	if (get_Add_left(next) != iv && get_Add_right(next) != iv)
+		return false;
+	if (!is_Const(step) || !tarval_is_long(get_Const_tarval(step)))
+		return false;
+	long const step_val = get_Const_long(step);
+	if (step_val <= 0 || step_val > MAX_STEP || !is_po2_or_zero(step_val))
+		return false;
+
+	env->iv       = iv;
+	env->step     = step_val;
+	env->limit    = limit;
+	env->relation = relation;
+	return true;
+}
+
+/** Checks the dependencies between accesses of different iterations. */
+static bool check_dependencies(vec_env_t *const env)
+{
+	for (size_t i = 0, n = ARR_LEN(env->accesses); i < n; ++i) {
+		access_t const *const a = &env->accesses[i];
+		for (size_t j = i + 1; j < n; ++j) {
+			access_t const *const b = &env->accesses[j];
+			if (!a->is_store && !b->is_store)
+				continue;
+			if (a->base == b->base) {
+				/* the same element in the same iteration is fine */
+				if (a->offset != b->offset) {
+					DB((dbg, LEVEL_3, "\tdependency between %+F and %+F\n",
+					    a->node, b->node));
+					return false;
+				}
+				continue;
+			}
+
+			ir_type *const type_a = is_Load(a->node) ? get_Load_type(a->node)
+			                                         : get_Store_type(a->node);
+			ir_type *const type_b = is_Load(b->node) ? get_Load_type(b->node)
+			                                         : get_Store_type(b->node);
+			ir_alias_relation const rel = get_alias_relation(
+				a->base, type_a, env->elem_size,
+				b->base, type_b, env->elem_size);
+			if (rel == ir_no_alias)
+				continue;
+			if (rel == ir_sure_alias
+			 || ARR_LEN(env->checks) >= MAX_OVERLAP_CHECKS)
+				return false;
+			overlap_check_t const check = {
+				.ptr_a = is_Load(a->node) ? get_Load_ptr(a->node)
+				                          : get_Store_ptr(a->node),
+				.ptr_b = is_Load(b->node) ? get_Load_ptr(b->node)
+				                          : get_Store_ptr(b->node),
+			};
+			ARR_APP1(overlap_check_t, env->checks, check);
+		}
+	}
+	return true;
+}
+
+static bool analyze_loop(vec_env_t *const env, ir_loop *const loop)
+{
+	if (get_loop_n_elements(loop) != 2)
+		return false;
+	ir_node *const b0 = get_loop_element(loop, 0).node;
+	ir_node *const b1 = get_loop_element(loop, 1).node;
+	if (!is_Block(b0) || !is_Block(b1))
+		return false;
+	ir_node *header;
+	ir_node *body;
+	if (get_Block_n_cfgpreds(b0) == 2 && get_Block_n_cfgpreds(b1) == 1) {
+		header = b0;
+		body   = b1;
+	} else if (get_Block_n_cfgpreds(b1) == 2 && get_Block_n_cfgpreds(b0) == 1) {
+		header = b1;
+		body   = b0;
+	} else {
+		return false;
+	}
+	env->header = header;
+	env->body   = body;
+
+	/* the header branches into the body or out of the loop */
+	ir_node *const body_pred = get_Block_cfgpred(body, 0);
+	if (!is_Proj(body_pred))
+		return false;
+	ir_node *const cond = get_Proj_pred(body_pred);
+	if (!is_Cond(cond) || get_nodes_block(cond) != header)
+		return false;
+	ir_node *const cmp = get_Cond_selector(cond);
+	if (!is_Cmp(cmp) || get_nodes_block(cmp) != header)
+		return false;
+
+	/* the body jumps back to the header */
+	for (int i = 0; i < 2; ++i) {
+		ir_node *const pred = get_Block_cfgpred(header, i);
+		if (get_nodes_block(pred) == body) {
+			if (!is_Jmp(pred))
+				return false;
+			env->back_pos  = i;
+			env->entry_pos = 1 - i;
+		}
+	}
+	ir_node *const entry = get_Block_cfgpred(header, env->entry_pos);
+	if (is_in_loop(env, entry) || get_nodes_block(get_Block_cfgpred(header, env->back_pos)) != body)
+		return false;
+
+	if (!find_induction_variable(env, cmp, get_Proj_num(body_pred) == pn_Cond_false))
+		return false;
+
+	foreach_irn_out_r(header, i, node) {
+		if (is_Block(node) || get_nodes_block(node) != header)
+			continue;
+		switch (get_irn_opcode(node)) {
+		case iro_Phi:
+			if (node == env->iv)
+				continue;
+			if (get_irn_mode(node) == mode_M) {
+				if (env->mem_phi != NULL)
+					return false;
+				env->mem_phi = node;
+				env->mem_in  = get_irn_n(node, env->entry_pos);
+			} else if (!add_reduction(env, node)) {
+				DB((dbg, LEVEL_3, "\tunsupported Phi %+F\n", node));
+				return false;
+			}
+			continue;
+		case iro_Cmp:
+		case iro_Cond:
+			if (node != cmp && node != cond)
+				return false;
+			continue;
+		case iro_Proj:
+			if (get_Proj_pred(node) != cond)
+				return false;
+			continue;
+		default:
+			DB((dbg, LEVEL_3, "\tunsupported node %+F in header\n", node));
+			return false;
+		}
+	}
+
+	if (env->mem_phi != NULL
+	 && !check_mem(env, get_irn_n(env->mem_phi, env->back_pos)))
+		return false;
+	for (size_t i = 0, n = ARR_LEN(env->reductions); i < n; ++i) {
+		ir_node *const phi = env->reductions[i].phi;
+		if (!check_vector(env, get_irn_n(phi, env->back_pos)))
+			return false;
+	}
+	if (ARR_LEN(env->accesses) == 0)
+		return false;
+
+	unsigned const vector_size = ir_target.vector_size;
+	if (!is_po2_or_zero(env->elem_size) || env->elem_size * 2 > vector_size)
+		return false;
+	env->n_lanes = vector_size / env->elem_size;
+	for (size_t i = 0, n = ARR_LEN(env->vector_ops); i < n; ++i) {
+		ir_node *const node  = env->vector_ops[i];
+		ir_mode *const vmode = get_vector_mode(env, get_irn_mode(node));
+		if (!ir_target.allow_vector_op(get_irn_op(node), vmode)) {
+			DB((dbg, LEVEL_3, "\tno vector operation for %+F\n", node));
+			return false;
+		}
+	}
+	return check_dependencies(env);
+}
+
+/**
+ * Returns the address of a frame slot of two vector registers, which is used
+ * to broadcast values and to rotate vectors.
+ */
+static ir_node *new_slot_address(vec_env_t *const env, ir_node *const block,
+                                 unsigned const offset)
+{
+	ir_graph *const irg = env->irg;
+	if (env->slot == NULL) {
+		unsigned const vector_size = ir_target.vector_size;
+		ir_type  *const byte_type  = get_type_for_mode(mode_Bu);
+		ir_type  *const slot_type  = new_type_array(byte_type, 2 * vector_size);
+		set_type_alignment(slot_type, vector_size);
+		ident *const id = id_unique("vector_slot");
+		env->slot = new_entity(get_irg_frame_type(irg), id, slot_type);
+	}
+	ir_node *const addr = new_r_Member(block, get_irg_frame(irg), env->slot);
+	if (offset == 0)
+		return addr;
+	ir_mode *const offset_mode = get_reference_offset_mode(get_irn_mode(addr));
+	ir_node *const cnst        = new_r_Const_long(irg, offset_mode, offset);
+	return new_r_Add(block, addr, cnst);
+}
+
+static ir_type *get_element_type(ir_mode *const mode)
+{
+	return get_type_for_mode(mode_is_vector(mode)
+		? get_mode_vector_element_mode(mode) : mode);
+}
+
+static void store_slot(vec_env_t *const env, ir_node *const block,
+                       ir_node **const mem, unsigned const offset,
+                       ir_node *const value)
+{
+	ir_node *const ptr   = new_slot_address(env, block, offset);
+	ir_type *const type  = get_element_type(get_irn_mode(value));
+	ir_node *const store = new_r_Store(block, *mem, ptr, value, type, cons_unaligned);
+	*mem = new_r_Proj(store, mode_M, pn_Store_M);
+}
+
+static ir_node *load_slot(vec_env_t *const env, ir_node *const block,
+                          ir_node **const mem, unsigned const offset,
+                          ir_mode *const mode)
+{
+	ir_node *const ptr  = new_slot_address(env, block, offset);
+	ir_type *const type = get_element_type(mode);
+	ir_node *const load = new_r_Load(block, *mem, ptr, mode, type, cons_unaligned);
+	*mem = new_r_Proj(load, mode_M, pn_Load_M);
+	return new_r_Proj(load, mode, pn_Load_res);
+}
+
+/** Creates a vector with @p value in all lanes in the preheader. */
+static ir_node *new_broadcast(vec_env_t *const env, ir_node *const value)
+{
+	ir_node *const block = env->preheader;
+	for (unsigned i = 0; i < env->n_lanes; ++i)
+		store_slot(env, block, &env->preheader_mem, i * env->elem_size, value);
+	ir_mode *const vmode = get_vector_mode(env, get_irn_mode(value));
+	return load_slot(env, block, &env->preheader_mem, 0, vmode);
+}
+
+static ir_node *new_minmax(ir_node *const block, ir_node *const left,
+                           ir_node *const right, ir_relation const relation)
+{
+	ir_node *const cmp = new_r_Cmp(block, left, right, relation);
+	return new_r_Mux(block, cmp, right, left);
+}
+
+/**
+ * Copies the address computation @p node into @p block, replacing the
+ * induction variable by @p iv.
+ */
+static ir_node *copy_scalar(vec_env_t const *const env, pmap *const copies,
+                            ir_node *const node, ir_node *const iv,
+                            ir_node *const block)
+{
+	if (node == env->iv)
+		return iv;
+	if (!is_in_loop(env, node))
+		return node;
+	ir_node *copy = pmap_get(ir_node, copies, node);
+	if (copy != NULL)
+		return copy;
+
+	copy = exact_copy(node);
+	set_nodes_block(copy, block);
+	foreach_irn_in(node, i, pred) {
+		set_irn_n(copy, i, copy_scalar(env, copies, pred, iv, block));
+	}
+	pmap_insert(copies, node, copy);
+	return copy;
+}
+
+static ir_node *vectorize_value(vec_env_t *env, ir_node *node);
+static ir_node *vectorize_mem(vec_env_t *env, ir_node *mem);
+
+static ir_node *vectorize_access(vec_env_t *const env, ir_node *const node)
+{
+	ir_node *res = pmap_get(ir_node, env->vectors, node);
+	if (res != NULL)
+		return res;
+
+	ir_node      *const block = env->vloop;
+	ir_cons_flags const flags = cons_unaligned
+		| (get_irn_pinned(node) ? cons_none : cons_floats);
+	if (is_Load(node)) {
+		ir_node *const ptr   = copy_scalar(env, env->scalars, get_Load_ptr(node), env->viv, block);
+		ir_node *const mem   = vectorize_mem(env, get_Load_mem(node));
+		ir_mode *const vmode = get_vector_mode(env, get_Load_mode(node));
+		res = new_r_Load(block, mem, ptr, vmode, get_Load_type(node), flags);
+	} else {
+		ir_node *const ptr   = copy_scalar(env, env->scalars, get_Store_ptr(node), env->viv, block);
+		ir_node *const value = vectorize_value(env, get_Store_value(node));
+		ir_node *const mem   = vectorize_mem(env, get_Store_mem(node));
+		res = new_r_Store(block, mem, ptr, value, get_Store_type(node), flags);
+	}
+	pmap_insert(env->vectors, node, res);
+	return res;
+}
+
+static ir_node *vectorize_value(vec_env_t *const env, ir_node *const node)
+{
+	ir_node *res = pmap_get(ir_node, env->vectors, node);
+	if (res != NULL)
+		return res;
+
+	ir_node *const block = env->vloop;
+	if (!is_in_loop(env, node)) {
+		res = new_broadcast(env, node);
+	} else if (is_Proj(node)) {
+		ir_node *const load  = vectorize_access(env, get_Proj_pred(node));
+		ir_mode *const vmode = get_vector_mode(env, get_irn_mode(node));
+		res = new_r_Proj(load, vmode, pn_Load_res);
+	} else if (is_Mux(node)) {
+		ir_node    *left;
+		ir_node    *right;
+		ir_relation relation;
+		bool const  is_minmax = get_minmax(node, &left, &right, &relation);
+		assert(is_minmax);
+		(void)is_minmax;
+		ir_node *const vleft  = vectorize_value(env, left);
+		ir_node *const vright = vectorize_value(env, right);
+		res = new_minmax(block, vleft, vright, relation);
+	} else {
+		ir_node *const left  = vectorize_value(env, get_binop_left(node));
+		ir_node *const right = vectorize_value(env, get_binop_right(node));
+		switch (get_irn_opcode(node)) {
+		case iro_Add: res = new_r_Add(block, left, right); break;
+		case iro_And: res = new_r_And(block, left, right); break;
+		case iro_Eor: res = new_r_Eor(block, left, right); break;
+		case iro_Mul: res = new_r_Mul(block, left, right); break;
+		case iro_Or:  res = new_r_Or(block, left, right);  break;
+		case iro_Sub: res = new_r_Sub(block, left, right); break;
+		default:
+			panic("unexpected node %+F", node);
+		}
+	}
+	pmap_insert(env->vectors, node, res);
+	return res;
+}
+
+static ir_node *vectorize_mem(vec_env_t *const env, ir_node *const mem)
+{
+	if (mem == env->mem_phi)
+		return env->vmem_phi;
+	if (!is_in_loop(env, mem))
+		return mem;
+	ir_node *res = pmap_get(ir_node, env->vectors, mem);
+	if (res != NULL)
+		return res;
+
+	if (is_Proj(mem)) {
+		ir_node *const pred = get_Proj_pred(mem);
+		ir_node *const vpred = vectorize_access(env, pred);
+		res = new_r_Proj(vpred, mode_M, get_Proj_num(mem));
+	} else {
+		assert(is_Sync(mem));
+		int       const arity = get_irn_arity(mem);
+		ir_node **const in    = ALLOCAN(ir_node*, arity);
+		foreach_irn_in(mem, i, pred) {
+			in[i] = vectorize_mem(env, pred);
+		}
+		res = new_r_Sync(env->vloop, arity, in);
+	}
+	pmap_insert(env->vectors, mem, res);
+	return res;
+}
+
+/** Folds the lanes of the accumulator @p value of reduction @p red. */
+static ir_node *fold_lanes(vec_env_t *const env, ir_node *const block,
+                           ir_node **const mem, reduction_t const *const red,
+                           ir_node *value)
+{
+	/* combine the vector with itself rotated by half, a quarter, ... */
+	ir_mode *const vmode       = get_irn_mode(value);
+	unsigned const vector_size = env->n_lanes * env->elem_size;
+	for (unsigned n = env->n_lanes / 2; n > 0; n /= 2) {
+		store_slot(env, block, mem, 0, value);
+		store_slot(env, block, mem, vector_size, value);
+		ir_node *const rotated = load_slot(env, block, mem, n * env->elem_size, vmode);
+		value = red->is_add ? new_r_Add(block, value, rotated)
+		                    : new_minmax(block, value, rotated, red->relation);
+	}
+	store_slot(env, block, mem, 0, value);
+	ir_node *const res = load_slot(env, block, mem, 0, get_irn_mode(red->phi));
+	if (!red->is_add)
+		return res;
+	/* the vector accumulator started at 0 */
+	ir_node *const init = get_irn_n(red->phi, env->entry_pos);
+	return new_r_Add(block, init, res);
+}
+
+static ir_node *new_guard(ir_node *const block, ir_node *const cmp,
+                          ir_node ***const fails)
+{
+	ir_node *const cond       = new_r_Cond(block, cmp);
+	ir_node *const proj_false = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ir_node *const proj_true  = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ARR_APP1(ir_node*, *fails, proj_false);
+	return new_r_Block(get_irn_irg(block), 1, &proj_true);
+}
+
+static void vectorize_loop(vec_env_t *const env)
+{
+	ir_graph *const irg         = env->irg;
+	ir_node  *const header      = env->header;
+	ir_mode  *const iv_mode     = get_irn_mode(env->iv);
+	ir_node  *const iv0         = get_irn_n(env->iv, env->entry_pos);
+	ir_mode  *const umode       = find_unsigned_mode(get_reference_offset_mode(mode_P));
+	ir_node **fails             = NEW_ARR_F(ir_node*, 0);
+
+	/* guard: the loop is entered at all */
+	ir_node *entry = get_Block_cfgpred(header, env->entry_pos);
+	ir_node *block = new_r_Block(irg, 1, &entry);
+	ir_node *cmp   = new_r_Cmp(block, iv0, env->limit, env->relation);
+	block = new_guard(block, cmp, &fails);
+
+	/* guard: at least one vector iteration, the number of scalar iterations
+	 * is ceil((limit - iv0) / step) or (limit - iv0) / step + 1 */
+	unsigned const log_step = log2_floor(env->step);
+	ir_node       *n_iter   = new_r_Sub(block, new_r_Conv(block, env->limit, umode),
+	                                    new_r_Conv(block, iv0, umode));
+	long     const round    = env->relation == ir_relation_less ? env->step - 1 : env->step;
+	if (round != 0)
+		n_iter = new_r_Add(block, n_iter, new_r_Const_long(irg, umode, round));
+	if (log_step != 0)
+		n_iter = new_r_Shr(block, n_iter, new_r_Const_long(irg, mode_Iu, log_step));
+	ir_node *const lane_mask = new_r_Const_long(irg, umode, ~(long)(env->n_lanes - 1));
+	ir_node *const n_vector  = new_r_And(block, n_iter, lane_mask);
+	cmp   = new_r_Cmp(block, n_vector, new_r_Const_null(irg, umode), ir_relation_less_greater);
+	block = new_guard(block, cmp, &fails);
+
+	/* guards: the accessed ranges do not overlap */
+	if (ARR_LEN(env->checks) > 0) {
+		pmap          *starts    = pmap_create();
+		ir_node *const log_elem  = new_r_Const_long(irg, mode_Iu, log2_floor(env->elem_size));
+		ir_node *const length    = new_r_Shl(block, n_vector, log_elem);
+		for (size_t i = 0, n = ARR_LEN(env->checks); i < n; ++i) {
+			overlap_check_t const *const check = &env->checks[i];
+			ir_node *const a    = copy_scalar(env, starts, check->ptr_a, iv0, block);
+			ir_node *const b    = copy_scalar(env, starts, check->ptr_b, iv0, block);
+			ir_node *const dist_ab = new_r_Conv(block, new_r_Sub(block, b, a), umode);
+			cmp   = new_r_Cmp(block, dist_ab, length, ir_relation_greater_equal);
+			block = new_guard(block, cmp, &fails);
+			ir_node *const dist_ba = new_r_Conv(block, new_r_Sub(block, a, b), umode);
+			cmp   = new_r_Cmp(block, dist_ba, length, ir_relation_greater_equal);
+			block = new_guard(block, cmp, &fails);
+		}
+		pmap_destroy(starts);
+	}
+
+	/* preheader */
+	env->preheader     = block;
+	env->preheader_mem = env->mem_in;
+	ir_node *const iv_length = log_step != 0
+		? new_r_Shl(block, n_vector, new_r_Const_long(irg, mode_Iu, log_step))
+		: n_vector;
+	ir_node *const vlimit    = new_r_Add(block, iv0, new_r_Conv(block, iv_length, iv_mode));
+
+	/* vector loop, the backedge is added when the body is complete */
+	ir_node *const vloop_in[] = { new_r_Jmp(block), new_r_Bad(irg, mode_X) };
+	ir_node *const vloop      = new_r_Block(irg, ARRAY_SIZE(vloop_in), vloop_in);
+	env->vloop = vloop;
+	ir_node *const iv_in[] = { iv0, iv0 };
+	env->viv = new_r_Phi(vloop, ARRAY_SIZE(iv_in), iv_in, iv_mode);
+	if (env->mem_phi != NULL) {
+		ir_node *const mem_in[] = { env->mem_in, env->mem_in };
+		env->vmem_phi = new_r_Phi(vloop, ARRAY_SIZE(mem_in), mem_in, mode_M);
+	}
+	for (size_t i = 0, n = ARR_LEN(env->reductions); i < n; ++i) {
+		reduction_t *const red   = &env->reductions[i];
+		ir_mode     *const mode  = get_irn_mode(red->phi);
+		ir_node     *const start = red->is_add ? new_r_Const_null(irg, mode)
+		                                       : get_irn_n(red->phi, env->entry_pos);
+		ir_node     *const vstart   = new_broadcast(env, start);
+		ir_node     *const acc_in[] = { vstart, vstart };
+		red->vphi = new_r_Phi(vloop, ARRAY_SIZE(acc_in), acc_in, get_irn_mode(vstart));
+		pmap_insert(env->vectors, red->phi, red->vphi);
+	}
+
+	for (size_t i = 0, n = ARR_LEN(env->reductions); i < n; ++i) {
+		reduction_t const *const red = &env->reductions[i];
+		ir_node *const next = vectorize_value(env, get_irn_n(red->phi, env->back_pos));
+		set_irn_n(red->vphi, 1, next);
+	}
+	if (env->mem_phi != NULL) {
+		ir_node *const next = vectorize_mem(env, get_irn_n(env->mem_phi, env->back_pos));
+		set_irn_n(env->vmem_phi, 1, next);
+		/* broadcasts are complete now */
+		set_irn_n(env->vmem_phi, 0, env->preheader_mem);
+	}
+
+	ir_node *const vstep      = new_r_Const_long(irg, iv_mode, env->step * env->n_lanes);
+	ir_node *const viv_next   = new_r_Add(vloop, env->viv, vstep);
+	set_irn_n(env->viv, 1, viv_next);
+	ir_node *const vcmp       = new_r_Cmp(vloop, viv_next, vlimit, ir_relation_less_greater);
+	ir_node *const vcond      = new_r_Cond(vloop, vcmp);
+	ir_node *const vloop_back = new_r_Proj(vcond, mode_X, pn_Cond_true);
+	ir_node *const vloop_exit = new_r_Proj(vcond, mode_X, pn_Cond_false);
+	set_irn_n(vloop, 1, vloop_back);
+
+	/* fold the reductions */
+	ir_node  *const rblock  = new_r_Block(irg, 1, &vloop_exit);
+	ir_node        *mem     = env->mem_phi != NULL ? get_irn_n(env->vmem_phi, 1)
+	                                               : env->preheader_mem;
+	size_t    const n_red   = ARR_LEN(env->reductions);
+	ir_node **const results = ALLOCAN(ir_node*, n_red);
+	for (size_t i = 0; i < n_red; ++i) {
+		reduction_t const *const red = &env->reductions[i];
+		results[i] = fold_lanes(env, rblock, &mem, red, get_irn_n(red->vphi, 1));
+	}
+	ARR_APP1(ir_node*, fails, new_r_Jmp(rblock));
+
+	/* merge into the original loop */
+	int       const n_preds = ARR_LEN(fails);
+	ir_node  *const merge   = new_r_Block(irg, n_preds, fails);
+	ir_node **const in      = ALLOCAN(ir_node*, n_preds);
+	for (int i = 0; i < n_preds - 1; ++i)
+		in[i] = iv0;
+	in[n_preds - 1] = viv_next;
+	set_irn_n(env->iv, env->entry_pos, new_r_Phi(merge, n_preds, in, iv_mode));
+	if (env->mem_phi != NULL) {
+		for (int i = 0; i < n_preds - 1; ++i)
+			in[i] = env->mem_in;
+		in[n_preds - 1] = mem;
+		set_irn_n(env->mem_phi, env->entry_pos, new_r_Phi(merge, n_preds, in, mode_M));
+	}
+	for (size_t r = 0; r < n_red; ++r) {
+		ir_node *const phi  = env->reductions[r].phi;
+		ir_node *const init = get_irn_n(phi, env->entry_pos);
+		for (int i = 0; i < n_preds - 1; ++i)
+			in[i] = init;
+		in[n_preds - 1] = results[r];
+		set_irn_n(phi, env->entry_pos, new_r_Phi(merge, n_preds, in, get_irn_mode(phi)));
+	}
+	set_irn_n(header, env->entry_pos, new_r_Jmp(merge));
+	DEL_ARR_F(fails);
+}
+
+static void collect_innermost_loops(ir_loop *const loop, ir_loop ***const loops,
+                                    bool const container)
+{
+	bool innermost = true;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			collect_innermost_loops(element.son, loops, false);
+			innermost = false;
+		}
+	}
+	if (innermost && !container)
+		ARR_APP1(ir_loop*, *loops, loop);
+}
+
+void vectorize_loops(ir_graph *const irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.vectorize");
+	if (ir_target.vector_size == 0 || ir_target.allow_vector_op == NULL)
+		return;
+
+	assure_lcssa(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **loops = NEW_ARR_F(ir_loop*, 0);
+	collect_innermost_loops(get_irg_loop(irg), &loops, true);
+
+	/* Phis are created with placeholder inputs */
+	int const rem_opt = get_optimize();
+	set_optimize(0);
+
+	unsigned n_vectorized = 0;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		vec_env_t env = {
+			.irg        = irg,
+			.reductions = NEW_ARR_F(reduction_t, 0),
+			.accesses   = NEW_ARR_F(access_t, 0),
+			.checks     = NEW_ARR_F(overlap_check_t, 0),
+			.vector_ops = NEW_ARR_F(ir_node*, 0),
+			.kinds      = pmap_create(),
+		};
+		DB((dbg, LEVEL_3, "inspect %+F\n", loops[i]));
+		if (analyze_loop(&env, loops[i])) {
+			DB((dbg, LEVEL_2, "vectorize %+F with %u lanes and %zu overlap checks\n",
+			    env.header, env.n_lanes, ARR_LEN(env.checks)));
+			env.scalars = pmap_create();
+			env.vectors = pmap_create();
+			vectorize_loop(&env);
+			pmap_destroy(env.vectors);
+			pmap_destroy(env.scalars);
+			++n_vectorized;
+		}
+		pmap_destroy(env.kinds);
+		DEL_ARR_F(env.vector_ops);
+		DEL_ARR_F(env.checks);
+		DEL_ARR_F(env.accesses);
+		DEL_ARR_F(env.reductions);
+	}
+	DEL_ARR_F(loops);
+
+	set_optimize(rem_opt);
+
+	DB((dbg, LEVEL_1, "%+F: %u loops vectorized\n", irg, n_vectorized));
+	confirm_irg_properties(irg, n_vectorized > 0 ? IR_GRAPH_PROPERTIES_NONE
+	                                             : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -11,17 +11,26 @@
  */
 #include "statev_t.h"
 
+#include "hashptr.h"
 #include "irprintf.h"
+#include "obst.h"
+#include "raw_bitset.h"
 #include "stat_timing.h"
+#include "statev_binary.h"
 #include "util.h"
+#include "xmalloc.h"
 #include <assert.h>
 #include <regex.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MAX_TIMER 256
+/** Number of records written at once by the binary output (64 KiB). */
+#define N_BUFFER_RECORDS 4096
+#define KEYS_MIN_SLOTS   64
 
 int (stat_ev_enabled) = 0;
 
@@ -41,6 +50,184 @@ static bool key_matches(const char *key)
 	return regexec(filter, key, 0, NULL, 0) == 0;
 }
 
+/** An interned key or context value of the binary output. */
+typedef struct key_entry_t {
+	unsigned hash; /**< hash of the name, 0 marks an empty slot */
+	uint32_t id;
+	bool     filtered; /**< the filter was applied to the name as key */
+	char    *name;
+} key_entry_t;
+
+/** Binary events are recorded without stat_ev_tim_push(), which excludes the
+ * time spent on statistics from enclosing timers, as it costs more than the
+ * recording itself. */
+static bool            stat_ev_binary;
+static statev_record_t buffer[N_BUFFER_RECORDS];
+static size_t          buffer_pos;
+static key_entry_t    *keys;
+static unsigned        keys_mask;
+static uint32_t        n_keys;
+/** Bitmap of the string ids passing the filter as key. */
+static unsigned       *key_passes;
+/** Bitmap of the string ids defined in the output. */
+static unsigned       *key_defined;
+static uint32_t        key_bits_size;
+static struct obstack  value_obst;
+
+static void flush_buffer(void)
+{
+	fwrite(buffer, sizeof(*buffer), buffer_pos, stat_ev_file);
+	buffer_pos = 0;
+}
+
+static statev_record_t *new_record(statev_record_kind_t const kind,
+                                   uint32_t const key)
+{
+	if (buffer_pos == N_BUFFER_RECORDS)
+		flush_buffer();
+	statev_record_t *const record = &buffer[buffer_pos++];
+	record->kind    = kind;
+	record->key     = key;
+	record->value.u = 0;
+	return record;
+}
+
+static void emit_string(uint32_t const id, char const *const str,
+                        size_t const len)
+{
+	new_record(STATEV_STRING, id)->value.u = len;
+	for (size_t pos = 0; pos < len; pos += sizeof(statev_record_t)) {
+		statev_record_t *const record = new_record(STATEV_STRING, id);
+		memset(record, 0, sizeof(*record));
+		memcpy(record, str + pos, MIN(len - pos, sizeof(*record)));
+	}
+}
+
+static void keys_resize(unsigned const n_slots)
+{
+	key_entry_t *const old_keys    = keys;
+	unsigned     const old_n_slots = old_keys != NULL ? keys_mask + 1 : 0;
+	keys      = XMALLOCNZ(key_entry_t, n_slots);
+	keys_mask = n_slots - 1;
+	for (unsigned i = 0; i < old_n_slots; ++i) {
+		key_entry_t const *const entry = &old_keys[i];
+		if (entry->hash == 0)
+			continue;
+		unsigned slot = entry->hash & keys_mask;
+		for (unsigned step = 1; keys[slot].hash != 0; ++step)
+			slot = (slot + step) & keys_mask;
+		keys[slot] = *entry;
+	}
+	free(old_keys);
+}
+
+static void filter_key(key_entry_t *const entry)
+{
+	entry->filtered = true;
+	if (key_matches(entry->name))
+		rbitset_set(key_passes, entry->id);
+}
+
+/**
+ * Returns the id of the string @p str. New strings are numbered, keys are
+ * matched against the filter on their first use as key.
+ */
+static uint32_t get_string_id(char const *const str, bool const is_key)
+{
+	unsigned const hash = hash_str(str) | 1;
+	unsigned       slot = hash & keys_mask;
+	for (unsigned step = 1; keys[slot].hash != 0; ++step) {
+		key_entry_t *const entry = &keys[slot];
+		if (entry->hash == hash && streq(entry->name, str)) {
+			if (is_key && !entry->filtered)
+				filter_key(entry);
+			return entry->id;
+		}
+		slot = (slot + step) & keys_mask;
+	}
+
+	key_entry_t *const entry = &keys[slot];
+	size_t       const len   = strlen(str) + 1;
+	entry->hash = hash;
+	entry->id   = n_keys++;
+	entry->name = XMALLOCN(char, len);
+	memcpy(entry->name, str, len);
+
+	if (entry->id >= key_bits_size) {
+		uint32_t  const new_size    = key_bits_size * 2;
+		unsigned *const new_passes  = rbitset_malloc(new_size);
+		unsigned *const new_defined = rbitset_malloc(new_size);
+		rbitset_copy(new_passes, key_passes, key_bits_size);
+		rbitset_copy(new_defined, key_defined, key_bits_size);
+		free(key_passes);
+		free(key_defined);
+		key_passes    = new_passes;
+		key_defined   = new_defined;
+		key_bits_size = new_size;
+	}
+	if (is_key)
+		filter_key(entry);
+
+	uint32_t const id = entry->id;
+	/* Keep the load factor below 3/4. */
+	if (n_keys * 4 >= (keys_mask + 1) * 3)
+		keys_resize((keys_mask + 1) * 2);
+	return id;
+}
+
+/**
+ * Emits the definition of string @p id before its first use.
+ */
+static void define_string(uint32_t const id, char const *const str)
+{
+	if (rbitset_is_set(key_defined, id))
+		return;
+	rbitset_set(key_defined, id);
+	emit_string(id, str, strlen(str));
+}
+
+/**
+ * Returns the id of @p key in @p id.
+ *
+ * @return true if events of @p key pass the filter
+ */
+static bool get_key_id(char const *const key, uint32_t *const id)
+{
+	*id = get_string_id(key, true);
+	if (!rbitset_is_set(key_passes, *id))
+		return false;
+	define_string(*id, key);
+	return true;
+}
+
+/**
+ * Returns a new record for an event of @p key or NULL if it is filtered.
+ */
+static statev_record_t *new_event(statev_record_kind_t const kind,
+                                  char const *const key)
+{
+	uint32_t id;
+	if (!get_key_id(key, &id))
+		return NULL;
+	return new_record(kind, id);
+}
+
+static void stat_ev_binary_push(char const *const key, char const *const fmt,
+                                va_list ap)
+{
+	uint32_t id;
+	if (!get_key_id(key, &id))
+		return;
+	/* context values like function names recur, so they are numbered, too */
+	ir_obst_vprintf(&value_obst, fmt, ap);
+	obstack_1grow(&value_obst, '\0');
+	char    *const value    = (char*)obstack_finish(&value_obst);
+	uint32_t const value_id = get_string_id(value, false);
+	define_string(value_id, value);
+	obstack_free(&value_obst, value);
+	new_record(STATEV_PUSH, id)->value.u = value_id;
+}
+
 static void stat_ev_vprintf(char ev, const char *key, const char *fmt, va_list ap)
 {
 	if (!key_matches(key))
@@ -102,6 +289,10 @@ void stat_ev_tim_pop(const char *name)
 
 void do_stat_ev_ctx_push_vfmt(const char *key, const char *fmt, va_list ap)
 {
+	if (stat_ev_binary) {
+		stat_ev_binary_push(key, fmt, ap);
+		return;
+	}
 	stat_ev_tim_push();
 	stat_ev_vprintf('P', key, fmt, ap);
 	stat_ev_tim_pop(NULL);
@@ -125,6 +316,10 @@ void (stat_ev_ctx_push_str)(const char *key, const char *str)
 
 void do_stat_ev_ctx_pop(const char *key)
 {
+	if (stat_ev_binary) {
+		new_event(STATEV_POP, key);
+		return;
+	}
 	stat_ev_tim_push();
 	stat_ev_printf('O', key, NULL);
 	stat_ev_tim_pop(NULL);
@@ -137,6 +332,12 @@ void (stat_ev_ctx_pop)(const char *key)
 
 void do_stat_ev_dbl(const char *name, double value)
 {
+	if (stat_ev_binary) {
+		statev_record_t *const record = new_event(STATEV_EV_DBL, name);
+		if (record != NULL)
+			record->value.d = value;
+		return;
+	}
 	stat_ev_tim_push();
 	stat_ev_printf('E', name, "%g", value);
 	stat_ev_tim_pop(NULL);
@@ -149,6 +350,12 @@ void (stat_ev_dbl)(const char *name, double value)
 
 void do_stat_ev_int(const char *name, int value)
 {
+	if (stat_ev_binary) {
+		statev_record_t *const record = new_event(STATEV_EV_INT, name);
+		if (record != NULL)
+			record->value.i = value;
+		return;
+	}
 	stat_ev_tim_push();
 	stat_ev_printf('E', name, "%d", value);
 	stat_ev_tim_pop(NULL);
@@ -161,6 +368,12 @@ void (stat_ev_int)(const char *name, int value)
 
 void do_stat_ev_ull(const char *name, unsigned long long value)
 {
+	if (stat_ev_binary) {
+		statev_record_t *const record = new_event(STATEV_EV_ULL, name);
+		if (record != NULL)
+			record->value.u = value;
+		return;
+	}
 	stat_ev_tim_push();
 	stat_ev_printf('E', name, "%llu", value);
 	stat_ev_tim_pop(NULL);
@@ -173,6 +386,10 @@ void (stat_ev_ull)(const char *name, unsigned long long value)
 
 void do_stat_ev(const char *name)
 {
+	if (stat_ev_binary) {
+		new_event(STATEV_EV, name);
+		return;
+	}
 	stat_ev_tim_push();
 	stat_ev_printf('E', name, "0.0");
 	stat_ev_tim_pop(NULL);
@@ -183,16 +400,8 @@ void (stat_ev)(const char *name)
 	stat_ev_(name);
 }
 
-void stat_ev_begin(const char *prefix, const char *filt)
+static void set_filter(const char *filt)
 {
-	char buf[512];
-
-	snprintf(buf, sizeof(buf), "%s.ev", prefix);
-	stat_ev_file = fopen(buf, "wt");
-	if (stat_ev_file == NULL) {
-		fprintf(stderr, "Warning: Couldn't create statev output '%s'\n", buf);
-	}
-
 	if (filt != NULL && filt[0] != '\0') {
 		filter = NULL;
 		if (regcomp(&regex, filt, REG_EXTENDED) == 0) {
@@ -203,13 +412,65 @@ void stat_ev_begin(const char *prefix, const char *filt)
 			        filt);
 		}
 	}
+}
 
+void stat_ev_begin(const char *prefix, const char *filt)
+{
+	char buf[512];
+
+	snprintf(buf, sizeof(buf), "%s.ev", prefix);
+	stat_ev_file = fopen(buf, "wt");
+	if (stat_ev_file == NULL) {
+		fprintf(stderr, "Warning: Couldn't create statev output '%s'\n", buf);
+	}
+
+	set_filter(filt);
+	stat_ev_binary  = false;
 	stat_ev_enabled = stat_ev_file != NULL;
 }
 
+void stat_ev_begin_binary(const char *prefix, const char *filt)
+{
+	char buf[512];
+
+	snprintf(buf, sizeof(buf), "%s.evb", prefix);
+	stat_ev_file = fopen(buf, "wb");
+	if (stat_ev_file == NULL) {
+		fprintf(stderr, "Warning: Couldn't create statev output '%s'\n", buf);
+		return;
+	}
+
+	set_filter(filt);
+	stat_ev_binary  = true;
+	stat_ev_enabled = 1;
+
+	keys_resize(KEYS_MIN_SLOTS);
+	key_bits_size = KEYS_MIN_SLOTS;
+	key_passes    = rbitset_malloc(key_bits_size);
+	key_defined   = rbitset_malloc(key_bits_size);
+	obstack_init(&value_obst);
+	new_record(STATEV_HEADER, STATEV_VERSION)->value.u = STATEV_MAGIC;
+}
+
 void stat_ev_end(void)
 {
 	if (stat_ev_file != NULL) {
+		if (stat_ev_binary) {
+			flush_buffer();
+			for (unsigned i = 0; i <= keys_mask; ++i)
+				free(keys[i].name);
+			free(keys);
+			free(key_passes);
+			free(key_defined);
+			obstack_free(&value_obst, NULL);
+			keys           = NULL;
+			keys_mask      = 0;
+			n_keys         = 0;
+			key_passes     = NULL;
+			key_defined    = NULL;
+			key_bits_size  = 0;
+			stat_ev_binary = false;
+		}
 		fclose(stat_ev_file);
 		stat_ev_file    = NULL;
 		stat_ev_enabled = 0;
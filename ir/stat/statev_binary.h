@@ -0,0 +1,51 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Binary format of statistic events.
+ *
+ * A binary statev file is a sequence of fixed size records in host byte
+ * order, starting with a STATEV_HEADER record. Keys and context values are
+ * numbered on first use and defined by a STATEV_STRING record before they are
+ * referenced. A STATEV_STRING record is followed by value.u bytes of string
+ * data, padded to a multiple of the record size.
+ */
+#ifndef FIRM_STAT_STATEV_BINARY_H
+#define FIRM_STAT_STATEV_BINARY_H
+
+#include <stdint.h>
+
+#define STATEV_MAGIC   0x56455346u /* "FSEV" */
+#define STATEV_VERSION 1
+
+typedef enum statev_record_kind_t {
+	STATEV_HEADER, /**< key is the version, value.u the magic */
+	STATEV_STRING, /**< defines string key, followed by its data */
+	STATEV_PUSH,   /**< pushes context key with string value.u */
+	STATEV_POP,    /**< pops context key */
+	STATEV_EV,     /**< event without a value */
+	STATEV_EV_INT, /**< event with value.i */
+	STATEV_EV_ULL, /**< event with value.u */
+	STATEV_EV_DBL, /**< event with value.d */
+} statev_record_kind_t;
+
+typedef struct statev_record_t {
+	uint32_t kind;
+	uint32_t key;
+	union {
+		int64_t  i;
+		uint64_t u;
+		double   d;
+	} value;
+} statev_record_t;
+
+/** Number of records needed for a string of @p len bytes. */
+static inline uint64_t statev_string_records(uint64_t const len)
+{
+	return (len + sizeof(statev_record_t) - 1) / sizeof(statev_record_t);
+}
+
+#endif
@@ -845,7 +845,8 @@ int entity_has_definition(const ir_entity *entity)
 {
 	switch (get_entity_kind(entity)) {
 	case IR_ENTITY_METHOD:
-		return get_entity_irg(entity) != NULL
+		return (get_entity_irg(entity) != NULL
+		     || entity->attr.mtd_attr.code_emitted)
 		    && (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN) == 0;
 
 	case IR_ENTITY_NORMAL:
@@ -114,6 +114,8 @@ typedef struct method_ent_attr {
 	global_ent_attr           base;
 	ir_graph *irg;                 /**< The corresponding irg if known.
 	                                    The ir_graph constructor automatically sets this field. */
+	bool code_emitted;             /**< Code was emitted and the irg freed
+	                                    afterwards, the method is still defined. */
 
 	unsigned vtable_number;        /**< For a dynamically called method, the number assigned
 	                                    in the virtual function table. */
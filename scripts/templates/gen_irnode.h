@@ -117,6 +117,7 @@ static inline void set_{{node.name}}_{{attr.name}}_(ir_node *node, {{attr.type}}
 	{{node.attr_struct}} *attr = ({{node.attr_struct}}*)get_irn_generic_attr(node);
 	attr->{{attr.name}} = {{attr.name}};
 	{%- else -%}
+	hook_set_irn_attr(node);
 	node->attr.{{node.attrs_name}}.{{attr.name}} = {{attr.name}};
 	{%- endif %}
 }
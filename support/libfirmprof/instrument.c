@@ -3,17 +3,32 @@
  * This file is a supplement to libFirm. It is public domain.
  *  @author Matthias Braun, Steven Schaefer
  */
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-/* Prevent the compiler from mangling the name of this function. */
+/* Prevent the compiler from mangling the name of these functions. */
 void __init_firmprof(const char*, unsigned int*, size_t)
      asm("__init_firmprof");
+void __init_firmprof_values(unsigned int*, uintptr_t*, unsigned, void**,
+                            unsigned)
+     asm("__init_firmprof_values");
+void __firmprof_value(uintptr_t*, uintptr_t)
+     asm("__firmprof_value");
+
+/* Number of values recorded per value profiling site, must match
+ * IR_PROFILE_VALUE_TOP_N of libFirm. */
+#define VALUE_TOP_N        4
+#define VALUE_RECORD_WORDS (1 + 2 * VALUE_TOP_N)
 
 typedef struct _profile_counter_t {
 	const char *filename;
 	unsigned   *counters;
 	unsigned    len;
+	uintptr_t  *records;     /* value records, VALUE_RECORD_WORDS per site */
+	unsigned    n_sites;
+	void      **functions;   /* functions identifying indirect call targets */
+	unsigned    n_functions;
 	struct _profile_counter_t *next;
 } profile_counter_t;
 
@@ -41,6 +56,40 @@ void write_little_endian(unsigned *counter, unsigned len, FILE *f)
 	}
 }
 
+/**
+ * Write a single unsigned integer of size bytes in little endian format.
+ */
+static void write_word(uint64_t v, unsigned size, FILE *f)
+{
+	unsigned      i;
+	unsigned char bytes[8];
+
+	for (i = 0; i < size; ++i)
+		bytes[i] = (v >> (8 * i)) & 0xff;
+
+	fwrite(bytes, 1, size, f);
+}
+
+/**
+ * Write the value records following the block counters. The section starts
+ * with the number of sites and words per site, followed by the records and
+ * the function addresses in the profiled run as 64-bit values.
+ */
+static void write_values(const profile_counter_t *counter, FILE *f)
+{
+	unsigned i;
+
+	fputs("firmvals", f);
+	write_word(counter->n_sites, 4, f);
+	write_word(VALUE_RECORD_WORDS, 4, f);
+	for (i = 0; i < counter->n_sites * VALUE_RECORD_WORDS; ++i)
+		write_word(counter->records[i], 8, f);
+
+	write_word(counter->n_functions, 4, f);
+	for (i = 0; i < counter->n_functions; ++i)
+		write_word((uintptr_t)counter->functions[i], 8, f);
+}
+
 static void write_profiles(void)
 {
 	profile_counter_t *counter = counters;
@@ -52,6 +101,8 @@ static void write_profiles(void)
 		} else {
 			fputs("firmprof", f);
 			write_little_endian(counter->counters, counter->len, f);
+			if (counter->records != NULL)
+				write_values(counter, f);
 			fclose(f);
 		}
 		free(counter);
@@ -79,10 +130,66 @@ void __init_firmprof(const char *filename,
 	if (counter == NULL)
 		return;
 
-	counter->filename = filename;
-	counter->counters = counts;
-	counter->next     = counters;
-	counter->len      = len;
+	counter->filename    = filename;
+	counter->counters    = counts;
+	counter->next        = counters;
+	counter->len         = len;
+	counter->records     = NULL;
+	counter->n_sites     = 0;
+	counter->functions   = NULL;
+	counter->n_functions = 0;
 
 	counters = counter;
 }
+
+/**
+ * Register the value records of a translation unit, whose block counters
+ * were registered with __init_firmprof before.
+ */
+void __init_firmprof_values(unsigned int *counts, uintptr_t *records,
+                            unsigned n_sites, void **functions,
+                            unsigned n_functions)
+{
+	profile_counter_t *counter;
+
+	for (counter = counters; counter != NULL; counter = counter->next) {
+		if (counter->counters == counts) {
+			counter->records     = records;
+			counter->n_sites     = n_sites;
+			counter->functions   = functions;
+			counter->n_functions = n_functions;
+			return;
+		}
+	}
+}
+
+/**
+ * Record a value at a value profiling site. A record consists of the number
+ * of executions followed by VALUE_TOP_N value, count pairs. If all pairs are
+ * in use, the count of the least frequent value is decremented and the value
+ * is replaced once its count drops to zero, so frequent values survive.
+ */
+void __firmprof_value(uintptr_t *record, uintptr_t value)
+{
+	uintptr_t *entries = record + 1;
+	unsigned   min     = 0;
+	unsigned   i;
+
+	++record[0];
+	for (i = 0; i < VALUE_TOP_N; ++i) {
+		if (entries[2 * i + 1] != 0 && entries[2 * i] == value) {
+			++entries[2 * i + 1];
+			return;
+		}
+	}
+	for (i = 0; i < VALUE_TOP_N; ++i) {
+		if (entries[2 * i + 1] < entries[2 * min + 1])
+			min = i;
+	}
+	if (entries[2 * min + 1] > 1) {
+		--entries[2 * min + 1];
+	} else {
+		entries[2 * min]     = value;
+		entries[2 * min + 1] = 1;
+	}
+}
@@ -0,0 +1,146 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Converts binary statev output (see stat_ev_begin_binary()) into
+ *          the text format of stat_ev_begin().
+ *
+ * Usage: statev_decode input.evb [output.ev]
+ */
+#include "statev_binary.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static FILE     *in;
+static char    **strings;
+static uint32_t  n_strings;
+
+static bool read_record(statev_record_t *const record)
+{
+	return fread(record, sizeof(*record), 1, in) == 1;
+}
+
+static char *read_string(uint64_t const len)
+{
+	uint64_t const n_records = statev_string_records(len);
+	char    *const str       = malloc(n_records * sizeof(statev_record_t) + 1);
+	if (str == NULL
+	    || fread(str, sizeof(statev_record_t), n_records, in) != n_records) {
+		free(str);
+		return NULL;
+	}
+	str[len] = '\0';
+	return str;
+}
+
+static char const *get_string(uint32_t const id)
+{
+	if (id >= n_strings || strings[id] == NULL) {
+		fprintf(stderr, "statev_decode: undefined string %" PRIu32 "\n", id);
+		exit(1);
+	}
+	return strings[id];
+}
+
+static void define_string(uint32_t const id, char *const str)
+{
+	if (id >= n_strings) {
+		uint32_t const new_n_strings = id * 2 + 1;
+		strings = realloc(strings, new_n_strings * sizeof(*strings));
+		if (strings == NULL) {
+			fputs("statev_decode: out of memory\n", stderr);
+			exit(1);
+		}
+		memset(strings + n_strings, 0,
+		       (new_n_strings - n_strings) * sizeof(*strings));
+		n_strings = new_n_strings;
+	}
+	free(strings[id]);
+	strings[id] = str;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s input.evb [output.ev]\n", argv[0]);
+		return 1;
+	}
+	in = fopen(argv[1], "rb");
+	if (in == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	FILE *const out = argc > 2 ? fopen(argv[2], "w") : stdout;
+	if (out == NULL) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	statev_record_t record;
+	if (!read_record(&record) || record.kind != STATEV_HEADER
+	    || record.value.u != STATEV_MAGIC) {
+		fprintf(stderr, "%s: not a binary statev file\n", argv[1]);
+		return 1;
+	}
+	if (record.key != STATEV_VERSION) {
+		fprintf(stderr, "%s: unsupported version %" PRIu32 "\n", argv[1],
+		        record.key);
+		return 1;
+	}
+
+	while (read_record(&record)) {
+		switch ((statev_record_kind_t)record.kind) {
+		case STATEV_STRING: {
+			char *const str = read_string(record.value.u);
+			if (str == NULL)
+				goto truncated;
+			define_string(record.key, str);
+			break;
+		}
+		case STATEV_PUSH:
+			fprintf(out, "P;%s;%s\n", get_string(record.key),
+			        get_string((uint32_t)record.value.u));
+			break;
+		case STATEV_POP:
+			fprintf(out, "O;%s\n", get_string(record.key));
+			break;
+		case STATEV_EV:
+			fprintf(out, "E;%s;0.0\n", get_string(record.key));
+			break;
+		case STATEV_EV_INT:
+			fprintf(out, "E;%s;%d\n", get_string(record.key),
+			        (int)record.value.i);
+			break;
+		case STATEV_EV_ULL:
+			fprintf(out, "E;%s;%llu\n", get_string(record.key),
+			        (unsigned long long)record.value.u);
+			break;
+		case STATEV_EV_DBL:
+			fprintf(out, "E;%s;%g\n", get_string(record.key), record.value.d);
+			break;
+		default:
+			fprintf(stderr, "%s: unknown record kind %" PRIu32 "\n", argv[1],
+			        record.kind);
+			return 1;
+		}
+	}
+
+	for (uint32_t i = 0; i < n_strings; ++i)
+		free(strings[i]);
+	free(strings);
+	fclose(in);
+	if (out != stdout)
+		fclose(out);
+	return 0;
+
+truncated:
+	fprintf(stderr, "%s: truncated file\n", argv[1]);
+	return 1;
+}
@@ -0,0 +1,176 @@
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Module b defines the small function inc() and the function spill() with a
+ * local variable. Module a calls inc(). The summary index selects inc() for
+ * import into a, and importing it reads neither the body nor the frame type
+ * of spill(). */
+
+#define B_IR      "irsummary_b.ir"
+#define B_SUMMARY "irsummary_b.sum"
+#define A_IR      "irsummary_a.ir"
+#define A_SUMMARY "irsummary_a.sum"
+
+static ir_type *new_int_method(void)
+{
+	ir_type *type_Is = new_type_primitive(mode_Is);
+	ir_type *method  = new_type_method(1, 1, false, cc_cdecl_set,
+	                                   mtp_no_property);
+	set_method_param_type(method, 0, type_Is);
+	set_method_res_type(method, 0, type_Is);
+	return method;
+}
+
+static ir_entity *new_function(ir_type *method, const char *name)
+{
+	return new_global_entity(get_glob_type(), new_id_from_str(name), method,
+	                         ir_visibility_external, IR_LINKAGE_DEFAULT);
+}
+
+static ir_graph *new_function_graph(ir_entity *ent, ir_node **arg)
+{
+	ir_graph *irg = new_ir_graph(ent, 0);
+	set_current_ir_graph(irg);
+	*arg = new_Proj(get_irg_args(irg), mode_Is, 0);
+	return irg;
+}
+
+static void finish_function_graph(ir_graph *irg, ir_node *res)
+{
+	ir_node *ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	mature_immBlock(get_r_cur_block(irg));
+	irg_finalize_cons(irg);
+}
+
+/* int inc(int x) { return x + 1; }
+ * int spill(int x) { volatile int v = x; return v; } */
+static void build_module_b(void)
+{
+	ir_type *method = new_int_method();
+
+	ir_node  *x;
+	ir_graph *irg = new_function_graph(new_function(method, "inc"), &x);
+	finish_function_graph(irg, new_Add(x, new_Const_long(mode_Is, 1)));
+
+	irg = new_function_graph(new_function(method, "spill"), &x);
+	ir_type   *type_Is = get_method_param_type(method, 0);
+	ir_entity *v       = new_entity(get_irg_frame_type(irg),
+	                                new_id_from_str("v"), type_Is);
+	ir_node   *ptr     = new_Member(get_irg_frame(irg), v);
+	ir_node   *store   = new_Store(get_store(), ptr, x, type_Is,
+	                               cons_volatile);
+	set_store(new_Proj(store, mode_M, pn_Store_M));
+	ir_node   *load    = new_Load(get_store(), ptr, mode_Is, type_Is,
+	                              cons_volatile);
+	set_store(new_Proj(load, mode_M, pn_Load_M));
+	finish_function_graph(irg, new_Proj(load, mode_Is, pn_Load_res));
+}
+
+/* int inc(int x);
+ * int caller(int x) { return inc(x); } */
+static ir_entity *build_module_a(void)
+{
+	ir_type   *method = new_int_method();
+	ir_entity *inc    = new_function(method, "inc");
+
+	ir_node  *x;
+	ir_graph *irg  = new_function_graph(new_function(method, "caller"), &x);
+	ir_node  *call = new_Call(get_store(), new_Address(inc), 1, &x, method);
+	set_store(new_Proj(call, mode_M, pn_Call_M));
+	ir_node  *ress = new_Proj(call, mode_T, pn_Call_T_result);
+	finish_function_graph(irg, new_Proj(ress, mode_Is, 0));
+	return inc;
+}
+
+static void export_module(const char *ir_filename, const char *summary)
+{
+	int res = ir_export(ir_filename);
+	assert(res == 0);
+	res = ir_export_summary(summary, ir_filename);
+	assert(res == 0);
+	(void)res;
+}
+
+typedef struct selection_t {
+	unsigned n_selected;
+	bool     inc_from_b;
+} selection_t;
+
+static void record_import(const char *ir_filename, ident *ld_name,
+                          void *data)
+{
+	selection_t *selection = (selection_t*)data;
+	printf("select %s from %s\n", get_id_str(ld_name), ir_filename);
+	++selection->n_selected;
+	if (strcmp(get_id_str(ld_name), "inc") == 0
+	 && strcmp(ir_filename, B_IR) == 0)
+		selection->inc_from_b = true;
+}
+
+static unsigned count_frame_types(void)
+{
+	unsigned n = 0;
+	for (size_t i = 0, n_types = get_irp_n_types(); i < n_types; ++i) {
+		if (is_frame_type(get_irp_type(i)))
+			++n;
+	}
+	return n;
+}
+
+int main(void)
+{
+	ir_init();
+
+	build_module_b();
+	export_module(B_IR, B_SUMMARY);
+
+	set_irp(new_ir_prog("a"));
+	ir_entity *inc = build_module_a();
+	export_module(A_IR, A_SUMMARY);
+
+	ir_summary_index *index = ir_new_summary_index();
+	int res = ir_summary_index_add(index, A_SUMMARY);
+	assert(res == 0);
+	res = ir_summary_index_add(index, B_SUMMARY);
+	assert(res == 0);
+
+	/* only the callee of module a is selected */
+	selection_t selection = { 0, false };
+	ir_summary_index_select_imports(index, A_IR, 100, record_import,
+	                                &selection);
+	assert(selection.n_selected == 1);
+	assert(selection.inc_from_b);
+
+	/* nothing is small enough */
+	selection.n_selected = 0;
+	ir_summary_index_select_imports(index, A_IR, 1, record_import,
+	                                &selection);
+	assert(selection.n_selected == 0);
+
+	res = ir_summary_import_callees(index, A_IR, 100);
+	assert(res == 0);
+	ir_free_summary_index(index);
+
+	ir_graph *inc_irg = get_entity_irg(inc);
+	assert(inc_irg != NULL);
+	assert(get_entity_linkage(inc) & IR_LINKAGE_NO_CODEGEN);
+	assert(get_irp_n_irgs() == 2);
+	assert(ir_get_global(new_id_from_str("spill")) == NULL);
+	/* the frame type of spill() was skipped */
+	printf("frame types: %u\n", count_frame_types());
+	assert(count_frame_types() == 2);
+	(void)res;
+	(void)inc_irg;
+
+	remove(A_IR);
+	remove(A_SUMMARY);
+	remove(B_IR);
+	remove(B_SUMMARY);
+
+	ir_finish();
+	return 0;
+}
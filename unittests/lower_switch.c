@@ -0,0 +1,116 @@
+#include "execfreq_t.h"
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* A Switch with sparse cases is lowered to a search tree. The root compare
+ * splits the cases at the point balancing the case frequencies. */
+
+#define N_CASES 5
+
+typedef struct switch_graph_t {
+	ir_graph *irg;
+	ir_node  *block;             /**< the block of the Switch */
+	ir_node  *targets[N_CASES];  /**< the case blocks */
+} switch_graph_t;
+
+/* switch (x) { case 0: return 1; case 100: return 2; ... default: return 0; } */
+static void build_switch(switch_graph_t *graph, const char *name)
+{
+	ir_type *type_Iu = get_type_for_mode(mode_Iu);
+	ir_type *method  = new_type_method(1, 1, false, cc_cdecl_set,
+	                                   mtp_no_property);
+	set_method_param_type(method, 0, type_Iu);
+	set_method_res_type(method, 0, type_Iu);
+	ir_entity *ent = new_global_entity(get_glob_type(), new_id_from_str(name),
+	                                   method, ir_visibility_external,
+	                                   IR_LINKAGE_DEFAULT);
+	ir_graph  *irg = new_ir_graph(ent, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *block = new_immBlock();
+	add_immBlock_pred(block, new_Jmp());
+	mature_immBlock(block);
+	set_cur_block(block);
+
+	ir_node         *sel   = new_Proj(get_irg_args(irg), mode_Iu, 0);
+	ir_switch_table *table = ir_new_switch_table(irg, N_CASES);
+	for (unsigned c = 0; c < N_CASES; ++c) {
+		ir_tarval *val = new_tarval_from_long(c * 100, mode_Iu);
+		ir_switch_table_set(table, c, val, val, c + 1);
+	}
+	ir_node *switchn = new_Switch(sel, N_CASES + 1, table);
+
+	ir_node *end_block = get_irg_end_block(irg);
+	for (unsigned pn = 0; pn <= N_CASES; ++pn) {
+		ir_node *target = new_immBlock();
+		add_immBlock_pred(target, new_Proj(switchn, mode_X, pn));
+		mature_immBlock(target);
+		set_cur_block(target);
+		ir_node *res = new_Const_long(mode_Iu, pn);
+		add_immBlock_pred(end_block, new_Return(get_store(), 1, &res));
+		if (pn > 0)
+			graph->targets[pn - 1] = target;
+	}
+	mature_immBlock(end_block);
+	irg_finalize_cons(irg);
+
+	graph->irg   = irg;
+	graph->block = block;
+}
+
+static void find_cmp(ir_node *node, void *ctx)
+{
+	switch_graph_t *graph = (switch_graph_t*)ctx;
+	if (is_Cmp(node) && get_nodes_block(node) == graph->block) {
+		ir_node **found = (ir_node**)get_irg_link(graph->irg);
+		assert(*found == NULL);
+		*found = node;
+	}
+}
+
+/** Returns the value the root compare of the search tree splits at. */
+static long get_pivot(switch_graph_t *graph)
+{
+	ir_node *cmp = NULL;
+	set_irg_link(graph->irg, &cmp);
+	irg_walk_graph(graph->irg, NULL, find_cmp, graph);
+	assert(cmp != NULL);
+	ir_node *pivot = get_Cmp_right(cmp);
+	assert(is_Const(pivot));
+	/* local optimization turns x < c into x <= c - 1 */
+	long value = get_tarval_long(get_Const_tarval(pivot));
+	if (get_Cmp_relation(cmp) == ir_relation_less_equal)
+		return value + 1;
+	assert(get_Cmp_relation(cmp) == ir_relation_less);
+	return value;
+}
+
+int main(void)
+{
+	ir_init();
+
+	/* without frequencies the estimate weighs all cases the same */
+	switch_graph_t uniform;
+	build_switch(&uniform, "uniform");
+	lower_switch(uniform.irg, 4, 256, mode_Iu);
+	long pivot = get_pivot(&uniform);
+	printf("uniform pivot: %ld\n", pivot);
+	assert(pivot == 200);
+
+	/* a hot last case is split off on its own */
+	switch_graph_t hot;
+	build_switch(&hot, "hot");
+	set_block_execfreq(get_irg_start_block(hot.irg), 1);
+	set_block_execfreq(hot.block, 104);
+	for (unsigned c = 0; c < N_CASES; ++c)
+		set_block_execfreq(hot.targets[c], c == N_CASES - 1 ? 100 : 1);
+	lower_switch(hot.irg, 4, 256, mode_Iu);
+	pivot = get_pivot(&hot);
+	printf("hot pivot: %ld\n", pivot);
+	assert(pivot == 400);
+
+	ir_finish();
+	return 0;
+}
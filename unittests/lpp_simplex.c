@@ -0,0 +1,119 @@
+#include "lpp.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+/* A small knapsack ILP is solved by the built-in simplex solver. Stopping at
+ * a user supplied bound or at the time limit yields a feasible solution,
+ * which is not reported as optimal. */
+
+#define N_VARS 4
+
+/* maximize 5a + 4b + 3c + 2d
+ * s.t.     2a + 3b +  c + 2d <= 5
+ *          4a +  b + 2c + 3d <= 11
+ *          3a + 4b + 2c +  d <= 8
+ * The optimum is a = c = d = 1, b = 0 with value 10. */
+static lpp_t *new_knapsack(int *vars)
+{
+	static const double obj[N_VARS]     = { 5, 4, 3, 2 };
+	static const double rows[3][N_VARS] = {
+		{ 2, 3, 1, 2 },
+		{ 4, 1, 2, 3 },
+		{ 3, 4, 2, 1 },
+	};
+	static const double rhs[3] = { 5, 11, 8 };
+
+	lpp_t *lpp = lpp_new("knapsack", lpp_maximize);
+	for (int v = 0; v < N_VARS; ++v)
+		vars[v] = lpp_add_var(lpp, NULL, lpp_binary, obj[v]);
+	for (int r = 0; r < 3; ++r) {
+		int cst = lpp_add_cst(lpp, NULL, lpp_less_equal, rhs[r]);
+		for (int v = 0; v < N_VARS; ++v)
+			lpp_set_factor_fast(lpp, cst, vars[v], rows[r][v]);
+	}
+	return lpp;
+}
+
+/* a + c is feasible with value 8 */
+static void set_start_values(lpp_t *lpp, const int *vars)
+{
+	lpp_set_start_value(lpp, vars[0], 1);
+	lpp_set_start_value(lpp, vars[1], 0);
+	lpp_set_start_value(lpp, vars[2], 1);
+	lpp_set_start_value(lpp, vars[3], 0);
+}
+
+static void test_optimum(void)
+{
+	int    vars[N_VARS];
+	lpp_t *lpp = new_knapsack(vars);
+	set_start_values(lpp, vars);
+	lpp_solve(lpp, "simplex");
+
+	printf("optimum: state %d, value %g, bound %g\n",
+	       lpp_get_sol_state(lpp), lpp->objval, lpp->best_bound);
+	assert(lpp_get_sol_state(lpp) == lpp_optimal);
+	assert(fabs(lpp->objval - 10) < 1e-6);
+	assert(fabs(lpp->best_bound - 10) < 1e-6);
+	assert(lpp_get_var_sol(lpp, vars[0]) == 1);
+	assert(lpp_get_var_sol(lpp, vars[1]) == 0);
+	assert(lpp_get_var_sol(lpp, vars[2]) == 1);
+	assert(lpp_get_var_sol(lpp, vars[3]) == 1);
+	lpp_free(lpp);
+}
+
+static void test_bound(void)
+{
+	int    vars[N_VARS];
+	lpp_t *lpp = new_knapsack(vars);
+	/* the search stops at the first solution reaching the bound */
+	lpp_set_bound(lpp, 9);
+	lpp_solve(lpp, "simplex");
+
+	printf("bound: state %d, value %g, bound %g\n",
+	       lpp_get_sol_state(lpp), lpp->objval, lpp->best_bound);
+	assert(lpp_get_sol_state(lpp) == lpp_feasible);
+	assert(lpp->objval >= 9 - 1e-6 && lpp->objval < 10 - 1e-6);
+	/* the dual bound comes from the open subtrees */
+	assert(lpp->best_bound >= 10 - 1e-6);
+	assert(isfinite(lpp->best_bound));
+	lpp_free(lpp);
+
+	/* the start solution already reaches the bound */
+	lpp = new_knapsack(vars);
+	set_start_values(lpp, vars);
+	lpp_set_bound(lpp, 8);
+	lpp_solve(lpp, "simplex");
+
+	printf("start bound: state %d, value %g, bound %g\n",
+	       lpp_get_sol_state(lpp), lpp->objval, lpp->best_bound);
+	assert(lpp_get_sol_state(lpp) == lpp_feasible);
+	assert(fabs(lpp->objval - 8) < 1e-6);
+	assert(lpp->best_bound >= 10 - 1e-6);
+	lpp_free(lpp);
+}
+
+static void test_time_limit(void)
+{
+	int    vars[N_VARS];
+	lpp_t *lpp = new_knapsack(vars);
+	set_start_values(lpp, vars);
+	lpp_set_time_limit(lpp, 1e-12);
+	lpp_solve(lpp, "simplex");
+
+	printf("time limit: state %d, value %g, bound %g\n",
+	       lpp_get_sol_state(lpp), lpp->objval, lpp->best_bound);
+	assert(lpp_get_sol_state(lpp) == lpp_feasible);
+	assert(lpp->objval >= 8 - 1e-6);
+	assert(lpp->best_bound >= 10 - 1e-6);
+	lpp_free(lpp);
+}
+
+int main(void)
+{
+	test_optimum();
+	test_bound();
+	test_time_limit();
+	return 0;
+}
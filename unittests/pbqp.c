@@ -0,0 +1,267 @@
+#include "brute_force.h"
+#include "heuristical.h"
+#include "kaps.h"
+#include "matrix.h"
+#include "vector.h"
+#include "xmalloc.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Small random PBQP instances are solved exactly and compared against an
+ * exhaustive search. A larger instance, shaped like the problems of the
+ * PBQP register allocator, is timed as a benchmark of the cost kernels. */
+
+static unsigned random_state = 42;
+
+static unsigned random_next(void)
+{
+	random_state = random_state * 1103515245u + 12345u;
+	return (random_state >> 16) & 0x7fff;
+}
+
+static num random_costs(unsigned inf_percent)
+{
+	if (random_next() % 100 < inf_percent)
+		return INF_COSTS;
+	return random_next() % 16;
+}
+
+typedef struct instance_t {
+	unsigned  n_nodes;
+	unsigned  n_alts;
+	num      *node_costs; /**< n_nodes x n_alts */
+	num      *edge_costs; /**< n_nodes x n_nodes matrices of n_alts x n_alts */
+	bool     *has_edge;   /**< n_nodes x n_nodes, only for src < tgt */
+} instance_t;
+
+static void instance_init(instance_t *inst, unsigned n_nodes, unsigned n_alts,
+                          unsigned edge_percent, unsigned inf_percent)
+{
+	unsigned n_matrix = n_alts * n_alts;
+
+	inst->n_nodes    = n_nodes;
+	inst->n_alts     = n_alts;
+	inst->node_costs = XMALLOCN(num, n_nodes * n_alts);
+	inst->edge_costs = XMALLOCNZ(num, n_nodes * n_nodes * n_matrix);
+	inst->has_edge   = XMALLOCNZ(bool, n_nodes * n_nodes);
+
+	for (unsigned i = 0; i < n_nodes * n_alts; ++i)
+		inst->node_costs[i] = random_costs(0);
+
+	for (unsigned src = 0; src < n_nodes; ++src) {
+		for (unsigned tgt = src + 1; tgt < n_nodes; ++tgt) {
+			if (random_next() % 100 >= edge_percent)
+				continue;
+
+			num *costs = &inst->edge_costs[(src * n_nodes + tgt) * n_matrix];
+			for (unsigned i = 0; i < n_matrix; ++i)
+				costs[i] = random_costs(inf_percent);
+			inst->has_edge[src * n_nodes + tgt] = true;
+		}
+	}
+}
+
+static void instance_free(instance_t *inst)
+{
+	free(inst->node_costs);
+	free(inst->edge_costs);
+	free(inst->has_edge);
+}
+
+static pbqp_t *instance_build(instance_t const *inst)
+{
+	unsigned n_nodes  = inst->n_nodes;
+	unsigned n_alts   = inst->n_alts;
+	unsigned n_matrix = n_alts * n_alts;
+	pbqp_t  *pbqp     = alloc_pbqp(n_nodes);
+
+	for (unsigned node = 0; node < n_nodes; ++node) {
+		vector_t *costs = vector_alloc(pbqp, n_alts);
+		for (unsigned alt = 0; alt < n_alts; ++alt)
+			vector_set(costs, alt, inst->node_costs[node * n_alts + alt]);
+		add_node_costs(pbqp, node, costs);
+	}
+
+	for (unsigned src = 0; src < n_nodes; ++src) {
+		for (unsigned tgt = src + 1; tgt < n_nodes; ++tgt) {
+			if (!inst->has_edge[src * n_nodes + tgt])
+				continue;
+
+			num const     *costs = &inst->edge_costs[(src * n_nodes + tgt) * n_matrix];
+			pbqp_matrix_t *mat   = pbqp_matrix_alloc(pbqp, n_alts, n_alts);
+			for (unsigned row = 0; row < n_alts; ++row) {
+				for (unsigned col = 0; col < n_alts; ++col)
+					pbqp_matrix_set(mat, row, col, costs[row * n_alts + col]);
+			}
+			add_edge_costs(pbqp, src, tgt, mat);
+		}
+	}
+
+	return pbqp;
+}
+
+static num instance_evaluate(instance_t const *inst, unsigned const *selection)
+{
+	unsigned n_nodes  = inst->n_nodes;
+	unsigned n_alts   = inst->n_alts;
+	unsigned n_matrix = n_alts * n_alts;
+	num      sum      = 0;
+
+	for (unsigned node = 0; node < n_nodes; ++node)
+		sum = pbqp_add(sum, inst->node_costs[node * n_alts + selection[node]]);
+
+	for (unsigned src = 0; src < n_nodes; ++src) {
+		for (unsigned tgt = src + 1; tgt < n_nodes; ++tgt) {
+			if (!inst->has_edge[src * n_nodes + tgt])
+				continue;
+
+			num const *costs = &inst->edge_costs[(src * n_nodes + tgt) * n_matrix];
+			sum = pbqp_add(sum, costs[selection[src] * n_alts + selection[tgt]]);
+		}
+	}
+
+	return sum;
+}
+
+static num instance_exhaustive_min(instance_t const *inst)
+{
+	unsigned *selection = XMALLOCNZ(unsigned, inst->n_nodes);
+	num       min       = INF_COSTS;
+
+	for (;;) {
+		num value = instance_evaluate(inst, selection);
+		if (value < min)
+			min = value;
+
+		unsigned node = 0;
+		while (node < inst->n_nodes && ++selection[node] == inst->n_alts)
+			selection[node++] = 0;
+		if (node == inst->n_nodes)
+			break;
+	}
+
+	free(selection);
+	return min;
+}
+
+/** Checks that the solution of @p pbqp has the costs claimed by the solver. */
+static num check_solution(instance_t const *inst, pbqp_t *pbqp)
+{
+	unsigned *selection = XMALLOCN(unsigned, inst->n_nodes);
+	for (unsigned node = 0; node < inst->n_nodes; ++node) {
+		selection[node] = get_node_solution(pbqp, node);
+		assert(selection[node] < inst->n_alts);
+	}
+
+	num value = instance_evaluate(inst, selection);
+	assert(value == get_solution(pbqp));
+	free(selection);
+	return value;
+}
+
+static void test_kernels(void)
+{
+	pbqp_t *pbqp = alloc_pbqp(1);
+
+	assert(pbqp_add(1, 2) == 3);
+	assert(pbqp_add(INF_COSTS, 0) == INF_COSTS);
+	assert(pbqp_add(0, INF_COSTS) == INF_COSTS);
+	assert(pbqp_add(INF_COSTS, INF_COSTS) == INF_COSTS);
+	assert(pbqp_add(7, INF_COSTS) == INF_COSTS);
+
+	/* 3x5 matrix with some infinite entries */
+	pbqp_matrix_t *mat = pbqp_matrix_alloc(pbqp, 3, 5);
+	for (unsigned row = 0; row < 3; ++row) {
+		for (unsigned col = 0; col < 5; ++col)
+			pbqp_matrix_set(mat, row, col, (row + 1) * 10 + col);
+	}
+	pbqp_matrix_set(mat, 1, 2, INF_COSTS);
+
+	vector_t *row_flags = vector_alloc(pbqp, 3);
+	vector_t *col_flags = vector_alloc(pbqp, 5);
+	vector_set(col_flags, 0, INF_COSTS);
+	vector_set(row_flags, 0, INF_COSTS);
+
+	assert(pbqp_matrix_get_row_min(mat, 1, col_flags) == 21);
+	assert(pbqp_matrix_get_row_min_index(mat, 1, col_flags) == 1);
+	assert(pbqp_matrix_get_col_min(mat, 2, row_flags) == 32);
+	assert(pbqp_matrix_get_col_min_index(mat, 2, row_flags) == 2);
+
+	pbqp_matrix_t *transposed = pbqp_matrix_copy_and_transpose(pbqp, mat);
+	assert(transposed->rows == 5 && transposed->cols == 3);
+	assert(pbqp_matrix_get_row_min(transposed, 2, row_flags) == 32);
+
+	pbqp_matrix_sub_row_value(mat, 1, col_flags, 21);
+	assert(mat->entries[1 * 5 + 0] == 0);
+	assert(mat->entries[1 * 5 + 1] == 0);
+	assert(mat->entries[1 * 5 + 2] == INF_COSTS);
+	assert(mat->entries[1 * 5 + 4] == 3);
+
+	pbqp_matrix_sub_col_value(mat, 3, row_flags, 2);
+	assert(mat->entries[0 * 5 + 3] == 0);
+	assert(mat->entries[1 * 5 + 3] == 0);
+	assert(mat->entries[2 * 5 + 3] == 31);
+
+	vector_t *vec = vector_alloc(pbqp, 5);
+	for (unsigned i = 0; i < 5; ++i)
+		vector_set(vec, i, 5 - i);
+	assert(vector_get_min_with_matrix_row(vec, mat, 2) == 33);
+	vector_add_matrix_row(vec, mat, 2);
+	assert(vector_get_min(vec) == 33);
+	assert(vector_get_min_index(vec) == 3);
+
+	free_pbqp(pbqp);
+}
+
+static void test_exact(void)
+{
+	for (unsigned round = 0; round < 200; ++round) {
+		instance_t inst;
+		instance_init(&inst, 2 + round % 6, 2 + round % 3, 60, 10);
+
+		num     expected = instance_exhaustive_min(&inst);
+		pbqp_t *pbqp     = instance_build(&inst);
+		solve_pbqp_brute_force(pbqp);
+		if (expected != INF_COSTS)
+			assert(check_solution(&inst, pbqp) == expected);
+		free_pbqp(pbqp);
+
+		pbqp = instance_build(&inst);
+		solve_pbqp_heuristical(pbqp);
+		if (expected != INF_COSTS)
+			assert(check_solution(&inst, pbqp) >= expected);
+		free_pbqp(pbqp);
+
+		instance_free(&inst);
+	}
+}
+
+static void benchmark(void)
+{
+	instance_t inst;
+	instance_init(&inst, 400, 16, 3, 20);
+
+	clock_t start = clock();
+	pbqp_t *pbqp  = instance_build(&inst);
+	solve_pbqp_heuristical(pbqp);
+	clock_t end   = clock();
+
+	num solution = check_solution(&inst, pbqp);
+	free_pbqp(pbqp);
+	instance_free(&inst);
+
+	printf("pbqp: %u nodes, %u alternatives: costs %u in %.3f msec\n",
+	       inst.n_nodes, inst.n_alts, (unsigned)solution,
+	       (double)(end - start) * 1000.0 / CLOCKS_PER_SEC);
+}
+
+int main(void)
+{
+	test_kernels();
+	test_exact();
+	benchmark();
+	return 0;
+}